@@ -10,6 +10,7 @@
 #include <cstdio>
 #include <cstring>
 #include <iterator> // std::size
+#include <limits>
 #include <string_view>
 
 #include "lock.h"
@@ -38,6 +39,7 @@
 #include <netinet/in.h>
 #include <pthread.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 
 #include <dirent.h>
@@ -161,6 +163,19 @@ void net_buffer_init(NETSOCKET_BUFFER *buffer);
 void net_buffer_reinit(NETSOCKET_BUFFER *buffer);
 void net_buffer_simple(NETSOCKET_BUFFER *buffer, char **buf, int *size);
 
+#ifdef CONF_PLATFORM_LINUX
+// outgoing packets waiting for net_udp_flush, see net_udp_set_send_batching
+typedef struct
+{
+	int num;
+	int socks[VLEN];
+	struct mmsghdr msgs[VLEN];
+	struct iovec iovecs[VLEN];
+	char bufs[VLEN][PACKETSIZE];
+	struct sockaddr_in6 sockaddrs[VLEN];
+} NETSOCKET_SEND_QUEUE;
+#endif
+
 struct NETSOCKET_INTERNAL
 {
 	int type;
@@ -169,6 +184,9 @@ struct NETSOCKET_INTERNAL
 	int web_ipv4sock;
 
 	NETSOCKET_BUFFER buffer;
+#ifdef CONF_PLATFORM_LINUX
+	NETSOCKET_SEND_QUEUE *send_queue;
+#endif
 };
 static NETSOCKET_INTERNAL invalid_socket = {NETTYPE_INVALID, -1, -1, -1};
 
@@ -426,6 +444,48 @@ int io_error(IOHANDLE io)
 	return ferror((FILE *)io);
 }
 
+const void *io_map(IOHANDLE io, unsigned *size)
+{
+	*size = 0;
+#if defined(CONF_FAMILY_WINDOWS)
+	HANDLE File = (HANDLE)_get_osfhandle(_fileno((FILE *)io));
+	LARGE_INTEGER Size;
+	if(File == INVALID_HANDLE_VALUE || !GetFileSizeEx(File, &Size) || Size.QuadPart <= 0 || Size.QuadPart > std::numeric_limits<unsigned>::max())
+		return nullptr;
+	HANDLE Mapping = CreateFileMappingW(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(!Mapping)
+		return nullptr;
+	void *pData = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+	// the view keeps the mapping alive
+	CloseHandle(Mapping);
+	if(!pData)
+		return nullptr;
+	*size = (unsigned)Size.QuadPart;
+	return pData;
+#else
+	const int Fd = fileno((FILE *)io);
+	struct stat Stat;
+	if(Fd < 0 || fstat(Fd, &Stat) != 0 || Stat.st_size <= 0 || (uint64_t)Stat.st_size > std::numeric_limits<unsigned>::max())
+		return nullptr;
+	void *pData = mmap(nullptr, Stat.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+	if(pData == MAP_FAILED)
+		return nullptr;
+	*size = (unsigned)Stat.st_size;
+	return pData;
+#endif
+}
+
+void io_unmap(const void *data, unsigned size)
+{
+	if(!data)
+		return;
+#if defined(CONF_FAMILY_WINDOWS)
+	UnmapViewOfFile(data);
+#else
+	munmap((void *)data, size);
+#endif
+}
+
 unsigned io_write(IOHANDLE io, const void *buffer, unsigned size)
 {
 	return fwrite(buffer, 1, size, (FILE *)io);
@@ -478,6 +538,10 @@ struct ASYNCIO
 	unsigned int read_pos;
 	unsigned int write_pos;
 
+	ASYNCIO_WRITE_FUNC write_func;
+	ASYNCIO_FINISH_FUNC finish_func;
+	void *user;
+
 	int error;
 	unsigned char finish;
 	unsigned char refcount;
@@ -546,6 +610,11 @@ static void aio_thread(void *user)
 		{
 			if(aio->finish != ASYNCIO_RUNNING)
 			{
+				if(aio->finish_func)
+				{
+					aio->finish_func(aio->io, aio->user);
+					aio->error = io_error(aio->io);
+				}
 				if(aio->finish == ASYNCIO_CLOSE)
 				{
 					io_close(aio->io);
@@ -581,7 +650,10 @@ static void aio_thread(void *user)
 		aio->read_pos = (aio->read_pos + buffers.len1 + buffers.len2) % aio->buffer_size;
 		aio->lock.unlock();
 
-		io_write(aio->io, local_buffer, local_buffer_len);
+		if(aio->write_func)
+			aio->write_func(aio->io, local_buffer, local_buffer_len, aio->user);
+		else
+			io_write(aio->io, local_buffer, local_buffer_len);
 		io_flush(aio->io);
 		result_io_error = io_error(aio->io);
 
@@ -591,6 +663,11 @@ static void aio_thread(void *user)
 }
 
 ASYNCIO *aio_new(IOHANDLE io)
+{
+	return aio_new_filtered(io, nullptr, nullptr, nullptr);
+}
+
+ASYNCIO *aio_new_filtered(IOHANDLE io, ASYNCIO_WRITE_FUNC write_func, ASYNCIO_FINISH_FUNC finish_func, void *user)
 {
 	ASYNCIO *aio = new ASYNCIO;
 	if(!aio)
@@ -598,6 +675,9 @@ ASYNCIO *aio_new(IOHANDLE io)
 		return 0;
 	}
 	aio->io = io;
+	aio->write_func = write_func;
+	aio->finish_func = finish_func;
+	aio->user = user;
 	sphore_init(&aio->sphore);
 	aio->thread = 0;
 
@@ -1418,6 +1498,15 @@ static void priv_net_close_socket(int sock)
 
 static int priv_net_close_all_sockets(NETSOCKET sock)
 {
+#ifdef CONF_PLATFORM_LINUX
+	if(sock->send_queue)
+	{
+		net_udp_flush(sock);
+		free(sock->send_queue);
+		sock->send_queue = nullptr;
+	}
+#endif
+
 	/* close down ipv4 */
 	if(sock->ipv4sock >= 0)
 	{
@@ -1622,10 +1711,52 @@ NETSOCKET net_udp_create(NETADDR bindaddr)
 	return sock;
 }
 
+#ifdef CONF_PLATFORM_LINUX
+static int priv_net_udp_queue(NETSOCKET sock, const NETADDR *addr, const void *data, int size)
+{
+	NETSOCKET_SEND_QUEUE *queue = sock->send_queue;
+	if(queue->num == VLEN)
+		net_udp_flush(sock);
+
+	const int i = queue->num++;
+	socklen_t namelen;
+	if(addr->type == NETTYPE_IPV4)
+	{
+		queue->socks[i] = sock->ipv4sock;
+		netaddr_to_sockaddr_in(addr, (struct sockaddr_in *)&queue->sockaddrs[i]);
+		namelen = sizeof(struct sockaddr_in);
+	}
+	else
+	{
+		queue->socks[i] = sock->ipv6sock;
+		netaddr_to_sockaddr_in6(addr, &queue->sockaddrs[i]);
+		namelen = sizeof(struct sockaddr_in6);
+	}
+	mem_copy(queue->bufs[i], data, size);
+	queue->iovecs[i].iov_base = queue->bufs[i];
+	queue->iovecs[i].iov_len = size;
+	mem_zero(&queue->msgs[i], sizeof(queue->msgs[i]));
+	queue->msgs[i].msg_hdr.msg_iov = &queue->iovecs[i];
+	queue->msgs[i].msg_hdr.msg_iovlen = 1;
+	queue->msgs[i].msg_hdr.msg_name = &queue->sockaddrs[i];
+	queue->msgs[i].msg_hdr.msg_namelen = namelen;
+	return size;
+}
+#endif
+
 int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size)
 {
 	int d = -1;
 
+#ifdef CONF_PLATFORM_LINUX
+	// broadcasts, websockets and sends to both protocols don't get queued
+	if(sock->send_queue && size <= PACKETSIZE &&
+		((addr->type == NETTYPE_IPV4 && sock->ipv4sock >= 0) || (addr->type == NETTYPE_IPV6 && sock->ipv6sock >= 0)))
+	{
+		return priv_net_udp_queue(sock, addr, data, size);
+	}
+#endif
+
 	if(addr->type & NETTYPE_IPV4)
 	{
 		if(sock->ipv4sock >= 0)
@@ -1642,6 +1773,7 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 				netaddr_to_sockaddr_in(addr, &sa);
 
 			d = sendto((int)sock->ipv4sock, (const char *)data, size, 0, (struct sockaddr *)&sa, sizeof(sa));
+			network_stats.sent_syscalls++;
 		}
 		else
 			dbg_msg("net", "can't send ipv4 traffic to this socket");
@@ -1680,6 +1812,7 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 				netaddr_to_sockaddr_in6(addr, &sa);
 
 			d = sendto((int)sock->ipv6sock, (const char *)data, size, 0, (struct sockaddr *)&sa, sizeof(sa));
+			network_stats.sent_syscalls++;
 		}
 		else
 			dbg_msg("net", "can't send ipv6 traffic to this socket");
@@ -1705,6 +1838,67 @@ int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size
 	return d;
 }
 
+void net_udp_set_send_batching(NETSOCKET sock, bool batch)
+{
+#ifdef CONF_PLATFORM_LINUX
+	if(batch && !sock->send_queue)
+	{
+		sock->send_queue = (NETSOCKET_SEND_QUEUE *)malloc(sizeof(*sock->send_queue));
+		sock->send_queue->num = 0;
+	}
+	else if(!batch && sock->send_queue)
+	{
+		net_udp_flush(sock);
+		free(sock->send_queue);
+		sock->send_queue = nullptr;
+	}
+#endif
+}
+
+int net_udp_flush(NETSOCKET sock)
+{
+#ifdef CONF_PLATFORM_LINUX
+	NETSOCKET_SEND_QUEUE *queue = sock->send_queue;
+	if(!queue || queue->num == 0)
+		return 0;
+
+	// one sendmmsg per run of packets going out on the same socket
+	int sent = 0;
+	int first = 0;
+	while(first < queue->num)
+	{
+		int last = first + 1;
+		while(last < queue->num && queue->socks[last] == queue->socks[first])
+			last++;
+
+		while(first < last)
+		{
+			const int result = sendmmsg(queue->socks[first], &queue->msgs[first], last - first, 0);
+			network_stats.sent_syscalls++;
+			if(result <= 0)
+			{
+				// like a failed sendto, the packet is lost. skip it so the
+				// rest still gets out
+				first++;
+				continue;
+			}
+			for(int i = first; i < first + result; i++)
+			{
+				network_stats.sent_bytes += queue->iovecs[i].iov_len;
+				network_stats.sent_packets++;
+			}
+			sent += result;
+			first += result;
+		}
+	}
+
+	queue->num = 0;
+	return sent;
+#else
+	return 0;
+#endif
+}
+
 void net_buffer_init(NETSOCKET_BUFFER *buffer)
 {
 #if defined(CONF_PLATFORM_LINUX)
@@ -2500,6 +2694,30 @@ int fs_file_time(const char *name, time_t *created, time_t *modified)
 	return 0;
 }
 
+int fs_file_stat(const char *name, int64_t *size, time_t *modified)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	const std::wstring wide_name = windows_utf8_to_wide(name);
+	if(!GetFileAttributesExW(wide_name.c_str(), GetFileExInfoStandard, &data))
+		return 1;
+
+	*size = ((int64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	*modified = filetime_to_unixtime(&data.ftLastWriteTime);
+#elif defined(CONF_FAMILY_UNIX)
+	struct stat sb;
+	if(stat(name, &sb))
+		return 1;
+
+	*size = sb.st_size;
+	*modified = sb.st_mtime;
+#else
+#error not implemented
+#endif
+
+	return 0;
+}
+
 void swap_endian(void *data, unsigned elem_size, unsigned num)
 {
 	char *src = (char *)data;
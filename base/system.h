@@ -405,6 +405,32 @@ int io_sync(IOHANDLE io);
  */
 int io_error(IOHANDLE io);
 
+/**
+ * Maps the whole file into memory for reading.
+ *
+ * @ingroup File-IO
+ *
+ * @param io Handle to a file opened for reading.
+ * @param size Receives the size of the mapped file.
+ *
+ * @return Pointer to the read-only contents of the file, nullptr on failure or if the file is empty.
+ *
+ * @remark The mapping stays valid after the file has been closed.
+ * @remark The file must not be truncated while it is mapped.
+ * @remark The mapping must be released with @link io_unmap @endlink.
+ */
+const void *io_map(IOHANDLE io, unsigned *size);
+
+/**
+ * Releases a mapping created by @link io_map @endlink.
+ *
+ * @ingroup File-IO
+ *
+ * @param data Pointer returned by @link io_map @endlink.
+ * @param size Size of the mapped file.
+ */
+void io_unmap(const void *data, unsigned size);
+
 /**
  * @ingroup File-IO
  * @return An <IOHANDLE> to the standard input.
@@ -443,6 +469,28 @@ typedef struct ASYNCIO ASYNCIO;
  */
 ASYNCIO *aio_new(IOHANDLE io);
 
+typedef void (*ASYNCIO_WRITE_FUNC)(IOHANDLE io, const void *buffer, unsigned size, void *user);
+typedef void (*ASYNCIO_FINISH_FUNC)(IOHANDLE io, void *user);
+
+/**
+ * Wraps a @link IOHANDLE @endlink for asynchronous writing, passing the
+ * queued data through callbacks instead of writing it directly.
+ *
+ * @ingroup File-IO
+ *
+ * @param io Handle to the file.
+ * @param write_func Called on the writing thread with the queued data, it is
+ *                   responsible for writing it to the file.
+ * @param finish_func Called on the writing thread once all data was handed
+ *                    to write_func and the handle is closed or waited for,
+ *                    before the file is closed. May be null.
+ * @param user Pointer passed to the callbacks.
+ *
+ * @return The handle for asynchronous writing.
+ *
+ */
+ASYNCIO *aio_new_filtered(IOHANDLE io, ASYNCIO_WRITE_FUNC write_func, ASYNCIO_FINISH_FUNC finish_func, void *user);
+
 /**
  * Locks the ASYNCIO structure so it can't be written into by
  * other threads.
@@ -929,6 +977,34 @@ NETSOCKET net_udp_create(NETADDR bindaddr);
  */
 int net_udp_send(NETSOCKET sock, const NETADDR *addr, const void *data, int size);
 
+/**
+ * Queues the packets sent over an UDP socket instead of sending each of
+ * them right away. The queue is sent with as few syscalls as possible by
+ * @link net_udp_flush @endlink or once it is full.
+ *
+ * @ingroup Network-UDP
+ *
+ * @param sock Socket to use.
+ * @param batch Whether to queue packets. Disabling it flushes the queue.
+ *
+ * @remark Only has an effect on Linux, other platforms always send right away.
+ * @remark Broadcasts and websocket packets are never queued.
+ */
+void net_udp_set_send_batching(NETSOCKET sock, bool batch);
+
+/**
+ * Sends the packets queued on an UDP socket.
+ *
+ * @ingroup Network-UDP
+ *
+ * @param sock Socket to use.
+ *
+ * @return The number of packets sent.
+ *
+ * @see net_udp_set_send_batching
+ */
+int net_udp_flush(NETSOCKET sock);
+
 /*
 	Function: net_udp_recv
 		Receives a packet over an UDP socket.
@@ -2052,6 +2128,22 @@ int fs_rename(const char *oldname, const char *newname);
  */
 int fs_file_time(const char *name, time_t *created, time_t *modified);
 
+/**
+ * Gets the size and the modification time of a file.
+ *
+ * @ingroup Filesystem
+ *
+ * @param name Path of a file.
+ * @param size Pointer where the size in bytes will be stored.
+ * @param modified Pointer where the modification time will be stored.
+ *
+ * @return 0 on success, non-zero on failure.
+ *
+ * @remark The strings are treated as zero-terminated strings.
+ * @remark Returned time is in seconds since UNIX Epoch.
+ */
+int fs_file_stat(const char *name, int64_t *size, time_t *modified);
+
 /*
 	Group: Undocumented
 */
@@ -2140,6 +2232,7 @@ typedef struct
 	uint64_t sent_bytes;
 	uint64_t recv_packets;
 	uint64_t recv_bytes;
+	uint64_t sent_syscalls;
 } NETSTATS;
 
 void net_stats(NETSTATS *stats);
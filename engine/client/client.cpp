@@ -78,7 +78,10 @@ CClient::CClient() :
 	m_DemoPlayer(&m_SnapshotDelta, true, [&]() { UpdateDemoIntraTimers(); })
 {
 	for(auto &DemoRecorder : m_aDemoRecorder)
+	{
 		DemoRecorder = CDemoRecorder(&m_SnapshotDelta);
+		DemoRecorder.SetAsyncWriter(&m_DemoWriter);
+	}
 
 	m_RenderFrameTime = 0.0001f;
 	m_LastRenderTime = time_get();
@@ -452,6 +455,7 @@ void CClient::OnEnterGame(bool Dummy)
 	m_aapSnapshots[Dummy][SNAP_CURRENT] = 0;
 	m_aapSnapshots[Dummy][SNAP_PREV] = 0;
 	m_aSnapshotStorage[Dummy].PurgeAll();
+	m_SnapshotReceiver.Reset(Dummy);
 	// Also make gameclient aware that snapshots have been purged
 	GameClient()->InvalidateSnapshot();
 	m_aReceivedSnapshots[Dummy] = 0;
@@ -811,6 +815,7 @@ int CClient::SnapNumItems(int SnapID) const
 void CClient::SnapSetStaticsize(int ItemType, int Size)
 {
 	m_SnapshotDelta.SetStaticsize(ItemType, Size);
+	m_SnapshotReceiver.SetStaticsize(ItemType, Size);
 }
 
 void CClient::DebugRender()
@@ -870,36 +875,38 @@ void CClient::DebugRender()
 
 	// render rates
 	{
+		// snapshots from the server are unpacked by the receiver
+		const CSnapshotDelta *pSnapshotDelta = m_DemoPlayer.IsPlaying() ? &m_SnapshotDelta : m_SnapshotReceiver.SnapshotDelta();
 		int y = 0;
 		str_format(aBuffer, sizeof(aBuffer), "%5s %20s: %8s %8s %8s", "ID", "Name", "Rate", "Updates", "R/U");
 		Graphics()->QuadsText(2, 100 + y * 12, 16, aBuffer);
 		y++;
 		for(int i = 0; i < NUM_NETOBJTYPES; i++)
 		{
-			if(m_SnapshotDelta.GetDataRate(i))
+			if(pSnapshotDelta->GetDataRate(i))
 			{
-				str_format(aBuffer, sizeof(aBuffer), "%5d %20s: %8d %8d %8d", i, GameClient()->GetItemName(i), m_SnapshotDelta.GetDataRate(i) / 8, m_SnapshotDelta.GetDataUpdates(i),
-					(m_SnapshotDelta.GetDataRate(i) / m_SnapshotDelta.GetDataUpdates(i)) / 8);
+				str_format(aBuffer, sizeof(aBuffer), "%5d %20s: %8d %8d %8d", i, GameClient()->GetItemName(i), pSnapshotDelta->GetDataRate(i) / 8, pSnapshotDelta->GetDataUpdates(i),
+					(pSnapshotDelta->GetDataRate(i) / pSnapshotDelta->GetDataUpdates(i)) / 8);
 				Graphics()->QuadsText(2, 100 + y * 12, 16, aBuffer);
 				y++;
 			}
 		}
 		for(int i = CSnapshot::MAX_TYPE; i > (CSnapshot::MAX_TYPE - 64); i--)
 		{
-			if(m_SnapshotDelta.GetDataRate(i) && m_aapSnapshots[g_Config.m_ClDummy][IClient::SNAP_CURRENT])
+			if(pSnapshotDelta->GetDataRate(i) && m_aapSnapshots[g_Config.m_ClDummy][IClient::SNAP_CURRENT])
 			{
 				int Type = m_aapSnapshots[g_Config.m_ClDummy][IClient::SNAP_CURRENT]->m_pAltSnap->GetExternalItemType(i);
 				if(Type == UUID_INVALID)
 				{
-					str_format(aBuffer, sizeof(aBuffer), "%5d %20s: %8d %8d %8d", i, "Unknown UUID", m_SnapshotDelta.GetDataRate(i) / 8, m_SnapshotDelta.GetDataUpdates(i),
-						(m_SnapshotDelta.GetDataRate(i) / m_SnapshotDelta.GetDataUpdates(i)) / 8);
+					str_format(aBuffer, sizeof(aBuffer), "%5d %20s: %8d %8d %8d", i, "Unknown UUID", pSnapshotDelta->GetDataRate(i) / 8, pSnapshotDelta->GetDataUpdates(i),
+						(pSnapshotDelta->GetDataRate(i) / pSnapshotDelta->GetDataUpdates(i)) / 8);
 					Graphics()->QuadsText(2, 100 + y * 12, 16, aBuffer);
 					y++;
 				}
 				else if(Type != i)
 				{
-					str_format(aBuffer, sizeof(aBuffer), "%5d %20s: %8d %8d %8d", Type, GameClient()->GetItemName(Type), m_SnapshotDelta.GetDataRate(i) / 8, m_SnapshotDelta.GetDataUpdates(i),
-						(m_SnapshotDelta.GetDataRate(i) / m_SnapshotDelta.GetDataUpdates(i)) / 8);
+					str_format(aBuffer, sizeof(aBuffer), "%5d %20s: %8d %8d %8d", Type, GameClient()->GetItemName(Type), pSnapshotDelta->GetDataRate(i) / 8, pSnapshotDelta->GetDataUpdates(i),
+						(pSnapshotDelta->GetDataRate(i) / pSnapshotDelta->GetDataUpdates(i)) / 8);
 					Graphics()->QuadsText(2, 100 + y * 12, 16, aBuffer);
 					y++;
 				}
@@ -1116,14 +1123,30 @@ const char *CClient::LoadMapSearch(const char *pMapName, SHA256_DIGEST *pWantedS
 			return nullptr;
 	}
 
-	// search for the map within subfolders
+	if(pWantedSha256)
+	{
+		// look the map up by its hash, it might be in a subfolder or have another name
+		if(Storage()->FindMap(*pWantedSha256, aBuf, sizeof(aBuf)))
+		{
+			pError = LoadMap(pMapName, aBuf, pWantedSha256, WantedCrc);
+			if(!pError)
+				return nullptr;
+		}
+	}
+
+	// search for the map within subfolders, the index does not know about
+	// maps that were copied there while the client is running
 	char aFilename[IO_MAX_PATH_LENGTH];
 	str_format(aFilename, sizeof(aFilename), "%s.map", pMapName);
 	if(Storage()->FindFile(aFilename, "maps", IStorage::TYPE_ALL, aBuf, sizeof(aBuf)))
 	{
 		pError = LoadMap(pMapName, aBuf, pWantedSha256, WantedCrc);
 		if(!pError)
+		{
+			if(pWantedSha256)
+				Storage()->AddMapToIndex(aBuf, *pWantedSha256);
 			return nullptr;
+		}
 	}
 
 	static char s_aErrorMsg[256];
@@ -1392,7 +1415,7 @@ static CServerCapabilities GetServerCapabilities(int Version, int Flags)
 	return Result;
 }
 
-void CClient::ProcessServerPacket(CNetChunk *pPacket, int Conn, bool Dummy)
+void CClient::ProcessServerPacket(CNetChunk *pPacket, int Conn, bool Dummy, int64_t RecvTime)
 {
 	CUnpacker Unpacker;
 	Unpacker.Reset(pPacket->m_pData, pPacket->m_DataSize);
@@ -1782,291 +1805,293 @@ void CClient::ProcessServerPacket(CNetChunk *pPacket, int Conn, bool Dummy)
 				if((NumParts < CSnapshot::MAX_PARTS && m_aSnapshotParts[Conn] == (((uint64_t)(1) << NumParts) - 1)) ||
 					(NumParts == CSnapshot::MAX_PARTS && m_aSnapshotParts[Conn] == std::numeric_limits<uint64_t>::max()))
 				{
-					unsigned char aTmpBuffer2[CSnapshot::MAX_SIZE];
-					unsigned char aTmpBuffer3[CSnapshot::MAX_SIZE];
-					CSnapshot *pTmpBuffer3 = (CSnapshot *)aTmpBuffer3; // Fix compiler warning for strict-aliasing
-
 					// reset snapshoting
 					m_aSnapshotParts[Conn] = 0;
 
-					// find snapshot that we should use as delta
-					const CSnapshot *pDeltaShot = CSnapshot::EmptySnapshot();
-					if(DeltaTick >= 0)
+					// decompression and unpacking happen on the snapshot receiver,
+					// the results are handled in ProcessSnapshot
+					if(!m_SnapshotReceiver.PushSnapshot(Conn, GameTick, DeltaTick, Crc, Msg == NETMSG_SNAPEMPTY, RecvTime, m_aaSnapshotIncomingData[Conn], m_aSnapshotIncomingDataSize[Conn]) && g_Config.m_Debug)
 					{
-						int DeltashotSize = m_aSnapshotStorage[Conn].Get(DeltaTick, 0, &pDeltaShot, 0);
-
-						if(DeltashotSize < 0)
-						{
-							// couldn't find the delta snapshots that the server used
-							// to compress this snapshot. force the server to resync
-							if(g_Config.m_Debug)
-							{
-								m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "client", "error, couldn't find the delta snapshot");
-							}
-
-							// ack snapshot
-							m_aAckGameTick[Conn] = -1;
-							SendInput();
-							return;
-						}
-					}
-
-					// decompress snapshot
-					const void *pDeltaData = m_SnapshotDelta.EmptyDelta();
-					int DeltaSize = sizeof(int) * 3;
-
-					if(m_aSnapshotIncomingDataSize[Conn])
-					{
-						int IntSize = CVariableInt::Decompress(m_aaSnapshotIncomingData[Conn], m_aSnapshotIncomingDataSize[Conn], aTmpBuffer2, sizeof(aTmpBuffer2));
-
-						if(IntSize < 0) // failure during decompression
-							return;
-
-						pDeltaData = aTmpBuffer2;
-						DeltaSize = IntSize;
+						m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "client", "error, snapshot receiver queue full");
 					}
+				}
+			}
+		}
+		else if(Conn == CONN_MAIN && Msg == NETMSG_RCONTYPE)
+		{
+			bool UsernameReq = Unpacker.GetInt() & 1;
+			GameClient()->OnRconType(UsernameReq);
+		}
+	}
+	else
+	{
+		if((pPacket->m_Flags & NET_CHUNKFLAG_VITAL) != 0)
+		{
+			// game message
+			bool Recording = false;
+			for(auto &DemoRecorder : m_aDemoRecorder)
+				Recording |= DemoRecorder.IsRecording();
+			if(!Dummy && Recording)
+			{
+				// snapshots still in the receiver are recorded before this message
+				if(!m_SnapshotReceiver.PushMessage(Conn, pPacket->m_pData, pPacket->m_DataSize))
+				{
+					for(auto &DemoRecorder : m_aDemoRecorder)
+						if(DemoRecorder.IsRecording())
+							DemoRecorder.RecordMessage(pPacket->m_pData, pPacket->m_DataSize);
+				}
+			}
 
-					// unpack delta
-					const int SnapSize = m_SnapshotDelta.UnpackDelta(pDeltaShot, pTmpBuffer3, pDeltaData, DeltaSize);
-					if(SnapSize < 0)
-					{
-						dbg_msg("client", "delta unpack failed. error=%d", SnapSize);
-						return;
-					}
-					if(!pTmpBuffer3->IsValid(SnapSize))
-					{
-						dbg_msg("client", "snapshot invalid. SnapSize=%d, DeltaSize=%d", SnapSize, DeltaSize);
-						return;
-					}
+			GameClient()->OnMessage(Msg, &Unpacker, Conn, Dummy);
+		}
+	}
+}
 
-					if(Msg != NETMSG_SNAPEMPTY && pTmpBuffer3->Crc() != Crc)
-					{
-						if(g_Config.m_Debug)
-						{
-							char aBuf[256];
-							str_format(aBuf, sizeof(aBuf), "snapshot crc error #%d - tick=%d wantedcrc=%d gotcrc=%d compressed_size=%d delta_tick=%d",
-								m_SnapCrcErrors, GameTick, Crc, pTmpBuffer3->Crc(), m_aSnapshotIncomingDataSize[Conn], DeltaTick);
-							m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "client", aBuf);
-						}
+void CClient::ProcessSnapshot(const CSnapshotReceiver::CResult *pResult)
+{
+	const int Conn = pResult->m_Conn;
+	const bool Dummy = g_Config.m_ClDummy ^ Conn;
+	int GameTick = pResult->m_GameTick;
 
-						m_SnapCrcErrors++;
-						if(m_SnapCrcErrors > 10)
-						{
-							// to many errors, send reset
-							m_aAckGameTick[Conn] = -1;
-							SendInput();
-							m_SnapCrcErrors = 0;
-						}
-						return;
-					}
-					else
-					{
-						if(m_SnapCrcErrors)
-							m_SnapCrcErrors--;
-					}
+	// we are not allowed to process snapshot yet
+	if(State() < IClient::STATE_LOADING)
+		return;
 
-					// purge old snapshots
-					int PurgeTick = DeltaTick;
-					if(m_aapSnapshots[Conn][SNAP_PREV] && m_aapSnapshots[Conn][SNAP_PREV]->m_Tick < PurgeTick)
-						PurgeTick = m_aapSnapshots[Conn][SNAP_PREV]->m_Tick;
-					if(m_aapSnapshots[Conn][SNAP_CURRENT] && m_aapSnapshots[Conn][SNAP_CURRENT]->m_Tick < PurgeTick)
-						PurgeTick = m_aapSnapshots[Conn][SNAP_CURRENT]->m_Tick;
-					m_aSnapshotStorage[Conn].PurgeUntil(PurgeTick);
-
-					// create a verified and unpacked snapshot
-					unsigned char aAltSnapBuffer[CSnapshot::MAX_SIZE];
-					CSnapshot *pAltSnapBuffer = (CSnapshot *)aAltSnapBuffer;
-					const int AltSnapSize = UnpackAndValidateSnapshot(pTmpBuffer3, pAltSnapBuffer);
-					if(AltSnapSize < 0)
-					{
-						dbg_msg("client", "unpack snapshot and validate failed. error=%d", AltSnapSize);
-						return;
-					}
+	if(pResult->m_Type == CSnapshotReceiver::RESULT_MISSING_DELTA)
+	{
+		// couldn't find the delta snapshots that the server used
+		// to compress this snapshot. force the server to resync
+		if(g_Config.m_Debug)
+		{
+			m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "client", "error, couldn't find the delta snapshot");
+		}
 
-					// add new
-					m_aSnapshotStorage[Conn].Add(GameTick, time_get(), SnapSize, pTmpBuffer3, AltSnapSize, pAltSnapBuffer);
+		// ack snapshot
+		m_aAckGameTick[Conn] = -1;
+		SendInput();
+		return;
+	}
 
-					if(!Dummy)
-					{
-						// for antiping: if the projectile netobjects from the server contains extra data, this is removed and the original content restored before recording demo
-						unsigned char aExtraInfoRemoved[CSnapshot::MAX_SIZE];
-						mem_copy(aExtraInfoRemoved, pTmpBuffer3, SnapSize);
-						SnapshotRemoveExtraProjectileInfo(aExtraInfoRemoved);
+	if(pResult->m_Type == CSnapshotReceiver::RESULT_CRC_ERROR)
+	{
+		if(g_Config.m_Debug)
+		{
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "snapshot crc error #%d - tick=%d wantedcrc=%d gotcrc=%d compressed_size=%d delta_tick=%d",
+				m_SnapCrcErrors, GameTick, pResult->m_Crc, pResult->m_GotCrc, pResult->m_DataSize, pResult->m_DeltaTick);
+			m_pConsole->Print(IConsole::OUTPUT_LEVEL_DEBUG, "client", aBuf);
+		}
 
-						// add snapshot to demo
-						for(auto &DemoRecorder : m_aDemoRecorder)
-						{
-							if(DemoRecorder.IsRecording())
-							{
-								// write snapshot
-								DemoRecorder.RecordSnapshot(GameTick, aExtraInfoRemoved, SnapSize);
-							}
-						}
-					}
+		m_SnapCrcErrors++;
+		if(m_SnapCrcErrors > 10)
+		{
+			// to many errors, send reset
+			m_aAckGameTick[Conn] = -1;
+			SendInput();
+			m_SnapCrcErrors = 0;
+		}
+		return;
+	}
 
-					// apply snapshot, cycle pointers
-					m_aReceivedSnapshots[Conn]++;
+	if(m_SnapCrcErrors)
+		m_SnapCrcErrors--;
 
-					// we got two snapshots until we see us self as connected
-					if(m_aReceivedSnapshots[Conn] == 2)
-					{
-						// start at 200ms and work from there
-						if(!Dummy)
-						{
-							m_PredictedTime.Init(GameTick * time_freq() / 50);
-							m_PredictedTime.SetAdjustSpeed(CSmoothTime::ADJUSTDIRECTION_UP, 1000.0f);
-							m_PredictedTime.UpdateMargin(PredictionMargin() * time_freq() / 1000);
-						}
-						m_aGameTime[Conn].Init((GameTick - 1) * time_freq() / 50);
-						m_aapSnapshots[Conn][SNAP_PREV] = m_aSnapshotStorage[Conn].m_pFirst;
-						m_aapSnapshots[Conn][SNAP_CURRENT] = m_aSnapshotStorage[Conn].m_pLast;
-						if(!Dummy)
-						{
-							m_LocalStartTime = time_get();
-#if defined(CONF_VIDEORECORDER)
-							IVideo::SetLocalStartTime(m_LocalStartTime);
-#endif
-							GameClient()->OnNewSnapshot();
-						}
-						SetState(IClient::STATE_ONLINE);
-						if(!Dummy)
-						{
-							DemoRecorder_HandleAutoStart();
-						}
-					}
+	// purge old snapshots
+	int PurgeTick = pResult->m_DeltaTick;
+	if(m_aapSnapshots[Conn][SNAP_PREV] && m_aapSnapshots[Conn][SNAP_PREV]->m_Tick < PurgeTick)
+		PurgeTick = m_aapSnapshots[Conn][SNAP_PREV]->m_Tick;
+	if(m_aapSnapshots[Conn][SNAP_CURRENT] && m_aapSnapshots[Conn][SNAP_CURRENT]->m_Tick < PurgeTick)
+		PurgeTick = m_aapSnapshots[Conn][SNAP_CURRENT]->m_Tick;
+	m_aSnapshotStorage[Conn].PurgeUntil(PurgeTick);
 
-					// adjust game time
-					if(m_aReceivedSnapshots[Conn] > 2)
-					{
-						int64_t Now = m_aGameTime[Conn].Get(time_get());
-						int64_t TickStart = GameTick * time_freq() / 50;
-						int64_t TimeLeft = (TickStart - Now) * 1000 / time_freq();
-						m_aGameTime[Conn].Update(&m_GametimeMarginGraph, (GameTick - 1) * time_freq() / 50, TimeLeft, CSmoothTime::ADJUSTDIRECTION_DOWN);
-					}
-					if(g_Config.m_ClRunOnJoinConsole && m_aReceivedSnapshots[Conn] > g_Config.m_ClRunOnJoinDelay && !m_CodeRunAfterJoinConsole[Conn])
-					{
-						m_pConsole->ExecuteLine(g_Config.m_ClRunOnJoin);
-						m_CodeRunAfterJoinConsole[Conn] = true;
-					}
+	// add new
+	m_aSnapshotStorage[Conn].Add(GameTick, pResult->m_RecvTime, pResult->m_SnapSize, pResult->Snap(), pResult->m_AltSnapSize, pResult->AltSnap());
 
-					if(m_aReceivedSnapshots[Conn] > 50 && !m_CodeRunAfterJoin[Conn])
-					{
-						if(m_ServerCapabilities.m_ChatTimeoutCode)
-						{
-							CNetMsg_Cl_Say TOMsgp;
-							TOMsgp.m_Team = 0;
-							char aBufTO[256];
-							str_format(aBufTO, sizeof(aBufTO), "/timeout %s", m_aTimeoutCodes[Conn]);
-							TOMsgp.m_pMessage = aBufTO;
-							CMsgPacker PackerTO(TOMsgp.ms_MsgID, false);
-							TOMsgp.Pack(&PackerTO);
-							SendMsg(Conn, &PackerTO, MSGFLAG_VITAL);
-
-							CNetMsg_Cl_Say MsgP;
-							MsgP.m_Team = 0;
-							char aBuf[128];
-							char aBufMsg[256];
-							//if(!g_Config.m_ClRunOnJoin[0] && !g_Config.m_ClDummyDefaultEyes && !g_Config.m_ClPlayerDefaultEyes)
-							//	str_format(aBufMsg, sizeof(aBufMsg), "/timeout %s", m_aTimeoutCodes[Conn]);
-							//else
-							//	str_format(aBufMsg, sizeof(aBufMsg), "/mc;timeout %s", m_aTimeoutCodes[Conn]);
-							str_format(aBufMsg, sizeof(aBufMsg), "/mc");
-
-							if(g_Config.m_ClRunOnJoin[0] && !g_Config.m_ClRunOnJoinConsole)
-							{
-								str_format(aBuf, sizeof(aBuf), ";%s", g_Config.m_ClRunOnJoin);
-								str_append(aBufMsg, aBuf);
-							}
-							if(g_Config.m_ClDummyDefaultEyes || g_Config.m_ClPlayerDefaultEyes)
-							{
-								int Emote = ((g_Config.m_ClDummy) ? !Dummy : Dummy) ? g_Config.m_ClDummyDefaultEyes : g_Config.m_ClPlayerDefaultEyes;
-								char aBufEmote[128];
-								aBufEmote[0] = '\0';
-								switch(Emote)
-								{
-								case EMOTE_NORMAL:
-									break;
-								case EMOTE_PAIN:
-									str_format(aBufEmote, sizeof(aBufEmote), "emote pain %d", g_Config.m_ClEyeDuration);
-									break;
-								case EMOTE_HAPPY:
-									str_format(aBufEmote, sizeof(aBufEmote), "emote happy %d", g_Config.m_ClEyeDuration);
-									break;
-								case EMOTE_SURPRISE:
-									str_format(aBufEmote, sizeof(aBufEmote), "emote surprise %d", g_Config.m_ClEyeDuration);
-									break;
-								case EMOTE_ANGRY:
-									str_format(aBufEmote, sizeof(aBufEmote), "emote angry %d", g_Config.m_ClEyeDuration);
-									break;
-								case EMOTE_BLINK:
-									str_format(aBufEmote, sizeof(aBufEmote), "emote blink %d", g_Config.m_ClEyeDuration);
-									break;
-								}
-								if(aBufEmote[0])
-								{
-									str_format(aBuf, sizeof(aBuf), ";%s", aBufEmote);
-									str_append(aBufMsg, aBuf);
-								}
-							}
-							MsgP.m_pMessage = aBufMsg;
-							CMsgPacker PackerTimeout(&MsgP);
-							MsgP.Pack(&PackerTimeout);
-							if(g_Config.m_ClRunOnJoin[0] || g_Config.m_ClDummyDefaultEyes || g_Config.m_ClPlayerDefaultEyes)
-								SendMsg(Conn, &PackerTimeout, MSGFLAG_VITAL);
-						}
-						m_CodeRunAfterJoin[Conn] = true;
-					}
+	if(!Dummy)
+	{
+		// for antiping: if the projectile netobjects from the server contains extra data, this is removed and the original content restored before recording demo
+		unsigned char aExtraInfoRemoved[CSnapshot::MAX_SIZE];
+		mem_copy(aExtraInfoRemoved, pResult->Snap(), pResult->m_SnapSize);
+		SnapshotRemoveExtraProjectileInfo(aExtraInfoRemoved);
 
-					// TClientPlus feature - Fake Ping
-					if(g_Config.m_ClPlusFakePingEnabled) {
-						GameTick -= g_Config.m_ClPlusFakePing * 2/40;
-					} else if(g_Config.m_ClPlusFakePingEnabled1) {
-						GameTick += g_Config.m_ClPlusFakePing * 2/40;
-					}
+		// add snapshot to demo
+		for(auto &DemoRecorder : m_aDemoRecorder)
+		{
+			if(DemoRecorder.IsRecording())
+			{
+				// write snapshot
+				DemoRecorder.RecordSnapshot(GameTick, aExtraInfoRemoved, pResult->m_SnapSize);
+			}
+		}
+	}
 
-					if(g_Config.m_ClPlusFakePingEnabled || g_Config.m_ClPlusFakePingEnabled1)
-					{
-						GameTick += GameTick % 2;
-					}
+	// the snapshot may have waited for the receiver, the game time is
+	// adjusted as of when it arrived
+	const int64_t Delay = time_get() - pResult->m_RecvTime;
 
-					if(g_Config.m_ClPlusFreezePing) {
-						GameTick++;
-					}
+	// apply snapshot, cycle pointers
+	m_aReceivedSnapshots[Conn]++;
 
-					// ack snapshot
-					m_aAckGameTick[Conn] = GameTick;
-				}
-			}
+	// we got two snapshots until we see us self as connected
+	if(m_aReceivedSnapshots[Conn] == 2)
+	{
+		// start at 200ms and work from there
+		if(!Dummy)
+		{
+			m_PredictedTime.Init(GameTick * time_freq() / 50 + Delay);
+			m_PredictedTime.SetAdjustSpeed(CSmoothTime::ADJUSTDIRECTION_UP, 1000.0f);
+			m_PredictedTime.UpdateMargin(PredictionMargin() * time_freq() / 1000);
 		}
-		else if(Conn == CONN_MAIN && Msg == NETMSG_RCONTYPE)
+		m_aGameTime[Conn].Init((GameTick - 1) * time_freq() / 50 + Delay);
+		m_aapSnapshots[Conn][SNAP_PREV] = m_aSnapshotStorage[Conn].m_pFirst;
+		m_aapSnapshots[Conn][SNAP_CURRENT] = m_aSnapshotStorage[Conn].m_pLast;
+		if(!Dummy)
 		{
-			bool UsernameReq = Unpacker.GetInt() & 1;
-			GameClient()->OnRconType(UsernameReq);
+			m_LocalStartTime = time_get();
+#if defined(CONF_VIDEORECORDER)
+			IVideo::SetLocalStartTime(m_LocalStartTime);
+#endif
+			GameClient()->OnNewSnapshot();
+		}
+		SetState(IClient::STATE_ONLINE);
+		if(!Dummy)
+		{
+			DemoRecorder_HandleAutoStart();
 		}
 	}
-	else
+
+	// adjust game time
+	if(m_aReceivedSnapshots[Conn] > 2)
 	{
-		if((pPacket->m_Flags & NET_CHUNKFLAG_VITAL) != 0)
+		int64_t Now = m_aGameTime[Conn].Get(time_get());
+		int64_t TickStart = GameTick * time_freq() / 50 + Delay;
+		int64_t TimeLeft = (TickStart - Now) * 1000 / time_freq();
+		m_aGameTime[Conn].Update(&m_GametimeMarginGraph, (GameTick - 1) * time_freq() / 50 + Delay, TimeLeft, CSmoothTime::ADJUSTDIRECTION_DOWN);
+	}
+	if(g_Config.m_ClRunOnJoinConsole && m_aReceivedSnapshots[Conn] > g_Config.m_ClRunOnJoinDelay && !m_CodeRunAfterJoinConsole[Conn])
+	{
+		m_pConsole->ExecuteLine(g_Config.m_ClRunOnJoin);
+		m_CodeRunAfterJoinConsole[Conn] = true;
+	}
+
+	if(m_aReceivedSnapshots[Conn] > 50 && !m_CodeRunAfterJoin[Conn])
+	{
+		if(m_ServerCapabilities.m_ChatTimeoutCode)
 		{
-			// game message
-			if(!Dummy)
+			CNetMsg_Cl_Say TOMsgp;
+			TOMsgp.m_Team = 0;
+			char aBufTO[256];
+			str_format(aBufTO, sizeof(aBufTO), "/timeout %s", m_aTimeoutCodes[Conn]);
+			TOMsgp.m_pMessage = aBufTO;
+			CMsgPacker PackerTO(TOMsgp.ms_MsgID, false);
+			TOMsgp.Pack(&PackerTO);
+			SendMsg(Conn, &PackerTO, MSGFLAG_VITAL);
+
+			CNetMsg_Cl_Say MsgP;
+			MsgP.m_Team = 0;
+			char aBuf[128];
+			char aBufMsg[256];
+			//if(!g_Config.m_ClRunOnJoin[0] && !g_Config.m_ClDummyDefaultEyes && !g_Config.m_ClPlayerDefaultEyes)
+			//	str_format(aBufMsg, sizeof(aBufMsg), "/timeout %s", m_aTimeoutCodes[Conn]);
+			//else
+			//	str_format(aBufMsg, sizeof(aBufMsg), "/mc;timeout %s", m_aTimeoutCodes[Conn]);
+			str_format(aBufMsg, sizeof(aBufMsg), "/mc");
+
+			if(g_Config.m_ClRunOnJoin[0] && !g_Config.m_ClRunOnJoinConsole)
 			{
-				for(auto &DemoRecorder : m_aDemoRecorder)
-					if(DemoRecorder.IsRecording())
-						DemoRecorder.RecordMessage(pPacket->m_pData, pPacket->m_DataSize);
+				str_format(aBuf, sizeof(aBuf), ";%s", g_Config.m_ClRunOnJoin);
+				str_append(aBufMsg, aBuf);
 			}
+			if(g_Config.m_ClDummyDefaultEyes || g_Config.m_ClPlayerDefaultEyes)
+			{
+				int Emote = ((g_Config.m_ClDummy) ? !Dummy : Dummy) ? g_Config.m_ClDummyDefaultEyes : g_Config.m_ClPlayerDefaultEyes;
+				char aBufEmote[128];
+				aBufEmote[0] = '\0';
+				switch(Emote)
+				{
+				case EMOTE_NORMAL:
+					break;
+				case EMOTE_PAIN:
+					str_format(aBufEmote, sizeof(aBufEmote), "emote pain %d", g_Config.m_ClEyeDuration);
+					break;
+				case EMOTE_HAPPY:
+					str_format(aBufEmote, sizeof(aBufEmote), "emote happy %d", g_Config.m_ClEyeDuration);
+					break;
+				case EMOTE_SURPRISE:
+					str_format(aBufEmote, sizeof(aBufEmote), "emote surprise %d", g_Config.m_ClEyeDuration);
+					break;
+				case EMOTE_ANGRY:
+					str_format(aBufEmote, sizeof(aBufEmote), "emote angry %d", g_Config.m_ClEyeDuration);
+					break;
+				case EMOTE_BLINK:
+					str_format(aBufEmote, sizeof(aBufEmote), "emote blink %d", g_Config.m_ClEyeDuration);
+					break;
+				}
+				if(aBufEmote[0])
+				{
+					str_format(aBuf, sizeof(aBuf), ";%s", aBufEmote);
+					str_append(aBufMsg, aBuf);
+				}
+			}
+			MsgP.m_pMessage = aBufMsg;
+			CMsgPacker PackerTimeout(&MsgP);
+			MsgP.Pack(&PackerTimeout);
+			if(g_Config.m_ClRunOnJoin[0] || g_Config.m_ClDummyDefaultEyes || g_Config.m_ClPlayerDefaultEyes)
+				SendMsg(Conn, &PackerTimeout, MSGFLAG_VITAL);
+		}
+		m_CodeRunAfterJoin[Conn] = true;
+	}
 
-			GameClient()->OnMessage(Msg, &Unpacker, Conn, Dummy);
+	// TClientPlus feature - Fake Ping
+	if(g_Config.m_ClPlusFakePingEnabled) {
+		GameTick -= g_Config.m_ClPlusFakePing * 2/40;
+	} else if(g_Config.m_ClPlusFakePingEnabled1) {
+		GameTick += g_Config.m_ClPlusFakePing * 2/40;
+	}
+
+	if(g_Config.m_ClPlusFakePingEnabled || g_Config.m_ClPlusFakePingEnabled1)
+	{
+		GameTick += GameTick % 2;
+	}
+
+	if(g_Config.m_ClPlusFreezePing) {
+		GameTick++;
+	}
+
+	// ack snapshot
+	m_aAckGameTick[Conn] = GameTick;
+}
+
+void CClient::ProcessSnapshotResults()
+{
+	const CSnapshotReceiver::CResult *pResult;
+	while((pResult = m_SnapshotReceiver.Peek()))
+	{
+		if(pResult->m_Type == CSnapshotReceiver::RESULT_MESSAGE)
+		{
+			// game messages are recorded in order with the snapshots
+			for(auto &DemoRecorder : m_aDemoRecorder)
+				if(DemoRecorder.IsRecording())
+					DemoRecorder.RecordMessage(pResult->Message(), pResult->m_DataSize);
+		}
+		else
+		{
+			ProcessSnapshot(pResult);
 		}
+		m_SnapshotReceiver.Pop();
 	}
 }
 
 int CClient::UnpackAndValidateSnapshot(CSnapshot *pFrom, CSnapshot *pTo)
+{
+	return UnpackAndValidateSnapshot(GameClient()->GetNetObjHandler(), pFrom, pTo);
+}
+
+int CClient::UnpackAndValidateSnapshot(CNetObjHandler *pNetObjHandler, const CSnapshot *pFrom, CSnapshot *pTo)
 {
 	CUnpacker Unpacker;
 	CSnapshotBuilder Builder;
 	Builder.Init();
-	CNetObjHandler *pNetObjHandler = GameClient()->GetNetObjHandler();
 
 	int Num = pFrom->NumItems();
 	for(int Index = 0; Index < Num; Index++)
@@ -2082,9 +2107,7 @@ int CClient::UnpackAndValidateSnapshot(CSnapshot *pFrom, CSnapshot *pTo)
 		{
 			if(g_Config.m_Debug && ItemType != UUID_UNKNOWN)
 			{
-				char aBuf[256];
-				str_format(aBuf, sizeof(aBuf), "dropped weird object '%s' (%d), failed on '%s'", pNetObjHandler->GetObjName(ItemType), ItemType, pNetObjHandler->FailedObjOn());
-				m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "client", aBuf);
+				dbg_msg("client", "dropped weird object '%s' (%d), failed on '%s'", pNetObjHandler->GetObjName(ItemType), ItemType, pNetObjHandler->FailedObjOn());
 			}
 			continue;
 		}
@@ -2136,6 +2159,7 @@ void CClient::FinishMapDownload()
 	const char *pError = LoadMap(m_aMapdownloadName, m_aMapdownloadFilename, pSha256, m_MapdownloadCrc);
 	if(!pError)
 	{
+		Storage()->AddMapToIndex(m_aMapdownloadFilename, m_pMap->Sha256());
 		ResetMapDownload();
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "client/network", "loading done");
 		SendReady(CONN_MAIN);
@@ -2381,6 +2405,7 @@ void CClient::PumpNetwork()
 	{
 		while(m_aNetClient[i].Recv(&Packet))
 		{
+			const int64_t RecvTime = time_get();
 			if(Packet.m_ClientID == -1)
 			{
 				ProcessConnlessPacket(&Packet);
@@ -2390,9 +2415,14 @@ void CClient::PumpNetwork()
 			{
 				continue;
 			}
-			ProcessServerPacket(&Packet, i, g_Config.m_ClDummy ^ i);
+			ProcessServerPacket(&Packet, i, g_Config.m_ClDummy ^ i, RecvTime);
+			ProcessSnapshotResults();
 		}
 	}
+
+	// only take the snapshots that are ready, the ones still being unpacked
+	// come with the next frame. their receive time keeps the timing right
+	ProcessSnapshotResults();
 }
 
 void CClient::OnDemoPlayerSnapshot(void *pData, int Size)
@@ -2681,6 +2711,8 @@ void CClient::Update()
 	// pump the network
 	PumpNetwork();
 
+	Engine()->RunJobContinuations();
+
 	if(m_pMapdownloadTask)
 	{
 		if(m_pMapdownloadTask->State() == HTTP_DONE)
@@ -2892,6 +2924,14 @@ void CClient::Run()
 
 	GameClient()->OnInit();
 
+	// the receiver validates the snapshots with its own object handler,
+	// the one of the game client is not thread safe
+	std::shared_ptr<CNetObjHandler> pNetObjHandler = std::make_shared<CNetObjHandler>();
+	m_SnapshotReceiver.Init([pNetObjHandler](const CSnapshot *pFrom, CSnapshot *pTo) {
+		return UnpackAndValidateSnapshot(pNetObjHandler.get(), pFrom, pTo);
+	},
+		g_Config.m_ClSnapshotThread);
+
 	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "client", "version " GAME_RELEASE_VERSION " on " CONF_PLATFORM_STRING " " CONF_ARCH_STRING, ColorRGBA(0.7f, 0.7f, 1.0f, 1.0f));
 	if(GIT_SHORTREV_HASH)
 	{
@@ -3174,6 +3214,7 @@ void CClient::Run()
 
 	GameClient()->OnShutdown();
 	Disconnect();
+	m_SnapshotReceiver.Shutdown();
 
 	// close socket
 	for(unsigned int i = 0; i < std::size(m_aNetClient); i++)
@@ -3755,6 +3796,7 @@ void CClient::DemoRecorder_Start(const char *pFilename, bool WithTimestamp, int
 		else
 			str_format(aFilename, sizeof(aFilename), "demos/%s.demo", pFilename);
 
+		m_DemoWriter.SetQueueSize(g_Config.m_ClDemoAsyncQueue * 1024);
 		m_aDemoRecorder[Recorder].Start(Storage(), m_pConsole, aFilename, GameClient()->NetVersion(), m_aCurrentMap, m_pMap->Sha256(), m_pMap->Crc(), "client", m_pMap->MapSize(), 0, m_pMap->File());
 	}
 }
@@ -4673,7 +4715,10 @@ void CClient::RaceRecord_Start(const char *pFilename)
 	if(State() != IClient::STATE_ONLINE)
 		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demorec/record", "client is not online");
 	else
+	{
+		m_DemoWriter.SetQueueSize(g_Config.m_ClDemoAsyncQueue * 1024);
 		m_aDemoRecorder[RECORDER_RACE].Start(Storage(), m_pConsole, pFilename, GameClient()->NetVersion(), m_aCurrentMap, m_pMap->Sha256(), m_pMap->Crc(), "client", m_pMap->MapSize(), 0, m_pMap->File());
+	}
 }
 
 void CClient::RaceRecord_Stop()
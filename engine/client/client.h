@@ -25,6 +25,7 @@
 
 #include "graph.h"
 #include "smooth_time.h"
+#include "snapshot_receiver.h"
 
 class CDemoEdit;
 class IDemoRecorder;
@@ -77,6 +78,8 @@ class CClient : public IClient, public CDemoPlayer::IListener
 
 	CNetClient m_aNetClient[NUM_CONNS];
 	CDemoPlayer m_DemoPlayer;
+	// declared first, so it outlives the recorders
+	CDemoWriter m_DemoWriter;
 	CDemoRecorder m_aDemoRecorder[RECORDER_MAX];
 	CDemoEditor m_DemoEditor;
 	CGhostRecorder m_GhostRecorder;
@@ -195,6 +198,7 @@ class CClient : public IClient, public CDemoPlayer::IListener
 	char m_aaaDemorecSnapshotData[NUM_SNAPSHOT_TYPES][2][CSnapshot::MAX_SIZE];
 
 	CSnapshotDelta m_SnapshotDelta;
+	CSnapshotReceiver m_SnapshotReceiver;
 
 	std::deque<std::shared_ptr<CDemoEdit>> m_EditJobs;
 
@@ -344,8 +348,11 @@ public:
 
 	void ProcessConnlessPacket(CNetChunk *pPacket);
 	void ProcessServerInfo(int Type, NETADDR *pFrom, const void *pData, int DataSize);
-	void ProcessServerPacket(CNetChunk *pPacket, int Conn, bool Dummy);
+	void ProcessServerPacket(CNetChunk *pPacket, int Conn, bool Dummy, int64_t RecvTime);
+	void ProcessSnapshot(const CSnapshotReceiver::CResult *pResult);
+	void ProcessSnapshotResults();
 
+	static int UnpackAndValidateSnapshot(CNetObjHandler *pNetObjHandler, const CSnapshot *pFrom, CSnapshot *pTo);
 	int UnpackAndValidateSnapshot(CSnapshot *pFrom, CSnapshot *pTo);
 
 	void ResetMapDownload();
@@ -0,0 +1,377 @@
+#include "snapshot_receiver.h"
+
+#include <engine/shared/compression.h>
+
+// Entries are 16 byte aligned and never wrap around the end of the ring, a
+// padding entry fills the gap. The producer reserves room for the largest
+// entry it might write and commits what it actually wrote.
+class CSnapshotReceiver::CRing
+{
+	struct CEntryHeader
+	{
+		int32_t m_Size;
+		int32_t m_Padding;
+		int64_t m_Reserved;
+	};
+
+	unsigned char *m_pBuffer;
+	size_t m_Capacity;
+	std::atomic<size_t> m_ReadPos{0};
+	std::atomic<size_t> m_WritePos{0};
+	size_t m_ReservedPos = 0;
+
+	static size_t EntrySize(size_t DataSize) { return (sizeof(CEntryHeader) + DataSize + 15) & ~(size_t)15; }
+
+public:
+	CRing(size_t Capacity)
+	{
+		m_Capacity = Capacity & ~(size_t)15;
+		m_pBuffer = (unsigned char *)malloc(m_Capacity);
+	}
+
+	~CRing()
+	{
+		free(m_pBuffer);
+	}
+
+	void *Reserve(size_t MaxSize)
+	{
+		size_t WritePos = m_WritePos.load(std::memory_order_relaxed);
+		const size_t ReadPos = m_ReadPos.load(std::memory_order_acquire);
+		const size_t MaxSize16 = EntrySize(MaxSize);
+		size_t Offset = WritePos % m_Capacity;
+		const size_t Padding = m_Capacity - Offset < MaxSize16 ? m_Capacity - Offset : 0;
+		if(WritePos + Padding + MaxSize16 - ReadPos > m_Capacity)
+			return nullptr;
+
+		if(Padding)
+		{
+			CEntryHeader *pPadding = (CEntryHeader *)(m_pBuffer + Offset);
+			pPadding->m_Size = Padding - sizeof(CEntryHeader);
+			pPadding->m_Padding = 1;
+			WritePos += Padding;
+			Offset = 0;
+		}
+		m_ReservedPos = WritePos;
+		return m_pBuffer + Offset + sizeof(CEntryHeader);
+	}
+
+	void Commit(size_t Size)
+	{
+		CEntryHeader *pHeader = (CEntryHeader *)(m_pBuffer + m_ReservedPos % m_Capacity);
+		pHeader->m_Size = Size;
+		pHeader->m_Padding = 0;
+		m_WritePos.store(m_ReservedPos + EntrySize(Size), std::memory_order_release);
+	}
+
+	const void *Peek()
+	{
+		size_t ReadPos = m_ReadPos.load(std::memory_order_relaxed);
+		while(ReadPos != m_WritePos.load(std::memory_order_acquire))
+		{
+			const CEntryHeader *pHeader = (const CEntryHeader *)(m_pBuffer + ReadPos % m_Capacity);
+			if(!pHeader->m_Padding)
+				return pHeader + 1;
+			ReadPos += EntrySize(pHeader->m_Size);
+			m_ReadPos.store(ReadPos, std::memory_order_release);
+		}
+		return nullptr;
+	}
+
+	void Pop()
+	{
+		const size_t ReadPos = m_ReadPos.load(std::memory_order_relaxed);
+		const CEntryHeader *pHeader = (const CEntryHeader *)(m_pBuffer + ReadPos % m_Capacity);
+		m_ReadPos.store(ReadPos + EntrySize(pHeader->m_Size), std::memory_order_release);
+	}
+};
+
+class CSnapshotReceiver::CRequest
+{
+public:
+	int m_Type;
+	int m_Conn;
+	int m_Generation;
+	int m_GameTick;
+	int m_DeltaTick;
+	unsigned m_Crc;
+	bool m_Empty;
+	int m_DataSize;
+	int64_t m_RecvTime;
+	const void *m_pData;
+};
+
+CSnapshotReceiver::CSnapshotReceiver()
+{
+	for(int &LastTick : m_aLastTick)
+		LastTick = -1;
+	sphore_init(&m_RequestSemaphore);
+	sphore_init(&m_SpaceSemaphore);
+}
+
+CSnapshotReceiver::~CSnapshotReceiver()
+{
+	Shutdown();
+	sphore_destroy(&m_SpaceSemaphore);
+	sphore_destroy(&m_RequestSemaphore);
+}
+
+void CSnapshotReceiver::Init(FUnpackAndValidate &&pfnUnpackAndValidate, bool Threaded)
+{
+	dbg_assert(!m_pResults, "snapshot receiver already initialized");
+
+	m_pfnUnpackAndValidate = std::move(pfnUnpackAndValidate);
+	m_pResults = new CRing(RESULT_QUEUE_SIZE);
+	if(Threaded)
+	{
+		m_pRequests = new CRing(REQUEST_QUEUE_SIZE);
+		m_pThread = thread_init(Run, this, "snapshot receiver");
+	}
+}
+
+void CSnapshotReceiver::Shutdown()
+{
+	if(m_pThread)
+	{
+		// the thread might wait for the render thread to make room for a result
+		m_Shutdown.store(true, std::memory_order_release);
+		sphore_signal(&m_SpaceSemaphore);
+		while(!Push(REQUEST_QUIT, 0, 0, 0, 0, false, 0, nullptr, 0))
+			thread_yield();
+		thread_wait(m_pThread);
+		m_pThread = nullptr;
+	}
+	delete m_pRequests;
+	m_pRequests = nullptr;
+	delete m_pResults;
+	m_pResults = nullptr;
+}
+
+bool CSnapshotReceiver::Push(int Type, int Conn, int GameTick, int DeltaTick, unsigned Crc, bool Empty, int64_t RecvTime, const void *pData, int DataSize)
+{
+	if(!m_pResults)
+		return false;
+
+	CRequest Request;
+	Request.m_Type = Type;
+	Request.m_Conn = Conn;
+	Request.m_Generation = m_aGeneration[Conn];
+	Request.m_GameTick = GameTick;
+	Request.m_DeltaTick = DeltaTick;
+	Request.m_Crc = Crc;
+	Request.m_Empty = Empty;
+	Request.m_DataSize = DataSize;
+	Request.m_RecvTime = RecvTime;
+	Request.m_pData = pData;
+
+	if(!m_pThread)
+	{
+		Process(&Request);
+		return true;
+	}
+
+	CRequest *pRequest = (CRequest *)m_pRequests->Reserve(sizeof(CRequest) + DataSize);
+	if(!pRequest)
+		return false;
+	*pRequest = Request;
+	pRequest->m_pData = pRequest + 1;
+	if(DataSize)
+		mem_copy(pRequest + 1, pData, DataSize);
+	m_pRequests->Commit(sizeof(CRequest) + DataSize);
+	sphore_signal(&m_RequestSemaphore);
+	return true;
+}
+
+bool CSnapshotReceiver::PushSnapshot(int Conn, int GameTick, int DeltaTick, unsigned Crc, bool Empty, int64_t RecvTime, const void *pData, int DataSize)
+{
+	if(Push(REQUEST_SNAPSHOT, Conn, GameTick, DeltaTick, Crc, Empty, RecvTime, pData, DataSize))
+		return true;
+	m_NumDropped++;
+	return false;
+}
+
+bool CSnapshotReceiver::PushMessage(int Conn, const void *pData, int Size)
+{
+	return Push(REQUEST_MESSAGE, Conn, 0, 0, 0, false, 0, pData, Size);
+}
+
+void CSnapshotReceiver::Reset(int Conn)
+{
+	// results of the old generation are skipped by Peek, the storage is
+	// purged in order with the snapshots
+	m_aGeneration[Conn]++;
+	while(!Push(REQUEST_RESET, Conn, 0, 0, 0, false, 0, nullptr, 0) && m_pThread)
+		thread_yield();
+}
+
+const CSnapshotReceiver::CResult *CSnapshotReceiver::Peek()
+{
+	if(!m_pResults)
+		return nullptr;
+
+	const CResult *pResult;
+	while((pResult = (const CResult *)m_pResults->Peek()))
+	{
+		if(pResult->m_Generation == m_aGeneration[pResult->m_Conn])
+			return pResult;
+		Pop();
+	}
+	return nullptr;
+}
+
+void CSnapshotReceiver::Pop()
+{
+	m_pResults->Pop();
+	if(m_pThread)
+		sphore_signal(&m_SpaceSemaphore);
+}
+
+CSnapshotReceiver::CResult *CSnapshotReceiver::ReserveResult(const CRequest *pRequest, int Type)
+{
+	const size_t MaxSize = sizeof(CResult) + (Type == RESULT_SNAPSHOT ? 2 * CSnapshot::MAX_SIZE : Type == RESULT_MESSAGE ? pRequest->m_DataSize : 0);
+	CResult *pResult;
+	while(!(pResult = (CResult *)m_pResults->Reserve(MaxSize)))
+	{
+		// the render thread empties the ring every frame. without a thread,
+		// the results are taken right after every push
+		if(!m_pThread || m_Shutdown.load(std::memory_order_acquire))
+			return nullptr;
+		sphore_wait(&m_SpaceSemaphore);
+	}
+
+	pResult->m_Type = Type;
+	pResult->m_Conn = pRequest->m_Conn;
+	pResult->m_Generation = pRequest->m_Generation;
+	pResult->m_GameTick = pRequest->m_GameTick;
+	pResult->m_DeltaTick = pRequest->m_DeltaTick;
+	pResult->m_Crc = pRequest->m_Crc;
+	pResult->m_GotCrc = 0;
+	pResult->m_DataSize = pRequest->m_DataSize;
+	pResult->m_SnapSize = 0;
+	pResult->m_AltSnapSize = 0;
+	pResult->m_RecvTime = pRequest->m_RecvTime;
+	return pResult;
+}
+
+void CSnapshotReceiver::CommitResult(CResult *pResult, int DataSize)
+{
+	m_pResults->Commit(sizeof(CResult) + DataSize);
+}
+
+void CSnapshotReceiver::ProcessSnapshot(const CRequest *pRequest)
+{
+	const int Conn = pRequest->m_Conn;
+
+	// a tick can be handed over twice before the render thread acked it
+	if(pRequest->m_GameTick <= m_aLastTick[Conn])
+		return;
+
+	// find snapshot that we should use as delta
+	const CSnapshot *pDeltaShot = CSnapshot::EmptySnapshot();
+	if(pRequest->m_DeltaTick >= 0 && m_aDeltaStorage[Conn].Get(pRequest->m_DeltaTick, nullptr, &pDeltaShot, nullptr) < 0)
+	{
+		CResult *pResult = ReserveResult(pRequest, RESULT_MISSING_DELTA);
+		if(pResult)
+			CommitResult(pResult, 0);
+		return;
+	}
+
+	// decompress snapshot
+	const void *pDeltaData = m_SnapshotDelta.EmptyDelta();
+	int DeltaSize = sizeof(int) * 3;
+	if(pRequest->m_DataSize)
+	{
+		const int IntSize = CVariableInt::Decompress(pRequest->m_pData, pRequest->m_DataSize, m_aDeltaData, sizeof(m_aDeltaData));
+		if(IntSize < 0) // failure during decompression
+			return;
+		pDeltaData = m_aDeltaData;
+		DeltaSize = IntSize;
+	}
+
+	// unpack delta straight into the result
+	CResult *pResult = ReserveResult(pRequest, RESULT_SNAPSHOT);
+	if(!pResult)
+		return;
+	CSnapshot *pSnap = (CSnapshot *)(pResult + 1);
+	const int SnapSize = m_SnapshotDelta.UnpackDelta(pDeltaShot, pSnap, pDeltaData, DeltaSize);
+	if(SnapSize < 0)
+	{
+		dbg_msg("client", "delta unpack failed. error=%d", SnapSize);
+		return;
+	}
+	if(!pSnap->IsValid(SnapSize))
+	{
+		dbg_msg("client", "snapshot invalid. SnapSize=%d, DeltaSize=%d", SnapSize, DeltaSize);
+		return;
+	}
+
+	if(!pRequest->m_Empty && pSnap->Crc() != pRequest->m_Crc)
+	{
+		pResult->m_Type = RESULT_CRC_ERROR;
+		pResult->m_GotCrc = pSnap->Crc();
+		CommitResult(pResult, 0);
+		return;
+	}
+
+	// the server only uses acked snapshots as delta, the acks only move forward
+	m_aDeltaStorage[Conn].PurgeUntil(pRequest->m_DeltaTick);
+
+	// create a verified and unpacked snapshot
+	CSnapshot *pAltSnap = (CSnapshot *)((char *)pSnap + SnapSize);
+	const int AltSnapSize = m_pfnUnpackAndValidate(pSnap, pAltSnap);
+	if(AltSnapSize < 0)
+	{
+		dbg_msg("client", "unpack snapshot and validate failed. error=%d", AltSnapSize);
+		return;
+	}
+
+	m_aDeltaStorage[Conn].Add(pRequest->m_GameTick, pRequest->m_RecvTime, SnapSize, pSnap, 0, nullptr);
+	m_aLastTick[Conn] = pRequest->m_GameTick;
+
+	pResult->m_GotCrc = pRequest->m_Crc;
+	pResult->m_SnapSize = SnapSize;
+	pResult->m_AltSnapSize = AltSnapSize;
+	CommitResult(pResult, SnapSize + AltSnapSize);
+}
+
+void CSnapshotReceiver::Process(const CRequest *pRequest)
+{
+	if(pRequest->m_Type == REQUEST_SNAPSHOT)
+	{
+		ProcessSnapshot(pRequest);
+	}
+	else if(pRequest->m_Type == REQUEST_MESSAGE)
+	{
+		CResult *pResult = ReserveResult(pRequest, RESULT_MESSAGE);
+		if(pResult)
+		{
+			mem_copy(pResult + 1, pRequest->m_pData, pRequest->m_DataSize);
+			CommitResult(pResult, pRequest->m_DataSize);
+		}
+	}
+	else if(pRequest->m_Type == REQUEST_RESET)
+	{
+		m_aDeltaStorage[pRequest->m_Conn].PurgeAll();
+		m_aLastTick[pRequest->m_Conn] = -1;
+	}
+}
+
+void CSnapshotReceiver::Run(void *pUser)
+{
+	CSnapshotReceiver *pThis = (CSnapshotReceiver *)pUser;
+	while(true)
+	{
+		sphore_wait(&pThis->m_RequestSemaphore);
+		const CRequest *pRequest;
+		while((pRequest = (const CRequest *)pThis->m_pRequests->Peek()))
+		{
+			if(pRequest->m_Type == REQUEST_QUIT)
+			{
+				pThis->m_pRequests->Pop();
+				return;
+			}
+			pThis->Process(pRequest);
+			pThis->m_pRequests->Pop();
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#ifndef ENGINE_CLIENT_SNAPSHOT_RECEIVER_H
+#define ENGINE_CLIENT_SNAPSHOT_RECEIVER_H
+
+#include <base/system.h>
+
+#include <engine/shared/snapshot.h>
+
+#include <atomic>
+#include <functional>
+
+// Turns the reassembled snapshot data of the server connections into
+// validated snapshots: decompression, delta unpacking, CRC check and the
+// unpacking of the alternative snapshot. With a thread, this happens next to
+// the render thread. The data goes in through one single producer, single
+// consumer ring and the results come back through another one, in the order
+// the data went in. Without a thread, every push is processed right away.
+class CSnapshotReceiver
+{
+public:
+	enum
+	{
+		NUM_CONNS = 2,
+
+		RESULT_SNAPSHOT = 0,
+		RESULT_MESSAGE,
+		RESULT_MISSING_DELTA,
+		RESULT_CRC_ERROR,
+	};
+
+	class CResult
+	{
+	public:
+		int m_Type;
+		int m_Conn;
+		int m_Generation;
+		int m_GameTick;
+		int m_DeltaTick;
+		unsigned m_Crc;
+		unsigned m_GotCrc;
+		int m_DataSize;
+		int m_SnapSize;
+		int m_AltSnapSize;
+		int64_t m_RecvTime;
+
+		// followed by the snapshot and the alternative snapshot, or the message
+		const CSnapshot *Snap() const { return (const CSnapshot *)(this + 1); }
+		const CSnapshot *AltSnap() const { return (const CSnapshot *)((const char *)(this + 1) + m_SnapSize); }
+		const void *Message() const { return this + 1; }
+	};
+
+	// unpacks the snapshot into the alternative snapshot, returns its size or a negative error
+	typedef std::function<int(const CSnapshot *pFrom, CSnapshot *pTo)> FUnpackAndValidate;
+
+private:
+	class CRing;
+	class CRequest;
+
+	enum
+	{
+		REQUEST_SNAPSHOT = 0,
+		REQUEST_MESSAGE,
+		REQUEST_RESET,
+		REQUEST_QUIT,
+
+		REQUEST_QUEUE_SIZE = 1024 * 1024,
+		RESULT_QUEUE_SIZE = 2 * 1024 * 1024,
+	};
+
+	CRing *m_pRequests = nullptr;
+	CRing *m_pResults = nullptr;
+	FUnpackAndValidate m_pfnUnpackAndValidate;
+	void *m_pThread = nullptr;
+	SEMAPHORE m_RequestSemaphore;
+	SEMAPHORE m_SpaceSemaphore;
+	std::atomic<bool> m_Shutdown{false};
+
+	// render thread
+	int m_aGeneration[NUM_CONNS] = {0};
+	int m_NumDropped = 0;
+
+	// snapshot thread, or the render thread without a thread
+	CSnapshotDelta m_SnapshotDelta;
+	CSnapshotStorage m_aDeltaStorage[NUM_CONNS];
+	int m_aLastTick[NUM_CONNS];
+	char m_aDeltaData[CSnapshot::MAX_SIZE];
+
+	bool Push(int Type, int Conn, int GameTick, int DeltaTick, unsigned Crc, bool Empty, int64_t RecvTime, const void *pData, int DataSize);
+	void Process(const CRequest *pRequest);
+	void ProcessSnapshot(const CRequest *pRequest);
+	CResult *ReserveResult(const CRequest *pRequest, int Type);
+	void CommitResult(CResult *pResult, int DataSize);
+	static void Run(void *pUser);
+
+public:
+	CSnapshotReceiver();
+	~CSnapshotReceiver();
+
+	// item sizes have to be set before the first snapshot is pushed
+	void SetStaticsize(int ItemType, int Size) { m_SnapshotDelta.SetStaticsize(ItemType, Size); }
+	void Init(FUnpackAndValidate &&pfnUnpackAndValidate, bool Threaded);
+	void Shutdown();
+
+	bool PushSnapshot(int Conn, int GameTick, int DeltaTick, unsigned Crc, bool Empty, int64_t RecvTime, const void *pData, int DataSize);
+	// passes a message through, so it comes back in order with the snapshots
+	bool PushMessage(int Conn, const void *pData, int Size);
+	// forgets the snapshots of the connection, including the ones still being processed
+	void Reset(int Conn);
+
+	const CResult *Peek();
+	void Pop();
+
+	int NumDropped() const { return m_NumDropped; }
+	// only for the data rates in the debug overlay, they can be read while
+	// the thread unpacks
+	const CSnapshotDelta *SnapshotDelta() const { return &m_SnapshotDelta; }
+};
+
+#endif
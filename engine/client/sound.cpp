@@ -23,157 +23,7 @@ extern "C" {
 
 void CSound::Mix(short *pFinalOut, unsigned Frames)
 {
-	Frames = minimum(Frames, m_MaxFrames);
-	mem_zero(m_pMixBuffer, Frames * 2 * sizeof(int));
-
-	// acquire lock while we are mixing
-	m_SoundLock.lock();
-
-	const int MasterVol = m_SoundVolume.load(std::memory_order_relaxed);
-
-	for(auto &Voice : m_aVoices)
-	{
-		if(!Voice.m_pSample)
-			continue;
-
-		// mix voice
-		int *pOut = m_pMixBuffer;
-
-		const int Step = Voice.m_pSample->m_Channels; // setup input sources
-		short *pInL = &Voice.m_pSample->m_pData[Voice.m_Tick * Step];
-		short *pInR = &Voice.m_pSample->m_pData[Voice.m_Tick * Step + 1];
-
-		unsigned End = Voice.m_pSample->m_NumFrames - Voice.m_Tick;
-
-		int VolumeR = round_truncate(Voice.m_pChannel->m_Vol * (Voice.m_Vol / 255.0f));
-		int VolumeL = VolumeR;
-
-		// make sure that we don't go outside the sound data
-		if(Frames < End)
-			End = Frames;
-
-		// check if we have a mono sound
-		if(Voice.m_pSample->m_Channels == 1)
-			pInR = pInL;
-
-		// volume calculation
-		if(Voice.m_Flags & ISound::FLAG_POS && Voice.m_pChannel->m_Pan)
-		{
-			// TODO: we should respect the channel panning value
-			const int dx = Voice.m_X - m_CenterX.load(std::memory_order_relaxed);
-			const int dy = Voice.m_Y - m_CenterY.load(std::memory_order_relaxed);
-			float FalloffX = 0.0f;
-			float FalloffY = 0.0f;
-
-			int RangeX = 0; // for panning
-			bool InVoiceField = false;
-
-			switch(Voice.m_Shape)
-			{
-			case ISound::SHAPE_CIRCLE:
-			{
-				const float Radius = Voice.m_Circle.m_Radius;
-				RangeX = Radius;
-
-				// dx and dy can be larger than 46341 and thus the calculation would go beyond the limits of a integer,
-				// therefore we cast them into float
-				const int Dist = (int)length(vec2(dx, dy));
-				if(Dist < Radius)
-				{
-					InVoiceField = true;
-
-					// falloff
-					int FalloffDistance = Radius * Voice.m_Falloff;
-					if(Dist > FalloffDistance)
-						FalloffX = FalloffY = (Radius - Dist) / (Radius - FalloffDistance);
-					else
-						FalloffX = FalloffY = 1.0f;
-				}
-				else
-					InVoiceField = false;
-
-				break;
-			}
-
-			case ISound::SHAPE_RECTANGLE:
-			{
-				RangeX = Voice.m_Rectangle.m_Width / 2.0f;
-
-				const int abs_dx = absolute(dx);
-				const int abs_dy = absolute(dy);
-
-				const int w = Voice.m_Rectangle.m_Width / 2.0f;
-				const int h = Voice.m_Rectangle.m_Height / 2.0f;
-
-				if(abs_dx < w && abs_dy < h)
-				{
-					InVoiceField = true;
-
-					// falloff
-					int fx = Voice.m_Falloff * w;
-					int fy = Voice.m_Falloff * h;
-
-					FalloffX = abs_dx > fx ? (float)(w - abs_dx) / (w - fx) : 1.0f;
-					FalloffY = abs_dy > fy ? (float)(h - abs_dy) / (h - fy) : 1.0f;
-				}
-				else
-					InVoiceField = false;
-
-				break;
-			}
-			};
-
-			if(InVoiceField)
-			{
-				// panning
-				if(!(Voice.m_Flags & ISound::FLAG_NO_PANNING))
-				{
-					if(dx > 0)
-						VolumeL = ((RangeX - absolute(dx)) * VolumeL) / RangeX;
-					else
-						VolumeR = ((RangeX - absolute(dx)) * VolumeR) / RangeX;
-				}
-
-				{
-					VolumeL *= FalloffX * FalloffY;
-					VolumeR *= FalloffX * FalloffY;
-				}
-			}
-			else
-			{
-				VolumeL = 0;
-				VolumeR = 0;
-			}
-		}
-
-		// process all frames
-		for(unsigned s = 0; s < End; s++)
-		{
-			*pOut++ += (*pInL) * VolumeL;
-			*pOut++ += (*pInR) * VolumeR;
-			pInL += Step;
-			pInR += Step;
-			Voice.m_Tick++;
-		}
-
-		// free voice if not used any more
-		if(Voice.m_Tick == Voice.m_pSample->m_NumFrames)
-		{
-			if(Voice.m_Flags & ISound::FLAG_LOOP)
-				Voice.m_Tick = 0;
-			else
-			{
-				Voice.m_pSample = nullptr;
-				Voice.m_Age++;
-			}
-		}
-	}
-
-	m_SoundLock.unlock();
-
-	// clamp accumulated values
-	for(unsigned i = 0; i < Frames * 2; i++)
-		pFinalOut[i] = clamp<int>(((m_pMixBuffer[i] * MasterVol) / 101) >> 8, std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+	m_Mixer.Mix(pFinalOut, Frames);
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
 	swap_endian(pFinalOut, sizeof(short), Frames * 2);
@@ -238,7 +88,7 @@ int CSound::Init()
 #if defined(CONF_VIDEORECORDER)
 	m_MaxFrames = maximum<uint32_t>(m_MaxFrames, 1024 * 2); // make the buffer bigger just in case
 #endif
-	m_pMixBuffer = (int *)calloc(m_MaxFrames * 2, sizeof(int));
+	m_Mixer.Init(m_MaxFrames);
 
 	SDL_PauseAudioDevice(m_Device, 0);
 
@@ -250,6 +100,8 @@ int CSound::Init()
 int CSound::Update()
 {
 	UpdateVolume();
+	m_Mixer.Flush();
+	FreePendingSamples(false);
 	return 0;
 }
 
@@ -258,7 +110,15 @@ void CSound::UpdateVolume()
 	int WantedVolume = g_Config.m_SndVolume;
 	if(!m_pGraphics->WindowActive() && g_Config.m_SndNonactiveMute)
 		WantedVolume = 0;
-	m_SoundVolume.store(WantedVolume, std::memory_order_relaxed);
+	m_Mixer.SetMasterVolume(WantedVolume);
+}
+
+void CSound::FreePendingSamples(bool All)
+{
+	auto It = m_vPendingFrees.begin();
+	for(; It != m_vPendingFrees.end() && (All || m_Mixer.Reached(It->m_Sequence)); ++It)
+		free(It->m_pData);
+	m_vPendingFrees.erase(m_vPendingFrees.begin(), It);
 }
 
 void CSound::Shutdown()
@@ -270,8 +130,7 @@ void CSound::Shutdown()
 
 	SDL_CloseAudioDevice(m_Device);
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
-	free(m_pMixBuffer);
-	m_pMixBuffer = nullptr;
+	FreePendingSamples(true);
 }
 
 int CSound::AllocID()
@@ -614,7 +473,11 @@ void CSound::UnloadSample(int SampleID)
 		return;
 
 	Stop(SampleID);
-	free(m_aSamples[SampleID].m_pData);
+	// the mixer might still be mixing the voices that were just stopped
+	if(m_aSamples[SampleID].m_pData && !m_Mixer.Reached(m_Mixer.Sequence()))
+		m_vPendingFrees.push_back({m_aSamples[SampleID].m_pData, m_Mixer.Sequence()});
+	else
+		free(m_aSamples[SampleID].m_pData);
 	m_aSamples[SampleID].m_pData = nullptr;
 }
 
@@ -626,20 +489,45 @@ float CSound::GetSampleTotalTime(int SampleID)
 	return (m_aSamples[SampleID].m_NumFrames / (float)m_aSamples[SampleID].m_Rate);
 }
 
+bool CSound::IsVoiceActive(int VoiceID)
+{
+	CVoice &Voice = m_aVoices[VoiceID];
+	if(!Voice.m_pSample)
+		return false;
+	if(!m_Mixer.Finished(VoiceID, Voice.m_Serial))
+		return true;
+
+	// free voice if not used any more
+	Voice.m_pSample = nullptr;
+	Voice.m_Age++;
+	return false;
+}
+
+int CSound::VoiceTick(int VoiceID) const
+{
+	int Tick;
+	if(m_Mixer.Position(VoiceID, m_aVoices[VoiceID].m_Serial, &Tick))
+		return Tick;
+	return m_aVoices[VoiceID].m_Tick;
+}
+
+void CSound::StopVoiceMixing(int VoiceID)
+{
+	m_Mixer.Stop(VoiceID, m_aVoices[VoiceID].m_Serial);
+	m_aVoices[VoiceID].m_pSample = nullptr;
+}
+
 float CSound::GetSampleCurrentTime(int SampleID)
 {
 	if(SampleID == -1 || SampleID >= NUM_SAMPLES)
 		return 0.0f;
 
 	CSample *pSample = &m_aSamples[SampleID];
-	if(IsPlaying(SampleID))
+	for(int VoiceID = 0; VoiceID < NUM_VOICES; VoiceID++)
 	{
-		for(auto &Voice : m_aVoices)
+		if(IsVoiceActive(VoiceID) && m_aVoices[VoiceID].m_pSample == pSample)
 		{
-			if(Voice.m_pSample == pSample)
-			{
-				return (Voice.m_Tick / (float)pSample->m_Rate);
-			}
+			return (VoiceTick(VoiceID) / (float)pSample->m_Rate);
 		}
 	}
 
@@ -654,11 +542,13 @@ void CSound::SetSampleCurrentTime(int SampleID, float Time)
 	CSample *pSample = &m_aSamples[SampleID];
 	if(IsPlaying(SampleID))
 	{
-		for(auto &Voice : m_aVoices)
+		for(int VoiceID = 0; VoiceID < NUM_VOICES; VoiceID++)
 		{
+			CVoice &Voice = m_aVoices[VoiceID];
 			if(Voice.m_pSample == pSample)
 			{
 				Voice.m_Tick = pSample->m_NumFrames * Time;
+				m_Mixer.Seek(VoiceID, Voice.m_Serial, Voice.m_Tick);
 			}
 		}
 	}
@@ -670,14 +560,12 @@ void CSound::SetSampleCurrentTime(int SampleID, float Time)
 
 void CSound::SetChannel(int ChannelID, float Vol, float Pan)
 {
-	m_aChannels[ChannelID].m_Vol = (int)(Vol * 255.0f);
-	m_aChannels[ChannelID].m_Pan = (int)(Pan * 255.0f); // TODO: this is only on and off right now
+	m_Mixer.SetChannel(ChannelID, (int)(Vol * 255.0f), (int)(Pan * 255.0f)); // TODO: panning is only on and off right now
 }
 
 void CSound::SetListenerPos(float x, float y)
 {
-	m_CenterX.store((int)x, std::memory_order_relaxed);
-	m_CenterY.store((int)y, std::memory_order_relaxed);
+	m_Mixer.SetListenerPos((int)x, (int)y);
 }
 
 void CSound::SetVoiceVolume(CVoiceHandle Voice, float Volume)
@@ -687,12 +575,12 @@ void CSound::SetVoiceVolume(CVoiceHandle Voice, float Volume)
 
 	int VoiceID = Voice.Id();
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
+	if(!IsVoiceActive(VoiceID) || m_aVoices[VoiceID].m_Age != Voice.Age())
 		return;
 
 	Volume = clamp(Volume, 0.0f, 1.0f);
-	m_aVoices[VoiceID].m_Vol = (int)(Volume * 255.0f);
+	m_aVoices[VoiceID].m_Params.m_Vol = (int)(Volume * 255.0f);
+	m_Mixer.SetParams(VoiceID, m_aVoices[VoiceID].m_Serial, m_aVoices[VoiceID].m_Params);
 }
 
 void CSound::SetVoiceFalloff(CVoiceHandle Voice, float Falloff)
@@ -702,12 +590,12 @@ void CSound::SetVoiceFalloff(CVoiceHandle Voice, float Falloff)
 
 	int VoiceID = Voice.Id();
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
+	if(!IsVoiceActive(VoiceID) || m_aVoices[VoiceID].m_Age != Voice.Age())
 		return;
 
 	Falloff = clamp(Falloff, 0.0f, 1.0f);
-	m_aVoices[VoiceID].m_Falloff = Falloff;
+	m_aVoices[VoiceID].m_Params.m_Falloff = Falloff;
+	m_Mixer.SetParams(VoiceID, m_aVoices[VoiceID].m_Serial, m_aVoices[VoiceID].m_Params);
 }
 
 void CSound::SetVoiceLocation(CVoiceHandle Voice, float x, float y)
@@ -717,12 +605,12 @@ void CSound::SetVoiceLocation(CVoiceHandle Voice, float x, float y)
 
 	int VoiceID = Voice.Id();
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
+	if(!IsVoiceActive(VoiceID) || m_aVoices[VoiceID].m_Age != Voice.Age())
 		return;
 
-	m_aVoices[VoiceID].m_X = x;
-	m_aVoices[VoiceID].m_Y = y;
+	m_aVoices[VoiceID].m_Params.m_X = x;
+	m_aVoices[VoiceID].m_Params.m_Y = y;
+	m_Mixer.SetParams(VoiceID, m_aVoices[VoiceID].m_Serial, m_aVoices[VoiceID].m_Params);
 }
 
 void CSound::SetVoiceTimeOffset(CVoiceHandle Voice, float TimeOffset)
@@ -732,29 +620,28 @@ void CSound::SetVoiceTimeOffset(CVoiceHandle Voice, float TimeOffset)
 
 	int VoiceID = Voice.Id();
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
-		return;
-
-	if(!m_aVoices[VoiceID].m_pSample)
+	if(!IsVoiceActive(VoiceID) || m_aVoices[VoiceID].m_Age != Voice.Age())
 		return;
 
+	const CSample *pSample = m_aVoices[VoiceID].m_pSample;
 	int Tick = 0;
-	bool IsLooping = m_aVoices[VoiceID].m_Flags & ISound::FLAG_LOOP;
-	uint64_t TickOffset = m_aVoices[VoiceID].m_pSample->m_Rate * TimeOffset;
-	if(m_aVoices[VoiceID].m_pSample->m_NumFrames > 0 && IsLooping)
-		Tick = TickOffset % m_aVoices[VoiceID].m_pSample->m_NumFrames;
+	bool IsLooping = m_aVoices[VoiceID].m_Params.m_Flags & ISound::FLAG_LOOP;
+	uint64_t TickOffset = pSample->m_Rate * TimeOffset;
+	if(pSample->m_NumFrames > 0 && IsLooping)
+		Tick = TickOffset % pSample->m_NumFrames;
 	else
-		Tick = clamp(TickOffset, (uint64_t)0, (uint64_t)m_aVoices[VoiceID].m_pSample->m_NumFrames);
+		Tick = clamp(TickOffset, (uint64_t)0, (uint64_t)pSample->m_NumFrames);
 
 	// at least 200msec off, else depend on buffer size
-	float Threshold = maximum(0.2f * m_aVoices[VoiceID].m_pSample->m_Rate, (float)m_MaxFrames);
-	if(absolute(m_aVoices[VoiceID].m_Tick - Tick) > Threshold)
+	const int CurrentTick = VoiceTick(VoiceID);
+	float Threshold = maximum(0.2f * pSample->m_Rate, (float)m_MaxFrames);
+	if(absolute(CurrentTick - Tick) > Threshold)
 	{
 		// take care of looping (modulo!)
-		if(!(IsLooping && (minimum(m_aVoices[VoiceID].m_Tick, Tick) + m_aVoices[VoiceID].m_pSample->m_NumFrames - maximum(m_aVoices[VoiceID].m_Tick, Tick)) <= Threshold))
+		if(!(IsLooping && (minimum(CurrentTick, Tick) + pSample->m_NumFrames - maximum(CurrentTick, Tick)) <= Threshold))
 		{
 			m_aVoices[VoiceID].m_Tick = Tick;
+			m_Mixer.Seek(VoiceID, m_aVoices[VoiceID].m_Serial, Tick);
 		}
 	}
 }
@@ -766,12 +653,12 @@ void CSound::SetVoiceCircle(CVoiceHandle Voice, float Radius)
 
 	int VoiceID = Voice.Id();
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
+	if(!IsVoiceActive(VoiceID) || m_aVoices[VoiceID].m_Age != Voice.Age())
 		return;
 
-	m_aVoices[VoiceID].m_Shape = ISound::SHAPE_CIRCLE;
-	m_aVoices[VoiceID].m_Circle.m_Radius = maximum(0.0f, Radius);
+	m_aVoices[VoiceID].m_Params.m_Shape = ISound::SHAPE_CIRCLE;
+	m_aVoices[VoiceID].m_Params.m_Circle.m_Radius = maximum(0.0f, Radius);
+	m_Mixer.SetParams(VoiceID, m_aVoices[VoiceID].m_Serial, m_aVoices[VoiceID].m_Params);
 }
 
 void CSound::SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height)
@@ -781,25 +668,23 @@ void CSound::SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height)
 
 	int VoiceID = Voice.Id();
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
+	if(!IsVoiceActive(VoiceID) || m_aVoices[VoiceID].m_Age != Voice.Age())
 		return;
 
-	m_aVoices[VoiceID].m_Shape = ISound::SHAPE_RECTANGLE;
-	m_aVoices[VoiceID].m_Rectangle.m_Width = maximum(0.0f, Width);
-	m_aVoices[VoiceID].m_Rectangle.m_Height = maximum(0.0f, Height);
+	m_aVoices[VoiceID].m_Params.m_Shape = ISound::SHAPE_RECTANGLE;
+	m_aVoices[VoiceID].m_Params.m_Rectangle.m_Width = maximum(0.0f, Width);
+	m_aVoices[VoiceID].m_Params.m_Rectangle.m_Height = maximum(0.0f, Height);
+	m_Mixer.SetParams(VoiceID, m_aVoices[VoiceID].m_Serial, m_aVoices[VoiceID].m_Params);
 }
 
 ISound::CVoiceHandle CSound::Play(int ChannelID, int SampleID, int Flags, float x, float y)
 {
-	const CLockScope LockScope(m_SoundLock);
-
 	// search for voice
 	int VoiceID = -1;
 	for(int i = 0; i < NUM_VOICES; i++)
 	{
 		int NextID = (m_NextVoice + i) % NUM_VOICES;
-		if(!m_aVoices[NextID].m_pSample)
+		if(!IsVoiceActive(NextID))
 		{
 			VoiceID = NextID;
 			m_NextVoice = NextID + 1;
@@ -811,29 +696,35 @@ ISound::CVoiceHandle CSound::Play(int ChannelID, int SampleID, int Flags, float
 	int Age = -1;
 	if(VoiceID != -1)
 	{
-		m_aVoices[VoiceID].m_pSample = &m_aSamples[SampleID];
-		m_aVoices[VoiceID].m_pChannel = &m_aChannels[ChannelID];
+		CVoice &Voice = m_aVoices[VoiceID];
+		Voice.m_pSample = &m_aSamples[SampleID];
+		Voice.m_ChannelID = ChannelID;
 		if(Flags & FLAG_LOOP)
 		{
-			m_aVoices[VoiceID].m_Tick = m_aSamples[SampleID].m_PausedAt;
+			Voice.m_Tick = m_aSamples[SampleID].m_PausedAt;
 		}
 		else if(Flags & FLAG_PREVIEW)
 		{
-			m_aVoices[VoiceID].m_Tick = m_aSamples[SampleID].m_PausedAt;
+			Voice.m_Tick = m_aSamples[SampleID].m_PausedAt;
 			m_aSamples[SampleID].m_PausedAt = 0;
 		}
 		else
 		{
-			m_aVoices[VoiceID].m_Tick = 0;
+			Voice.m_Tick = 0;
 		}
-		m_aVoices[VoiceID].m_Vol = 255;
-		m_aVoices[VoiceID].m_Flags = Flags;
-		m_aVoices[VoiceID].m_X = (int)x;
-		m_aVoices[VoiceID].m_Y = (int)y;
-		m_aVoices[VoiceID].m_Falloff = 0.0f;
-		m_aVoices[VoiceID].m_Shape = ISound::SHAPE_CIRCLE;
-		m_aVoices[VoiceID].m_Circle.m_Radius = 1500;
-		Age = m_aVoices[VoiceID].m_Age;
+		Voice.m_Serial = m_NextSerial;
+		m_NextSerial = (m_NextSerial + 1) & 0x7fffffff;
+		Voice.m_Params.m_Vol = 255;
+		Voice.m_Params.m_Flags = Flags;
+		Voice.m_Params.m_X = (int)x;
+		Voice.m_Params.m_Y = (int)y;
+		Voice.m_Params.m_Falloff = 0.0f;
+		Voice.m_Params.m_Shape = ISound::SHAPE_CIRCLE;
+		Voice.m_Params.m_Circle.m_Radius = 1500;
+		Age = Voice.m_Age;
+
+		const CSample &Sample = m_aSamples[SampleID];
+		m_Mixer.Play(VoiceID, Voice.m_Serial, Sample.m_pData, Sample.m_NumFrames, Sample.m_Channels, ChannelID, Voice.m_Tick, Voice.m_Params);
 	}
 
 	return CreateVoiceHandle(VoiceID, Age);
@@ -852,14 +743,13 @@ ISound::CVoiceHandle CSound::Play(int ChannelID, int SampleID, int Flags)
 void CSound::Pause(int SampleID)
 {
 	// TODO: a nice fade out
-	const CLockScope LockScope(m_SoundLock);
 	CSample *pSample = &m_aSamples[SampleID];
-	for(auto &Voice : m_aVoices)
+	for(int VoiceID = 0; VoiceID < NUM_VOICES; VoiceID++)
 	{
-		if(Voice.m_pSample == pSample)
+		if(IsVoiceActive(VoiceID) && m_aVoices[VoiceID].m_pSample == pSample)
 		{
-			Voice.m_pSample->m_PausedAt = Voice.m_Tick;
-			Voice.m_pSample = nullptr;
+			pSample->m_PausedAt = VoiceTick(VoiceID);
+			StopVoiceMixing(VoiceID);
 		}
 	}
 }
@@ -867,17 +757,16 @@ void CSound::Pause(int SampleID)
 void CSound::Stop(int SampleID)
 {
 	// TODO: a nice fade out
-	const CLockScope LockScope(m_SoundLock);
 	CSample *pSample = &m_aSamples[SampleID];
-	for(auto &Voice : m_aVoices)
+	for(int VoiceID = 0; VoiceID < NUM_VOICES; VoiceID++)
 	{
-		if(Voice.m_pSample == pSample)
+		if(IsVoiceActive(VoiceID) && m_aVoices[VoiceID].m_pSample == pSample)
 		{
-			if(Voice.m_Flags & FLAG_LOOP)
-				Voice.m_pSample->m_PausedAt = Voice.m_Tick;
+			if(m_aVoices[VoiceID].m_Params.m_Flags & FLAG_LOOP)
+				pSample->m_PausedAt = VoiceTick(VoiceID);
 			else
-				Voice.m_pSample->m_PausedAt = 0;
-			Voice.m_pSample = nullptr;
+				pSample->m_PausedAt = 0;
+			StopVoiceMixing(VoiceID);
 		}
 	}
 }
@@ -885,17 +774,16 @@ void CSound::Stop(int SampleID)
 void CSound::StopAll()
 {
 	// TODO: a nice fade out
-	const CLockScope LockScope(m_SoundLock);
-	for(auto &Voice : m_aVoices)
+	for(int VoiceID = 0; VoiceID < NUM_VOICES; VoiceID++)
 	{
-		if(Voice.m_pSample)
+		if(IsVoiceActive(VoiceID))
 		{
-			if(Voice.m_Flags & FLAG_LOOP)
-				Voice.m_pSample->m_PausedAt = Voice.m_Tick;
+			if(m_aVoices[VoiceID].m_Params.m_Flags & FLAG_LOOP)
+				m_aVoices[VoiceID].m_pSample->m_PausedAt = VoiceTick(VoiceID);
 			else
-				Voice.m_pSample->m_PausedAt = 0;
+				m_aVoices[VoiceID].m_pSample->m_PausedAt = 0;
+			StopVoiceMixing(VoiceID);
 		}
-		Voice.m_pSample = nullptr;
 	}
 }
 
@@ -906,19 +794,22 @@ void CSound::StopVoice(CVoiceHandle Voice)
 
 	int VoiceID = Voice.Id();
 
-	const CLockScope LockScope(m_SoundLock);
-	if(m_aVoices[VoiceID].m_Age != Voice.Age())
+	if(!IsVoiceActive(VoiceID) || m_aVoices[VoiceID].m_Age != Voice.Age())
 		return;
 
-	m_aVoices[VoiceID].m_pSample = nullptr;
+	StopVoiceMixing(VoiceID);
 	m_aVoices[VoiceID].m_Age++;
 }
 
 bool CSound::IsPlaying(int SampleID)
 {
-	const CLockScope LockScope(m_SoundLock);
 	const CSample *pSample = &m_aSamples[SampleID];
-	return std::any_of(std::begin(m_aVoices), std::end(m_aVoices), [pSample](const auto &Voice) { return Voice.m_pSample == pSample; });
+	for(int VoiceID = 0; VoiceID < NUM_VOICES; VoiceID++)
+	{
+		if(IsVoiceActive(VoiceID) && m_aVoices[VoiceID].m_pSample == pSample)
+			return true;
+	}
+	return false;
 }
 
 void CSound::PauseAudioDevice()
@@ -3,13 +3,13 @@
 #ifndef ENGINE_CLIENT_SOUND_H
 #define ENGINE_CLIENT_SOUND_H
 
-#include <base/lock.h>
-
 #include <engine/sound.h>
 
+#include "sound_mixer.h"
+
 #include <SDL_audio.h>
 
-#include <atomic>
+#include <vector>
 
 struct CSample
 {
@@ -22,29 +22,20 @@ struct CSample
 	int m_PausedAt;
 };
 
-struct CChannel
-{
-	int m_Vol;
-	int m_Pan;
-};
-
 struct CVoice
 {
 	CSample *m_pSample;
-	CChannel *m_pChannel;
+	int m_ChannelID;
 	int m_Age; // increases when reused
-	int m_Tick;
-	int m_Vol; // 0 - 255
-	int m_Flags;
-	int m_X, m_Y;
-	float m_Falloff; // [0.0, 1.0]
-
-	int m_Shape;
-	union
-	{
-		ISound::CVoiceShapeCircle m_Circle;
-		ISound::CVoiceShapeRectangle m_Rectangle;
-	};
+	int m_Serial; // identifies the playback to the mixer
+	int m_Tick; // where the playback was started or moved to
+	CSoundMixer::CVoiceParams m_Params;
+};
+
+struct CPendingFree
+{
+	short *m_pData;
+	uint64_t m_Sequence;
 };
 
 class CSound : public IEngineSound
@@ -52,30 +43,29 @@ class CSound : public IEngineSound
 	enum
 	{
 		NUM_SAMPLES = 512,
-		NUM_VOICES = 256,
-		NUM_CHANNELS = 16,
+		NUM_VOICES = CSoundMixer::NUM_VOICES,
+		NUM_CHANNELS = CSoundMixer::NUM_CHANNELS,
 	};
 
 	bool m_SoundEnabled = false;
 	SDL_AudioDeviceID m_Device = 0;
-	CLock m_SoundLock;
 
+	// the voices are only touched by the game thread, the audio callback
+	// mixes its own copy that is kept up to date through commands
+	CSoundMixer m_Mixer;
 	CSample m_aSamples[NUM_SAMPLES] = {{0}};
 	CVoice m_aVoices[NUM_VOICES] = {{0}};
-	CChannel m_aChannels[NUM_CHANNELS] = {{255, 0}};
 	int m_NextVoice = 0;
+	int m_NextSerial = 0;
 	uint32_t m_MaxFrames = 0;
+	// sample data stays around until the mixer is done with it
+	std::vector<CPendingFree> m_vPendingFrees;
 
-	std::atomic<int> m_CenterX = 0;
-	std::atomic<int> m_CenterY = 0;
-	std::atomic<int> m_SoundVolume = 100;
 	int m_MixingRate = 48000;
 
 	class IEngineGraphics *m_pGraphics = nullptr;
 	IStorage *m_pStorage = nullptr;
 
-	int *m_pMixBuffer = nullptr;
-
 	int AllocID();
 	void RateConvert(CSample &Sample);
 
@@ -83,11 +73,15 @@ class CSound : public IEngineSound
 	bool DecodeWV(CSample &Sample, const void *pData, unsigned DataSize);
 
 	void UpdateVolume();
+	void FreePendingSamples(bool All);
+	bool IsVoiceActive(int VoiceID);
+	int VoiceTick(int VoiceID) const;
+	void StopVoiceMixing(int VoiceID);
 
 public:
 	int Init() override;
 	int Update() override;
-	void Shutdown() override REQUIRES(!m_SoundLock);
+	void Shutdown() override;
 
 	bool IsSoundEnabled() override { return m_SoundEnabled; }
 
@@ -95,33 +89,33 @@ public:
 	int LoadWV(const char *pFilename, int StorageType = IStorage::TYPE_ALL) override;
 	int LoadOpusFromMem(const void *pData, unsigned DataSize, bool FromEditor) override;
 	int LoadWVFromMem(const void *pData, unsigned DataSize, bool FromEditor) override;
-	void UnloadSample(int SampleID) override REQUIRES(!m_SoundLock);
+	void UnloadSample(int SampleID) override;
 
 	float GetSampleTotalTime(int SampleID) override; // in s
-	float GetSampleCurrentTime(int SampleID) override REQUIRES(!m_SoundLock); // in s
-	void SetSampleCurrentTime(int SampleID, float Time) override REQUIRES(!m_SoundLock);
+	float GetSampleCurrentTime(int SampleID) override; // in s
+	void SetSampleCurrentTime(int SampleID, float Time) override;
 
 	void SetChannel(int ChannelID, float Vol, float Pan) override;
 	void SetListenerPos(float x, float y) override;
 
-	void SetVoiceVolume(CVoiceHandle Voice, float Volume) override REQUIRES(!m_SoundLock);
-	void SetVoiceFalloff(CVoiceHandle Voice, float Falloff) override REQUIRES(!m_SoundLock);
-	void SetVoiceLocation(CVoiceHandle Voice, float x, float y) override REQUIRES(!m_SoundLock);
-	void SetVoiceTimeOffset(CVoiceHandle Voice, float TimeOffset) override REQUIRES(!m_SoundLock); // in s
+	void SetVoiceVolume(CVoiceHandle Voice, float Volume) override;
+	void SetVoiceFalloff(CVoiceHandle Voice, float Falloff) override;
+	void SetVoiceLocation(CVoiceHandle Voice, float x, float y) override;
+	void SetVoiceTimeOffset(CVoiceHandle Voice, float TimeOffset) override; // in s
 
-	void SetVoiceCircle(CVoiceHandle Voice, float Radius) override REQUIRES(!m_SoundLock);
-	void SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height) override REQUIRES(!m_SoundLock);
+	void SetVoiceCircle(CVoiceHandle Voice, float Radius) override;
+	void SetVoiceRectangle(CVoiceHandle Voice, float Width, float Height) override;
 
-	CVoiceHandle Play(int ChannelID, int SampleID, int Flags, float x, float y) REQUIRES(!m_SoundLock);
-	CVoiceHandle PlayAt(int ChannelID, int SampleID, int Flags, float x, float y) override REQUIRES(!m_SoundLock);
-	CVoiceHandle Play(int ChannelID, int SampleID, int Flags) override REQUIRES(!m_SoundLock);
-	void Pause(int SampleID) override REQUIRES(!m_SoundLock);
-	void Stop(int SampleID) override REQUIRES(!m_SoundLock);
-	void StopAll() override REQUIRES(!m_SoundLock);
-	void StopVoice(CVoiceHandle Voice) override REQUIRES(!m_SoundLock);
-	bool IsPlaying(int SampleID) override REQUIRES(!m_SoundLock);
+	CVoiceHandle Play(int ChannelID, int SampleID, int Flags, float x, float y);
+	CVoiceHandle PlayAt(int ChannelID, int SampleID, int Flags, float x, float y) override;
+	CVoiceHandle Play(int ChannelID, int SampleID, int Flags) override;
+	void Pause(int SampleID) override;
+	void Stop(int SampleID) override;
+	void StopAll() override;
+	void StopVoice(CVoiceHandle Voice) override;
+	bool IsPlaying(int SampleID) override;
 
-	void Mix(short *pFinalOut, unsigned Frames) override REQUIRES(!m_SoundLock);
+	void Mix(short *pFinalOut, unsigned Frames) override;
 	void PauseAudioDevice() override;
 	void UnpauseAudioDevice() override;
 };
@@ -0,0 +1,404 @@
+#include "sound_mixer.h"
+
+#include <base/math.h>
+#include <base/vmath.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOUND_MIXER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include <limits>
+
+CSoundMixer::CSoundMixer()
+{
+	m_vOverflow.reserve(COMMAND_QUEUE_SIZE);
+}
+
+void CSoundMixer::Init(unsigned MaxFrames)
+{
+	m_vMixBuffer.assign((size_t)MaxFrames * 2, 0);
+}
+
+bool CSoundMixer::TryPush(const CCommand &Command)
+{
+	const uint64_t Write = m_CommandWrite.load(std::memory_order_relaxed);
+	if(Write - m_CommandRead.load(std::memory_order_acquire) >= COMMAND_QUEUE_SIZE)
+		return false;
+	m_aCommands[Write % COMMAND_QUEUE_SIZE] = Command;
+	m_CommandWrite.store(Write + 1, std::memory_order_release);
+	return true;
+}
+
+void CSoundMixer::Flush()
+{
+	size_t NumPushed = 0;
+	while(NumPushed < m_vOverflow.size() && TryPush(m_vOverflow[NumPushed]))
+		NumPushed++;
+	m_vOverflow.erase(m_vOverflow.begin(), m_vOverflow.begin() + NumPushed);
+}
+
+void CSoundMixer::Push(const CCommand &Command)
+{
+	// without a mix buffer nothing takes the commands
+	if(m_vMixBuffer.empty())
+		return;
+
+	m_NumPushed++;
+	// the audio device might be paused, the commands are kept in order
+	// until there is room again
+	if(!m_vOverflow.empty())
+		Flush();
+	if(!m_vOverflow.empty() || !TryPush(Command))
+		m_vOverflow.push_back(Command);
+}
+
+void CSoundMixer::Play(int Voice, int Serial, const short *pData, int NumFrames, int Channels, int ChannelID, int Tick, const CVoiceParams &Params)
+{
+	CCommand Command;
+	Command.m_Type = COMMAND_PLAY;
+	Command.m_Voice = Voice;
+	Command.m_Serial = Serial;
+	Command.m_Tick = Tick;
+	Command.m_pData = pData;
+	Command.m_NumFrames = NumFrames;
+	Command.m_Channels = Channels;
+	Command.m_ChannelID = ChannelID;
+	Command.m_Params = Params;
+	Push(Command);
+}
+
+void CSoundMixer::SetParams(int Voice, int Serial, const CVoiceParams &Params)
+{
+	CCommand Command = {};
+	Command.m_Type = COMMAND_PARAMS;
+	Command.m_Voice = Voice;
+	Command.m_Serial = Serial;
+	Command.m_Params = Params;
+	Push(Command);
+}
+
+void CSoundMixer::Seek(int Voice, int Serial, int Tick)
+{
+	CCommand Command = {};
+	Command.m_Type = COMMAND_SEEK;
+	Command.m_Voice = Voice;
+	Command.m_Serial = Serial;
+	Command.m_Tick = Tick;
+	Push(Command);
+}
+
+void CSoundMixer::Stop(int Voice, int Serial)
+{
+	CCommand Command = {};
+	Command.m_Type = COMMAND_STOP;
+	Command.m_Voice = Voice;
+	Command.m_Serial = Serial;
+	Push(Command);
+}
+
+bool CSoundMixer::Finished(int Voice, int Serial) const
+{
+	return m_aVoiceStates[Voice].m_FinishedSerial.load(std::memory_order_acquire) == Serial;
+}
+
+bool CSoundMixer::Position(int Voice, int Serial, int *pTick) const
+{
+	const uint64_t Position = m_aVoiceStates[Voice].m_Position.load(std::memory_order_relaxed);
+	if((int)(Position >> 32) != Serial)
+		return false;
+	*pTick = (int)(uint32_t)Position;
+	return true;
+}
+
+void CSoundMixer::SetChannel(int ChannelID, int Vol, int Pan)
+{
+	m_aChannels[ChannelID].m_Vol.store(Vol, std::memory_order_relaxed);
+	m_aChannels[ChannelID].m_Pan.store(Pan, std::memory_order_relaxed);
+}
+
+void CSoundMixer::SetListenerPos(int X, int Y)
+{
+	m_CenterX.store(X, std::memory_order_relaxed);
+	m_CenterY.store(Y, std::memory_order_relaxed);
+}
+
+void CSoundMixer::ApplyCommands()
+{
+	uint64_t Read = m_CommandRead.load(std::memory_order_relaxed);
+	const uint64_t Write = m_CommandWrite.load(std::memory_order_acquire);
+	for(; Read != Write; Read++)
+	{
+		const CCommand &Command = m_aCommands[Read % COMMAND_QUEUE_SIZE];
+		CMixVoice &Voice = m_aVoices[Command.m_Voice];
+		if(Command.m_Type == COMMAND_PLAY)
+		{
+			Voice.m_pData = Command.m_pData;
+			Voice.m_NumFrames = Command.m_NumFrames;
+			Voice.m_Channels = Command.m_Channels;
+			Voice.m_ChannelID = Command.m_ChannelID;
+			Voice.m_Serial = Command.m_Serial;
+			Voice.m_Tick = clamp(Command.m_Tick, 0, Command.m_NumFrames);
+			Voice.m_Params = Command.m_Params;
+			continue;
+		}
+
+		// the voice might have finished and been replaced since
+		if(!Voice.m_pData || Voice.m_Serial != Command.m_Serial)
+			continue;
+		if(Command.m_Type == COMMAND_PARAMS)
+			Voice.m_Params = Command.m_Params;
+		else if(Command.m_Type == COMMAND_SEEK)
+			Voice.m_Tick = clamp(Command.m_Tick, 0, Voice.m_NumFrames);
+		else if(Command.m_Type == COMMAND_STOP)
+			Voice.m_pData = nullptr;
+	}
+	m_CommandRead.store(Read, std::memory_order_release);
+}
+
+void CSoundMixer::VoiceVolume(const CMixVoice &Voice, int *pVolumeL, int *pVolumeR) const
+{
+	const CChannelState &Channel = m_aChannels[Voice.m_ChannelID];
+	const CVoiceParams &Params = Voice.m_Params;
+	int VolumeR = round_truncate(Channel.m_Vol.load(std::memory_order_relaxed) * (Params.m_Vol / 255.0f));
+	int VolumeL = VolumeR;
+
+	// volume calculation
+	if(Params.m_Flags & ISound::FLAG_POS && Channel.m_Pan.load(std::memory_order_relaxed))
+	{
+		// TODO: we should respect the channel panning value
+		const int dx = Params.m_X - m_CenterX.load(std::memory_order_relaxed);
+		const int dy = Params.m_Y - m_CenterY.load(std::memory_order_relaxed);
+		float FalloffX = 0.0f;
+		float FalloffY = 0.0f;
+
+		int RangeX = 0; // for panning
+		bool InVoiceField = false;
+
+		switch(Params.m_Shape)
+		{
+		case ISound::SHAPE_CIRCLE:
+		{
+			const float Radius = Params.m_Circle.m_Radius;
+			RangeX = Radius;
+
+			// dx and dy can be larger than 46341 and thus the calculation would go beyond the limits of a integer,
+			// therefore we cast them into float
+			const int Dist = (int)length(vec2(dx, dy));
+			if(Dist < Radius)
+			{
+				InVoiceField = true;
+
+				// falloff
+				int FalloffDistance = Radius * Params.m_Falloff;
+				if(Dist > FalloffDistance)
+					FalloffX = FalloffY = (Radius - Dist) / (Radius - FalloffDistance);
+				else
+					FalloffX = FalloffY = 1.0f;
+			}
+			else
+				InVoiceField = false;
+
+			break;
+		}
+
+		case ISound::SHAPE_RECTANGLE:
+		{
+			RangeX = Params.m_Rectangle.m_Width / 2.0f;
+
+			const int abs_dx = absolute(dx);
+			const int abs_dy = absolute(dy);
+
+			const int w = Params.m_Rectangle.m_Width / 2.0f;
+			const int h = Params.m_Rectangle.m_Height / 2.0f;
+
+			if(abs_dx < w && abs_dy < h)
+			{
+				InVoiceField = true;
+
+				// falloff
+				int fx = Params.m_Falloff * w;
+				int fy = Params.m_Falloff * h;
+
+				FalloffX = abs_dx > fx ? (float)(w - abs_dx) / (w - fx) : 1.0f;
+				FalloffY = abs_dy > fy ? (float)(h - abs_dy) / (h - fy) : 1.0f;
+			}
+			else
+				InVoiceField = false;
+
+			break;
+		}
+		};
+
+		if(InVoiceField)
+		{
+			// panning
+			if(!(Params.m_Flags & ISound::FLAG_NO_PANNING))
+			{
+				if(dx > 0)
+					VolumeL = ((RangeX - absolute(dx)) * VolumeL) / RangeX;
+				else
+					VolumeR = ((RangeX - absolute(dx)) * VolumeR) / RangeX;
+			}
+
+			{
+				VolumeL *= FalloffX * FalloffY;
+				VolumeR *= FalloffX * FalloffY;
+			}
+		}
+		else
+		{
+			VolumeL = 0;
+			VolumeR = 0;
+		}
+	}
+
+	// the kernels multiply in 16 bit
+	*pVolumeL = clamp(VolumeL, 0, (int)std::numeric_limits<short>::max());
+	*pVolumeR = clamp(VolumeR, 0, (int)std::numeric_limits<short>::max());
+}
+
+#if defined(SOUND_MIXER_SSE2)
+// adds four stereo frames in 16 bit to the 32 bit output
+static inline void MixFrames4(int *pOut, __m128i Frames, __m128i Volume)
+{
+	const __m128i Low = _mm_mullo_epi16(Frames, Volume);
+	const __m128i High = _mm_mulhi_epi16(Frames, Volume);
+	__m128i *pOut128 = (__m128i *)pOut;
+	_mm_storeu_si128(pOut128, _mm_add_epi32(_mm_loadu_si128(pOut128), _mm_unpacklo_epi16(Low, High)));
+	_mm_storeu_si128(pOut128 + 1, _mm_add_epi32(_mm_loadu_si128(pOut128 + 1), _mm_unpackhi_epi16(Low, High)));
+}
+#endif
+
+void CSoundMixer::MixMono(int *pOut, const short *pIn, unsigned Frames, int VolumeL, int VolumeR)
+{
+	unsigned i = 0;
+#if defined(SOUND_MIXER_SSE2)
+	const __m128i Volume = _mm_set_epi16(VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL);
+	for(; i + 8 <= Frames; i += 8)
+	{
+		const __m128i In = _mm_loadu_si128((const __m128i *)(pIn + i));
+		MixFrames4(pOut + 2 * i, _mm_unpacklo_epi16(In, In), Volume);
+		MixFrames4(pOut + 2 * i + 8, _mm_unpackhi_epi16(In, In), Volume);
+	}
+#endif
+	for(; i < Frames; i++)
+	{
+		pOut[2 * i] += pIn[i] * VolumeL;
+		pOut[2 * i + 1] += pIn[i] * VolumeR;
+	}
+}
+
+void CSoundMixer::MixStereo(int *pOut, const short *pIn, unsigned Frames, int VolumeL, int VolumeR)
+{
+	unsigned i = 0;
+#if defined(SOUND_MIXER_SSE2)
+	const __m128i Volume = _mm_set_epi16(VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL, VolumeR, VolumeL);
+	for(; i + 4 <= Frames; i += 4)
+		MixFrames4(pOut + 2 * i, _mm_loadu_si128((const __m128i *)(pIn + 2 * i)), Volume);
+#endif
+	for(; i < Frames; i++)
+	{
+		pOut[2 * i] += pIn[2 * i] * VolumeL;
+		pOut[2 * i + 1] += pIn[2 * i + 1] * VolumeR;
+	}
+}
+
+void CSoundMixer::Clip(short *pOut, const int *pIn, unsigned Samples, int MasterVol)
+{
+	// same as ((In * MasterVol) / 101) >> 8, without overflowing
+	const float Scale = MasterVol / (101.0f * 256.0f);
+	const float Min = std::numeric_limits<short>::min();
+	const float Max = std::numeric_limits<short>::max();
+	unsigned i = 0;
+#if defined(SOUND_MIXER_SSE2)
+	const __m128 Scale128 = _mm_set1_ps(Scale);
+	const __m128 Min128 = _mm_set1_ps(Min);
+	const __m128 Max128 = _mm_set1_ps(Max);
+	for(; i + 8 <= Samples; i += 8)
+	{
+		const __m128 In0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(pIn + i))), Scale128);
+		const __m128 In1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(pIn + i + 4))), Scale128);
+		const __m128i Out0 = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(In0, Min128), Max128));
+		const __m128i Out1 = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(In1, Min128), Max128));
+		_mm_storeu_si128((__m128i *)(pOut + i), _mm_packs_epi32(Out0, Out1));
+	}
+#endif
+	for(; i < Samples; i++)
+		pOut[i] = (short)clamp(pIn[i] * Scale, Min, Max);
+}
+
+void CSoundMixer::Mix(short *pFinalOut, unsigned Frames)
+{
+	ApplyCommands();
+	const uint64_t NumApplied = m_CommandRead.load(std::memory_order_relaxed);
+
+	const unsigned MaxFrames = m_vMixBuffer.size() / 2;
+	if(!MaxFrames)
+	{
+		mem_zero(pFinalOut, Frames * 2 * sizeof(short));
+		return;
+	}
+
+	// the volumes only change between buffers
+	int aVolumeL[NUM_VOICES];
+	int aVolumeR[NUM_VOICES];
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		if(m_aVoices[i].m_pData)
+			VoiceVolume(m_aVoices[i], &aVolumeL[i], &aVolumeR[i]);
+	}
+
+	const int MasterVol = m_MasterVol.load(std::memory_order_relaxed);
+	int *pMixBuffer = m_vMixBuffer.data();
+	for(unsigned Done = 0; Done < Frames;)
+	{
+		const unsigned Part = minimum(Frames - Done, MaxFrames);
+		mem_zero(pMixBuffer, Part * 2 * sizeof(int));
+
+		for(int i = 0; i < NUM_VOICES; i++)
+		{
+			CMixVoice &Voice = m_aVoices[i];
+			unsigned Mixed = 0;
+			while(Voice.m_pData && Mixed < Part)
+			{
+				const unsigned End = minimum<unsigned>(Part - Mixed, Voice.m_NumFrames - Voice.m_Tick);
+				// voices that cannot be heard only move on
+				if(aVolumeL[i] || aVolumeR[i])
+				{
+					if(Voice.m_Channels == 1)
+						MixMono(pMixBuffer + 2 * Mixed, Voice.m_pData + Voice.m_Tick, End, aVolumeL[i], aVolumeR[i]);
+					else
+						MixStereo(pMixBuffer + 2 * Mixed, Voice.m_pData + Voice.m_Tick * 2, End, aVolumeL[i], aVolumeR[i]);
+				}
+				Mixed += End;
+				Voice.m_Tick += End;
+
+				// free voice if not used any more
+				if(Voice.m_Tick == Voice.m_NumFrames)
+				{
+					if(Voice.m_Params.m_Flags & ISound::FLAG_LOOP && Voice.m_NumFrames > 0)
+						Voice.m_Tick = 0;
+					else
+					{
+						Voice.m_pData = nullptr;
+						m_aVoiceStates[i].m_FinishedSerial.store(Voice.m_Serial, std::memory_order_release);
+					}
+				}
+			}
+		}
+
+		Clip(pFinalOut + 2 * Done, pMixBuffer, Part * 2, MasterVol);
+		Done += Part;
+	}
+
+	for(int i = 0; i < NUM_VOICES; i++)
+	{
+		const CMixVoice &Voice = m_aVoices[i];
+		if(Voice.m_pData)
+			m_aVoiceStates[i].m_Position.store((uint64_t)(uint32_t)Voice.m_Serial << 32 | (uint32_t)Voice.m_Tick, std::memory_order_relaxed);
+	}
+
+	// stopped sample data is not touched anymore
+	m_NumMixed.store(NumApplied, std::memory_order_release);
+}
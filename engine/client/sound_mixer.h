@@ -0,0 +1,151 @@
+#ifndef ENGINE_CLIENT_SOUND_MIXER_H
+#define ENGINE_CLIENT_SOUND_MIXER_H
+
+#include <base/system.h>
+
+#include <engine/sound.h>
+
+#include <atomic>
+#include <vector>
+
+// Mixes the voices on the audio thread without ever waiting for the game
+// thread. The game thread owns the voice allocation and sends every change
+// through a single producer, single consumer command queue. The mixer
+// applies the commands at the start of a buffer and reports back where the
+// voices are and which ones finished.
+class CSoundMixer
+{
+public:
+	enum
+	{
+		NUM_VOICES = 256,
+		NUM_CHANNELS = 16,
+	};
+
+	struct CVoiceParams
+	{
+		int m_Vol; // 0 - 255
+		int m_Flags;
+		int m_X, m_Y;
+		float m_Falloff; // [0.0, 1.0]
+
+		int m_Shape;
+		union
+		{
+			ISound::CVoiceShapeCircle m_Circle;
+			ISound::CVoiceShapeRectangle m_Rectangle;
+		};
+	};
+
+private:
+	enum
+	{
+		COMMAND_PLAY = 0,
+		COMMAND_PARAMS,
+		COMMAND_SEEK,
+		COMMAND_STOP,
+
+		// power of two
+		COMMAND_QUEUE_SIZE = 4096,
+	};
+
+	struct CCommand
+	{
+		int m_Type;
+		int m_Voice;
+		int m_Serial;
+		int m_Tick;
+		const short *m_pData;
+		int m_NumFrames;
+		int m_Channels;
+		int m_ChannelID;
+		CVoiceParams m_Params;
+	};
+
+	struct CMixVoice
+	{
+		const short *m_pData; // nullptr if the voice is not playing
+		int m_NumFrames;
+		int m_Channels;
+		int m_ChannelID;
+		int m_Serial;
+		int m_Tick;
+		CVoiceParams m_Params;
+	};
+
+	struct CVoiceState
+	{
+		// serial of the playback in the upper and the tick in the lower half
+		std::atomic<uint64_t> m_Position{0};
+		std::atomic<int> m_FinishedSerial{-1};
+	};
+
+	struct CChannelState
+	{
+		std::atomic<int> m_Vol{255};
+		std::atomic<int> m_Pan{0};
+	};
+
+	// game thread
+	uint64_t m_NumPushed = 0;
+	std::vector<CCommand> m_vOverflow;
+
+	// shared
+	CCommand m_aCommands[COMMAND_QUEUE_SIZE];
+	std::atomic<uint64_t> m_CommandWrite{0};
+	std::atomic<uint64_t> m_CommandRead{0};
+	std::atomic<uint64_t> m_NumMixed{0};
+	CVoiceState m_aVoiceStates[NUM_VOICES];
+	CChannelState m_aChannels[NUM_CHANNELS];
+	std::atomic<int> m_CenterX{0};
+	std::atomic<int> m_CenterY{0};
+	std::atomic<int> m_MasterVol{100};
+
+	// audio thread
+	CMixVoice m_aVoices[NUM_VOICES] = {};
+	std::vector<int> m_vMixBuffer;
+
+	void Push(const CCommand &Command);
+	bool TryPush(const CCommand &Command);
+	void ApplyCommands();
+	void VoiceVolume(const CMixVoice &Voice, int *pVolumeL, int *pVolumeR) const;
+
+public:
+	CSoundMixer();
+
+	// the mix buffer is allocated once, larger requests are mixed in parts
+	void Init(unsigned MaxFrames);
+
+	// game thread
+	void Play(int Voice, int Serial, const short *pData, int NumFrames, int Channels, int ChannelID, int Tick, const CVoiceParams &Params);
+	void SetParams(int Voice, int Serial, const CVoiceParams &Params);
+	void Seek(int Voice, int Serial, int Tick);
+	void Stop(int Voice, int Serial);
+	// retries the commands that did not fit into the queue
+	void Flush();
+
+	bool Finished(int Voice, int Serial) const;
+	// the tick of the playback as of the last mixed buffer, false if it was not mixed yet
+	bool Position(int Voice, int Serial, int *pTick) const;
+	// the number of commands sent so far, sample data that was stopped
+	// before can be freed once Reached returns true for it
+	uint64_t Sequence() const { return m_NumPushed; }
+	bool Reached(uint64_t Sequence) const { return m_NumMixed.load(std::memory_order_acquire) >= Sequence; }
+
+	// any thread
+	void SetChannel(int ChannelID, int Vol, int Pan);
+	void SetListenerPos(int X, int Y);
+	void SetMasterVolume(int Vol) { m_MasterVol.store(Vol, std::memory_order_relaxed); }
+
+	// audio thread
+	void Mix(short *pFinalOut, unsigned Frames);
+
+	// add the frames multiplied with the volumes to the interleaved stereo
+	// output, a mono input is played on both sides
+	static void MixMono(int *pOut, const short *pIn, unsigned Frames, int VolumeL, int VolumeR);
+	static void MixStereo(int *pOut, const short *pIn, unsigned Frames, int VolumeL, int VolumeR);
+	// scales by the master volume and saturates to 16 bit
+	static void Clip(short *pOut, const int *pIn, unsigned Samples, int MasterVol);
+};
+
+#endif
@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/lock.h>
 #include <base/log.h>
 #include <base/math.h>
 #include <base/system.h>
@@ -13,9 +14,12 @@
 // ft2 texture
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_OUTLINE_H
 
+#include <atomic>
 #include <chrono>
 #include <cstddef>
+#include <deque>
 #include <limits>
 #include <tuple>
 #include <unordered_map>
@@ -76,6 +80,27 @@ struct SGlyphKeyEquals
 	}
 };
 
+struct SKerningKeyHash
+{
+	size_t operator()(const std::tuple<FT_Face, int, int, int> &Key) const
+	{
+		size_t Hash = 17;
+		Hash = Hash * 31 + std::hash<FT_Face>()(std::get<0>(Key));
+		Hash = Hash * 31 + std::hash<int>()(std::get<1>(Key));
+		Hash = Hash * 31 + std::hash<int>()(std::get<2>(Key));
+		Hash = Hash * 31 + std::hash<int>()(std::get<3>(Key));
+		return Hash;
+	}
+};
+
+struct SKerningKeyEquals
+{
+	bool operator()(const std::tuple<FT_Face, int, int, int> &Lhs, const std::tuple<FT_Face, int, int, int> &Rhs) const
+	{
+		return std::get<0>(Lhs) == std::get<0>(Rhs) && std::get<1>(Lhs) == std::get<1>(Rhs) && std::get<2>(Lhs) == std::get<2>(Rhs) && std::get<3>(Lhs) == std::get<3>(Rhs);
+	}
+};
+
 class CAtlas
 {
 	struct SSectionKeyHash
@@ -271,6 +296,250 @@ public:
 	}
 };
 
+/**
+ * Rasterizes glyphs on a worker thread, so text with many new
+ * characters does not stall the render thread.
+ *
+ * FreeType faces must not be used from multiple threads at the same time,
+ * so the worker opens its own faces from the same font data in its own
+ * library. The faces of the render thread are only used as keys.
+ */
+class CGlyphRasterizer
+{
+public:
+	enum
+	{
+		FONT_TEXTURE_FILL = 0,
+		FONT_TEXTURE_OUTLINE,
+		NUM_FONT_TEXTURES,
+	};
+
+	struct SRequest
+	{
+		unsigned m_Generation;
+		FT_Face m_Face;
+		FT_UInt m_GlyphIndex;
+		int m_Chr;
+		int m_FontSize;
+		// atlas region reserved for the glyph, including the outline padding
+		int m_X;
+		int m_Y;
+		unsigned m_Width;
+		unsigned m_Height;
+		int m_Padding;
+		int m_OutlineThickness;
+	};
+
+	struct SResult
+	{
+		SRequest m_Request;
+		std::vector<uint8_t> m_avData[NUM_FONT_TEXTURES];
+	};
+
+private:
+	struct SFaceSource
+	{
+		const FT_Byte *m_pData;
+		FT_Long m_DataSize;
+		FT_Long m_FaceIndex;
+	};
+
+	CLock m_Lock;
+	SEMAPHORE m_Semaphore;
+	void *m_pThread = nullptr;
+	bool m_Shutdown GUARDED_BY(m_Lock) = false;
+	unsigned m_Generation GUARDED_BY(m_Lock) = 0;
+	std::deque<SRequest> m_Requests GUARDED_BY(m_Lock);
+	std::vector<SResult> m_vResults GUARDED_BY(m_Lock);
+	std::atomic<bool> m_HasResults = false;
+	std::unordered_map<FT_Face, SFaceSource> m_FaceSources GUARDED_BY(m_Lock);
+
+	// only used by the worker thread
+	FT_Library m_Library = nullptr;
+	std::unordered_map<FT_Face, FT_Face> m_WorkerFaces;
+
+	static void Grow(const unsigned char *pIn, unsigned char *pOut, int w, int h, int OutlineCount)
+	{
+		for(int y = 0; y < h; y++)
+		{
+			for(int x = 0; x < w; x++)
+			{
+				int c = pIn[y * w + x];
+
+				for(int sy = -OutlineCount; sy <= OutlineCount; sy++)
+				{
+					for(int sx = -OutlineCount; sx <= OutlineCount; sx++)
+					{
+						int GetX = x + sx;
+						int GetY = y + sy;
+						if(GetX >= 0 && GetY >= 0 && GetX < w && GetY < h)
+						{
+							int Index = GetY * w + GetX;
+							if(pIn[Index] > c)
+								c = pIn[Index];
+						}
+					}
+				}
+
+				pOut[y * w + x] = c;
+			}
+		}
+	}
+
+	FT_Face WorkerFace(FT_Face Face) REQUIRES(!m_Lock)
+	{
+		auto It = m_WorkerFaces.find(Face);
+		if(It != m_WorkerFaces.end())
+			return It->second;
+
+		SFaceSource Source;
+		{
+			const CLockScope LockScope(m_Lock);
+			auto SourceIt = m_FaceSources.find(Face);
+			if(SourceIt == m_FaceSources.end())
+				return nullptr;
+			Source = SourceIt->second;
+		}
+
+		FT_Face WorkerFace = nullptr;
+		if(m_Library == nullptr || FT_New_Memory_Face(m_Library, Source.m_pData, Source.m_DataSize, Source.m_FaceIndex, &WorkerFace))
+			WorkerFace = nullptr;
+		m_WorkerFaces[Face] = WorkerFace;
+		return WorkerFace;
+	}
+
+	bool Rasterize(const SRequest &Request, SResult &Result) REQUIRES(!m_Lock)
+	{
+		FT_Face Face = WorkerFace(Request.m_Face);
+		if(Face == nullptr)
+			return false;
+
+		FT_Set_Pixel_Sizes(Face, 0, Request.m_FontSize);
+		if(FT_Load_Glyph(Face, Request.m_GlyphIndex, FT_LOAD_RENDER | FT_LOAD_NO_BITMAP))
+		{
+			log_debug("textrender", "Error rendering glyph. Chr=%d GlyphIndex=%u", Request.m_Chr, Request.m_GlyphIndex);
+			return false;
+		}
+
+		const FT_Bitmap *pBitmap = &Face->glyph->bitmap;
+		const size_t Width = Request.m_Width;
+		const size_t Height = Request.m_Height;
+		if(pBitmap->width + Request.m_Padding * 2 != Width || pBitmap->rows + Request.m_Padding * 2 != Height)
+		{
+			log_debug("textrender", "Rendered glyph does not match its region. Chr=%d GlyphIndex=%u", Request.m_Chr, Request.m_GlyphIndex);
+			return false;
+		}
+
+		Result.m_Request = Request;
+		std::vector<uint8_t> &vFill = Result.m_avData[FONT_TEXTURE_FILL];
+		std::vector<uint8_t> &vOutline = Result.m_avData[FONT_TEXTURE_OUTLINE];
+		vFill.assign(Width * Height, 0);
+		vOutline.resize(Width * Height);
+		for(size_t py = 0; py < pBitmap->rows; ++py)
+		{
+			mem_copy(&vFill[(py + Request.m_Padding) * Width + Request.m_Padding], &pBitmap->buffer[py * pBitmap->pitch], pBitmap->width);
+		}
+		Grow(vFill.data(), vOutline.data(), Width, Height, Request.m_OutlineThickness);
+		return true;
+	}
+
+	static void Run(void *pUser)
+	{
+		CGlyphRasterizer *pThis = static_cast<CGlyphRasterizer *>(pUser);
+		while(true)
+		{
+			sphore_wait(&pThis->m_Semaphore);
+
+			SRequest Request;
+			{
+				const CLockScope LockScope(pThis->m_Lock);
+				if(pThis->m_Shutdown)
+					break;
+				if(pThis->m_Requests.empty())
+					continue; // discarded by a clear
+				Request = pThis->m_Requests.front();
+				pThis->m_Requests.pop_front();
+			}
+
+			SResult Result;
+			if(!pThis->Rasterize(Request, Result))
+				continue;
+
+			const CLockScope LockScope(pThis->m_Lock);
+			if(Request.m_Generation != pThis->m_Generation)
+				continue; // the atlas was cleared in the meantime
+			pThis->m_vResults.push_back(std::move(Result));
+			pThis->m_HasResults.store(true, std::memory_order_release);
+		}
+	}
+
+public:
+	CGlyphRasterizer()
+	{
+		// faces are created and used on the worker thread only
+		FT_Init_FreeType(&m_Library);
+		sphore_init(&m_Semaphore);
+		m_pThread = thread_init(Run, this, "glyph rasterizer");
+	}
+
+	~CGlyphRasterizer()
+	{
+		{
+			const CLockScope LockScope(m_Lock);
+			m_Shutdown = true;
+		}
+		sphore_signal(&m_Semaphore);
+		thread_wait(m_pThread);
+		sphore_destroy(&m_Semaphore);
+
+		if(m_Library != nullptr)
+			FT_Done_FreeType(m_Library);
+	}
+
+	void AddFace(FT_Face Face, const FT_Byte *pData, FT_Long DataSize) REQUIRES(!m_Lock)
+	{
+		const CLockScope LockScope(m_Lock);
+		m_FaceSources[Face] = {pData, DataSize, Face->face_index};
+	}
+
+	unsigned Generation() REQUIRES(!m_Lock)
+	{
+		const CLockScope LockScope(m_Lock);
+		return m_Generation;
+	}
+
+	void Queue(const SRequest &Request) REQUIRES(!m_Lock)
+	{
+		{
+			const CLockScope LockScope(m_Lock);
+			m_Requests.push_back(Request);
+		}
+		sphore_signal(&m_Semaphore);
+	}
+
+	// Drops all queued requests and results, glyphs that are being
+	// rasterized right now are dropped when they are done.
+	void Discard() REQUIRES(!m_Lock)
+	{
+		const CLockScope LockScope(m_Lock);
+		m_Generation++;
+		m_Requests.clear();
+		m_vResults.clear();
+		m_HasResults.store(false, std::memory_order_relaxed);
+	}
+
+	bool TakeResults(std::vector<SResult> &vResults) REQUIRES(!m_Lock)
+	{
+		if(!m_HasResults.load(std::memory_order_acquire))
+			return false;
+		const CLockScope LockScope(m_Lock);
+		std::swap(vResults, m_vResults);
+		m_vResults.clear();
+		m_HasResults.store(false, std::memory_order_relaxed);
+		return !vResults.empty();
+	}
+};
+
 class CGlyphMap
 {
 public:
@@ -320,6 +589,12 @@ private:
 	uint8_t *m_apTextureData[NUM_FONT_TEXTURES];
 	CAtlas m_TextureAtlas;
 	std::unordered_map<std::tuple<FT_Face, int, int>, SGlyph, SGlyphKeyHash, SGlyphKeyEquals> m_Glyphs;
+	// (font face, font size, left character, right character) -> kerning
+	mutable std::unordered_map<std::tuple<FT_Face, int, int, int>, vec2, SKerningKeyHash, SKerningKeyEquals> m_Kernings;
+
+	CGlyphRasterizer m_Rasterizer;
+	unsigned m_RasterizerGeneration;
+	std::vector<CGlyphRasterizer::SResult> m_vRasterizedGlyphs;
 
 	// Data used for rendering glyphs
 	uint8_t m_aaGlyphData[NUM_FONT_TEXTURES][64 * 1024];
@@ -448,34 +723,6 @@ private:
 		return GlyphIndex;
 	}
 
-	void Grow(const unsigned char *pIn, unsigned char *pOut, int w, int h, int OutlineCount) const
-	{
-		for(int y = 0; y < h; y++)
-		{
-			for(int x = 0; x < w; x++)
-			{
-				int c = pIn[y * w + x];
-
-				for(int sy = -OutlineCount; sy <= OutlineCount; sy++)
-				{
-					for(int sx = -OutlineCount; sx <= OutlineCount; sx++)
-					{
-						int GetX = x + sx;
-						int GetY = y + sy;
-						if(GetX >= 0 && GetY >= 0 && GetX < w && GetY < h)
-						{
-							int Index = GetY * w + GetX;
-							if(pIn[Index] > c)
-								c = pIn[Index];
-						}
-					}
-				}
-
-				pOut[y * w + x] = c;
-			}
-		}
-	}
-
 	int AdjustOutlineThicknessToFontSize(int OutlineThickness, int FontSize) const
 	{
 		if(FontSize > 48)
@@ -501,18 +748,27 @@ private:
 
 	bool RenderGlyph(SGlyph &Glyph)
 	{
+		// Only load the outline here to get the metrics for the layout,
+		// the bitmap is rendered by the rasterizer thread.
 		FT_Set_Pixel_Sizes(Glyph.m_Face, 0, Glyph.m_FontSize);
 
-		if(FT_Load_Glyph(Glyph.m_Face, Glyph.m_GlyphIndex, FT_LOAD_RENDER | FT_LOAD_NO_BITMAP))
+		if(FT_Load_Glyph(Glyph.m_Face, Glyph.m_GlyphIndex, FT_LOAD_NO_BITMAP))
 		{
 			log_debug("textrender", "Error loading glyph. Chr=%d GlyphIndex=%u", Glyph.m_Chr, Glyph.m_GlyphIndex);
 			return false;
 		}
 
-		const FT_Bitmap *pBitmap = &Glyph.m_Face->glyph->bitmap;
+		// the outline box rounded out to whole pixels is the size of the
+		// bitmap FreeType renders, the metrics can be a pixel off
+		FT_BBox Box;
+		FT_Outline_Get_CBox(&Glyph.m_Face->glyph->outline, &Box);
+		Box.xMin = Box.xMin & -64;
+		Box.yMin = Box.yMin & -64;
+		Box.xMax = (Box.xMax + 63) & -64;
+		Box.yMax = (Box.yMax + 63) & -64;
 
-		const unsigned RealWidth = pBitmap->width;
-		const unsigned RealHeight = pBitmap->rows;
+		const unsigned RealWidth = (Box.xMax - Box.xMin) >> 6;
+		const unsigned RealHeight = (Box.yMax - Box.yMin) >> 6;
 
 		// adjust spacing
 		int OutlineThickness = 0;
@@ -543,36 +799,36 @@ private:
 				}
 			}
 
-			// prepare glyph data
-			mem_zero(m_aaGlyphData[FONT_TEXTURE_FILL], (size_t)Width * Height * sizeof(uint8_t));
-			for(unsigned py = 0; py < pBitmap->rows; ++py)
-			{
-				mem_copy(&m_aaGlyphData[FONT_TEXTURE_FILL][(py + y) * Width + x], &pBitmap->buffer[py * pBitmap->width], pBitmap->width);
-			}
-
-			// upload the glyph
-			UploadGlyph(FONT_TEXTURE_FILL, X, Y, Width, Height, m_aaGlyphData[FONT_TEXTURE_FILL]);
-			Grow(m_aaGlyphData[FONT_TEXTURE_FILL], m_aaGlyphData[FONT_TEXTURE_OUTLINE], Width, Height, OutlineThickness);
-			UploadGlyph(FONT_TEXTURE_OUTLINE, X, Y, Width, Height, m_aaGlyphData[FONT_TEXTURE_OUTLINE]);
+			// the region stays empty until the rasterizer is done with the glyph
+			CGlyphRasterizer::SRequest Request;
+			Request.m_Generation = m_RasterizerGeneration;
+			Request.m_Face = Glyph.m_Face;
+			Request.m_GlyphIndex = Glyph.m_GlyphIndex;
+			Request.m_Chr = Glyph.m_Chr;
+			Request.m_FontSize = Glyph.m_FontSize;
+			Request.m_X = X;
+			Request.m_Y = Y;
+			Request.m_Width = Width;
+			Request.m_Height = Height;
+			Request.m_Padding = x;
+			Request.m_OutlineThickness = OutlineThickness;
+			m_Rasterizer.Queue(Request);
 		}
 
 		// set glyph info
 		{
-			const int BmpWidth = pBitmap->width + x * 2;
-			const int BmpHeight = pBitmap->rows + y * 2;
-
 			Glyph.m_Height = Height;
 			Glyph.m_Width = Width;
 			Glyph.m_CharHeight = RealHeight;
 			Glyph.m_CharWidth = RealWidth;
-			Glyph.m_OffsetX = (Glyph.m_Face->glyph->metrics.horiBearingX >> 6);
-			Glyph.m_OffsetY = -((Glyph.m_Face->glyph->metrics.height >> 6) - (Glyph.m_Face->glyph->metrics.horiBearingY >> 6));
+			Glyph.m_OffsetX = Box.xMin >> 6;
+			Glyph.m_OffsetY = Box.yMin >> 6;
 			Glyph.m_AdvanceX = (Glyph.m_Face->glyph->advance.x >> 6);
 
 			Glyph.m_aUVs[0] = X;
 			Glyph.m_aUVs[1] = Y;
-			Glyph.m_aUVs[2] = Glyph.m_aUVs[0] + BmpWidth;
-			Glyph.m_aUVs[3] = Glyph.m_aUVs[1] + BmpHeight;
+			Glyph.m_aUVs[2] = Glyph.m_aUVs[0] + Width;
+			Glyph.m_aUVs[3] = Glyph.m_aUVs[1] + Height;
 
 			Glyph.m_State = SGlyph::EState::RENDERED;
 		}
@@ -591,6 +847,7 @@ public:
 
 		m_TextureAtlas.Clear(m_TextureDimension);
 		UploadTextures();
+		m_RasterizerGeneration = m_Rasterizer.Generation();
 	}
 
 	~CGlyphMap()
@@ -612,8 +869,9 @@ public:
 		return m_IconFace;
 	}
 
-	void AddFace(FT_Face Face)
+	void AddFace(FT_Face Face, const FT_Byte *pFontData, FT_Long FontDataSize)
 	{
+		m_Rasterizer.AddFace(Face, pFontData, FontDataSize);
 		m_vFtFaces.push_back(Face);
 		if(!m_DefaultFace)
 			m_DefaultFace = Face;
@@ -663,6 +921,9 @@ public:
 
 	void Clear()
 	{
+		m_Rasterizer.Discard();
+		m_RasterizerGeneration = m_Rasterizer.Generation();
+
 		for(size_t TextureIndex = 0; TextureIndex < NUM_FONT_TEXTURES; ++TextureIndex)
 		{
 			mem_zero(m_apTextureData[TextureIndex], m_TextureDimension * m_TextureDimension * sizeof(uint8_t));
@@ -671,6 +932,24 @@ public:
 
 		m_TextureAtlas.Clear(m_TextureDimension);
 		m_Glyphs.clear();
+		m_Kernings.clear();
+	}
+
+	// Copies the glyphs finished by the rasterizer thread into their atlas regions.
+	void UploadRasterizedGlyphs()
+	{
+		if(!m_Rasterizer.TakeResults(m_vRasterizedGlyphs))
+			return;
+
+		for(const CGlyphRasterizer::SResult &Result : m_vRasterizedGlyphs)
+		{
+			const CGlyphRasterizer::SRequest &Request = Result.m_Request;
+			if(Request.m_Generation != m_RasterizerGeneration)
+				continue;
+			UploadGlyph(FONT_TEXTURE_FILL, Request.m_X, Request.m_Y, Request.m_Width, Request.m_Height, Result.m_avData[FONT_TEXTURE_FILL].data());
+			UploadGlyph(FONT_TEXTURE_OUTLINE, Request.m_X, Request.m_Y, Request.m_Width, Request.m_Height, Result.m_avData[FONT_TEXTURE_OUTLINE].data());
+		}
+		m_vRasterizedGlyphs.clear();
 	}
 
 	const SGlyph *GetGlyph(int Chr, int FontSize)
@@ -721,10 +1000,20 @@ public:
 	{
 		if(pLeft != nullptr && pRight != nullptr && pLeft->m_Face == pRight->m_Face && pLeft->m_FontSize == pRight->m_FontSize)
 		{
+			if(!FT_HAS_KERNING(pLeft->m_Face))
+				return vec2(0.0f, 0.0f);
+
+			const auto Key = std::make_tuple(pLeft->m_Face, pLeft->m_FontSize, pLeft->m_Chr, pRight->m_Chr);
+			const auto It = m_Kernings.find(Key);
+			if(It != m_Kernings.end())
+				return It->second;
+
 			FT_Vector Kerning = {0, 0};
 			FT_Set_Pixel_Sizes(pLeft->m_Face, 0, pLeft->m_FontSize);
 			FT_Get_Kerning(pLeft->m_Face, pLeft->m_Chr, pRight->m_Chr, FT_KERNING_DEFAULT, &Kerning);
-			return vec2(Kerning.x >> 6, Kerning.y >> 6);
+			const vec2 Result = vec2(Kerning.x >> 6, Kerning.y >> 6);
+			m_Kernings.emplace(Key, Result);
+			return Result;
 		}
 		return vec2(0.0f, 0.0f);
 	}
@@ -1024,7 +1313,7 @@ class CTextRender : public IEngineTextRender
 				continue;
 			}
 
-			m_pGlyphMap->AddFace(FtFace);
+			m_pGlyphMap->AddFace(FtFace, pFontData, FontDataSize);
 
 			char aBuf[256];
 			str_format(aBuf, sizeof(aBuf), "Loaded font face %ld '%s %s' from font file '%s'", FaceIndex, FtFace->family_name, FtFace->style_name, pFontName);
@@ -2029,6 +2318,8 @@ public:
 	{
 		const STextContainer &TextContainer = GetTextContainer(TextContainerIndex);
 
+		m_pGlyphMap->UploadRasterizedGlyphs();
+
 		if(!TextContainer.m_StringInfo.m_vCharacterQuads.empty())
 		{
 			if(Graphics()->IsTextBufferingEnabled())
@@ -20,7 +20,8 @@ public:
 	virtual ~IEngine() = default;
 
 	virtual void Init() = 0;
-	virtual void AddJob(std::shared_ptr<IJob> pJob) = 0;
+	virtual void AddJob(std::shared_ptr<IJob> pJob, CJobGroup *pGroup = nullptr) = 0;
+	virtual void RunJobContinuations() = 0;
 	virtual void SetAdditionalLogger(std::shared_ptr<ILogger> &&pLogger) = 0;
 	static void RunJobBlocking(IJob *pJob);
 };
@@ -322,6 +322,9 @@ public:
 
 	virtual int LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType) = 0;
 	virtual void FreePNG(CImageInfo *pImg) = 0;
+	// adds the warning LoadPNG gives for images that old clients cannot load,
+	// for images decoded with ::LoadPNG on other threads. Main thread only.
+	virtual void WarnPngliteIncompatible(const char *pFilename, int PngliteIncompatible) = 0;
 
 	virtual bool CheckImageDivisibility(const char *pFileName, CImageInfo &Img, int DivX, int DivY, bool AllowResize) = 0;
 	virtual bool IsImageFormatRGBA(const char *pFileName, CImageInfo &Img) = 0;
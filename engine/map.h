@@ -38,6 +38,8 @@ public:
 	virtual void Unload() = 0;
 	virtual bool IsLoaded() const = 0;
 	virtual IOHANDLE File() const = 0;
+	virtual const unsigned char *FileData() const = 0;
+	virtual unsigned FileSize() const = 0;
 
 	virtual SHA256_DIGEST Sha256() const = 0;
 	virtual unsigned Crc() const = 0;
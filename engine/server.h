@@ -224,6 +224,10 @@ public:
 
 	virtual void SnapSetStaticsize(int ItemType, int Size) = 0;
 
+	// while set, SnapNewItem creates the items in pBuffer instead of the
+	// snapshot that is currently being built
+	virtual void SnapSetItemBuffer(class CSnapItemBuffer *pBuffer) = 0;
+
 	enum
 	{
 		RCON_CID_SERV = -1,
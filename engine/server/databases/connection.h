@@ -81,6 +81,15 @@ public:
 	// returns number of bytes read into the buffer
 	virtual int GetBlob(int Col, unsigned char *pBuffer, int BufferSize) = 0;
 
+	// groups the following statements into one transaction until it is
+	// committed or rolled back, used to write multiple queries at once
+	//
+	// returns true on failure
+	virtual bool BeginTransaction(char *pError, int ErrorSize) = 0;
+	// returns true on failure
+	virtual bool CommitTransaction(char *pError, int ErrorSize) = 0;
+	virtual void RollbackTransaction() = 0;
+
 	// SQL statements, that can't be abstracted, has side effects to the result
 	virtual bool AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize) = 0;
 
@@ -1,6 +1,7 @@
 #include "connection_pool.h"
 #include "connection.h"
 
+#include <base/math.h>
 #include <base/system.h>
 #include <cstring>
 #include <engine/console.h>
@@ -64,6 +65,7 @@ struct CSqlExecData
 
 	std::unique_ptr<const ISqlData> m_pThreadData;
 	const char *m_pName;
+	int64_t m_QueueTime = 0;
 };
 
 CSqlExecData::CSqlExecData(
@@ -117,25 +119,107 @@ CSqlExecData::CSqlExecData(IConsole *pConsole, CDbConnectionPool::Mode m) :
 	m_Ptr.m_Print.m_Mode = m;
 }
 
-void CDbConnectionPool::Print(IConsole *pConsole, Mode DatabaseMode)
+void CDbConnectionPool::CLaneStats::OnQueue()
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pConsole, DatabaseMode);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
+	int Depth = m_Depth.fetch_add(1) + 1;
+	int MaxDepth = m_MaxDepth.load();
+	while(Depth > MaxDepth && !m_MaxDepth.compare_exchange_weak(MaxDepth, Depth))
+	{
+	}
+}
+
+void CDbConnectionPool::CLaneStats::OnComplete(int64_t QueueTime, bool Success)
+{
+	m_Depth.fetch_sub(1);
+	if(!Success)
+		m_NumFailed.fetch_add(1);
+	int64_t Latency = time_get_impl() - QueueTime;
+	int64_t Limit = time_freq() / 1000;
+	int Bucket = 0;
+	while(Bucket < NUM_LATENCY_BUCKETS - 1 && Latency >= Limit)
+	{
+		Limit *= 10;
+		Bucket++;
+	}
+	m_aLatencies[Bucket].fetch_add(1);
+}
+
+void CDbConnectionPool::QueueRead(std::unique_ptr<CSqlExecData> pData)
+{
+	if(m_vpReadThreads.empty())
+		StartReadWorkers();
+	pData->m_QueueTime = time_get_impl();
+	{
+		CLockScope ls(m_pShared->m_QueueLock);
+		m_pShared->m_ReadQueue.push_back(std::move(pData));
+	}
+	m_pShared->m_NumRead.Signal();
+}
+
+void CDbConnectionPool::QueueWrite(std::unique_ptr<CSqlExecData> pData)
+{
+	pData->m_QueueTime = time_get_impl();
+	{
+		CLockScope ls(m_pShared->m_QueueLock);
+		m_pShared->m_BackupQueue.push_back(std::move(pData));
+	}
 	m_pShared->m_NumBackup.Signal();
 }
 
+void CDbConnectionPool::Print(IConsole *pConsole, Mode DatabaseMode)
+{
+	auto pData = std::make_unique<CSqlExecData>(pConsole, DatabaseMode);
+	if(DatabaseMode == Mode::READ)
+		QueueRead(std::move(pData));
+	else
+		QueueWrite(std::move(pData));
+}
+
+void CDbConnectionPool::PrintStats(IConsole *pConsole)
+{
+	static const char *s_apLaneNames[NUM_LANES] = {"read", "write"};
+	for(int Lane = 0; Lane < NUM_LANES; Lane++)
+	{
+		const CLaneStats &Stats = m_pShared->m_aStats[Lane];
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf),
+			"%s: depth=%d max_depth=%d failed=%d latency <1ms=%d <10ms=%d <100ms=%d <1s=%d <10s=%d >=10s=%d",
+			s_apLaneNames[Lane], Stats.m_Depth.load(), Stats.m_MaxDepth.load(), Stats.m_NumFailed.load(),
+			Stats.m_aLatencies[0].load(), Stats.m_aLatencies[1].load(), Stats.m_aLatencies[2].load(),
+			Stats.m_aLatencies[3].load(), Stats.m_aLatencies[4].load(), Stats.m_aLatencies[5].load());
+		pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+}
+
+void CDbConnectionPool::SetNumReadWorkers(int NumWorkers)
+{
+	dbg_assert(m_vpReadThreads.empty(), "read workers already started");
+	m_NumReadWorkers = clamp(NumWorkers, 1, (int)MAX_READ_WORKERS);
+}
+
 void CDbConnectionPool::RegisterSqliteDatabase(Mode DatabaseMode, const char aFileName[64])
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, aFileName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	auto pData = std::make_unique<CSqlExecData>(DatabaseMode, aFileName);
+	if(DatabaseMode == Mode::READ)
+	{
+		// the read workers pick it up before their next query
+		CLockScope ls(m_pShared->m_QueueLock);
+		m_pShared->m_vpReadServers.push_back(std::move(pData));
+		return;
+	}
+	QueueWrite(std::move(pData));
 }
 
 void CDbConnectionPool::RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	auto pData = std::make_unique<CSqlExecData>(DatabaseMode, pMysqlConfig);
+	if(DatabaseMode == Mode::READ)
+	{
+		CLockScope ls(m_pShared->m_QueueLock);
+		m_pShared->m_vpReadServers.push_back(std::move(pData));
+		return;
+	}
+	QueueWrite(std::move(pData));
 }
 
 void CDbConnectionPool::Execute(
@@ -143,9 +227,8 @@ void CDbConnectionPool::Execute(
 	std::unique_ptr<const ISqlData> pSqlRequestData,
 	const char *pName)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	m_pShared->m_aStats[LANE_READ].OnQueue();
+	QueueRead(std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName));
 }
 
 void CDbConnectionPool::ExecuteWrite(
@@ -153,9 +236,8 @@ void CDbConnectionPool::ExecuteWrite(
 	std::unique_ptr<const ISqlData> pSqlRequestData,
 	const char *pName)
 {
-	m_pShared->m_aQueries[m_InsertIdx++] = std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName);
-	m_InsertIdx %= std::size(m_pShared->m_aQueries);
-	m_pShared->m_NumBackup.Signal();
+	m_pShared->m_aStats[LANE_WRITE].OnQueue();
+	QueueWrite(std::make_unique<CSqlExecData>(pFunc, std::move(pSqlRequestData), pName));
 }
 
 void CDbConnectionPool::OnShutdown()
@@ -164,9 +246,18 @@ void CDbConnectionPool::OnShutdown()
 		return;
 	m_Shutdown = true;
 	m_pShared->m_Shutdown.store(true);
+	{
+		// an empty entry tells the threads to exit after the queries before it
+		CLockScope ls(m_pShared->m_QueueLock);
+		m_pShared->m_BackupQueue.push_back(nullptr);
+		for(size_t i = 0; i < m_vpReadThreads.size(); i++)
+			m_pShared->m_ReadQueue.push_back(nullptr);
+	}
 	m_pShared->m_NumBackup.Signal();
+	for(size_t i = 0; i < m_vpReadThreads.size(); i++)
+		m_pShared->m_NumRead.Signal();
 	int i = 0;
-	while(m_pShared->m_Shutdown.load())
+	while(m_pShared->m_NumRunning.load() > 0)
 	{
 		// print a log about every two seconds
 		if(i % 20 == 0 && i > 0)
@@ -178,9 +269,37 @@ void CDbConnectionPool::OnShutdown()
 	}
 }
 
+static std::unique_ptr<CSqlExecData> PopQuery(CLock &Lock, std::deque<std::unique_ptr<CSqlExecData>> &Queue)
+{
+	CLockScope ls(Lock);
+	dbg_assert(!Queue.empty(), "database queue out of sync with its semaphore");
+	auto pData = std::move(Queue.front());
+	Queue.pop_front();
+	return pData;
+}
+
+/* static */
+void CDbConnectionPool::CompleteQuery(CLaneStats *pStats, CSqlExecData *pData, bool Success)
+{
+	if(pData->m_Mode == CSqlExecData::READ_ACCESS || pData->m_Mode == CSqlExecData::WRITE_ACCESS)
+		pStats->OnComplete(pData->m_QueueTime, Success);
+	if(pData->m_pThreadData != nullptr && pData->m_pThreadData->m_pResult != nullptr)
+	{
+		pData->m_pThreadData->m_pResult->m_Success = Success;
+		pData->m_pThreadData->m_pResult->m_Completed.store(true);
+	}
+}
+
+static std::unique_ptr<IDbConnection> CreateConnection(const CSqlExecData *pData)
+{
+	if(pData->m_Mode == CSqlExecData::ADD_MYSQL)
+		return CreateMysqlConnection(pData->m_Ptr.m_MySql.m_Config);
+	return CreateSqliteConnection(pData->m_Ptr.m_Sqlite.m_FileName, true);
+}
+
 // The backup worker thread looks at write queries and stores them
-// in the sqlite database (WRITE_BACKUP). It skips over read queries.
-// After processing the query, it gets passed on to the Worker thread.
+// in the sqlite database (WRITE_BACKUP). After processing the query,
+// it gets passed on to the Worker thread.
 // This is done to not loose ranks when the server shuts down before all
 // queries are executed on the mysql server
 class CBackup
@@ -203,6 +322,7 @@ void CBackup::Start(void *pUser)
 {
 	CBackup *pThis = (CBackup *)pUser;
 	pThis->ProcessQueries();
+	pThis->m_pShared->m_NumRunning.fetch_sub(1);
 	delete pThis;
 }
 
@@ -211,33 +331,38 @@ void CBackup::ProcessQueries()
 	for(int JobNum = 0;; JobNum++)
 	{
 		m_pShared->m_NumBackup.Wait();
-		CSqlExecData *pThreadData = m_pShared->m_aQueries[JobNum % std::size(m_pShared->m_aQueries)].get();
-
+		auto pThreadData = PopQuery(m_pShared->m_QueueLock, m_pShared->m_BackupQueue);
 		// work through all database jobs after OnShutdown is called before exiting the thread
-		if(pThreadData == nullptr)
+		const bool Exit = pThreadData == nullptr;
+
+		if(Exit)
 		{
-			m_pShared->m_NumWorker.Signal();
-			return;
+			// pass the end on to the worker thread
 		}
-
-		if(pThreadData->m_Mode == CSqlExecData::ADD_SQLITE &&
+		else if(pThreadData->m_Mode == CSqlExecData::ADD_SQLITE &&
 			pThreadData->m_Ptr.m_Sqlite.m_Mode == CDbConnectionPool::Mode::WRITE_BACKUP)
 		{
 			m_pWriteBackup = CreateSqliteConnection(pThreadData->m_Ptr.m_Sqlite.m_FileName, true);
 		}
 		else if(pThreadData->m_Mode == CSqlExecData::WRITE_ACCESS && m_pWriteBackup.get())
 		{
-			bool Success = CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData, Write::BACKUP_FIRST);
+			bool Success = CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData.get(), Write::BACKUP_FIRST);
 			dbg_msg("sql", "[%i] %s done on write backup database, Success=%i", JobNum, pThreadData->m_pName, Success);
 		}
+		{
+			CLockScope ls(m_pShared->m_QueueLock);
+			m_pShared->m_WriteQueue.push_back(std::move(pThreadData));
+		}
 		m_pShared->m_NumWorker.Signal();
+		if(Exit)
+			return;
 	}
 }
 
-// the worker threads executes queries on mysql or sqlite. If we write on
-// a mysql server and have a backup server configured, we'll remove the
-// entry from the backup server after completing it on the write server.
-// static void Worker(void *pUser);
+// the worker thread executes the writes on mysql or sqlite in the order
+// they were queued. If we write on a mysql server and have a backup server
+// configured, we'll remove the entry from the backup server after
+// completing it on the write server.
 class CWorker
 {
 public:
@@ -248,19 +373,20 @@ public:
 
 private:
 	void Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode);
+	// returns true if the writes were done in one transaction
+	bool ExecWriteBatch(int JobNum, std::vector<std::unique_ptr<CSqlExecData>> &vpBatch);
+	bool ExecWrite(int JobNum, CSqlExecData *pThreadData);
 
-	// There are two possible configurations
-	//  * sqlite mode: There exists exactly one READ and the same WRITE server
-	//                 with no WRITE_BACKUP server
-	//  * mysql mode: there can exist multiple READ server, there must be at
-	//                most one WRITE server. The WRITE server for all DDNet
-	//                Servers must be the same (to counteract double loads).
-	//                There may be one WRITE_BACKUP sqlite server.
-	// This variable should only change, before the worker threads
-	std::vector<std::unique_ptr<IDbConnection>> m_vpReadConnections;
+	// There must be at most one WRITE server. The WRITE server for all
+	// DDNet Servers must be the same (to counteract double loads). There
+	// may be one WRITE_BACKUP sqlite server.
 	std::unique_ptr<IDbConnection> m_pWriteConnection;
 	std::unique_ptr<IDbConnection> m_pWriteBackup;
 
+	// enter fail mode when a sql request fails and write to the backup
+	// database until all requests are handled
+	bool m_FailMode = false;
+
 	std::shared_ptr<CDbConnectionPool::CSharedData> m_pShared;
 };
 
@@ -269,101 +395,73 @@ void CWorker::Start(void *pUser)
 {
 	CWorker *pThis = (CWorker *)pUser;
 	pThis->ProcessQueries();
+	pThis->m_pShared->m_NumRunning.fetch_sub(1);
 	delete pThis;
 }
 
 void CWorker::ProcessQueries()
 {
-	// remember last working server and try to connect to it first
-	int ReadServer = 0;
-	// enter fail mode when a sql request fails, skip read request during it and
-	// write to the backup database until all requests are handled
-	bool FailMode = false;
+	CDbConnectionPool::CLaneStats *pStats = &m_pShared->m_aStats[CDbConnectionPool::LANE_WRITE];
 	for(int JobNum = 0;; JobNum++)
 	{
-		if(FailMode && m_pShared->m_NumWorker.GetApproximateValue() == 0)
+		if(m_FailMode && m_pShared->m_NumWorker.GetApproximateValue() == 0)
 		{
-			FailMode = false;
+			m_FailMode = false;
 		}
 		m_pShared->m_NumWorker.Wait();
-		auto pThreadData = std::move(m_pShared->m_aQueries[JobNum % std::size(m_pShared->m_aQueries)]);
+		auto pThreadData = PopQuery(m_pShared->m_QueueLock, m_pShared->m_WriteQueue);
 		// work through all database jobs after OnShutdown is called before exiting the thread
 		if(pThreadData == nullptr)
 		{
-			m_pShared->m_Shutdown.store(false);
 			return;
 		}
 		bool Success = false;
 		switch(pThreadData->m_Mode)
 		{
 		case CSqlExecData::READ_ACCESS:
+			dbg_assert(false, "read query on the write lane");
+			break;
+		case CSqlExecData::WRITE_ACCESS:
 		{
-			for(size_t i = 0; i < m_vpReadConnections.size(); i++)
+			// bursts of finishes are written in one transaction
+			std::vector<std::unique_ptr<CSqlExecData>> vpBatch;
+			vpBatch.push_back(std::move(pThreadData));
+			if(!m_FailMode && !m_pShared->m_Shutdown && m_pWriteConnection != nullptr)
 			{
-				if(m_pShared->m_Shutdown)
-				{
-					dbg_msg("sql", "[%i] %s dismissed read request during shutdown", JobNum, pThreadData->m_pName);
-					break;
-				}
-				if(FailMode)
-				{
-					dbg_msg("sql", "[%i] %s dismissed read request during FailMode", JobNum, pThreadData->m_pName);
-					break;
-				}
-				int CurServer = (ReadServer + i) % (int)m_vpReadConnections.size();
-				if(CDbConnectionPool::ExecSqlFunc(m_vpReadConnections[CurServer].get(), pThreadData.get(), Write::NORMAL))
+				CLockScope ls(m_pShared->m_QueueLock);
+				while(vpBatch.size() < (size_t)CDbConnectionPool::MAX_WRITE_BATCH &&
+					!m_pShared->m_WriteQueue.empty() &&
+					m_pShared->m_WriteQueue.front() != nullptr &&
+					m_pShared->m_WriteQueue.front()->m_Mode == CSqlExecData::WRITE_ACCESS)
 				{
-					ReadServer = CurServer;
-					dbg_msg("sql", "[%i] %s done on read database %d", JobNum, pThreadData->m_pName, CurServer);
-					Success = true;
-					break;
+					vpBatch.push_back(std::move(m_pShared->m_WriteQueue.front()));
+					m_pShared->m_WriteQueue.pop_front();
 				}
 			}
-			if(!Success)
-			{
-				FailMode = true;
-			}
-		}
-		break;
-		case CSqlExecData::WRITE_ACCESS:
-		{
-			if(m_pShared->m_Shutdown && m_pWriteBackup != nullptr)
-			{
-				dbg_msg("sql", "[%i] %s skipped to backup database during shutdown", JobNum, pThreadData->m_pName);
-			}
-			else if(FailMode && m_pWriteBackup != nullptr)
-			{
-				dbg_msg("sql", "[%i] %s skipped to backup database during FailMode", JobNum, pThreadData->m_pName);
-			}
-			else if(CDbConnectionPool::ExecSqlFunc(m_pWriteConnection.get(), pThreadData.get(), Write::NORMAL))
-			{
-				dbg_msg("sql", "[%i] %s done on write database", JobNum, pThreadData->m_pName);
-				Success = true;
-			}
-			// enter fail mode if not successful
-			FailMode = FailMode || !Success;
-			const Write w = Success ? Write::NORMAL_SUCCEEDED : Write::NORMAL_FAILED;
-			if(m_pWriteBackup && CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData.get(), w))
+			// the backup thread signals after pushing, so this doesn't block for long
+			for(size_t i = 1; i < vpBatch.size(); i++)
+				m_pShared->m_NumWorker.Wait();
+
+			if(vpBatch.size() == 1 || !ExecWriteBatch(JobNum, vpBatch))
 			{
-				dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table", JobNum, pThreadData->m_pName);
-				Success = true;
+				for(size_t i = 0; i < vpBatch.size(); i++)
+					CDbConnectionPool::CompleteQuery(pStats, vpBatch[i].get(), ExecWrite(JobNum + i, vpBatch[i].get()));
 			}
+			JobNum += vpBatch.size() - 1;
+			continue;
 		}
-		break;
 		case CSqlExecData::ADD_MYSQL:
 		{
 			auto pMysql = CreateMysqlConnection(pThreadData->m_Ptr.m_MySql.m_Config);
 			switch(pThreadData->m_Ptr.m_MySql.m_Mode)
 			{
-			case CDbConnectionPool::Mode::READ:
-				m_vpReadConnections.push_back(std::move(pMysql));
-				break;
 			case CDbConnectionPool::Mode::WRITE:
 				m_pWriteConnection = std::move(pMysql);
 				break;
 			case CDbConnectionPool::Mode::WRITE_BACKUP:
 				m_pWriteBackup = std::move(pMysql);
 				break;
+			case CDbConnectionPool::Mode::READ:
 			case CDbConnectionPool::Mode::NUM_MODES:
 				break;
 			}
@@ -375,15 +473,13 @@ void CWorker::ProcessQueries()
 			auto pSqlite = CreateSqliteConnection(pThreadData->m_Ptr.m_Sqlite.m_FileName, true);
 			switch(pThreadData->m_Ptr.m_Sqlite.m_Mode)
 			{
-			case CDbConnectionPool::Mode::READ:
-				m_vpReadConnections.push_back(std::move(pSqlite));
-				break;
 			case CDbConnectionPool::Mode::WRITE:
 				m_pWriteConnection = std::move(pSqlite);
 				break;
 			case CDbConnectionPool::Mode::WRITE_BACKUP:
 				m_pWriteBackup = std::move(pSqlite);
 				break;
+			case CDbConnectionPool::Mode::READ:
 			case CDbConnectionPool::Mode::NUM_MODES:
 				break;
 			}
@@ -397,24 +493,63 @@ void CWorker::ProcessQueries()
 		}
 		if(!Success)
 			dbg_msg("sql", "[%i] %s failed on all databases", JobNum, pThreadData->m_pName);
-		if(pThreadData->m_pThreadData != nullptr && pThreadData->m_pThreadData->m_pResult != nullptr)
+		CDbConnectionPool::CompleteQuery(pStats, pThreadData.get(), Success);
+	}
+}
+
+bool CWorker::ExecWriteBatch(int JobNum, std::vector<std::unique_ptr<CSqlExecData>> &vpBatch)
+{
+	if(!CDbConnectionPool::ExecSqlBatch(m_pWriteConnection.get(), vpBatch))
+	{
+		dbg_msg("sql", "[%i] batch of %d writes failed, writing them one by one", JobNum, (int)vpBatch.size());
+		return false;
+	}
+	CDbConnectionPool::CLaneStats *pStats = &m_pShared->m_aStats[CDbConnectionPool::LANE_WRITE];
+	for(size_t i = 0; i < vpBatch.size(); i++)
+	{
+		CSqlExecData *pWrite = vpBatch[i].get();
+		dbg_msg("sql", "[%i] %s done on write database in a batch of %d", JobNum + (int)i, pWrite->m_pName, (int)vpBatch.size());
+		if(m_pWriteBackup && CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pWrite, Write::NORMAL_SUCCEEDED))
 		{
-			pThreadData->m_pThreadData->m_pResult->m_Success = Success;
-			pThreadData->m_pThreadData->m_pResult->m_Completed.store(true);
+			dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table", JobNum + (int)i, pWrite->m_pName);
 		}
+		CDbConnectionPool::CompleteQuery(pStats, pWrite, true);
 	}
+	return true;
 }
 
-void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
+bool CWorker::ExecWrite(int JobNum, CSqlExecData *pThreadData)
 {
-	if(DatabaseMode == CDbConnectionPool::Mode::READ)
+	bool Success = false;
+	if(m_pShared->m_Shutdown && m_pWriteBackup != nullptr)
+	{
+		dbg_msg("sql", "[%i] %s skipped to backup database during shutdown", JobNum, pThreadData->m_pName);
+	}
+	else if(m_FailMode && m_pWriteBackup != nullptr)
 	{
-		for(auto &pReadConnection : m_vpReadConnections)
-			pReadConnection->Print(pConsole, "Read");
-		if(m_vpReadConnections.empty())
-			pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no read databases");
+		dbg_msg("sql", "[%i] %s skipped to backup database during FailMode", JobNum, pThreadData->m_pName);
 	}
-	else if(DatabaseMode == CDbConnectionPool::Mode::WRITE)
+	else if(CDbConnectionPool::ExecSqlFunc(m_pWriteConnection.get(), pThreadData, Write::NORMAL))
+	{
+		dbg_msg("sql", "[%i] %s done on write database", JobNum, pThreadData->m_pName);
+		Success = true;
+	}
+	// enter fail mode if not successful
+	m_FailMode = m_FailMode || !Success;
+	const Write w = Success ? Write::NORMAL_SUCCEEDED : Write::NORMAL_FAILED;
+	if(m_pWriteBackup && CDbConnectionPool::ExecSqlFunc(m_pWriteBackup.get(), pThreadData, w))
+	{
+		dbg_msg("sql", "[%i] %s done move write on backup database to non-backup table", JobNum, pThreadData->m_pName);
+		Success = true;
+	}
+	if(!Success)
+		dbg_msg("sql", "[%i] %s failed on all databases", JobNum, pThreadData->m_pName);
+	return Success;
+}
+
+void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
+{
+	if(DatabaseMode == CDbConnectionPool::Mode::WRITE)
 	{
 		if(m_pWriteConnection)
 			m_pWriteConnection->Print(pConsole, "Write");
@@ -430,6 +565,109 @@ void CWorker::Print(IConsole *pConsole, CDbConnectionPool::Mode DatabaseMode)
 	}
 }
 
+// Read workers execute the read queries concurrently, each with its own
+// connections to all read servers.
+//  * sqlite mode: There exists exactly one READ server, the same file as
+//                 the WRITE server
+//  * mysql mode: there can exist multiple READ servers
+class CReadWorker
+{
+public:
+	CReadWorker(std::shared_ptr<CDbConnectionPool::CSharedData> pShared, int Index) :
+		m_pShared(std::move(pShared)), m_Index(Index) {}
+	static void Start(void *pUser);
+	void ProcessQueries();
+
+private:
+	// connects to read servers registered since the last query
+	void UpdateConnections();
+
+	std::vector<std::unique_ptr<IDbConnection>> m_vpReadConnections;
+
+	std::shared_ptr<CDbConnectionPool::CSharedData> m_pShared;
+	int m_Index;
+};
+
+/* static */
+void CReadWorker::Start(void *pUser)
+{
+	CReadWorker *pThis = (CReadWorker *)pUser;
+	pThis->ProcessQueries();
+	pThis->m_pShared->m_NumRunning.fetch_sub(1);
+	delete pThis;
+}
+
+void CReadWorker::UpdateConnections()
+{
+	CLockScope ls(m_pShared->m_QueueLock);
+	while(m_vpReadConnections.size() < m_pShared->m_vpReadServers.size())
+		m_vpReadConnections.push_back(CreateConnection(m_pShared->m_vpReadServers[m_vpReadConnections.size()].get()));
+}
+
+void CReadWorker::ProcessQueries()
+{
+	CDbConnectionPool::CLaneStats *pStats = &m_pShared->m_aStats[CDbConnectionPool::LANE_READ];
+	// remember last working server and try to connect to it first
+	int ReadServer = 0;
+	// enter fail mode when a sql request fails, skip read requests during it
+	// until all requests are handled
+	bool FailMode = false;
+	for(int JobNum = 0;; JobNum++)
+	{
+		if(FailMode && m_pShared->m_NumRead.GetApproximateValue() == 0)
+		{
+			FailMode = false;
+		}
+		m_pShared->m_NumRead.Wait();
+		auto pThreadData = PopQuery(m_pShared->m_QueueLock, m_pShared->m_ReadQueue);
+		if(pThreadData == nullptr)
+		{
+			return;
+		}
+		UpdateConnections();
+
+		if(pThreadData->m_Mode == CSqlExecData::PRINT)
+		{
+			IConsole *pConsole = pThreadData->m_Ptr.m_Print.m_pConsole;
+			for(auto &pReadConnection : m_vpReadConnections)
+				pReadConnection->Print(pConsole, "Read");
+			if(m_vpReadConnections.empty())
+				pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "There are no read databases");
+			continue;
+		}
+
+		dbg_assert(pThreadData->m_Mode == CSqlExecData::READ_ACCESS, "write query on the read lane");
+		bool Success = false;
+		for(size_t i = 0; i < m_vpReadConnections.size(); i++)
+		{
+			if(m_pShared->m_Shutdown)
+			{
+				dbg_msg("sql", "[%i.%i] %s dismissed read request during shutdown", m_Index, JobNum, pThreadData->m_pName);
+				break;
+			}
+			if(FailMode)
+			{
+				dbg_msg("sql", "[%i.%i] %s dismissed read request during FailMode", m_Index, JobNum, pThreadData->m_pName);
+				break;
+			}
+			int CurServer = (ReadServer + i) % (int)m_vpReadConnections.size();
+			if(CDbConnectionPool::ExecSqlFunc(m_vpReadConnections[CurServer].get(), pThreadData.get(), Write::NORMAL))
+			{
+				ReadServer = CurServer;
+				dbg_msg("sql", "[%i.%i] %s done on read database %d", m_Index, JobNum, pThreadData->m_pName, CurServer);
+				Success = true;
+				break;
+			}
+		}
+		if(!Success)
+		{
+			FailMode = true;
+			dbg_msg("sql", "[%i.%i] %s failed on all databases", m_Index, JobNum, pThreadData->m_pName);
+		}
+		CDbConnectionPool::CompleteQuery(pStats, pThreadData.get(), Success);
+	}
+}
+
 /* static */
 bool CDbConnectionPool::ExecSqlFunc(IDbConnection *pConnection, CSqlExecData *pData, Write w)
 {
@@ -464,9 +702,48 @@ bool CDbConnectionPool::ExecSqlFunc(IDbConnection *pConnection, CSqlExecData *pD
 	return Success;
 }
 
+/* static */
+bool CDbConnectionPool::ExecSqlBatch(IDbConnection *pConnection, std::vector<std::unique_ptr<CSqlExecData>> &vpData)
+{
+	char aError[256] = "unknown error";
+	if(pConnection->Connect(aError, sizeof(aError)))
+	{
+		dbg_msg("sql", "failed connecting to db: %s", aError);
+		return false;
+	}
+	bool Success = !pConnection->BeginTransaction(aError, sizeof(aError));
+	for(size_t i = 0; Success && i < vpData.size(); i++)
+	{
+		dbg_assert(vpData[i]->m_Mode == CSqlExecData::WRITE_ACCESS, "only writes can be batched");
+		Success = !vpData[i]->m_Ptr.m_pWriteFunc(pConnection, vpData[i]->m_pThreadData.get(), Write::NORMAL, aError, sizeof(aError));
+	}
+	if(Success)
+		Success = !pConnection->CommitTransaction(aError, sizeof(aError));
+	else
+		pConnection->RollbackTransaction();
+	pConnection->Disconnect();
+	if(!Success)
+	{
+		dbg_msg("sql", "batch failed: %s", aError);
+	}
+	return Success;
+}
+
+void CDbConnectionPool::StartReadWorkers()
+{
+	for(int i = 0; i < m_NumReadWorkers; i++)
+	{
+		char aName[64];
+		str_format(aName, sizeof(aName), "database read worker thread %d", i);
+		m_pShared->m_NumRunning.fetch_add(1);
+		m_vpReadThreads.push_back(thread_init(CReadWorker::Start, new CReadWorker(m_pShared, i), aName));
+	}
+}
+
 CDbConnectionPool::CDbConnectionPool()
 {
 	m_pShared = std::make_shared<CSharedData>();
+	m_pShared->m_NumRunning.store(2);
 	m_pWorkerThread = thread_init(CWorker::Start, new CWorker(m_pShared), "database worker thread");
 	m_pBackupThread = thread_init(CBackup::Start, new CBackup(m_pShared), "database backup worker thread");
 }
@@ -478,4 +755,6 @@ CDbConnectionPool::~CDbConnectionPool()
 		thread_wait(m_pWorkerThread);
 	if(m_pBackupThread)
 		thread_wait(m_pBackupThread);
+	for(void *pReadThread : m_vpReadThreads)
+		thread_wait(pReadThread);
 }
@@ -2,7 +2,9 @@
 #define ENGINE_SERVER_DATABASES_CONNECTION_POOL_H
 
 #include <atomic>
+#include <base/lock.h>
 #include <base/tl/threading.h>
+#include <deque>
 #include <memory>
 #include <vector>
 
@@ -76,7 +78,29 @@ public:
 		NUM_MODES,
 	};
 
+	// reads and writes are queued separately, so slow reads don't delay writes
+	enum Lane
+	{
+		LANE_READ,
+		LANE_WRITE,
+		NUM_LANES,
+	};
+
+	enum
+	{
+		MAX_READ_WORKERS = 16,
+		// number of queued writes executed in one transaction
+		MAX_WRITE_BATCH = 16,
+		// latencies below 1ms, 10ms, 100ms, 1s, 10s and above
+		NUM_LATENCY_BUCKETS = 6,
+	};
+
 	void Print(IConsole *pConsole, Mode DatabaseMode);
+	// prints queue depth and latencies of the read and write lane
+	void PrintStats(IConsole *pConsole);
+
+	// has to be called before the first read, defaults to one read worker
+	void SetNumReadWorkers(int NumWorkers);
 
 	void RegisterSqliteDatabase(Mode DatabaseMode, const char FileName[64]);
 	void RegisterMysqlDatabase(Mode DatabaseMode, const CMysqlConfig *pMysqlConfig);
@@ -96,38 +120,66 @@ public:
 
 	friend class CWorker;
 	friend class CBackup;
+	friend class CReadWorker;
 
 private:
 	static bool ExecSqlFunc(IDbConnection *pConnection, struct CSqlExecData *pData, Write w);
+	static bool ExecSqlBatch(IDbConnection *pConnection, std::vector<std::unique_ptr<struct CSqlExecData>> &vpData);
 
-	// Only the main thread accesses this variable. It points to the index,
-	// where the next query is added to the queue.
-	int m_InsertIdx = 0;
+	void QueueRead(std::unique_ptr<struct CSqlExecData> pData);
+	void QueueWrite(std::unique_ptr<struct CSqlExecData> pData);
+	void StartReadWorkers();
 
 	bool m_Shutdown = false;
+	int m_NumReadWorkers = 1;
+
+	struct CLaneStats
+	{
+		// queries waiting or in progress
+		std::atomic_int m_Depth{0};
+		std::atomic_int m_MaxDepth{0};
+		std::atomic_int m_NumFailed{0};
+		// time from queueing until the query completed
+		std::atomic_int m_aLatencies[NUM_LATENCY_BUCKETS] = {};
+
+		void OnQueue();
+		void OnComplete(int64_t QueueTime, bool Success);
+	};
 
 	struct CSharedData
 	{
 		// Used as signal that shutdown is in progress from main thread to
 		// speed up the queries by discarding read queries and writing to
 		// the sqlite file instead of the remote mysql server.
-		// The worker thread signals the main thread that all queries are
-		// processed by setting this variable to false again.
 		std::atomic_bool m_Shutdown{false};
-		// Queries go first to the backup thread. This semaphore signals about
-		// new queries.
+		// number of threads that haven't worked through their queue yet
+		std::atomic_int m_NumRunning{0};
+
+		CLock m_QueueLock;
+		// Writes go first to the backup thread, which passes them on to the
+		// write worker. This keeps the order of the writes.
+		std::deque<std::unique_ptr<struct CSqlExecData>> m_BackupQueue GUARDED_BY(m_QueueLock);
+		std::deque<std::unique_ptr<struct CSqlExecData>> m_WriteQueue GUARDED_BY(m_QueueLock);
+		// consumed by all read workers
+		std::deque<std::unique_ptr<struct CSqlExecData>> m_ReadQueue GUARDED_BY(m_QueueLock);
+		// every read worker connects to all read servers
+		std::vector<std::unique_ptr<struct CSqlExecData>> m_vpReadServers GUARDED_BY(m_QueueLock);
+
+		// signal the number of entries in the queues above
 		CSemaphore m_NumBackup;
-		// When the backup thread processed the query, it signals the main
-		// thread with this semaphore about the new query
 		CSemaphore m_NumWorker;
+		CSemaphore m_NumRead;
 
-		// spsc queue with additional backup worker to look at queries first.
-		std::unique_ptr<struct CSqlExecData> m_aQueries[512];
+		CLaneStats m_aStats[NUM_LANES];
 	};
 
+	// marks the result as completed and records the latency
+	static void CompleteQuery(CLaneStats *pStats, struct CSqlExecData *pData, bool Success);
+
 	std::shared_ptr<CSharedData> m_pShared;
 	void *m_pWorkerThread = nullptr;
 	void *m_pBackupThread = nullptr;
+	std::vector<void *> m_vpReadThreads;
 };
 
 #endif // ENGINE_SERVER_DATABASES_CONNECTION_POOL_H
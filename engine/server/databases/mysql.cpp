@@ -101,6 +101,10 @@ public:
 	void GetString(int Col, char *pBuffer, int BufferSize) override;
 	int GetBlob(int Col, unsigned char *pBuffer, int BufferSize) override;
 
+	bool BeginTransaction(char *pError, int ErrorSize) override;
+	bool CommitTransaction(char *pError, int ErrorSize) override;
+	void RollbackTransaction() override;
+
 	bool AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize) override;
 
 private:
@@ -685,6 +689,41 @@ bool CMysqlConnection::AddPoints(const char *pPlayer, int Points, char *pError,
 	return ExecuteUpdate(&NumUpdated, pError, ErrorSize);
 }
 
+bool CMysqlConnection::BeginTransaction(char *pError, int ErrorSize)
+{
+	if(mysql_autocommit(&m_Mysql, false))
+	{
+		StoreErrorMysql("autocommit");
+		str_copy(pError, m_aErrorDetail, ErrorSize);
+		return true;
+	}
+	return false;
+}
+
+bool CMysqlConnection::CommitTransaction(char *pError, int ErrorSize)
+{
+	bool Failed = false;
+	if(mysql_commit(&m_Mysql))
+	{
+		StoreErrorMysql("commit");
+		str_copy(pError, m_aErrorDetail, ErrorSize);
+		mysql_rollback(&m_Mysql);
+		Failed = true;
+	}
+	mysql_autocommit(&m_Mysql, true);
+	return Failed;
+}
+
+void CMysqlConnection::RollbackTransaction()
+{
+	if(mysql_rollback(&m_Mysql))
+	{
+		StoreErrorMysql("rollback");
+		dbg_msg("mysql", "rollback failed %s", m_aErrorDetail);
+	}
+	mysql_autocommit(&m_Mysql, true);
+}
+
 std::unique_ptr<IDbConnection> CreateMysqlConnection(CMysqlConfig Config)
 {
 	return std::make_unique<CMysqlConnection>(Config);
@@ -50,6 +50,10 @@ public:
 	// passing a negative buffer size is undefined behavior
 	int GetBlob(int Col, unsigned char *pBuffer, int BufferSize) override;
 
+	bool BeginTransaction(char *pError, int ErrorSize) override;
+	bool CommitTransaction(char *pError, int ErrorSize) override;
+	void RollbackTransaction() override;
+
 	bool AddPoints(const char *pPlayer, int Points, char *pError, int ErrorSize) override;
 
 	// fail safe
@@ -352,6 +356,31 @@ const char *CSqliteConnection::MedianMapTime(char *pBuffer, int BufferSize) cons
 	return pBuffer;
 }
 
+bool CSqliteConnection::BeginTransaction(char *pError, int ErrorSize)
+{
+	// take the write lock right away, upgrading a read transaction later
+	// can fail with SQLITE_BUSY regardless of the busy timeout
+	return Execute("BEGIN IMMEDIATE", pError, ErrorSize);
+}
+
+bool CSqliteConnection::CommitTransaction(char *pError, int ErrorSize)
+{
+	if(m_pStmt != nullptr)
+		sqlite3_finalize(m_pStmt);
+	m_pStmt = nullptr;
+	return Execute("COMMIT", pError, ErrorSize);
+}
+
+void CSqliteConnection::RollbackTransaction()
+{
+	if(m_pStmt != nullptr)
+		sqlite3_finalize(m_pStmt);
+	m_pStmt = nullptr;
+	char aError[256];
+	if(Execute("ROLLBACK", aError, sizeof(aError)))
+		dbg_msg("sql", "rollback failed: %s", aError);
+}
+
 bool CSqliteConnection::Execute(const char *pQuery, char *pError, int ErrorSize)
 {
 	char *pErrorMsg;
@@ -316,6 +316,8 @@ CServer::CServer()
 	for(int i = 0; i < MAX_CLIENTS; i++)
 		m_aDemoRecorder[i] = CDemoRecorder(&m_SnapshotDelta, true);
 	m_aDemoRecorder[MAX_CLIENTS] = CDemoRecorder(&m_SnapshotDelta, false);
+	for(auto &Recorder : m_aDemoRecorder)
+		Recorder.SetAsyncWriter(&m_DemoWriter);
 
 	m_TickSpeed = SERVER_TICK_SPEED;
 
@@ -324,6 +326,11 @@ CServer::CServer()
 	m_CurrentGameTick = MIN_TICK;
 	m_RunServer = UNINITIALIZED;
 
+	m_pSnapItemBuffer = nullptr;
+	m_NumSnapJobs = 0;
+	m_NextSnapJob = 0;
+	m_SnapWorkersShutdown = false;
+
 	m_aShutdownReason[0] = 0;
 
 	for(int i = 0; i < NUM_MAP_TYPES; i++)
@@ -359,7 +366,7 @@ CServer::~CServer()
 {
 	for(auto &pCurrentMapData : m_apCurrentMapData)
 	{
-		free(pCurrentMapData);
+		free((void *)pCurrentMapData);
 	}
 
 	if(m_RunServer != UNINITIALIZED)
@@ -916,132 +923,249 @@ void CServer::SendMsgRaw(int ClientID, const void *pData, int Size, int Flags)
 	m_NetServer.Send(&Packet);
 }
 
-void CServer::DoSnapshot()
+bool CServer::WantsSnapshot(int ClientID) const
 {
-	GameServer()->OnPreSnap();
+	// client must be ingame to receive snapshots
+	if(m_aClients[ClientID].m_State != CClient::STATE_INGAME)
+		return false;
 
-	// create snapshot for demo recording
-	if(m_aDemoRecorder[MAX_CLIENTS].IsRecording())
-	{
-		char aData[CSnapshot::MAX_SIZE];
+	// this client is trying to recover, don't spam snapshots
+	if(m_aClients[ClientID].m_SnapRate == CClient::SNAPRATE_RECOVER && (Tick() % 50) != 0)
+		return false;
 
-		// build snap and possibly add some messages
-		m_SnapshotBuilder.Init();
-		GameServer()->OnSnap(-1);
-		int SnapshotSize = m_SnapshotBuilder.Finish(aData);
+	// this client is trying to recover, don't spam snapshots
+	if(m_aClients[ClientID].m_SnapRate == CClient::SNAPRATE_INIT && (Tick() % 10) != 0)
+		return false;
 
-		// write snapshot
-		m_aDemoRecorder[MAX_CLIENTS].RecordSnapshot(Tick(), aData, SnapshotSize);
-	}
+	return true;
+}
 
-	// create snapshots for all clients
-	for(int i = 0; i < MaxClients(); i++)
-	{
-		// client must be ingame to receive snapshots
-		if(m_aClients[i].m_State != CClient::STATE_INGAME)
-			continue;
+CServer::CSnapJob *CServer::GetSnapJob(int Index)
+{
+	while((int)m_vpSnapJobs.size() <= Index)
+		m_vpSnapJobs.push_back(std::make_unique<CSnapJob>());
+	return m_vpSnapJobs[Index].get();
+}
 
-		// this client is trying to recover, don't spam snapshots
-		if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_RECOVER && (Tick() % 50) != 0)
-			continue;
+void CServer::BuildClientSnapshot(CSnapJob *pJob)
+{
+	const int ClientID = pJob->m_ClientID;
+	m_SnapshotBuilder.Init(m_aClients[ClientID].m_Sixup);
 
-		// this client is trying to recover, don't spam snapshots
-		if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_INIT && (Tick() % 10) != 0)
-			continue;
+	GameServer()->OnSnap(ClientID);
 
-		{
-			m_SnapshotBuilder.Init(m_aClients[i].m_Sixup);
+	// finish snapshot
+	pJob->m_SnapshotSize = m_SnapshotBuilder.Finish(pJob->m_aData);
 
-			GameServer()->OnSnap(i);
+	if(m_aDemoRecorder[ClientID].IsRecording())
+	{
+		// write snapshot
+		m_aDemoRecorder[ClientID].RecordSnapshot(Tick(), pJob->m_aData, pJob->m_SnapshotSize);
+	}
+}
 
-			// finish snapshot
-			char aData[CSnapshot::MAX_SIZE];
-			CSnapshot *pData = (CSnapshot *)aData; // Fix compiler warning for strict-aliasing
-			int SnapshotSize = m_SnapshotBuilder.Finish(pData);
+void CServer::EncodeClientSnapshot(CSnapJob *pJob)
+{
+	// may run on a snapshot worker, only touch the state of this client
+	CClient &Client = m_aClients[pJob->m_ClientID];
+	CSnapshot *pData = (CSnapshot *)pJob->m_aData; // Fix compiler warning for strict-aliasing
 
-			if(m_aDemoRecorder[i].IsRecording())
-			{
-				// write snapshot
-				m_aDemoRecorder[i].RecordSnapshot(Tick(), aData, SnapshotSize);
-			}
+	pJob->m_Crc = pData->Crc();
 
-			int Crc = pData->Crc();
+	// remove old snapshots
+	// keep 3 seconds worth of snapshots
+	Client.m_Snapshots.PurgeUntil(m_CurrentGameTick - SERVER_TICK_SPEED * 3);
 
-			// remove old snapshots
-			// keep 3 seconds worth of snapshots
-			m_aClients[i].m_Snapshots.PurgeUntil(m_CurrentGameTick - SERVER_TICK_SPEED * 3);
+	// save the snapshot
+	Client.m_Snapshots.Add(m_CurrentGameTick, time_get(), pJob->m_SnapshotSize, pData, 0, nullptr);
 
-			// save the snapshot
-			m_aClients[i].m_Snapshots.Add(m_CurrentGameTick, time_get(), SnapshotSize, pData, 0, nullptr);
+	// find snapshot that we can perform delta against
+	pJob->m_DeltaTick = -1;
+	const CSnapshot *pDeltashot = CSnapshot::EmptySnapshot();
+	{
+		int DeltashotSize = Client.m_Snapshots.Get(Client.m_LastAckedSnapshot, 0, &pDeltashot, 0);
+		if(DeltashotSize >= 0)
+			pJob->m_DeltaTick = Client.m_LastAckedSnapshot;
+		else
+		{
+			// no acked package found, force client to recover rate
+			if(Client.m_SnapRate == CClient::SNAPRATE_FULL)
+				Client.m_SnapRate = CClient::SNAPRATE_RECOVER;
+		}
+	}
 
-			// find snapshot that we can perform delta against
-			int DeltaTick = -1;
-			const CSnapshot *pDeltashot = CSnapshot::EmptySnapshot();
-			{
-				int DeltashotSize = m_aClients[i].m_Snapshots.Get(m_aClients[i].m_LastAckedSnapshot, 0, &pDeltashot, 0);
-				if(DeltashotSize >= 0)
-					DeltaTick = m_aClients[i].m_LastAckedSnapshot;
-				else
-				{
-					// no acked package found, force client to recover rate
-					if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
-						m_aClients[i].m_SnapRate = CClient::SNAPRATE_RECOVER;
-				}
-			}
+	// create delta
+	const CSnapshotDelta &Delta = Client.m_Sixup ? m_SnapshotDeltaSixup : m_SnapshotDelta;
+	char aDeltaData[CSnapshot::MAX_SIZE];
+	pJob->m_DeltaSize = Delta.CreateDelta(pDeltashot, pData, aDeltaData);
+	pJob->m_CompSize = 0;
 
-			// create delta
-			m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, m_aClients[i].m_Sixup);
-			m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, m_aClients[i].m_Sixup);
-			char aDeltaData[CSnapshot::MAX_SIZE];
-			int DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+	if(pJob->m_DeltaSize)
+	{
+		// compress it
+		pJob->m_CompSize = CVariableInt::Compress(aDeltaData, pJob->m_DeltaSize, pJob->m_aCompData, sizeof(pJob->m_aCompData));
+	}
+}
 
-			if(DeltaSize)
-			{
-				// compress it
-				const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
+void CServer::SendClientSnapshot(const CSnapJob *pJob)
+{
+	const int ClientID = pJob->m_ClientID;
+	const int DeltaTick = pJob->m_DeltaTick;
 
-				char aCompData[CSnapshot::MAX_SIZE];
-				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
-				int NumPackets = (SnapshotSize + MaxSize - 1) / MaxSize;
+	if(pJob->m_DeltaSize)
+	{
+		const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
+		const int SnapshotSize = pJob->m_CompSize;
+		int NumPackets = (SnapshotSize + MaxSize - 1) / MaxSize;
 
-				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
-				{
-					int Chunk = Left < MaxSize ? Left : MaxSize;
-					Left -= Chunk;
+		for(int n = 0, Left = SnapshotSize; Left > 0; n++)
+		{
+			int Chunk = Left < MaxSize ? Left : MaxSize;
+			Left -= Chunk;
 
-					if(NumPackets == 1)
-					{
-						CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick - DeltaTick);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n * MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-					else
-					{
-						CMsgPacker Msg(NETMSG_SNAP, true);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick - DeltaTick);
-						Msg.AddInt(NumPackets);
-						Msg.AddInt(n);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n * MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
-					}
-				}
+			if(NumPackets == 1)
+			{
+				CMsgPacker Msg(NETMSG_SNAPSINGLE, true);
+				Msg.AddInt(m_CurrentGameTick);
+				Msg.AddInt(m_CurrentGameTick - DeltaTick);
+				Msg.AddInt(pJob->m_Crc);
+				Msg.AddInt(Chunk);
+				Msg.AddRaw(&pJob->m_aCompData[n * MaxSize], Chunk);
+				SendMsg(&Msg, MSGFLAG_FLUSH, ClientID);
 			}
 			else
 			{
-				CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
+				CMsgPacker Msg(NETMSG_SNAP, true);
 				Msg.AddInt(m_CurrentGameTick);
 				Msg.AddInt(m_CurrentGameTick - DeltaTick);
-				SendMsg(&Msg, MSGFLAG_FLUSH, i);
+				Msg.AddInt(NumPackets);
+				Msg.AddInt(n);
+				Msg.AddInt(pJob->m_Crc);
+				Msg.AddInt(Chunk);
+				Msg.AddRaw(&pJob->m_aCompData[n * MaxSize], Chunk);
+				SendMsg(&Msg, MSGFLAG_FLUSH, ClientID);
 			}
 		}
 	}
+	else
+	{
+		CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
+		Msg.AddInt(m_CurrentGameTick);
+		Msg.AddInt(m_CurrentGameTick - DeltaTick);
+		SendMsg(&Msg, MSGFLAG_FLUSH, ClientID);
+	}
+}
+
+void CServer::StartSnapWorkers(int NumThreads)
+{
+	m_SnapWorkersShutdown = false;
+	sphore_init(&m_SnapWorkSemaphore);
+	sphore_init(&m_SnapDoneSemaphore);
+
+	char aName[32];
+	m_vpSnapWorkers.reserve(NumThreads);
+	for(int i = 0; i < NumThreads; i++)
+	{
+		str_format(aName, sizeof(aName), "snapshot worker %d", i);
+		m_vpSnapWorkers.push_back(thread_init(SnapWorkerThread, this, aName));
+	}
+}
+
+void CServer::StopSnapWorkers()
+{
+	if(m_vpSnapWorkers.empty())
+		return;
+
+	m_SnapWorkersShutdown = true;
+	for(size_t i = 0; i < m_vpSnapWorkers.size(); i++)
+		sphore_signal(&m_SnapWorkSemaphore);
+	for(void *pThread : m_vpSnapWorkers)
+		thread_wait(pThread);
+	m_vpSnapWorkers.clear();
+	sphore_destroy(&m_SnapWorkSemaphore);
+	sphore_destroy(&m_SnapDoneSemaphore);
+}
+
+void CServer::SnapWorkerThread(void *pUser)
+{
+	CServer *pThis = (CServer *)pUser;
+
+	while(true)
+	{
+		sphore_wait(&pThis->m_SnapWorkSemaphore);
+		if(pThis->m_SnapWorkersShutdown)
+			break;
+		pThis->RunSnapJobs();
+		sphore_signal(&pThis->m_SnapDoneSemaphore);
+	}
+}
+
+void CServer::RunSnapJobs()
+{
+	int Index;
+	while((Index = m_NextSnapJob.fetch_add(1)) < m_NumSnapJobs)
+		EncodeClientSnapshot(m_vpSnapJobs[Index].get());
+}
+
+void CServer::DoSnapshot()
+{
+	GameServer()->OnPreSnap();
+
+	// create snapshot for demo recording
+	if(m_aDemoRecorder[MAX_CLIENTS].IsRecording())
+	{
+		char aData[CSnapshot::MAX_SIZE];
+
+		// build snap and possibly add some messages
+		m_SnapshotBuilder.Init();
+		GameServer()->OnSnap(-1);
+		int SnapshotSize = m_SnapshotBuilder.Finish(aData);
+
+		// write snapshot
+		m_aDemoRecorder[MAX_CLIENTS].RecordSnapshot(Tick(), aData, SnapshotSize);
+	}
+
+	if(m_vpSnapWorkers.empty())
+	{
+		// create snapshots for all clients
+		for(int i = 0; i < MaxClients(); i++)
+		{
+			if(!WantsSnapshot(i))
+				continue;
+
+			CSnapJob *pJob = GetSnapJob(0);
+			pJob->m_ClientID = i;
+			BuildClientSnapshot(pJob);
+			EncodeClientSnapshot(pJob);
+			SendClientSnapshot(pJob);
+		}
+	}
+	else
+	{
+		// the game is not thread-safe, build all snapshots on the main thread
+		m_NumSnapJobs = 0;
+		for(int i = 0; i < MaxClients(); i++)
+		{
+			if(!WantsSnapshot(i))
+				continue;
+
+			CSnapJob *pJob = GetSnapJob(m_NumSnapJobs++);
+			pJob->m_ClientID = i;
+			BuildClientSnapshot(pJob);
+		}
+
+		// delta and compress them on the workers, the main thread helps out
+		m_NextSnapJob = 0;
+		for(size_t i = 0; i < m_vpSnapWorkers.size(); i++)
+			sphore_signal(&m_SnapWorkSemaphore);
+		RunSnapJobs();
+		for(size_t i = 0; i < m_vpSnapWorkers.size(); i++)
+			sphore_wait(&m_SnapDoneSemaphore);
+
+		// send in client order
+		for(int i = 0; i < m_NumSnapJobs; i++)
+			SendClientSnapshot(m_vpSnapJobs[i].get());
+	}
 
 	GameServer()->OnPostSnap();
 }
@@ -2567,12 +2691,14 @@ int CServer::LoadMap(const char *pMapName)
 
 	str_copy(m_aCurrentMap, pMapName);
 
-	// load complete map into memory for download
+	// copy the complete map into memory for download, the file held by the
+	// map may be mapped and can change on disk while clients download it
 	{
-		free(m_apCurrentMapData[MAP_TYPE_SIX]);
-		void *pData;
-		Storage()->ReadFile(aBuf, IStorage::TYPE_ALL, &pData, &m_aCurrentMapSize[MAP_TYPE_SIX]);
-		m_apCurrentMapData[MAP_TYPE_SIX] = (unsigned char *)pData;
+		free((void *)m_apCurrentMapData[MAP_TYPE_SIX]);
+		unsigned char *pData = (unsigned char *)malloc(m_pMap->FileSize());
+		mem_copy(pData, m_pMap->FileData(), m_pMap->FileSize());
+		m_apCurrentMapData[MAP_TYPE_SIX] = pData;
+		m_aCurrentMapSize[MAP_TYPE_SIX] = m_pMap->FileSize();
 	}
 
 	// load sixup version of the map
@@ -2593,7 +2719,7 @@ int CServer::LoadMap(const char *pMapName)
 		}
 		else
 		{
-			free(m_apCurrentMapData[MAP_TYPE_SIXUP]);
+			free((void *)m_apCurrentMapData[MAP_TYPE_SIXUP]);
 			m_apCurrentMapData[MAP_TYPE_SIXUP] = (unsigned char *)pData;
 
 			m_aCurrentMapSha256[MAP_TYPE_SIXUP] = sha256(m_apCurrentMapData[MAP_TYPE_SIXUP], m_aCurrentMapSize[MAP_TYPE_SIXUP]);
@@ -2605,7 +2731,7 @@ int CServer::LoadMap(const char *pMapName)
 	}
 	if(!Config()->m_SvSixup)
 	{
-		free(m_apCurrentMapData[MAP_TYPE_SIXUP]);
+		free((void *)m_apCurrentMapData[MAP_TYPE_SIXUP]);
 		m_apCurrentMapData[MAP_TYPE_SIXUP] = 0;
 	}
 
@@ -2644,6 +2770,8 @@ int CServer::Run()
 		return -1;
 	}
 
+	DbPool()->SetNumReadWorkers(Config()->m_SvSqlReadWorkers);
+
 	if(Config()->m_SvSqliteFile[0] != '\0')
 	{
 		char aFullPath[IO_MAX_PATH_LENGTH];
@@ -2686,6 +2814,8 @@ int CServer::Run()
 	if(Port == 0)
 		dbg_msg("server", "using port %d", BindAddr.port);
 
+	m_NetServer.SetSendBatching(Config()->m_SvSendBatching);
+
 #if defined(CONF_UPNP)
 	m_UPnP.Open(BindAddr);
 #endif
@@ -2720,6 +2850,13 @@ int CServer::Run()
 	m_pConsole->StoreCommands(false);
 	m_pRegister->OnConfigChange();
 
+	if(Config()->m_SvSnapshotThreads > 0)
+	{
+		StartSnapWorkers(Config()->m_SvSnapshotThreads);
+		str_format(aBuf, sizeof(aBuf), "encoding snapshots on %d worker threads", Config()->m_SvSnapshotThreads);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+
 	if(m_AuthManager.IsGenerated())
 	{
 		dbg_msg("server", "+-------------------------+");
@@ -2911,6 +3048,9 @@ int CServer::Run()
 			// master server stuff
 			m_pRegister->Update();
 
+			// finished jobs, see IJob::Then
+			pEngine->RunJobContinuations();
+
 			if(m_ServerInfoNeedsUpdate)
 				UpdateServerInfo();
 
@@ -2933,6 +3073,9 @@ int CServer::Run()
 				}
 			}
 
+			// send everything this iteration produced before going to sleep
+			m_NetServer.FlushSendQueue();
+
 			// wait for incoming data
 			if(NonActive)
 			{
@@ -2985,6 +3128,8 @@ int CServer::Run()
 			m_NetServer.Drop(i, pDisconnectReason);
 	}
 
+	StopSnapWorkers();
+
 	m_Econ.Shutdown();
 
 	m_Fifo.Shutdown();
@@ -3381,6 +3526,7 @@ void CServer::DemoRecorder_HandleAutoStart()
 		char aDate[20];
 		str_timestamp(aDate, sizeof(aDate));
 		str_format(aFilename, sizeof(aFilename), "demos/%s_%s.demo", "auto/autorecord", aDate);
+		m_DemoWriter.SetQueueSize(Config()->m_SvDemoAsyncQueue * 1024);
 		m_aDemoRecorder[MAX_CLIENTS].Start(Storage(), m_pConsole, aFilename, GameServer()->NetVersion(), m_aCurrentMap, m_aCurrentMapSha256[MAP_TYPE_SIX], m_aCurrentMapCrc[MAP_TYPE_SIX], "server", m_aCurrentMapSize[MAP_TYPE_SIX], m_apCurrentMapData[MAP_TYPE_SIX]);
 		if(Config()->m_SvAutoDemoMax)
 		{
@@ -3412,6 +3558,7 @@ void CServer::StartRecord(int ClientID)
 	{
 		char aFilename[IO_MAX_PATH_LENGTH];
 		str_format(aFilename, sizeof(aFilename), "demos/%s_%d_%d_tmp.demo", m_aCurrentMap, m_NetServer.Address().port, ClientID);
+		m_DemoWriter.SetQueueSize(Config()->m_SvDemoAsyncQueue * 1024);
 		m_aDemoRecorder[ClientID].Start(Storage(), Console(), aFilename, GameServer()->NetVersion(), m_aCurrentMap, m_aCurrentMapSha256[MAP_TYPE_SIX], m_aCurrentMapCrc[MAP_TYPE_SIX], "server", m_aCurrentMapSize[MAP_TYPE_SIX], m_apCurrentMapData[MAP_TYPE_SIX]);
 	}
 }
@@ -3446,6 +3593,7 @@ void CServer::ConRecord(IConsole::IResult *pResult, void *pUser)
 		str_timestamp(aDate, sizeof(aDate));
 		str_format(aFilename, sizeof(aFilename), "demos/demo_%s.demo", aDate);
 	}
+	pServer->m_DemoWriter.SetQueueSize(pServer->Config()->m_SvDemoAsyncQueue * 1024);
 	pServer->m_aDemoRecorder[MAX_CLIENTS].Start(pServer->Storage(), pServer->Console(), aFilename, pServer->GameServer()->NetVersion(), pServer->m_aCurrentMap, pServer->m_aCurrentMapSha256[MAP_TYPE_SIX], pServer->m_aCurrentMapCrc[MAP_TYPE_SIX], "server", pServer->m_aCurrentMapSize[MAP_TYPE_SIX], pServer->m_apCurrentMapData[MAP_TYPE_SIX]);
 }
 
@@ -3470,6 +3618,36 @@ void CServer::ConLogout(IConsole::IResult *pResult, void *pUser)
 	}
 }
 
+void CServer::ConDemoRecorderStats(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pServer = (CServer *)pUser;
+
+	for(int i = 0; i < MAX_CLIENTS + 1; i++)
+	{
+		const CDemoRecorder &Recorder = pServer->m_aDemoRecorder[i];
+		const CDemoRecorder::CAsyncStats &Stats = Recorder.AsyncStats();
+		if(!Recorder.IsRecording() || !Stats.m_QueueSize)
+			continue;
+
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "%s: queued=%" PRId64 " dropped=%" PRId64 " peak_usage=%dKiB/%dKiB",
+			i == MAX_CLIENTS ? "server" : pServer->ClientName(i), Stats.m_NumQueued, Stats.m_NumDropped, Stats.m_PeakUsage / 1024, Stats.m_QueueSize / 1024);
+		pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+}
+
+void CServer::ConNetSendStats(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pServer = (CServer *)pUser;
+
+	NETSTATS Stats;
+	net_stats(&Stats);
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "sent packets=%" PRIu64 " bytes=%" PRIu64 " syscalls=%" PRIu64 " packets_per_syscall=%.2f",
+		Stats.sent_packets, Stats.sent_bytes, Stats.sent_syscalls, Stats.sent_syscalls ? (double)Stats.sent_packets / Stats.sent_syscalls : 0.0);
+	pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+}
+
 void CServer::ConShowIps(IConsole::IResult *pResult, void *pUser)
 {
 	CServer *pServer = (CServer *)pUser;
@@ -3540,6 +3718,12 @@ void CServer::ConAddSqlServer(IConsole::IResult *pResult, void *pUserData)
 	pSelf->DbPool()->RegisterMysqlDatabase(Write ? CDbConnectionPool::WRITE : CDbConnectionPool::READ, &Config);
 }
 
+void CServer::ConDumpSqlStats(IConsole::IResult *pResult, void *pUserData)
+{
+	CServer *pSelf = (CServer *)pUserData;
+	pSelf->DbPool()->PrintStats(pSelf->Console());
+}
+
 void CServer::ConDumpSqlServers(IConsole::IResult *pResult, void *pUserData)
 {
 	CServer *pSelf = (CServer *)pUserData;
@@ -3788,6 +3972,8 @@ void CServer::RegisterCommands()
 	Console()->Register("shutdown", "?r[reason]", CFGFLAG_SERVER, ConShutdown, this, "Shut down");
 	Console()->Register("logout", "", CFGFLAG_SERVER, ConLogout, this, "Logout of rcon");
 	Console()->Register("show_ips", "?i[show]", CFGFLAG_SERVER, ConShowIps, this, "Show IP addresses in rcon commands (1 = on, 0 = off)");
+	Console()->Register("demo_recorder_stats", "", CFGFLAG_SERVER, ConDemoRecorderStats, this, "Show the queue usage and dropped chunks of the background demo writers");
+	Console()->Register("net_send_stats", "", CFGFLAG_SERVER, ConNetSendStats, this, "Show how many packets were sent and with how many syscalls");
 
 	Console()->Register("record", "?s[file]", CFGFLAG_SERVER | CFGFLAG_STORE, ConRecord, this, "Record to a file");
 	Console()->Register("stoprecord", "", CFGFLAG_SERVER, ConStopRecord, this, "Stop recording");
@@ -3796,6 +3982,7 @@ void CServer::RegisterCommands()
 
 	Console()->Register("add_sqlserver", "s['r'|'w'] s[Database] s[Prefix] s[User] s[Password] s[IP] i[Port] ?i[SetUpDatabase ?]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAddSqlServer, this, "add a sqlserver");
 	Console()->Register("dump_sqlservers", "s['r'|'w']", CFGFLAG_SERVER, ConDumpSqlServers, this, "dumps all sqlservers readservers = r, writeservers = w");
+	Console()->Register("dump_sqlstats", "", CFGFLAG_SERVER, ConDumpSqlStats, this, "dumps queue depth and latencies of the sql read and write queries");
 
 	Console()->Register("auth_add", "s[ident] s[level] r[pw]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAuthAdd, this, "Add a rcon key");
 	Console()->Register("auth_add_p", "s[ident] s[level] s[hash] s[salt]", CFGFLAG_SERVER | CFGFLAG_NONTEEHISTORIC, ConAuthAddHashed, this, "Add a prehashed rcon key");
@@ -3848,12 +4035,29 @@ void CServer::SnapFreeID(int ID)
 void *CServer::SnapNewItem(int Type, int ID, int Size)
 {
 	dbg_assert(ID >= -1 && ID <= 0xffff, "incorrect id");
-	return ID < 0 ? 0 : m_SnapshotBuilder.NewItem(Type, ID, Size);
+	if(ID < 0)
+		return 0;
+	if(m_pSnapItemBuffer)
+		return m_pSnapItemBuffer->NewItem(Type, ID, Size);
+	return m_SnapshotBuilder.NewItem(Type, ID, Size);
 }
 
 void CServer::SnapSetStaticsize(int ItemType, int Size)
 {
 	m_SnapshotDelta.SetStaticsize(ItemType, Size);
+	m_SnapshotDeltaSixup.SetStaticsize(ItemType, Size);
+
+	// the 0.7 event types need other sizes per protocol, set them here
+	// instead of in DoSnapshot, the demo writer threads read the sizes
+	m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, false);
+	m_SnapshotDelta.SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, false);
+	m_SnapshotDeltaSixup.SetStaticsize(protocol7::NETEVENTTYPE_SOUNDWORLD, true);
+	m_SnapshotDeltaSixup.SetStaticsize(protocol7::NETEVENTTYPE_DAMAGE, true);
+}
+
+void CServer::SnapSetItemBuffer(CSnapItemBuffer *pBuffer)
+{
+	m_pSnapItemBuffer = pBuffer;
 }
 
 CServer *CreateServer() { return new CServer(); }
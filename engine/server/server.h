@@ -17,6 +17,7 @@
 #include <engine/shared/snapshot.h>
 #include <engine/shared/uuid_manager.h>
 
+#include <atomic>
 #include <list>
 #include <memory>
 #include <optional>
@@ -221,7 +222,9 @@ public:
 	int m_aIdMap[MAX_CLIENTS * VANILLA_MAX_CLIENTS];
 
 	CSnapshotDelta m_SnapshotDelta;
+	CSnapshotDelta m_SnapshotDeltaSixup;
 	CSnapshotBuilder m_SnapshotBuilder;
+	CSnapItemBuffer *m_pSnapItemBuffer;
 	CSnapIDPool m_IDPool;
 	CNetServer m_NetServer;
 	CEcon m_Econ;
@@ -260,9 +263,11 @@ public:
 	char m_aCurrentMap[IO_MAX_PATH_LENGTH];
 	SHA256_DIGEST m_aCurrentMapSha256[NUM_MAP_TYPES];
 	unsigned m_aCurrentMapCrc[NUM_MAP_TYPES];
-	unsigned char *m_apCurrentMapData[NUM_MAP_TYPES];
+	const unsigned char *m_apCurrentMapData[NUM_MAP_TYPES];
 	unsigned int m_aCurrentMapSize[NUM_MAP_TYPES];
 
+	// declared first, so it outlives the recorders
+	CDemoWriter m_DemoWriter;
 	CDemoRecorder m_aDemoRecorder[MAX_CLIENTS + 1];
 	CAuthManager m_AuthManager;
 
@@ -326,6 +331,40 @@ public:
 	int GetClientVersion(int ClientID) const override;
 	int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID) override;
 
+	// a client snapshot on its way through DoSnapshot: built on the main
+	// thread, encoded on the snapshot workers, sent on the main thread
+	class CSnapJob
+	{
+	public:
+		int m_ClientID;
+		int m_SnapshotSize;
+		int m_Crc;
+		int m_DeltaTick;
+		int m_DeltaSize;
+		int m_CompSize;
+		char m_aData[CSnapshot::MAX_SIZE];
+		char m_aCompData[CSnapshot::MAX_SIZE];
+	};
+
+	std::vector<std::unique_ptr<CSnapJob>> m_vpSnapJobs;
+	int m_NumSnapJobs;
+	std::atomic<int> m_NextSnapJob;
+
+	std::vector<void *> m_vpSnapWorkers;
+	std::atomic<bool> m_SnapWorkersShutdown;
+	SEMAPHORE m_SnapWorkSemaphore;
+	SEMAPHORE m_SnapDoneSemaphore;
+
+	void StartSnapWorkers(int NumThreads);
+	void StopSnapWorkers();
+	static void SnapWorkerThread(void *pUser);
+	void RunSnapJobs();
+
+	bool WantsSnapshot(int ClientID) const;
+	CSnapJob *GetSnapJob(int Index);
+	void BuildClientSnapshot(CSnapJob *pJob);
+	void EncodeClientSnapshot(CSnapJob *pJob);
+	void SendClientSnapshot(const CSnapJob *pJob);
 	void DoSnapshot();
 
 	static int NewClientCallback(int ClientID, void *pUser, bool Sixup);
@@ -410,6 +449,8 @@ public:
 	static void ConMapReload(IConsole::IResult *pResult, void *pUser);
 	static void ConLogout(IConsole::IResult *pResult, void *pUser);
 	static void ConShowIps(IConsole::IResult *pResult, void *pUser);
+	static void ConDemoRecorderStats(IConsole::IResult *pResult, void *pUser);
+	static void ConNetSendStats(IConsole::IResult *pResult, void *pUser);
 
 	static void ConAuthAdd(IConsole::IResult *pResult, void *pUser);
 	static void ConAuthAddHashed(IConsole::IResult *pResult, void *pUser);
@@ -425,6 +466,7 @@ public:
 	// console commands for sqlmasters
 	static void ConAddSqlServer(IConsole::IResult *pResult, void *pUserData);
 	static void ConDumpSqlServers(IConsole::IResult *pResult, void *pUserData);
+	static void ConDumpSqlStats(IConsole::IResult *pResult, void *pUserData);
 
 	static void ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConchainMaxclientsperipUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
@@ -452,6 +494,7 @@ public:
 	void SnapFreeID(int ID) override;
 	void *SnapNewItem(int Type, int ID, int Size) override;
 	void SnapSetStaticsize(int ItemType, int Size) override;
+	void SnapSetItemBuffer(CSnapItemBuffer *pBuffer) override;
 
 	// DDRace
 
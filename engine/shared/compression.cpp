@@ -4,6 +4,7 @@
 
 #include "compression.h"
 
+#include <cstring>
 #include <iterator> // std::size
 
 // Format: ESDDDDDD EDDDDDDD EDD... Extended, Data, Sign
@@ -65,6 +66,73 @@ const unsigned char *CVariableInt::Unpack(const unsigned char *pSrc, int *pInOut
 	return pSrc;
 }
 
+// bulk helpers for Compress and Decompress, callers make sure there is room for the largest packed int
+static inline unsigned char *PackUnchecked(unsigned char *pDst, int i)
+{
+	unsigned char Sign = 0;
+	if(i < 0)
+	{
+		Sign = 0x40; // set sign bit
+		i = ~i;
+	}
+
+	if(i < 0x40)
+	{
+		*pDst = Sign | i;
+		return pDst + 1;
+	}
+
+	*pDst++ = 0x80 | Sign | (i & 0x3F);
+	i >>= 6;
+	while(i >= 0x80)
+	{
+		*pDst++ = 0x80 | (i & 0x7F);
+		i >>= 7;
+	}
+	*pDst++ = i;
+	return pDst;
+}
+
+static inline const unsigned char *UnpackUnchecked(const unsigned char *pSrc, int *pOut)
+{
+	const int Sign = (*pSrc >> 6) & 1;
+	int Value = *pSrc & 0x3F;
+	if(*pSrc & 0x80)
+	{
+		Value |= (pSrc[1] & 0x7F) << 6;
+		if(pSrc[1] & 0x80)
+		{
+			Value |= (pSrc[2] & 0x7F) << (6 + 7);
+			if(pSrc[2] & 0x80)
+			{
+				Value |= (pSrc[3] & 0x7F) << (6 + 7 + 7);
+				if(pSrc[3] & 0x80)
+				{
+					Value |= (pSrc[4] & 0x0F) << (6 + 7 + 7 + 7);
+					pSrc++;
+				}
+				pSrc++;
+			}
+			pSrc++;
+		}
+		pSrc++;
+	}
+	*pOut = Value ^ -Sign; // if(sign) *i = ~(*i)
+	return pSrc + 1;
+}
+
+// ints in [-64, 63] take a single byte without the extend bit
+static inline int UnpackByte(unsigned char Byte)
+{
+	return (Byte & 0x3F) ^ -((Byte >> 6) & 1);
+}
+
+static inline unsigned char PackByte(int i)
+{
+	const int Sign = i >> 31;
+	return (Sign & 0x40) | ((i ^ Sign) & 0x3F);
+}
+
 long CVariableInt::Decompress(const void *pSrc_, int SrcSize, void *pDst_, int DstSize)
 {
 	dbg_assert(DstSize % sizeof(int) == 0, "invalid bounds");
@@ -75,11 +143,31 @@ long CVariableInt::Decompress(const void *pSrc_, int SrcSize, void *pDst_, int D
 	const int *pDstEnd = pDst + DstSize / sizeof(int);
 	while(pSrc < pSrcEnd)
 	{
+		// zero and small deltas dominate, take eight of them at once if no extend bit is set
+		if(pSrcEnd - pSrc >= 8 && pDstEnd - pDst >= 8)
+		{
+			uint64_t Word;
+			memcpy(&Word, pSrc, sizeof(Word));
+			if(!(Word & 0x8080808080808080ull))
+			{
+				for(int i = 0; i < 8; i++)
+					pDst[i] = UnpackByte(pSrc[i]);
+				pSrc += 8;
+				pDst += 8;
+				continue;
+			}
+		}
+
 		if(pDst >= pDstEnd)
 			return -1;
-		pSrc = CVariableInt::Unpack(pSrc, pDst, pSrcEnd - pSrc);
-		if(!pSrc)
-			return -1;
+		if(pSrcEnd - pSrc >= MAX_BYTES_PACKED)
+			pSrc = UnpackUnchecked(pSrc, pDst);
+		else
+		{
+			pSrc = CVariableInt::Unpack(pSrc, pDst, pSrcEnd - pSrc);
+			if(!pSrc)
+				return -1;
+		}
 		pDst++;
 	}
 	return (long)((unsigned char *)pDst - (unsigned char *)pDst_);
@@ -95,9 +183,31 @@ long CVariableInt::Compress(const void *pSrc_, int SrcSize, void *pDst_, int Dst
 	SrcSize /= sizeof(int);
 	while(SrcSize)
 	{
-		pDst = CVariableInt::Pack(pDst, *pSrc, pDstEnd - pDst);
-		if(!pDst)
-			return -1;
+		// eight ints that each fit into a single byte
+		if(SrcSize >= 8 && pDstEnd - pDst >= 8)
+		{
+			unsigned Large = 0;
+			for(int i = 0; i < 8; i++)
+				Large |= ((unsigned)pSrc[i] + 0x40) & ~0x7Fu;
+			if(!Large)
+			{
+				for(int i = 0; i < 8; i++)
+					pDst[i] = PackByte(pSrc[i]);
+				pDst += 8;
+				pSrc += 8;
+				SrcSize -= 8;
+				continue;
+			}
+		}
+
+		if(pDstEnd - pDst >= MAX_BYTES_PACKED)
+			pDst = PackUnchecked(pDst, *pSrc);
+		else
+		{
+			pDst = CVariableInt::Pack(pDst, *pSrc, pDstEnd - pDst);
+			if(!pDst)
+				return -1;
+		}
 		SrcSize--;
 		pSrc++;
 	}
@@ -354,6 +354,38 @@ void CConsole::InitChecksum(CChecksumData *pData) const
 	}
 }
 
+const char *CConsole::FindCommandEnd(const char *pStr, bool InterpretSemicolons, const char **ppNextPart)
+{
+	const char *pEnd = pStr;
+	int InString = 0;
+	*ppNextPart = 0;
+
+	while(*pEnd)
+	{
+		if(*pEnd == '"')
+			InString ^= 1;
+		else if(*pEnd == '\\') // escape sequences
+		{
+			if(pEnd[1] == '"')
+				pEnd++;
+		}
+		else if(!InString && InterpretSemicolons)
+		{
+			if(*pEnd == ';') // command separator
+			{
+				*ppNextPart = pEnd + 1;
+				break;
+			}
+			else if(*pEnd == '#') // comment, no need to do anything more
+				break;
+		}
+
+		pEnd++;
+	}
+
+	return pEnd;
+}
+
 bool CConsole::LineIsValid(const char *pStr)
 {
 	if(!pStr || *pStr == 0)
@@ -362,32 +394,8 @@ bool CConsole::LineIsValid(const char *pStr)
 	do
 	{
 		CResult Result;
-		const char *pEnd = pStr;
-		const char *pNextPart = 0;
-		int InString = 0;
-
-		while(*pEnd)
-		{
-			if(*pEnd == '"')
-				InString ^= 1;
-			else if(*pEnd == '\\') // escape sequences
-			{
-				if(pEnd[1] == '"')
-					pEnd++;
-			}
-			else if(!InString)
-			{
-				if(*pEnd == ';') // command separator
-				{
-					pNextPart = pEnd + 1;
-					break;
-				}
-				else if(*pEnd == '#') // comment, no need to do anything more
-					break;
-			}
-
-			pEnd++;
-		}
+		const char *pNextPart;
+		const char *pEnd = FindCommandEnd(pStr, true, &pNextPart);
 
 		if(ParseStart(&Result, pStr, (pEnd - pStr) + 1) != 0)
 			return false;
@@ -402,6 +410,82 @@ bool CConsole::LineIsValid(const char *pStr)
 	return true;
 }
 
+bool CConsole::CanExecuteCommand(const CCommand *pCommand, const char *pName, int ClientID, int Stroke)
+{
+	if(ClientID == IConsole::CLIENT_ID_GAME && !(pCommand->m_Flags & CFGFLAG_GAME))
+	{
+		if(Stroke)
+		{
+			char aBuf[96];
+			str_format(aBuf, sizeof(aBuf), "Command '%s' cannot be executed from a map.", pName);
+			Print(OUTPUT_LEVEL_STANDARD, "console", aBuf);
+		}
+		return false;
+	}
+	if(ClientID == IConsole::CLIENT_ID_NO_GAME && pCommand->m_Flags & CFGFLAG_GAME)
+	{
+		if(Stroke)
+		{
+			char aBuf[96];
+			str_format(aBuf, sizeof(aBuf), "Command '%s' cannot be executed from a non-map config file.", pName);
+			Print(OUTPUT_LEVEL_STANDARD, "console", aBuf);
+			str_format(aBuf, sizeof(aBuf), "Hint: Put the command in '%s.cfg' instead of '%s.map.cfg' ", g_Config.m_SvMap, g_Config.m_SvMap);
+			Print(OUTPUT_LEVEL_STANDARD, "console", aBuf);
+		}
+		return false;
+	}
+	if(pCommand->GetAccessLevel() < m_AccessLevel)
+	{
+		if(Stroke)
+		{
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "Access for command %s denied.", pName);
+			Print(OUTPUT_LEVEL_STANDARD, "console", aBuf);
+		}
+		return false;
+	}
+	return true;
+}
+
+bool CConsole::ExecuteParsedCommand(CCommand *pCommand, CResult *pResult, int ClientID)
+{
+	if(m_StoreCommands && pCommand->m_Flags & CFGFLAG_STORE)
+	{
+		m_ExecutionQueue.AddEntry();
+		m_ExecutionQueue.m_pLast->m_pCommand = pCommand;
+		m_ExecutionQueue.m_pLast->m_Result = *pResult;
+		return true;
+	}
+
+	if(pCommand->m_Flags & CMDFLAG_TEST && !g_Config.m_SvTestingCommands)
+		return false;
+
+	if(m_pfnTeeHistorianCommandCallback && !(pCommand->m_Flags & CFGFLAG_NONTEEHISTORIC))
+	{
+		m_pfnTeeHistorianCommandCallback(ClientID, m_FlagMask, pCommand->m_pName, pResult, m_pTeeHistorianCommandUserdata);
+	}
+
+	if(pResult->GetVictim() == CResult::VICTIM_ME)
+		pResult->SetVictim(ClientID);
+
+	if(pResult->HasVictim() && pResult->GetVictim() == CResult::VICTIM_ALL)
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			pResult->SetVictim(i);
+			pCommand->m_pfnCallback(pResult, pCommand->m_pUserData);
+		}
+	}
+	else
+	{
+		pCommand->m_pfnCallback(pResult, pCommand->m_pUserData);
+	}
+
+	if(pCommand->m_Flags & CMDFLAG_TEST)
+		m_Cheated = true;
+	return true;
+}
+
 void CConsole::ExecuteLineStroked(int Stroke, const char *pStr, int ClientID, bool InterpretSemicolons)
 {
 	const char *pWithoutPrefix = str_startswith(pStr, "mc;");
@@ -414,32 +498,8 @@ void CConsole::ExecuteLineStroked(int Stroke, const char *pStr, int ClientID, bo
 	{
 		CResult Result;
 		Result.m_ClientID = ClientID;
-		const char *pEnd = pStr;
-		const char *pNextPart = 0;
-		int InString = 0;
-
-		while(*pEnd)
-		{
-			if(*pEnd == '"')
-				InString ^= 1;
-			else if(*pEnd == '\\') // escape sequences
-			{
-				if(pEnd[1] == '"')
-					pEnd++;
-			}
-			else if(!InString && InterpretSemicolons)
-			{
-				if(*pEnd == ';') // command separator
-				{
-					pNextPart = pEnd + 1;
-					break;
-				}
-				else if(*pEnd == '#') // comment, no need to do anything more
-					break;
-			}
-
-			pEnd++;
-		}
+		const char *pNextPart;
+		const char *pEnd = FindCommandEnd(pStr, InterpretSemicolons, &pNextPart);
 
 		if(ParseStart(&Result, pStr, (pEnd - pStr) + 1) != 0)
 			return;
@@ -455,27 +515,7 @@ void CConsole::ExecuteLineStroked(int Stroke, const char *pStr, int ClientID, bo
 
 		if(pCommand)
 		{
-			if(ClientID == IConsole::CLIENT_ID_GAME && !(pCommand->m_Flags & CFGFLAG_GAME))
-			{
-				if(Stroke)
-				{
-					char aBuf[96];
-					str_format(aBuf, sizeof(aBuf), "Command '%s' cannot be executed from a map.", Result.m_pCommand);
-					Print(OUTPUT_LEVEL_STANDARD, "console", aBuf);
-				}
-			}
-			else if(ClientID == IConsole::CLIENT_ID_NO_GAME && pCommand->m_Flags & CFGFLAG_GAME)
-			{
-				if(Stroke)
-				{
-					char aBuf[96];
-					str_format(aBuf, sizeof(aBuf), "Command '%s' cannot be executed from a non-map config file.", Result.m_pCommand);
-					Print(OUTPUT_LEVEL_STANDARD, "console", aBuf);
-					str_format(aBuf, sizeof(aBuf), "Hint: Put the command in '%s.cfg' instead of '%s.map.cfg' ", g_Config.m_SvMap, g_Config.m_SvMap);
-					Print(OUTPUT_LEVEL_STANDARD, "console", aBuf);
-				}
-			}
-			else if(pCommand->GetAccessLevel() >= m_AccessLevel)
+			if(CanExecuteCommand(pCommand, Result.m_pCommand, ClientID, Stroke))
 			{
 				int IsStrokeCommand = 0;
 				if(Result.m_pCommand[0] == '+')
@@ -493,49 +533,10 @@ void CConsole::ExecuteLineStroked(int Stroke, const char *pStr, int ClientID, bo
 						str_format(aBuf, sizeof(aBuf), "Invalid arguments... Usage: %s %s", pCommand->m_pName, pCommand->m_pParams);
 						Print(OUTPUT_LEVEL_STANDARD, "chatresp", aBuf);
 					}
-					else if(m_StoreCommands && pCommand->m_Flags & CFGFLAG_STORE)
-					{
-						m_ExecutionQueue.AddEntry();
-						m_ExecutionQueue.m_pLast->m_pCommand = pCommand;
-						m_ExecutionQueue.m_pLast->m_Result = Result;
-					}
-					else
-					{
-						if(pCommand->m_Flags & CMDFLAG_TEST && !g_Config.m_SvTestingCommands)
-							return;
-
-						if(m_pfnTeeHistorianCommandCallback && !(pCommand->m_Flags & CFGFLAG_NONTEEHISTORIC))
-						{
-							m_pfnTeeHistorianCommandCallback(ClientID, m_FlagMask, pCommand->m_pName, &Result, m_pTeeHistorianCommandUserdata);
-						}
-
-						if(Result.GetVictim() == CResult::VICTIM_ME)
-							Result.SetVictim(ClientID);
-
-						if(Result.HasVictim() && Result.GetVictim() == CResult::VICTIM_ALL)
-						{
-							for(int i = 0; i < MAX_CLIENTS; i++)
-							{
-								Result.SetVictim(i);
-								pCommand->m_pfnCallback(&Result, pCommand->m_pUserData);
-							}
-						}
-						else
-						{
-							pCommand->m_pfnCallback(&Result, pCommand->m_pUserData);
-						}
-
-						if(pCommand->m_Flags & CMDFLAG_TEST)
-							m_Cheated = true;
-					}
+					else if(!ExecuteParsedCommand(pCommand, &Result, ClientID))
+						return;
 				}
 			}
-			else if(Stroke)
-			{
-				char aBuf[256];
-				str_format(aBuf, sizeof(aBuf), "Access for command %s denied.", Result.m_pCommand);
-				Print(OUTPUT_LEVEL_STANDARD, "console", aBuf);
-			}
 		}
 		else if(Stroke)
 		{
@@ -570,9 +571,23 @@ int CConsole::PossibleCommands(const char *pStr, int FlagMask, bool Temp, FPossi
 	return Index;
 }
 
+unsigned CConsole::HashCommandName(const char *pName)
+{
+	// FNV-1a over the lower case name, like str_comp_nocase only ASCII is folded
+	unsigned Hash = 2166136261u;
+	for(; *pName; pName++)
+	{
+		unsigned char c = *pName;
+		if(c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		Hash = (Hash ^ c) * 16777619u;
+	}
+	return Hash % COMMAND_HASH_SIZE;
+}
+
 CConsole::CCommand *CConsole::FindCommand(const char *pName, int FlagMask)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	for(CCommand *pCommand = m_apCommandHash[HashCommandName(pName)]; pCommand; pCommand = pCommand->m_pNextHash)
 	{
 		if(pCommand->m_Flags & FlagMask)
 		{
@@ -628,9 +643,23 @@ bool CConsole::ExecuteFile(const char *pFilename, int ClientID, bool LogFailure,
 		CLineReader Reader;
 		Reader.Init(File);
 
+		// lines that didn't change since the last time the file was executed skip the parsing
+		std::vector<CCompiledLine> &vLines = m_CompiledScripts[pFilename];
+		size_t NumLines = 0;
 		char *pLine;
 		while((pLine = Reader.Get()))
-			ExecuteLine(pLine, ClientID);
+		{
+			if(NumLines == vLines.size())
+				vLines.emplace_back();
+			CCompiledLine *pCompiled = &vLines[NumLines++];
+			if(pCompiled->m_Line != pLine)
+			{
+				pCompiled->m_Line = pLine;
+				pCompiled->m_Generation = -1;
+			}
+			ExecuteCompiledLine(pCompiled, ClientID);
+		}
+		vLines.resize(NumLines);
 
 		io_close(File);
 		Success = true;
@@ -645,6 +674,83 @@ bool CConsole::ExecuteFile(const char *pFilename, int ClientID, bool LogFailure,
 	return Success;
 }
 
+void CConsole::CompileLine(CCompiledLine *pLine, int FlagMask)
+{
+	pLine->m_Generation = m_CommandsGeneration;
+	pLine->m_FlagMask = FlagMask;
+	pLine->m_Cached = false;
+	pLine->m_vCommands.clear();
+
+	const char *pLineStart = pLine->m_Line.c_str();
+	const char *pStr = pLineStart;
+	const char *pWithoutPrefix = str_startswith(pStr, "mc;");
+	if(pWithoutPrefix)
+		pStr = pWithoutPrefix;
+	while(pStr && *pStr)
+	{
+		CResult Result;
+		const char *pNextPart;
+		const char *pEnd = FindCommandEnd(pStr, true, &pNextPart);
+		const int Length = minimum((int)(pEnd - pStr) + 1, (int)sizeof(Result.m_aStringStorage));
+		ParseStart(&Result, pStr, Length);
+		if(!*Result.m_pCommand)
+			break;
+
+		// stroke commands, unknown commands and invalid arguments always take the regular path
+		CCommand *pCommand = FindCommand(Result.m_pCommand, FlagMask);
+		if(!pCommand || Result.m_pCommand[0] == '+' || ParseArgs(&Result, pCommand->m_pParams))
+			return;
+
+		CCompiledCommand &Compiled = pLine->m_vCommands.emplace_back();
+		Compiled.m_pCommand = pCommand;
+		Compiled.m_Start = pStr - pLineStart;
+		Compiled.m_vStorage.assign(Result.m_aStringStorage, Result.m_aStringStorage + Length);
+		Compiled.m_CommandOffset = Result.m_pCommand - Result.m_aStringStorage;
+		for(int i = 0; i < Result.NumArguments(); i++)
+			Compiled.m_vArgOffsets.push_back(Result.m_apArgs[i] - Result.m_aStringStorage);
+		Compiled.m_Victim = Result.m_Victim;
+
+		pStr = pNextPart;
+	}
+	pLine->m_Cached = true;
+}
+
+void CConsole::ExecuteCompiledLine(CCompiledLine *pLine, int ClientID)
+{
+	const int FlagMask = ClientID == IConsole::CLIENT_ID_GAME ? m_FlagMask | CFGFLAG_GAME : m_FlagMask;
+	if(pLine->m_Generation != m_CommandsGeneration || pLine->m_FlagMask != FlagMask)
+		CompileLine(pLine, FlagMask);
+	if(!pLine->m_Cached)
+	{
+		ExecuteLine(pLine->m_Line.c_str(), ClientID);
+		return;
+	}
+
+	// same as the press of ExecuteLine, the release does nothing for commands without '+'
+	for(const CCompiledCommand &Compiled : pLine->m_vCommands)
+	{
+		// a command changed the registered commands, the cached ones may be gone
+		if(pLine->m_Generation != m_CommandsGeneration)
+		{
+			ExecuteLine(pLine->m_Line.c_str() + Compiled.m_Start, ClientID);
+			return;
+		}
+
+		CResult Result;
+		Result.m_ClientID = ClientID;
+		mem_copy(Result.m_aStringStorage, Compiled.m_vStorage.data(), Compiled.m_vStorage.size());
+		Result.m_pCommand = Result.m_aStringStorage + Compiled.m_CommandOffset;
+		for(int Offset : Compiled.m_vArgOffsets)
+			Result.AddArgument(Result.m_aStringStorage + Offset);
+		Result.m_Victim = Compiled.m_Victim;
+
+		if(!CanExecuteCommand(Compiled.m_pCommand, Result.m_pCommand, ClientID, 1))
+			continue;
+		if(!ExecuteParsedCommand(Compiled.m_pCommand, &Result, ClientID))
+			return;
+	}
+}
+
 void CConsole::Con_Echo(IResult *pResult, void *pUserData)
 {
 	((CConsole *)pUserData)->Print(IConsole::OUTPUT_LEVEL_STANDARD, "console", pResult->GetString(0));
@@ -968,6 +1074,8 @@ CConsole::CConsole(int FlagMask)
 	m_apStrokeStr[1] = "1";
 	m_ExecutionQueue.Reset();
 	m_pFirstCommand = 0;
+	mem_zero(m_apCommandHash, sizeof(m_apCommandHash));
+	m_CommandsGeneration = 0;
 	m_pFirstExec = 0;
 	m_pfnTeeHistorianCommandCallback = 0;
 	m_pTeeHistorianCommandUserdata = 0;
@@ -1079,12 +1187,18 @@ void CConsole::ParseArguments(int NumArgs, const char **ppArguments)
 
 void CConsole::AddCommandSorted(CCommand *pCommand)
 {
+	m_CommandsGeneration++;
+
+	// the hash chains are sorted the same way as the command list, so lookups find the same command
+	CCommand **ppHashSlot = &m_apCommandHash[HashCommandName(pCommand->m_pName)];
+	while(*ppHashSlot && str_comp(pCommand->m_pName, (*ppHashSlot)->m_pName) > 0)
+		ppHashSlot = &(*ppHashSlot)->m_pNextHash;
+	pCommand->m_pNextHash = *ppHashSlot;
+	*ppHashSlot = pCommand;
+
 	if(!m_pFirstCommand || str_comp(pCommand->m_pName, m_pFirstCommand->m_pName) <= 0)
 	{
-		if(m_pFirstCommand && m_pFirstCommand->m_pNext)
-			pCommand->m_pNext = m_pFirstCommand;
-		else
-			pCommand->m_pNext = 0;
+		pCommand->m_pNext = m_pFirstCommand;
 		m_pFirstCommand = pCommand;
 	}
 	else
@@ -1101,6 +1215,20 @@ void CConsole::AddCommandSorted(CCommand *pCommand)
 	}
 }
 
+void CConsole::RemoveCommandHash(CCommand *pCommand)
+{
+	m_CommandsGeneration++;
+
+	for(CCommand **ppHashSlot = &m_apCommandHash[HashCommandName(pCommand->m_pName)]; *ppHashSlot; ppHashSlot = &(*ppHashSlot)->m_pNextHash)
+	{
+		if(*ppHashSlot == pCommand)
+		{
+			*ppHashSlot = pCommand->m_pNextHash;
+			break;
+		}
+	}
+}
+
 void CConsole::Register(const char *pName, const char *pParams,
 	int Flags, FCommandCallback pfnFunc, void *pUser, const char *pHelp)
 {
@@ -1123,6 +1251,8 @@ void CConsole::Register(const char *pName, const char *pParams,
 
 	if(DoAdd)
 		AddCommandSorted(pCommand);
+	else
+		m_CommandsGeneration++;
 
 	if(pCommand->m_Flags & CFGFLAG_CHAT)
 		pCommand->SetAccessLevel(ACCESS_LEVEL_USER);
@@ -1189,6 +1319,7 @@ void CConsole::DeregisterTemp(const char *pName)
 	// add to recycle list
 	if(pRemoved)
 	{
+		RemoveCommandHash(pRemoved);
 		pRemoved->m_pNext = m_pRecycleList;
 		m_pRecycleList = pRemoved;
 	}
@@ -1212,6 +1343,18 @@ void CConsole::DeregisterTempAll()
 		}
 	}
 
+	for(CCommand *&pHashFirst : m_apCommandHash)
+	{
+		for(CCommand **ppHashSlot = &pHashFirst; *ppHashSlot;)
+		{
+			if((*ppHashSlot)->m_Temp)
+				*ppHashSlot = (*ppHashSlot)->m_pNextHash;
+			else
+				ppHashSlot = &(*ppHashSlot)->m_pNextHash;
+		}
+	}
+	m_CommandsGeneration++;
+
 	m_TempCommands.Reset();
 	m_pRecycleList = 0;
 }
@@ -1260,7 +1403,7 @@ void CConsole::StoreCommands(bool Store)
 
 const IConsole::CCommandInfo *CConsole::GetCommandInfo(const char *pName, int FlagMask, bool Temp)
 {
-	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	for(CCommand *pCommand = m_apCommandHash[HashCommandName(pName)]; pCommand; pCommand = pCommand->m_pNextHash)
 	{
 		if(pCommand->m_Flags & FlagMask && pCommand->m_Temp == Temp)
 		{
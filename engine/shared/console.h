@@ -8,12 +8,17 @@
 #include <engine/console.h>
 #include <engine/storage.h>
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 class CConsole : public IConsole
 {
 	class CCommand : public CCommandInfo
 	{
 	public:
 		CCommand *m_pNext;
+		CCommand *m_pNextHash;
 		int m_Flags;
 		bool m_Temp;
 		FCommandCallback m_pfnCallback;
@@ -33,10 +38,19 @@ class CConsole : public IConsole
 		void *m_pUserData;
 	};
 
+	enum
+	{
+		COMMAND_HASH_SIZE = 2048,
+	};
+
 	int m_FlagMask;
 	bool m_StoreCommands;
 	const char *m_apStrokeStr[2];
 	CCommand *m_pFirstCommand;
+	// commands by case insensitive name, same names in the order of the command list
+	CCommand *m_apCommandHash[COMMAND_HASH_SIZE];
+	// changes whenever a command is registered or removed
+	int m_CommandsGeneration;
 
 	class CExecFile
 	{
@@ -89,12 +103,11 @@ class CConsole : public IConsole
 		const char *m_apArgs[MAX_PARTS];
 
 		CResult()
-
 		{
-			mem_zero(m_aStringStorage, sizeof(m_aStringStorage));
+			// the storage and arguments are only read up to what ParseStart and AddArgument filled in
+			m_aStringStorage[0] = 0;
 			m_pArgsStart = 0;
 			m_pCommand = 0;
-			mem_zero(m_apArgs, sizeof(m_apArgs));
 		}
 
 		CResult &operator=(const CResult &Other)
@@ -158,6 +171,46 @@ class CConsole : public IConsole
 	*/
 	char NextParam(const char *&pFormat);
 
+	// returns the end of the command starting at pStr and sets ppNextPart to the next one, if any
+	static const char *FindCommandEnd(const char *pStr, bool InterpretSemicolons, const char **ppNextPart);
+
+	// checks the flags and access level before running a command, reports why it can't run if Stroke is set
+	bool CanExecuteCommand(const CCommand *pCommand, const char *pName, int ClientID, int Stroke);
+	// runs a command with parsed arguments, returns false if the rest of the line is skipped
+	bool ExecuteParsedCommand(CCommand *pCommand, CResult *pResult, int ClientID);
+
+	// a command of a cfg line with its arguments already parsed
+	class CCompiledCommand
+	{
+	public:
+		CCommand *m_pCommand;
+		// offset of the command in the line, the rest of the line is executed as is if the cache can't be used
+		int m_Start;
+		// the string storage as ParseArgs left it and the offsets of the command and the arguments
+		std::vector<char> m_vStorage;
+		int m_CommandOffset;
+		std::vector<int> m_vArgOffsets;
+		int m_Victim;
+	};
+
+	class CCompiledLine
+	{
+	public:
+		std::string m_Line;
+		// compiled against this generation of commands and flag mask
+		int m_Generation = -1;
+		int m_FlagMask = 0;
+		// false if the line has commands that can't be cached, e.g. unknown commands or invalid arguments
+		bool m_Cached = false;
+		std::vector<CCompiledCommand> m_vCommands;
+	};
+
+	// cfg files executed before, by filename
+	std::unordered_map<std::string, std::vector<CCompiledLine>> m_CompiledScripts;
+
+	void CompileLine(CCompiledLine *pLine, int FlagMask);
+	void ExecuteCompiledLine(CCompiledLine *pLine, int ClientID);
+
 	class CExecutionQueue
 	{
 		CHeap m_Queue;
@@ -188,7 +241,9 @@ class CConsole : public IConsole
 		}
 	} m_ExecutionQueue;
 
+	static unsigned HashCommandName(const char *pName);
 	void AddCommandSorted(CCommand *pCommand);
+	void RemoveCommandHash(CCommand *pCommand);
 	CCommand *FindCommand(const char *pName, int FlagMask);
 
 public:
@@ -7,12 +7,17 @@
 #include <base/log.h>
 #include <base/math.h>
 #include <base/system.h>
+#include <engine/engine.h>
 #include <engine/storage.h>
 
 #include "uuid_manager.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdlib>
 #include <limits>
+#include <mutex>
 
 static const int DEBUG = 0;
 
@@ -88,6 +93,10 @@ struct CDatafileInfo
 struct CDatafile
 {
 	IOHANDLE m_File;
+	// the whole file, mapped into memory or read into a buffer if it can't be mapped
+	const unsigned char *m_pFileData;
+	unsigned m_FileSize;
+	bool m_FileMapped;
 	SHA256_DIGEST m_Sha256;
 	unsigned m_Crc;
 	CDatafileInfo m_Info;
@@ -98,6 +107,14 @@ struct CDatafile
 	char *m_pData;
 };
 
+static void FreeFileData(const unsigned char *pFileData, unsigned FileSize, bool FileMapped)
+{
+	if(FileMapped)
+		io_unmap(pFileData, FileSize);
+	else
+		free((void *)pFileData);
+}
+
 bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int StorageType)
 {
 	log_trace("datafile", "loading. filename='%s'", pFilename);
@@ -109,44 +126,54 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		return false;
 	}
 
-	// take the CRC of the file and store it
+	// the header, the items and the data are all read from memory
+	unsigned FileSize;
+	const unsigned char *pFileData = static_cast<const unsigned char *>(io_map(File, &FileSize));
+	const bool FileMapped = pFileData != nullptr;
+	if(!FileMapped)
+	{
+		void *pBuffer;
+		io_read_all(File, &pBuffer, &FileSize);
+		pFileData = static_cast<const unsigned char *>(pBuffer);
+	}
+
+	// take the CRC and the SHA256 of the file in a single pass
 	unsigned Crc = 0;
 	SHA256_DIGEST Sha256;
 	{
 		enum
 		{
-			BUFFER_SIZE = 64 * 1024
+			CHUNK_SIZE = 64 * 1024
 		};
 
 		SHA256_CTX Sha256Ctxt;
 		sha256_init(&Sha256Ctxt);
-		unsigned char aBuffer[BUFFER_SIZE];
-
-		while(true)
+		for(unsigned Offset = 0; Offset < FileSize; Offset += CHUNK_SIZE)
 		{
-			unsigned Bytes = io_read(File, aBuffer, BUFFER_SIZE);
-			if(Bytes == 0)
-				break;
-			Crc = crc32(Crc, aBuffer, Bytes);
-			sha256_update(&Sha256Ctxt, aBuffer, Bytes);
+			const unsigned Bytes = minimum<unsigned>(CHUNK_SIZE, FileSize - Offset);
+			Crc = crc32(Crc, pFileData + Offset, Bytes);
+			sha256_update(&Sha256Ctxt, pFileData + Offset, Bytes);
 		}
 		Sha256 = sha256_finish(&Sha256Ctxt);
-
-		io_seek(File, 0, IOSEEK_START);
 	}
 
 	// TODO: change this header
 	CDatafileHeader Header;
-	if(sizeof(Header) != io_read(File, &Header, sizeof(Header)))
+	if(FileSize < sizeof(Header))
 	{
 		dbg_msg("datafile", "couldn't load header");
+		FreeFileData(pFileData, FileSize, FileMapped);
+		io_close(File);
 		return false;
 	}
+	mem_copy(&Header, pFileData, sizeof(Header));
 	if(Header.m_aID[0] != 'A' || Header.m_aID[1] != 'T' || Header.m_aID[2] != 'A' || Header.m_aID[3] != 'D')
 	{
 		if(Header.m_aID[0] != 'D' || Header.m_aID[1] != 'A' || Header.m_aID[2] != 'T' || Header.m_aID[3] != 'A')
 		{
 			dbg_msg("datafile", "wrong signature. %x %x %x %x", Header.m_aID[0], Header.m_aID[1], Header.m_aID[2], Header.m_aID[3]);
+			FreeFileData(pFileData, FileSize, FileMapped);
+			io_close(File);
 			return false;
 		}
 	}
@@ -157,6 +184,8 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	if(Header.m_Version != 3 && Header.m_Version != 4)
 	{
 		dbg_msg("datafile", "wrong version. version=%x", Header.m_Version);
+		FreeFileData(pFileData, FileSize, FileMapped);
+		io_close(File);
 		return false;
 	}
 
@@ -174,11 +203,21 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	AllocSize += Header.m_NumRawData * sizeof(int); // add space for data sizes
 	if(Size > (((int64_t)1) << 31) || Header.m_NumItemTypes < 0 || Header.m_NumItems < 0 || Header.m_NumRawData < 0 || Header.m_ItemSize < 0)
 	{
+		FreeFileData(pFileData, FileSize, FileMapped);
 		io_close(File);
 		dbg_msg("datafile", "unable to load file, invalid file information");
 		return false;
 	}
 
+	// read types, offsets, sizes and item data
+	if((uint64_t)sizeof(CDatafileHeader) + Size > FileSize)
+	{
+		FreeFileData(pFileData, FileSize, FileMapped);
+		io_close(File);
+		dbg_msg("datafile", "couldn't load the whole thing, wanted=%d got=%d", Size, (int)(FileSize - sizeof(CDatafileHeader)));
+		return false;
+	}
+
 	CDatafile *pTmpDataFile = (CDatafile *)malloc(AllocSize);
 	pTmpDataFile->m_Header = Header;
 	pTmpDataFile->m_DataStartOffset = sizeof(CDatafileHeader) + Size;
@@ -186,6 +225,9 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	pTmpDataFile->m_pDataSizes = (int *)(pTmpDataFile->m_ppDataPtrs + Header.m_NumRawData);
 	pTmpDataFile->m_pData = (char *)(pTmpDataFile->m_pDataSizes + Header.m_NumRawData);
 	pTmpDataFile->m_File = File;
+	pTmpDataFile->m_pFileData = pFileData;
+	pTmpDataFile->m_FileSize = FileSize;
+	pTmpDataFile->m_FileMapped = FileMapped;
 	pTmpDataFile->m_Sha256 = Sha256;
 	pTmpDataFile->m_Crc = Crc;
 
@@ -193,15 +235,8 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	mem_zero(pTmpDataFile->m_ppDataPtrs, Header.m_NumRawData * sizeof(void *));
 	mem_zero(pTmpDataFile->m_pDataSizes, Header.m_NumRawData * sizeof(int));
 
-	// read types, offsets, sizes and item data
-	unsigned ReadSize = io_read(File, pTmpDataFile->m_pData, Size);
-	if(ReadSize != Size)
-	{
-		io_close(pTmpDataFile->m_File);
-		free(pTmpDataFile);
-		dbg_msg("datafile", "couldn't load the whole thing, wanted=%d got=%d", Size, ReadSize);
-		return false;
-	}
+	// the items are copied, they are handed out as writable memory
+	mem_copy(pTmpDataFile->m_pData, pFileData + sizeof(CDatafileHeader), Size);
 
 	Close();
 	m_pDataFile = pTmpDataFile;
@@ -213,7 +248,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	if(DEBUG)
 	{
 		dbg_msg("datafile", "allocsize=%d", AllocSize);
-		dbg_msg("datafile", "readsize=%d", ReadSize);
+		dbg_msg("datafile", "filesize=%u mapped=%d", FileSize, FileMapped);
 		dbg_msg("datafile", "swaplen=%d", Header.m_Swaplen);
 		dbg_msg("datafile", "item_size=%d", m_pDataFile->m_Header.m_ItemSize);
 	}
@@ -247,6 +282,7 @@ bool CDataFileReader::Close()
 		m_pDataFile->m_pDataSizes[i] = 0;
 	}
 
+	FreeFileData(m_pDataFile->m_pFileData, m_pDataFile->m_FileSize, m_pDataFile->m_FileMapped);
 	io_close(m_pDataFile->m_File);
 	free(m_pDataFile);
 	m_pDataFile = nullptr;
@@ -260,6 +296,20 @@ IOHANDLE CDataFileReader::File() const
 	return m_pDataFile->m_File;
 }
 
+const unsigned char *CDataFileReader::FileData() const
+{
+	if(!m_pDataFile)
+		return nullptr;
+	return m_pDataFile->m_pFileData;
+}
+
+unsigned CDataFileReader::FileSize() const
+{
+	if(!m_pDataFile)
+		return 0;
+	return m_pDataFile->m_FileSize;
+}
+
 int CDataFileReader::NumData() const
 {
 	if(!m_pDataFile)
@@ -308,6 +358,17 @@ int CDataFileReader::GetDataSize(int Index) const
 	return Size;
 }
 
+const unsigned char *CDataFileReader::GetFileData(int Index, unsigned DataSize) const
+{
+	const int64_t Offset = (int64_t)m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index];
+	if(m_pDataFile->m_Info.m_pDataOffsets[Index] < 0 || Offset + DataSize > m_pDataFile->m_FileSize)
+	{
+		log_error("datafile", "truncation error, could not read all data. index=%d wanted=%u got=%d", Index, DataSize, (int)maximum<int64_t>(m_pDataFile->m_FileSize - Offset, 0));
+		return nullptr;
+	}
+	return m_pDataFile->m_pFileData + Offset;
+}
+
 void *CDataFileReader::GetDataImpl(int Index, bool Swap)
 {
 	if(!m_pDataFile)
@@ -339,15 +400,10 @@ void *CDataFileReader::GetDataImpl(int Index, bool Swap)
 
 			log_trace("datafile", "loading data. index=%d size=%u uncompressed=%u", Index, DataSize, OriginalUncompressedSize);
 
-			// read the compressed data
-			void *pCompressedData = malloc(DataSize);
-			unsigned ActualDataSize = 0;
-			if(io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
-				ActualDataSize = io_read(m_pDataFile->m_File, pCompressedData, DataSize);
-			if(DataSize != ActualDataSize)
+			// the compressed data is decompressed straight from the file in memory
+			const unsigned char *pCompressedData = GetFileData(Index, DataSize);
+			if(!pCompressedData)
 			{
-				log_error("datafile", "truncation error, could not read all data. index=%d wanted=%u got=%u", Index, DataSize, ActualDataSize);
-				free(pCompressedData);
 				m_pDataFile->m_ppDataPtrs[Index] = nullptr;
 				m_pDataFile->m_pDataSizes[Index] = -1;
 				return nullptr;
@@ -356,8 +412,7 @@ void *CDataFileReader::GetDataImpl(int Index, bool Swap)
 			// decompress the data
 			m_pDataFile->m_ppDataPtrs[Index] = (char *)malloc(UncompressedSize);
 			m_pDataFile->m_pDataSizes[Index] = UncompressedSize;
-			const int Result = uncompress((Bytef *)m_pDataFile->m_ppDataPtrs[Index], &UncompressedSize, (Bytef *)pCompressedData, DataSize);
-			free(pCompressedData);
+			const int Result = uncompress((Bytef *)m_pDataFile->m_ppDataPtrs[Index], &UncompressedSize, pCompressedData, DataSize);
 			if(Result != Z_OK || UncompressedSize != OriginalUncompressedSize)
 			{
 				log_error("datafile", "uncompress error. result=%d wanted=%u got=%lu", Result, OriginalUncompressedSize, UncompressedSize);
@@ -375,19 +430,17 @@ void *CDataFileReader::GetDataImpl(int Index, bool Swap)
 		{
 			// load the data
 			log_trace("datafile", "loading data. index=%d size=%d", Index, DataSize);
-			m_pDataFile->m_ppDataPtrs[Index] = static_cast<char *>(malloc(DataSize));
-			m_pDataFile->m_pDataSizes[Index] = DataSize;
-			unsigned ActualDataSize = 0;
-			if(io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START) == 0)
-				ActualDataSize = io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
-			if(DataSize != ActualDataSize)
+			const unsigned char *pFileData = GetFileData(Index, DataSize);
+			if(!pFileData)
 			{
-				log_error("datafile", "truncation error, could not read all data. index=%d wanted=%u got=%u", Index, DataSize, ActualDataSize);
-				free(m_pDataFile->m_ppDataPtrs[Index]);
 				m_pDataFile->m_ppDataPtrs[Index] = nullptr;
 				m_pDataFile->m_pDataSizes[Index] = -1;
 				return nullptr;
 			}
+			// copied, the data is handed out as writable memory and may be replaced
+			m_pDataFile->m_ppDataPtrs[Index] = static_cast<char *>(malloc(DataSize));
+			m_pDataFile->m_pDataSizes[Index] = DataSize;
+			mem_copy(m_pDataFile->m_ppDataPtrs[Index], pFileData, DataSize);
 		}
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
@@ -399,6 +452,81 @@ void *CDataFileReader::GetDataImpl(int Index, bool Swap)
 	return m_pDataFile->m_ppDataPtrs[Index];
 }
 
+class CDataFileLoadJob : public IJob
+{
+public:
+	struct CState
+	{
+		CDataFileReader *m_pReader;
+		std::vector<int> m_vIndices;
+		std::atomic<int> m_NextIndex{0};
+		std::atomic<int> m_NumLoaded{0};
+		// signaled by whoever loads the last data
+		std::mutex m_Mutex;
+		std::condition_variable m_LoadedCond;
+	};
+
+	// jobs that run after all data was claimed don't touch the reader anymore
+	static void Work(CState *pState)
+	{
+		const int Num = pState->m_vIndices.size();
+		for(int i = pState->m_NextIndex++; i < Num; i = pState->m_NextIndex++)
+		{
+			pState->m_pReader->GetData(pState->m_vIndices[i]);
+			if(++pState->m_NumLoaded == Num)
+			{
+				std::unique_lock<std::mutex> Lock(pState->m_Mutex);
+				pState->m_LoadedCond.notify_all();
+			}
+		}
+	}
+
+	CDataFileLoadJob(std::shared_ptr<CState> pState) :
+		m_pState(std::move(pState)) {}
+
+private:
+	std::shared_ptr<CState> m_pState;
+	void Run() override { Work(m_pState.get()); }
+};
+
+void CDataFileReader::LoadData(std::vector<int> vIndices, IEngine *pEngine)
+{
+	if(!m_pDataFile)
+		return;
+
+	// every data may only be loaded once
+	std::sort(vIndices.begin(), vIndices.end());
+	vIndices.erase(std::unique(vIndices.begin(), vIndices.end()), vIndices.end());
+	vIndices.erase(std::remove_if(vIndices.begin(), vIndices.end(), [&](int Index) {
+		return Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData || m_pDataFile->m_ppDataPtrs[Index] || m_pDataFile->m_pDataSizes[Index] < 0;
+	}),
+		vIndices.end());
+	if(vIndices.empty())
+		return;
+
+	auto pState = std::make_shared<CDataFileLoadJob::CState>();
+	pState->m_pReader = this;
+	pState->m_vIndices = std::move(vIndices);
+	const int Num = pState->m_vIndices.size();
+
+	// the calling thread helps, so this doesn't wait for jobs queued behind others
+	if(pEngine)
+	{
+		const int NumJobs = minimum(Num - 1, (int)MAX_LOAD_JOBS);
+		for(int i = 0; i < NumJobs; i++)
+		{
+			auto pJob = std::make_shared<CDataFileLoadJob>(pState);
+			pJob->SetPriority(IJob::PRIORITY_HIGH);
+			pEngine->AddJob(std::move(pJob));
+		}
+	}
+	CDataFileLoadJob::Work(pState.get());
+
+	// no data is left to claim, wait for the jobs still loading theirs
+	std::unique_lock<std::mutex> Lock(pState->m_Mutex);
+	pState->m_LoadedCond.wait(Lock, [&] { return pState->m_NumLoaded == Num; });
+}
+
 void *CDataFileReader::GetData(int Index)
 {
 	return GetDataImpl(Index, false);
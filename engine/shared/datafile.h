@@ -21,7 +21,13 @@ enum
 // raw datafile access
 class CDataFileReader
 {
+	enum
+	{
+		MAX_LOAD_JOBS = 8,
+	};
+
 	struct CDatafile *m_pDataFile;
+	const unsigned char *GetFileData(int Index, unsigned DataSize) const;
 	void *GetDataImpl(int Index, bool Swap);
 	int GetFileDataSize(int Index) const;
 
@@ -44,6 +50,9 @@ public:
 	bool Close();
 	bool IsOpen() const { return m_pDataFile != nullptr; }
 	IOHANDLE File() const;
+	// the raw contents of the file, valid until the reader is closed
+	const unsigned char *FileData() const;
+	unsigned FileSize() const;
 
 	int GetDataSize(int Index) const;
 	void *GetData(int Index);
@@ -52,6 +61,8 @@ public:
 	void ReplaceData(int Index, char *pData, size_t Size); // memory for data must have been allocated with malloc
 	void UnloadData(int Index);
 	int NumData() const;
+	// loads the data in parallel on the job pool of the engine, on the calling thread without one
+	void LoadData(std::vector<int> vIndices, class IEngine *pEngine);
 
 	int GetItemSize(int Index) const;
 	void *GetItem(int Index, int *pType = nullptr, int *pID = nullptr);
@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/log.h>
 #include <base/math.h>
 #include <base/system.h>
 
@@ -17,6 +18,8 @@
 #include "network.h"
 #include "snapshot.h"
 
+#include <atomic>
+
 const double g_aSpeeds[g_DemoSpeeds] = {0.1, 0.25, 0.5, 0.75, 1.0, 1.25, 1.5, 2.0, 3.0, 4.0, 6.0, 8.0, 12.0, 16.0, 20.0, 24.0, 28.0, 32.0, 40.0, 48.0, 56.0, 64.0};
 const CUuid SHA256_EXTENSION =
 	{{0x6b, 0xe6, 0xda, 0x4a, 0xce, 0xbd, 0x38, 0x0c,
@@ -44,17 +47,217 @@ CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapDat
 
 CDemoRecorder::~CDemoRecorder()
 {
-	dbg_assert(m_File == 0, "Demo recorder was not stopped");
+	dbg_assert(m_File == 0 && !m_pAsyncRecording, "Demo recorder was not stopped");
+}
+
+// The state of one recording that goes through the writer thread. The thread
+// owns a synchronous recorder that does the actual delta, compression and
+// file writes.
+class CDemoWriter::CRecording
+{
+public:
+	// the item sizes are copied at Start, the owner may change its own
+	// snapshot delta while the thread creates deltas
+	CSnapshotDelta m_SnapshotDelta;
+	CDemoRecorder m_Recorder;
+	SEMAPHORE m_StoppedSemaphore;
+
+	CRecording(const CSnapshotDelta *pSnapshotDelta, bool NoMapData) :
+		m_SnapshotDelta(*pSnapshotDelta), m_Recorder(&m_SnapshotDelta, NoMapData)
+	{
+		sphore_init(&m_StoppedSemaphore);
+	}
+
+	~CRecording()
+	{
+		sphore_destroy(&m_StoppedSemaphore);
+	}
+};
+
+// The queue is a byte ring with one consumer. Entries are 16 byte aligned and
+// never wrap around the end of the ring, a padding entry fills the gap.
+enum
+{
+	DEMO_ENTRY_PADDING = 0,
+	DEMO_ENTRY_SNAPSHOT,
+	DEMO_ENTRY_MESSAGE,
+	DEMO_ENTRY_STOP, // the recording is done, signals its semaphore
+	DEMO_ENTRY_QUIT, // the thread exits
+
+	DEMO_MIN_QUEUE_SIZE = 256 * 1024,
+};
+
+struct CDemoEntryHeader
+{
+	int32_t m_Type;
+	int32_t m_Tick;
+	int32_t m_Size;
+	int32_t m_Reserved;
+	void *m_pRecording;
+	int64_t m_Reserved2;
+};
+
+static size_t DemoEntrySize(int DataSize) { return (sizeof(CDemoEntryHeader) + DataSize + 15) & ~(size_t)15; }
+
+CDemoWriter::CDemoWriter()
+{
+	sphore_init(&m_Semaphore);
+}
+
+CDemoWriter::~CDemoWriter()
+{
+	dbg_assert(m_NumRecordings == 0, "Demo writer still has recordings");
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		Shutdown();
+	}
+	sphore_destroy(&m_Semaphore);
+}
+
+bool CDemoWriter::Attach()
+{
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	const size_t Capacity = m_QueueSize > 0 ? maximum((int)DEMO_MIN_QUEUE_SIZE, m_QueueSize) & ~15 : 0;
+	if(m_NumRecordings == 0 && Capacity != m_Capacity)
+	{
+		Shutdown();
+		if(Capacity)
+		{
+			m_pBuffer = (unsigned char *)malloc(Capacity);
+			m_Capacity = Capacity;
+			m_ReadPos.store(0, std::memory_order_relaxed);
+			m_WritePos.store(0, std::memory_order_relaxed);
+			m_pThread = thread_init(Run, this, "demo writer");
+		}
+	}
+	if(!m_pThread)
+		return false;
+	m_NumRecordings++;
+	return true;
+}
+
+void CDemoWriter::Detach()
+{
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	m_NumRecordings--;
+}
+
+void CDemoWriter::Shutdown()
+{
+	if(m_pThread)
+	{
+		// the queued recordings are stopped already, the queue drains quickly
+		while(!PushLocked(nullptr, DEMO_ENTRY_QUIT, 0, nullptr, 0))
+			thread_yield();
+		thread_wait(m_pThread);
+		m_pThread = nullptr;
+	}
+	free(m_pBuffer);
+	m_pBuffer = nullptr;
+	m_Capacity = 0;
+}
+
+bool CDemoWriter::Push(CRecording *pRecording, int Type, int Tick, const void *pData, int Size)
+{
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	return PushLocked(pRecording, Type, Tick, pData, Size);
+}
+
+bool CDemoWriter::PushLocked(CRecording *pRecording, int Type, int Tick, const void *pData, int Size)
+{
+	size_t WritePos = m_WritePos.load(std::memory_order_relaxed);
+	const size_t ReadPos = m_ReadPos.load(std::memory_order_acquire);
+	const size_t Size16 = DemoEntrySize(Size);
+	size_t Offset = WritePos % m_Capacity;
+	const size_t Padding = m_Capacity - Offset < Size16 ? m_Capacity - Offset : 0;
+	if(WritePos + Padding + Size16 - ReadPos > m_Capacity)
+		return false;
+
+	if(Padding)
+	{
+		CDemoEntryHeader *pPadding = (CDemoEntryHeader *)(m_pBuffer + Offset);
+		pPadding->m_Type = DEMO_ENTRY_PADDING;
+		pPadding->m_Size = Padding - sizeof(CDemoEntryHeader);
+		WritePos += Padding;
+		Offset = 0;
+	}
+
+	CDemoEntryHeader *pHeader = (CDemoEntryHeader *)(m_pBuffer + Offset);
+	pHeader->m_Type = Type;
+	pHeader->m_Tick = Tick;
+	pHeader->m_Size = Size;
+	pHeader->m_pRecording = pRecording;
+	if(Size)
+		mem_copy(pHeader + 1, pData, Size);
+	m_WritePos.store(WritePos + Size16, std::memory_order_release);
+	sphore_signal(&m_Semaphore);
+	return true;
+}
+
+void CDemoWriter::Run(void *pUser)
+{
+	CDemoWriter *pThis = (CDemoWriter *)pUser;
+	size_t ReadPos = pThis->m_ReadPos.load(std::memory_order_relaxed);
+	while(true)
+	{
+		sphore_wait(&pThis->m_Semaphore);
+		const size_t WritePos = pThis->m_WritePos.load(std::memory_order_acquire);
+		while(ReadPos != WritePos)
+		{
+			const CDemoEntryHeader *pHeader = (const CDemoEntryHeader *)(pThis->m_pBuffer + ReadPos % pThis->m_Capacity);
+			CRecording *pRecording = (CRecording *)pHeader->m_pRecording;
+			const int Type = pHeader->m_Type;
+			if(Type == DEMO_ENTRY_SNAPSHOT)
+				pRecording->m_Recorder.RecordSnapshot(pHeader->m_Tick, pHeader + 1, pHeader->m_Size);
+			else if(Type == DEMO_ENTRY_MESSAGE)
+				pRecording->m_Recorder.RecordMessage(pHeader + 1, pHeader->m_Size);
+
+			ReadPos += DemoEntrySize(pHeader->m_Size);
+			pThis->m_ReadPos.store(ReadPos, std::memory_order_release);
+
+			// the recording may be gone right after the signal
+			if(Type == DEMO_ENTRY_STOP)
+				sphore_signal(&pRecording->m_StoppedSemaphore);
+			else if(Type == DEMO_ENTRY_QUIT)
+				return;
+		}
+	}
 }
 
 // Record
-int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, const SHA256_DIGEST &Sha256, unsigned Crc, const char *pType, unsigned MapSize, unsigned char *pMapData, IOHANDLE MapFile, DEMOFUNC_FILTER pfnFilter, void *pUser)
+int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, const SHA256_DIGEST &Sha256, unsigned Crc, const char *pType, unsigned MapSize, const unsigned char *pMapData, IOHANDLE MapFile, DEMOFUNC_FILTER pfnFilter, void *pUser)
 {
-	dbg_assert(m_File == 0, "Demo recorder already recording");
+	dbg_assert(m_File == 0 && !m_pAsyncRecording, "Demo recorder already recording");
 
 	m_pfnFilter = pfnFilter;
 	m_pUser = pUser;
 
+	if(m_pWriter && m_pWriter->Attach())
+	{
+		// the file and header are written right away, everything after that
+		// goes through the writer thread
+		CDemoWriter::CRecording *pRecording = new CDemoWriter::CRecording(m_pSnapshotDelta, m_NoMapData);
+		if(pRecording->m_Recorder.Start(pStorage, pConsole, pFilename, pNetVersion, pMap, Sha256, Crc, pType, MapSize, pMapData, MapFile) != 0)
+		{
+			delete pRecording;
+			m_pWriter->Detach();
+			return -1;
+		}
+
+		m_pConsole = pConsole;
+		m_pMapData = pMapData;
+		m_LastKeyFrame = -1;
+		m_LastTickMarker = -1;
+		m_FirstTick = -1;
+		m_NumTimelineMarkers = 0;
+		str_copy(m_aCurrentFilename, pFilename);
+
+		m_AsyncStats = CAsyncStats();
+		m_AsyncStats.m_QueueSize = m_pWriter->m_Capacity;
+		m_pAsyncRecording = pRecording;
+		return 0;
+	}
+
 	m_pMapData = pMapData;
 	m_pConsole = pConsole;
 
@@ -92,6 +295,12 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 			MapFile = pStorage->OpenFile(aMapFilename, IOFLAG_READ, IStorage::TYPE_ALL);
 		}
 		if(!MapFile)
+		{
+			// look the map up by its hash, it might be in a subfolder or have another name
+			if(pStorage->FindMap(Sha256, aMapFilename, sizeof(aMapFilename)))
+				MapFile = pStorage->OpenFile(aMapFilename, IOFLAG_READ, IStorage::TYPE_ALL);
+		}
+		if(!MapFile)
 		{
 			// search for the map within subfolders
 			char aBuf[IO_MAX_PATH_LENGTH];
@@ -285,8 +494,29 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 	io_write(m_File, aBuffer2, Size);
 }
 
+void CDemoRecorder::QueueAsync(int Type, int Tick, const void *pData, int Size)
+{
+	if(m_pWriter->Push(m_pAsyncRecording, Type, Tick, pData, Size))
+	{
+		m_AsyncStats.m_NumQueued++;
+		m_AsyncStats.m_PeakUsage = maximum(m_AsyncStats.m_PeakUsage, (int)m_pWriter->Usage());
+	}
+	else
+		m_AsyncStats.m_NumDropped++;
+}
+
 void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 {
+	if(m_pAsyncRecording)
+	{
+		// only track the ticks for the length and the timeline markers
+		m_LastTickMarker = Tick;
+		if(m_FirstTick < 0)
+			m_FirstTick = Tick;
+		QueueAsync(DEMO_ENTRY_SNAPSHOT, Tick, pData, Size);
+		return;
+	}
+
 	if(m_LastKeyFrame == -1 || (Tick - m_LastKeyFrame) > SERVER_TICK_SPEED * 5)
 	{
 		// write full tickmarker
@@ -324,11 +554,35 @@ void CDemoRecorder::RecordMessage(const void *pData, int Size)
 			return;
 		}
 	}
-	Write(CHUNKTYPE_MESSAGE, pData, Size);
+	if(m_pAsyncRecording)
+		QueueAsync(DEMO_ENTRY_MESSAGE, 0, pData, Size);
+	else
+		Write(CHUNKTYPE_MESSAGE, pData, Size);
 }
 
 int CDemoRecorder::Stop()
 {
+	if(m_pAsyncRecording)
+	{
+		// let the writer get through the queued chunks, then finish the file
+		// from here
+		while(!m_pWriter->Push(m_pAsyncRecording, DEMO_ENTRY_STOP, 0, nullptr, 0))
+			thread_yield();
+		sphore_wait(&m_pAsyncRecording->m_StoppedSemaphore);
+		m_pWriter->Detach();
+
+		if(m_AsyncStats.m_NumDropped)
+			log_warn("demo_recorder", "dropped %" PRId64 " of %" PRId64 " chunks of '%s', the demo writer fell behind", m_AsyncStats.m_NumDropped, m_AsyncStats.m_NumQueued + m_AsyncStats.m_NumDropped, m_aCurrentFilename);
+
+		CDemoRecorder &Recorder = m_pAsyncRecording->m_Recorder;
+		Recorder.m_NumTimelineMarkers = m_NumTimelineMarkers;
+		mem_copy(Recorder.m_aTimelineMarkers, m_aTimelineMarkers, sizeof(int) * m_NumTimelineMarkers);
+		const int Result = Recorder.Stop();
+		delete m_pAsyncRecording;
+		m_pAsyncRecording = nullptr;
+		return Result;
+	}
+
 	if(!m_File)
 		return -1;
 
@@ -4,17 +4,58 @@
 #define ENGINE_SHARED_DEMO_H
 
 #include <base/hash.h>
+#include <base/system.h>
 
 #include <engine/demo.h>
 #include <engine/shared/protocol.h>
 
+#include <atomic>
 #include <functional>
+#include <mutex>
 #include <vector>
 
 #include "snapshot.h"
 
 typedef std::function<void()> TUpdateIntraTimesFunc;
 
+// One background thread that does the delta, compression and file writes for
+// the recorders that use it. They share one queue, so the memory and the
+// number of threads do not grow with the number of recordings. Chunks are
+// dropped instead of blocking when the queue is full.
+class CDemoWriter
+{
+	friend class CDemoRecorder;
+
+	class CRecording;
+
+	std::mutex m_Mutex; // recorders may start, stop and push from several threads
+	unsigned char *m_pBuffer = nullptr;
+	size_t m_Capacity = 0;
+	std::atomic<size_t> m_ReadPos{0};
+	std::atomic<size_t> m_WritePos{0};
+	SEMAPHORE m_Semaphore;
+	void *m_pThread = nullptr;
+	int m_QueueSize = 0;
+	int m_NumRecordings = 0;
+
+	bool Attach();
+	void Detach();
+	bool Push(CRecording *pRecording, int Type, int Tick, const void *pData, int Size);
+	bool PushLocked(CRecording *pRecording, int Type, int Tick, const void *pData, int Size);
+	size_t Usage() const { return m_WritePos.load(std::memory_order_relaxed) - m_ReadPos.load(std::memory_order_acquire); }
+	// stops the thread and frees the queue, m_Mutex has to be held
+	void Shutdown();
+	static void Run(void *pUser);
+
+public:
+	CDemoWriter();
+	~CDemoWriter();
+
+	// the size of the queue shared by all recordings, a new size is used once
+	// no recording is running. with 0 the demos are written by the recorders
+	void SetQueueSize(int Size) { m_QueueSize = Size; }
+};
+
 class CDemoRecorder : public IDemoRecorder
 {
 	class IConsole *m_pConsole;
@@ -28,20 +69,37 @@ class CDemoRecorder : public IDemoRecorder
 	int m_NumTimelineMarkers;
 	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
 	bool m_NoMapData;
-	unsigned char *m_pMapData;
+	const unsigned char *m_pMapData;
 
 	DEMOFUNC_FILTER m_pfnFilter;
 	void *m_pUser;
 
+	friend CDemoWriter;
+	CDemoWriter *m_pWriter = nullptr;
+	CDemoWriter::CRecording *m_pAsyncRecording = nullptr;
+
 	void WriteTickMarker(int Tick, bool Keyframe);
 	void Write(int Type, const void *pData, int Size);
+	void QueueAsync(int Type, int Tick, const void *pData, int Size);
+
+public:
+	struct CAsyncStats
+	{
+		int64_t m_NumQueued = 0;
+		int64_t m_NumDropped = 0; // chunks lost because the writer thread fell behind
+		int m_PeakUsage = 0; // highest number of bytes waiting in the shared queue
+		int m_QueueSize = 0;
+	};
+
+private:
+	CAsyncStats m_AsyncStats;
 
 public:
 	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta, bool NoMapData = false);
 	CDemoRecorder() {}
 	~CDemoRecorder() override;
 
-	int Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetversion, const char *pMap, const SHA256_DIGEST &Sha256, unsigned MapCrc, const char *pType, unsigned MapSize, unsigned char *pMapData, IOHANDLE MapFile = nullptr, DEMOFUNC_FILTER pfnFilter = nullptr, void *pUser = nullptr);
+	int Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetversion, const char *pMap, const SHA256_DIGEST &Sha256, unsigned MapCrc, const char *pType, unsigned MapSize, const unsigned char *pMapData, IOHANDLE MapFile = nullptr, DEMOFUNC_FILTER pfnFilter = nullptr, void *pUser = nullptr);
 	int Stop() override;
 
 	void AddDemoMarker();
@@ -50,7 +108,13 @@ public:
 	void RecordSnapshot(int Tick, const void *pData, int Size);
 	void RecordMessage(const void *pData, int Size);
 
-	bool IsRecording() const override { return m_File != nullptr; }
+	// With a writer that has a queue, the next recording hands snapshots and
+	// messages to its thread. Stop waits for the queued chunks to be written
+	// and logs how many were dropped.
+	void SetAsyncWriter(CDemoWriter *pWriter) { m_pWriter = pWriter; }
+	const CAsyncStats &AsyncStats() const { return m_AsyncStats; }
+
+	bool IsRecording() const override { return m_File != nullptr || m_pAsyncRecording != nullptr; }
 	char *GetCurrentFilename() override { return m_aCurrentFilename; }
 	void ClearCurrentFilename() { m_aCurrentFilename[0] = '\0'; }
 
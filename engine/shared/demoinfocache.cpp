@@ -0,0 +1,187 @@
+#include "demoinfocache.h"
+
+#include <base/log.h>
+
+#include <engine/storage.h>
+
+#include <vector>
+
+// bump the version when the layout of the entries changes
+static const char gs_aDemoInfoCacheMagic[] = "DDNet demo info cache 1\n";
+
+// the headers are stored as they are in the demo file, the integers big endian:
+// path_length path size modified valid [header timeline_markers map_sha256]
+static void WriteInt64(std::vector<unsigned char> &vBuffer, int64_t Value)
+{
+	unsigned char aBuf[8];
+	uint_to_bytes_be(&aBuf[0], (uint64_t)Value >> 32);
+	uint_to_bytes_be(&aBuf[4], (uint64_t)Value & 0xffffffff);
+	vBuffer.insert(vBuffer.end(), aBuf, aBuf + sizeof(aBuf));
+}
+
+static int64_t ReadInt64(const unsigned char *pData)
+{
+	return (int64_t)(((uint64_t)bytes_be_to_uint(&pData[0]) << 32) | bytes_be_to_uint(&pData[4]));
+}
+
+CDemoInfoCache::CDemoInfoCache(IStorage *pStorage, const char *pCacheFilename) :
+	m_pStorage(pStorage), m_pCacheFilename(pCacheFilename)
+{
+	m_Loaded = false;
+	m_Changed = false;
+	m_NumReads = 0;
+}
+
+void CDemoInfoCache::Load()
+{
+	m_Loaded = true;
+
+	void *pFileData;
+	unsigned FileSize;
+	if(!m_pStorage->ReadFile(m_pCacheFilename, IStorage::TYPE_SAVE, &pFileData, &FileSize))
+		return;
+
+	const unsigned char *pData = static_cast<const unsigned char *>(pFileData);
+	const unsigned char *pEnd = pData + FileSize;
+	const size_t MagicSize = sizeof(gs_aDemoInfoCacheMagic) - 1;
+	if(FileSize < MagicSize || mem_comp(pData, gs_aDemoInfoCacheMagic, MagicSize) != 0)
+	{
+		free(pFileData);
+		return;
+	}
+	pData += MagicSize;
+
+	const size_t FixedSize = 4 + 8 + 8 + 1;
+	const size_t InfoSize = sizeof(CDemoHeader) + sizeof(CTimelineMarkers) + sizeof(SHA256_DIGEST);
+	while((size_t)(pEnd - pData) >= FixedSize)
+	{
+		const unsigned PathLength = bytes_be_to_uint(pData);
+		if(PathLength == 0 || PathLength >= IO_MAX_PATH_LENGTH || (size_t)(pEnd - pData) < FixedSize + PathLength)
+			break;
+		std::string Path((const char *)pData + 4, PathLength);
+		pData += 4 + PathLength;
+
+		CEntry Entry;
+		Entry.m_Size = ReadInt64(pData);
+		Entry.m_Modified = (time_t)ReadInt64(pData + 8);
+		Entry.m_Used = false;
+		mem_zero(&Entry.m_Info, sizeof(Entry.m_Info));
+		Entry.m_Info.m_Valid = pData[16] != 0;
+		pData += 17;
+		if(Entry.m_Info.m_Valid)
+		{
+			if((size_t)(pEnd - pData) < InfoSize)
+				break;
+			mem_copy(&Entry.m_Info.m_Info, pData, sizeof(CDemoHeader));
+			pData += sizeof(CDemoHeader);
+			mem_copy(&Entry.m_Info.m_TimelineMarkers, pData, sizeof(CTimelineMarkers));
+			pData += sizeof(CTimelineMarkers);
+			mem_copy(&Entry.m_Info.m_MapInfo.m_Sha256, pData, sizeof(SHA256_DIGEST));
+			pData += sizeof(SHA256_DIGEST);
+			if(!Entry.m_Info.m_Info.Valid())
+				continue;
+
+			// the rest of the map info comes from the header, like in GetDemoInfo
+			CMapInfo &MapInfo = Entry.m_Info.m_MapInfo;
+			str_copy(MapInfo.m_aName, Entry.m_Info.m_Info.m_aMapName);
+			MapInfo.m_Crc = bytes_be_to_uint(Entry.m_Info.m_Info.m_aMapCrc);
+			MapInfo.m_Size = bytes_be_to_uint(Entry.m_Info.m_Info.m_aMapSize);
+		}
+		m_Entries[Path] = Entry;
+	}
+
+	free(pFileData);
+}
+
+void CDemoInfoCache::Save()
+{
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	if(!m_Changed)
+		return;
+	m_Changed = false;
+
+	std::vector<unsigned char> vBuffer(gs_aDemoInfoCacheMagic, gs_aDemoInfoCacheMagic + sizeof(gs_aDemoInfoCacheMagic) - 1);
+	for(auto It = m_Entries.begin(); It != m_Entries.end();)
+	{
+		const std::string &Path = It->first;
+		const CEntry &Entry = It->second;
+		int64_t Size;
+		time_t Modified;
+		if(!Entry.m_Used && fs_file_stat(Path.c_str(), &Size, &Modified) != 0)
+		{
+			It = m_Entries.erase(It);
+			continue;
+		}
+
+		unsigned char aPathLength[4];
+		uint_to_bytes_be(aPathLength, Path.size());
+		vBuffer.insert(vBuffer.end(), aPathLength, aPathLength + sizeof(aPathLength));
+		vBuffer.insert(vBuffer.end(), Path.begin(), Path.end());
+		WriteInt64(vBuffer, Entry.m_Size);
+		WriteInt64(vBuffer, Entry.m_Modified);
+		vBuffer.push_back(Entry.m_Info.m_Valid);
+		if(Entry.m_Info.m_Valid)
+		{
+			const unsigned char *pHeader = (const unsigned char *)&Entry.m_Info.m_Info;
+			vBuffer.insert(vBuffer.end(), pHeader, pHeader + sizeof(CDemoHeader));
+			const unsigned char *pMarkers = (const unsigned char *)&Entry.m_Info.m_TimelineMarkers;
+			vBuffer.insert(vBuffer.end(), pMarkers, pMarkers + sizeof(CTimelineMarkers));
+			const unsigned char *pSha256 = Entry.m_Info.m_MapInfo.m_Sha256.data;
+			vBuffer.insert(vBuffer.end(), pSha256, pSha256 + sizeof(SHA256_DIGEST));
+		}
+		++It;
+	}
+
+	char aTmpFilename[IO_MAX_PATH_LENGTH];
+	IStorage::FormatTmpPath(aTmpFilename, sizeof(aTmpFilename), m_pCacheFilename);
+	IOHANDLE File = m_pStorage->OpenFile(aTmpFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		log_error("demoinfocache", "failed to open '%s' for writing", aTmpFilename);
+		return;
+	}
+	io_write(File, vBuffer.data(), vBuffer.size());
+	io_close(File);
+
+	if(m_pStorage->FileExists(m_pCacheFilename, IStorage::TYPE_SAVE))
+		m_pStorage->RemoveFile(m_pCacheFilename, IStorage::TYPE_SAVE);
+	if(!m_pStorage->RenameFile(aTmpFilename, m_pCacheFilename, IStorage::TYPE_SAVE))
+		log_error("demoinfocache", "failed to save '%s'", m_pCacheFilename);
+}
+
+bool CDemoInfoCache::Get(const IDemoPlayer *pDemoPlayer, const char *pFilename, int StorageType, CInfo *pInfo)
+{
+	char aPath[IO_MAX_PATH_LENGTH];
+	m_pStorage->GetCompletePath(StorageType, pFilename, aPath, sizeof(aPath));
+	int64_t Size;
+	time_t Modified;
+	const bool Exists = fs_file_stat(aPath, &Size, &Modified) == 0;
+	if(Exists)
+	{
+		std::unique_lock<std::mutex> Lock(m_Mutex);
+		if(!m_Loaded)
+			Load();
+		auto It = m_Entries.find(aPath);
+		if(It != m_Entries.end() && It->second.m_Size == Size && It->second.m_Modified == Modified)
+		{
+			It->second.m_Used = true;
+			*pInfo = It->second.m_Info;
+			return pInfo->m_Valid;
+		}
+	}
+
+	// other threads can keep using the cache while the file is read
+	pInfo->m_Valid = pDemoPlayer->GetDemoInfo(m_pStorage, nullptr, pFilename, StorageType, &pInfo->m_Info, &pInfo->m_TimelineMarkers, &pInfo->m_MapInfo);
+	m_NumReads++;
+	if(!Exists)
+		return pInfo->m_Valid;
+
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	CEntry &Entry = m_Entries[aPath];
+	Entry.m_Size = Size;
+	Entry.m_Modified = Modified;
+	Entry.m_Used = true;
+	Entry.m_Info = *pInfo;
+	m_Changed = true;
+	return pInfo->m_Valid;
+}
@@ -0,0 +1,65 @@
+#ifndef ENGINE_SHARED_DEMOINFOCACHE_H
+#define ENGINE_SHARED_DEMOINFOCACHE_H
+
+#include <base/system.h>
+
+#include <engine/demo.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class IStorage;
+
+// Persistent cache of the demo headers shown in the demo browser, so a folder
+// with many demos does not have to be read again every time it is listed. The
+// entries are keyed by the complete path of the demo and validated by its size
+// and modification time. The cache is only loaded once a lookup needs it and
+// can be used from several threads.
+class CDemoInfoCache
+{
+public:
+	struct CInfo
+	{
+		bool m_Valid;
+		CDemoHeader m_Info;
+		CTimelineMarkers m_TimelineMarkers;
+		CMapInfo m_MapInfo;
+	};
+
+private:
+	struct CEntry
+	{
+		int64_t m_Size;
+		time_t m_Modified;
+		bool m_Used; // looked up in this session
+		CInfo m_Info;
+	};
+
+	IStorage *m_pStorage;
+	const char *m_pCacheFilename;
+
+	std::mutex m_Mutex;
+	bool m_Loaded;
+	bool m_Changed;
+	std::atomic<int> m_NumReads;
+	std::unordered_map<std::string, CEntry> m_Entries;
+
+	void Load();
+
+public:
+	CDemoInfoCache(IStorage *pStorage, const char *pCacheFilename = "demoinfocache.dat");
+
+	// fills the info of the demo from the cache, or reads the header of the
+	// file if it is not cached or changed, returns whether the demo is valid
+	bool Get(const IDemoPlayer *pDemoPlayer, const char *pFilename, int StorageType, CInfo *pInfo);
+	// writes the cache if it changed, entries of demos that were not looked
+	// up in this session are kept as long as their file still exists
+	void Save();
+
+	// the number of demo files that had to be read
+	int NumReads() const { return m_NumReads.load(); }
+};
+
+#endif
@@ -93,11 +93,16 @@ public:
 		m_pConsole->Register("dbg_lognetwork", "", CFGFLAG_SERVER | CFGFLAG_CLIENT, Con_DbgLognetwork, this, "Log the network");
 	}
 
-	void AddJob(std::shared_ptr<IJob> pJob) override
+	void AddJob(std::shared_ptr<IJob> pJob, CJobGroup *pGroup = nullptr) override
 	{
 		if(g_Config.m_Debug)
 			dbg_msg("engine", "job added");
-		m_JobPool.Add(std::move(pJob));
+		m_JobPool.Add(std::move(pJob), pGroup);
+	}
+
+	void RunJobContinuations() override
+	{
+		m_JobPool.RunContinuations();
 	}
 
 	void SetAdditionalLogger(std::shared_ptr<ILogger> &&pLogger) override
@@ -3,6 +3,7 @@
 #include "huffman.h"
 #include <algorithm>
 #include <base/system.h>
+#include <cstring>
 
 const unsigned CHuffman::ms_aFreqTable[HUFFMAN_MAX_SYMBOLS] = {
 	1 << 30, 4545, 2657, 431, 1950, 919, 444, 482, 2244, 617, 838, 542, 715, 1814, 304, 240, 754, 212, 647, 186,
@@ -30,6 +31,17 @@ bool CompareNodesByFrequencyDesc(const CHuffmanConstructNode *pNode1, const CHuf
 	return pNode2->m_Frequency < pNode1->m_Frequency;
 }
 
+// fixed size memcpy compiles to a single load, unlike the out-of-line mem_copy
+static inline uint64_t LoadLittleEndian64(const unsigned char *pData)
+{
+	uint64_t Value;
+	memcpy(&Value, pData, sizeof(Value));
+#if defined(CONF_ARCH_ENDIAN_BIG)
+	swap_endian(&Value, sizeof(Value), 1);
+#endif
+	return Value;
+}
+
 void CHuffman::Setbits_r(CNode *pNode, int Bits, unsigned Depth)
 {
 	if(pNode->m_aLeafs[1] != 0xffff)
@@ -90,114 +102,127 @@ void CHuffman::ConstructTree(const unsigned *pFrequencies)
 	Setbits_r(m_pStartNode, 0, 0);
 }
 
-void CHuffman::Init(const unsigned *pFrequencies)
+void CHuffman::BuildDecodeLut()
 {
-	// make sure to cleanout every thing
-	mem_zero(m_aNodes, sizeof(m_aNodes));
-	mem_zero(m_apDecodeLut, sizeof(m_apDecodeLut));
-	m_pStartNode = 0x0;
-	m_NumNodes = 0;
-
-	// construct the tree
-	ConstructTree(pFrequencies);
-
-	// build decode LUT
 	for(int i = 0; i < HUFFMAN_LUTSIZE; i++)
 	{
-		unsigned Bits = i;
-		int k;
-		CNode *pNode = m_pStartNode;
-		for(k = 0; k < HUFFMAN_LUTBITS; k++)
+		CDecodeEntry *pEntry = &m_aDecodeLut[i];
+		pEntry->m_NumSymbols = 0;
+		pEntry->m_NumBits = 0;
+		pEntry->m_Node = HUFFMAN_NO_NODE;
+
+		// decode as many complete symbols as the lookup bits hold
+		unsigned Used = 0;
+		while(pEntry->m_NumSymbols < HUFFMAN_LUTSYMBOLS)
 		{
-			pNode = &m_aNodes[pNode->m_aLeafs[Bits & 1]];
-			Bits >>= 1;
+			const CNode *pNode = m_pStartNode;
+			unsigned k = Used;
+			while(k < HUFFMAN_LUTBITS && !pNode->m_NumBits)
+			{
+				pNode = &m_aNodes[pNode->m_aLeafs[(i >> k) & 1]];
+				k++;
+			}
 
-			if(!pNode)
+			if(!pNode->m_NumBits)
+			{
+				// the code is longer than the lookup, the tree walk takes over
+				if(pEntry->m_NumSymbols == 0)
+				{
+					pEntry->m_NumBits = HUFFMAN_LUTBITS;
+					pEntry->m_Node = pNode - m_aNodes;
+				}
 				break;
+			}
 
-			if(pNode->m_NumBits)
+			Used = k;
+			if(pNode == &m_aNodes[HUFFMAN_EOF_SYMBOL])
 			{
-				m_apDecodeLut[i] = pNode;
+				pEntry->m_NumBits = Used;
+				pEntry->m_Node = HUFFMAN_EOF_SYMBOL;
 				break;
 			}
+			pEntry->m_aSymbols[pEntry->m_NumSymbols++] = pNode->m_Symbol;
+			pEntry->m_NumBits = Used;
 		}
+	}
+}
 
-		if(k == HUFFMAN_LUTBITS)
-			m_apDecodeLut[i] = pNode;
+void CHuffman::Init(const unsigned *pFrequencies)
+{
+	// make sure to cleanout every thing
+	mem_zero(m_aNodes, sizeof(m_aNodes));
+	mem_zero(m_aEncodeTable, sizeof(m_aEncodeTable));
+	mem_zero(m_aDecodeLut, sizeof(m_aDecodeLut));
+	m_pStartNode = 0x0;
+	m_NumNodes = 0;
+
+	// construct the tree
+	ConstructTree(pFrequencies);
+
+	// build encode table
+	for(int i = 0; i < HUFFMAN_MAX_SYMBOLS; i++)
+	{
+		dbg_assert(m_aNodes[i].m_NumBits <= HUFFMAN_MAX_CODE_BITS, "huffman code too long");
+		m_aEncodeTable[i].m_Bits = m_aNodes[i].m_Bits;
+		m_aEncodeTable[i].m_NumBits = m_aNodes[i].m_NumBits;
 	}
+
+	// build decode LUT
+	BuildDecodeLut();
 }
 
 //***************************************************************
 int CHuffman::Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize) const
 {
-	// this macro loads a symbol for a byte into bits and bitcount
-#define HUFFMAN_MACRO_LOADSYMBOL(Sym) \
-	do \
-	{ \
-		Bits |= m_aNodes[Sym].m_Bits << Bitcount; \
-		Bitcount += m_aNodes[Sym].m_NumBits; \
-	} while(0)
-
-	// this macro writes the symbol stored in bits and bitcount to the dst pointer
-#define HUFFMAN_MACRO_WRITE() \
-	do \
-	{ \
-		while(Bitcount >= 8) \
-		{ \
-			*pDst++ = (unsigned char)(Bits & 0xff); \
-			if(pDst == pDstEnd) \
-				return -1; \
-			Bits >>= 8; \
-			Bitcount -= 8; \
-		} \
-	} while(0)
-
 	// setup buffer pointers
 	const unsigned char *pSrc = (const unsigned char *)pInput;
 	const unsigned char *pSrcEnd = pSrc + InputSize;
 	unsigned char *pDst = (unsigned char *)pOutput;
 	unsigned char *pDstEnd = pDst + OutputSize;
 
-	// symbol variables
-	unsigned Bits = 0;
+	// symbol variables, codes are at most 32 bits long so flushing 32 bits
+	// whenever they are full leaves enough room in the accumulator
+	uint64_t Bits = 0;
 	unsigned Bitcount = 0;
 
-	// make sure that we have data that we want to compress
-	if(InputSize)
+	while(pSrc != pSrcEnd)
 	{
-		// {A} load the first symbol
-		int Symbol = *pSrc++;
+		const CEncodeEntry &Entry = m_aEncodeTable[*pSrc++];
+		Bits |= (uint64_t)Entry.m_Bits << Bitcount;
+		Bitcount += Entry.m_NumBits;
 
-		while(pSrc != pSrcEnd)
+		if(Bitcount >= 32)
 		{
-			// {B} load the symbol
-			HUFFMAN_MACRO_LOADSYMBOL(Symbol);
-
-			// {C} fetch next symbol, this is done here because it will reduce dependency in the code
-			Symbol = *pSrc++;
-
-			// {B} write the symbol loaded at
-			HUFFMAN_MACRO_WRITE();
+			// at least the final byte still follows
+			if(pDstEnd - pDst <= 4)
+				return -1;
+			pDst[0] = (unsigned char)Bits;
+			pDst[1] = (unsigned char)(Bits >> 8);
+			pDst[2] = (unsigned char)(Bits >> 16);
+			pDst[3] = (unsigned char)(Bits >> 24);
+			pDst += 4;
+			Bits >>= 32;
+			Bitcount -= 32;
 		}
-
-		// write the last symbol loaded from {C} or {A} in the case of only 1 byte input buffer
-		HUFFMAN_MACRO_LOADSYMBOL(Symbol);
-		HUFFMAN_MACRO_WRITE();
 	}
 
 	// write EOF symbol
-	HUFFMAN_MACRO_LOADSYMBOL(HUFFMAN_EOF_SYMBOL);
-	HUFFMAN_MACRO_WRITE();
+	Bits |= (uint64_t)m_aEncodeTable[HUFFMAN_EOF_SYMBOL].m_Bits << Bitcount;
+	Bitcount += m_aEncodeTable[HUFFMAN_EOF_SYMBOL].m_NumBits;
 
-	// write out the last bits
-	*pDst++ = Bits;
+	// write out the remaining bytes and the last bits, which always take one byte
+	if(pDstEnd - pDst <= (int)(Bitcount / 8))
+		return -1;
+	while(Bitcount >= 8)
+	{
+		*pDst++ = (unsigned char)Bits;
+		Bits >>= 8;
+		Bitcount -= 8;
+	}
+	*pDst++ = (unsigned char)Bits;
 
 	// return the size of the output
 	return (int)(pDst - (const unsigned char *)pOutput);
-
-	// remove macros
-#undef HUFFMAN_MACRO_LOADSYMBOL
-#undef HUFFMAN_MACRO_WRITE
 }
 
 //***************************************************************
@@ -205,71 +230,93 @@ int CHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int O
 {
 	// setup buffer pointers
 	unsigned char *pDst = (unsigned char *)pOutput;
-	unsigned char *pSrc = (unsigned char *)pInput;
+	const unsigned char *pSrc = (const unsigned char *)pInput;
 	unsigned char *pDstEnd = pDst + OutputSize;
-	unsigned char *pSrcEnd = pSrc + InputSize;
+	const unsigned char *pSrcEnd = pSrc + InputSize;
 
-	unsigned Bits = 0;
+	uint64_t Bits = 0;
 	unsigned Bitcount = 0;
-
-	const CNode *pEof = &m_aNodes[HUFFMAN_EOF_SYMBOL];
+	// zero bits added past the end of the input
+	unsigned Padding = 0;
 
 	while(true)
 	{
-		// {A} try to load a node now, this will reduce dependency at location {D}
-		const CNode *pNode = 0;
-		if(Bitcount >= HUFFMAN_LUTBITS)
-			pNode = m_apDecodeLut[Bits & HUFFMAN_LUTMASK];
-
-		// {B} fill with new bits
-		while(Bitcount < 24 && pSrc != pSrcEnd)
+		// {A} fill with new bits, reading past the end of the input yields zero bits
+		if(pSrcEnd - pSrc >= 8)
 		{
-			Bits |= (*pSrc++) << Bitcount;
-			Bitcount += 8;
+			// load eight bytes at once and keep the whole ones that fit
+			Bits |= LoadLittleEndian64(pSrc) << Bitcount;
+			pSrc += (63 - Bitcount) >> 3;
+			Bitcount |= 56;
+		}
+		else
+		{
+			while(Bitcount <= 56)
+			{
+				if(pSrc != pSrcEnd)
+					Bits |= (uint64_t)(*pSrc++) << Bitcount;
+				else
+					Padding += 8;
+				Bitcount += 8;
+			}
 		}
 
-		// {C} load symbol now if we didn't that earlier at location {A}
-		if(!pNode)
-			pNode = m_apDecodeLut[Bits & HUFFMAN_LUTMASK];
-
-		if(!pNode)
-			return -1;
+		const CDecodeEntry &Entry = m_aDecodeLut[Bits & HUFFMAN_LUTMASK];
+		const int Available = (int)Bitcount - (int)Padding;
+		const bool Long = Entry.m_NumSymbols == 0 && Entry.m_Node != HUFFMAN_EOF_SYMBOL;
 
-		// {D} check if we hit a symbol already
-		if(pNode->m_NumBits)
+		// {B} output all symbols the lookup resolves at once, as long as they come from the input
+		if(!Long && Entry.m_NumBits <= Available)
 		{
-			// remove the bits for that symbol
-			Bits >>= pNode->m_NumBits;
-			Bitcount -= pNode->m_NumBits;
+			if(pDstEnd - pDst >= HUFFMAN_LUTSYMBOLS)
+			{
+				// copy the whole entry, only the valid symbols are kept
+				memcpy(pDst, Entry.m_aSymbols, HUFFMAN_LUTSYMBOLS);
+			}
+			else if(pDstEnd - pDst >= Entry.m_NumSymbols)
+			{
+				for(int i = 0; i < Entry.m_NumSymbols; i++)
+					pDst[i] = Entry.m_aSymbols[i];
+			}
+			else
+				return -1;
+			pDst += Entry.m_NumSymbols;
+			Bits >>= Entry.m_NumBits;
+			Bitcount -= Entry.m_NumBits;
+
+			// check for eof
+			if(Entry.m_Node == HUFFMAN_EOF_SYMBOL)
+				break;
+			continue;
 		}
-		else
+
+		// {C} walk the tree bit by bit for codes longer than the lookup and at the end of
+		// the input, the accumulator still holds enough bits for the longest code
+		const CNode *pNode = m_pStartNode;
+		int CodeBits = 0;
+		if(Long)
 		{
-			// remove the bits that the lut checked up for us
+			pNode = &m_aNodes[Entry.m_Node];
 			Bits >>= HUFFMAN_LUTBITS;
 			Bitcount -= HUFFMAN_LUTBITS;
-
-			// walk the tree bit by bit
-			while(true)
-			{
-				// traverse tree
-				pNode = &m_aNodes[pNode->m_aLeafs[Bits & 1]];
-
-				// remove bit
-				Bitcount--;
-				Bits >>= 1;
-
-				// check if we hit a symbol
-				if(pNode->m_NumBits)
-					break;
-
-				// no more bits, decoding error
-				if(Bitcount == 0)
-					return -1;
-			}
+			CodeBits = HUFFMAN_LUTBITS;
 		}
+		do
+		{
+			pNode = &m_aNodes[pNode->m_aLeafs[Bits & 1]];
+			Bits >>= 1;
+			Bitcount--;
+			CodeBits++;
+		} while(!pNode->m_NumBits);
+
+		// a code running past the end of the input is a decoding error. the byte-at-a-time
+		// decoder only noticed that for codes it had to walk past its 10 bit lookup and only
+		// if the input did not already end within those bits, keep rejecting the same packets
+		if(Available > HUFFMAN_TRUNCATION_CHECK_BITS && CodeBits > Available)
+			return -1;
 
 		// check for eof
-		if(pNode == pEof)
+		if(pNode == &m_aNodes[HUFFMAN_EOF_SYMBOL])
 			break;
 
 		// output character
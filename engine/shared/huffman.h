@@ -12,9 +12,17 @@ class CHuffman
 		HUFFMAN_MAX_SYMBOLS = HUFFMAN_EOF_SYMBOL + 1,
 		HUFFMAN_MAX_NODES = HUFFMAN_MAX_SYMBOLS * 2 - 1,
 
-		HUFFMAN_LUTBITS = 10,
+		HUFFMAN_LUTBITS = 11,
 		HUFFMAN_LUTSIZE = (1 << HUFFMAN_LUTBITS),
-		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE - 1)
+		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE - 1),
+		// maximum number of symbols a single decode lookup emits
+		HUFFMAN_LUTSYMBOLS = 4,
+
+		// the encoder flushes 32 bits of its 64 bit accumulator at a time
+		HUFFMAN_MAX_CODE_BITS = 32,
+		// lookup size of the original decoder, which decides when truncated input is rejected
+		HUFFMAN_TRUNCATION_CHECK_BITS = 10,
+		HUFFMAN_NO_NODE = 0xffff,
 	};
 
 	struct CNode
@@ -30,15 +38,36 @@ class CHuffman
 		unsigned char m_Symbol;
 	};
 
+	// code of a symbol, kept apart from the tree so the encoder touches as little memory as possible
+	struct CEncodeEntry
+	{
+		unsigned m_Bits;
+		unsigned m_NumBits;
+	};
+
+	// all complete symbols found in the next HUFFMAN_LUTBITS bits of the stream
+	struct CDecodeEntry
+	{
+		unsigned char m_aSymbols[HUFFMAN_LUTSYMBOLS];
+		unsigned char m_NumSymbols;
+		// bits used up by the symbols, HUFFMAN_LUTBITS if the code is longer than the lookup
+		unsigned char m_NumBits;
+		// HUFFMAN_EOF_SYMBOL if the symbols are followed by EOF, the node to continue the
+		// tree walk from if the code is longer than the lookup, HUFFMAN_NO_NODE otherwise
+		unsigned short m_Node;
+	};
+
 	static const unsigned ms_aFreqTable[HUFFMAN_MAX_SYMBOLS];
 
 	CNode m_aNodes[HUFFMAN_MAX_NODES];
-	CNode *m_apDecodeLut[HUFFMAN_LUTSIZE];
+	CEncodeEntry m_aEncodeTable[HUFFMAN_MAX_SYMBOLS];
+	CDecodeEntry m_aDecodeLut[HUFFMAN_LUTSIZE];
 	CNode *m_pStartNode;
 	int m_NumNodes;
 
 	void Setbits_r(CNode *pNode, int Bits, unsigned Depth);
 	void ConstructTree(const unsigned *pFrequencies);
+	void BuildDecodeLut();
 
 public:
 	/*
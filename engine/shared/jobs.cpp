@@ -2,8 +2,14 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include "jobs.h"
 
+#include <base/math.h>
+
+// the pool and queue index of the current thread, if it is a worker
+static thread_local CJobPool *gs_pWorkerPool = nullptr;
+static thread_local int gs_WorkerIndex = -1;
+
 IJob::IJob() :
-	m_Status(STATE_PENDING)
+	m_Status(STATE_PENDING), m_Priority(PRIORITY_NORMAL), m_pGroup(nullptr)
 {
 }
 
@@ -14,13 +20,58 @@ int IJob::Status()
 	return m_Status.load();
 }
 
+void IJob::SetPriority(int Priority)
+{
+	dbg_assert(Priority >= 0 && Priority < NUM_PRIORITIES, "invalid job priority");
+	m_Priority = Priority;
+}
+
+void IJob::Then(std::function<void()> &&fnContinuation)
+{
+	m_fnContinuation = std::move(fnContinuation);
+}
+
+CJobGroup::CJobGroup() :
+	m_NumPending(0)
+{
+}
+
+CJobGroup::~CJobGroup()
+{
+	dbg_assert(NumPending() == 0, "job group destroyed while jobs are pending");
+}
+
+int CJobGroup::NumPending()
+{
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	return m_NumPending;
+}
+
+void CJobGroup::Add()
+{
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	m_NumPending++;
+}
+
+void CJobGroup::Done()
+{
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	if(--m_NumPending == 0)
+		m_Done.notify_all();
+}
+
+void CJobGroup::Wait()
+{
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	m_Done.wait(Lock, [this] { return m_NumPending == 0; });
+}
+
 CJobPool::CJobPool()
 {
 	// empty the pool
 	m_Shutdown = false;
+	m_NextQueue = 0;
 	sphore_init(&m_Semaphore);
-	m_pFirstJob = 0;
-	m_pLastJob = 0;
 }
 
 CJobPool::~CJobPool()
@@ -31,46 +82,101 @@ CJobPool::~CJobPool()
 	}
 }
 
+std::shared_ptr<IJob> CJobPool::Pop(int Index)
+{
+	const int NumQueues = m_vpQueues.size();
+	for(int Priority = 0; Priority < IJob::NUM_PRIORITIES; Priority++)
+	{
+		// take the oldest job of the own queue first, then steal the newest
+		// job of the other queues, so owner and thief rarely meet
+		for(int i = 0; i < NumQueues; i++)
+		{
+			CQueue *pQueue = m_vpQueues[(Index + i) % NumQueues].get();
+			CLockScope ls(pQueue->m_Lock);
+			std::deque<std::shared_ptr<IJob>> &Jobs = pQueue->m_apJobs[Priority];
+			if(Jobs.empty())
+				continue;
+			std::shared_ptr<IJob> pJob;
+			if(i == 0)
+			{
+				pJob = std::move(Jobs.front());
+				Jobs.pop_front();
+			}
+			else
+			{
+				pJob = std::move(Jobs.back());
+				Jobs.pop_back();
+			}
+			return pJob;
+		}
+	}
+	return nullptr;
+}
+
 void CJobPool::WorkerThread(void *pUser)
 {
-	CJobPool *pPool = (CJobPool *)pUser;
+	CWorkerInfo *pInfo = (CWorkerInfo *)pUser;
+	CJobPool *pPool = pInfo->m_pPool;
+	gs_pWorkerPool = pPool;
+	gs_WorkerIndex = pInfo->m_Index;
+	delete pInfo;
 
 	while(!pPool->m_Shutdown)
 	{
-		std::shared_ptr<IJob> pJob = 0;
-
-		// fetch job from queue
+		// every added job signals the semaphore once, so there is a job for
+		// every wakeup. Another worker may have taken the one we were woken
+		// for, in that case the one it was woken for is still queued.
 		sphore_wait(&pPool->m_Semaphore);
+		std::shared_ptr<IJob> pJob = pPool->Pop(gs_WorkerIndex);
+		while(!pJob && !pPool->m_Shutdown)
 		{
-			CLockScope ls(pPool->m_Lock);
-			if(pPool->m_pFirstJob)
-			{
-				pJob = pPool->m_pFirstJob;
-				pPool->m_pFirstJob = pPool->m_pFirstJob->m_pNext;
-				// allow remaining objects in list to destruct, even when current object stays alive
-				pJob->m_pNext = nullptr;
-				if(!pPool->m_pFirstJob)
-					pPool->m_pLastJob = 0;
-			}
+			thread_yield();
+			pJob = pPool->Pop(gs_WorkerIndex);
 		}
 
 		// do the job if we have one
 		if(pJob)
 		{
-			RunBlocking(pJob.get());
+			pJob->m_Status = IJob::STATE_RUNNING;
+			pJob->Run();
+			pJob->m_Status = IJob::STATE_DONE;
+			pPool->Finish(pJob.get());
 		}
 	}
+
+	gs_pWorkerPool = nullptr;
+	gs_WorkerIndex = -1;
+}
+
+void CJobPool::Finish(IJob *pJob)
+{
+	if(pJob->m_fnContinuation)
+	{
+		CLockScope ls(m_ContinuationLock);
+		m_vContinuations.push_back(std::move(pJob->m_fnContinuation));
+	}
+	if(pJob->m_pGroup)
+	{
+		CJobGroup *pGroup = pJob->m_pGroup;
+		pJob->m_pGroup = nullptr;
+		pGroup->Done();
+	}
 }
 
 void CJobPool::Init(int NumThreads)
 {
+	// there is always one queue, so jobs can be added without workers
+	m_vpQueues.reserve(maximum(NumThreads, 1));
+	for(int i = 0; i < maximum(NumThreads, 1); i++)
+		m_vpQueues.push_back(std::make_unique<CQueue>());
+
 	// start threads
 	char aName[32];
 	m_vpThreads.reserve(NumThreads);
 	for(int i = 0; i < NumThreads; i++)
 	{
 		str_format(aName, sizeof(aName), "CJobPool worker %d", i);
-		m_vpThreads.push_back(thread_init(WorkerThread, this, aName));
+		m_vpThreads.push_back(thread_init(WorkerThread, new CWorkerInfo{this, i}, aName));
 	}
 }
 
@@ -82,27 +188,58 @@ void CJobPool::Destroy()
 	for(void *pThread : m_vpThreads)
 		thread_wait(pThread);
 	m_vpThreads.clear();
+	m_vpQueues.clear();
 	sphore_destroy(&m_Semaphore);
 }
 
-void CJobPool::Add(std::shared_ptr<IJob> pJob)
+void CJobPool::Add(std::shared_ptr<IJob> pJob, CJobGroup *pGroup)
 {
+	if(pGroup)
+	{
+		pJob->m_pGroup = pGroup;
+		pGroup->Add();
+	}
+
+	dbg_assert(!m_vpQueues.empty(), "job pool is not initialized");
+
+	// workers keep the jobs they add to themselves, which keeps related data
+	// in their caches; other threads spread their jobs over all workers
+	int Index;
+	if(gs_pWorkerPool == this)
+		Index = gs_WorkerIndex;
+	else
+		Index = m_NextQueue++ % m_vpQueues.size();
+
 	{
-		CLockScope ls(m_Lock);
+		CQueue *pQueue = m_vpQueues[Index].get();
+		CLockScope ls(pQueue->m_Lock);
 		// add job to queue
-		if(m_pLastJob)
-			m_pLastJob->m_pNext = pJob;
-		m_pLastJob = std::move(pJob);
-		if(!m_pFirstJob)
-			m_pFirstJob = m_pLastJob;
+		pQueue->m_apJobs[pJob->m_Priority].push_back(std::move(pJob));
 	}
 
 	sphore_signal(&m_Semaphore);
 }
 
+void CJobPool::RunContinuations()
+{
+	std::vector<std::function<void()>> vContinuations;
+	{
+		CLockScope ls(m_ContinuationLock);
+		std::swap(vContinuations, m_vContinuations);
+	}
+	for(auto &fnContinuation : vContinuations)
+		fnContinuation();
+}
+
 void CJobPool::RunBlocking(IJob *pJob)
 {
 	pJob->m_Status = IJob::STATE_RUNNING;
 	pJob->Run();
 	pJob->m_Status = IJob::STATE_DONE;
+	// the caller is the thread that waits for the result
+	if(pJob->m_fnContinuation)
+	{
+		std::function<void()> fnContinuation = std::move(pJob->m_fnContinuation);
+		fnContinuation();
+	}
 }
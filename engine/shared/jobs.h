@@ -7,9 +7,14 @@
 #include <base/system.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <vector>
 
+class CJobGroup;
 class CJobPool;
 
 class IJob
@@ -17,9 +22,10 @@ class IJob
 	friend CJobPool;
 
 private:
-	std::shared_ptr<IJob> m_pNext;
-
 	std::atomic<int> m_Status;
+	int m_Priority;
+	CJobGroup *m_pGroup;
+	std::function<void()> m_fnContinuation;
 	virtual void Run() = 0;
 
 public:
@@ -35,19 +41,79 @@ public:
 		STATE_RUNNING,
 		STATE_DONE
 	};
+
+	enum
+	{
+		PRIORITY_HIGH = 0, // latency-sensitive work the player is waiting for
+		PRIORITY_NORMAL, // background work like http requests or saving files
+		NUM_PRIORITIES
+	};
+
+	// Must be set before the job is added to the pool.
+	void SetPriority(int Priority);
+	int Priority() const { return m_Priority; }
+
+	// The continuation is called by CJobPool::RunContinuations after the
+	// job is done, on the thread that pumps them. The client and the server
+	// do that once per main loop iteration, other users of a pool have to
+	// call it themselves. Must be set before the job is added to the pool.
+	void Then(std::function<void()> &&fnContinuation);
+};
+
+class CJobGroup
+{
+	friend CJobPool;
+
+	// the worker finishes with the group while holding the mutex, so a
+	// waiter can only see the group completed once it is no longer touched
+	std::mutex m_Mutex;
+	std::condition_variable m_Done;
+	int m_NumPending;
+
+	void Add();
+	void Done();
+
+public:
+	CJobGroup();
+	~CJobGroup();
+	CJobGroup(const CJobGroup &Other) = delete;
+	CJobGroup &operator=(const CJobGroup &Other) = delete;
+
+	int NumPending();
+	// Blocks until all jobs added with this group are done.
+	void Wait();
 };
 
 class CJobPool
 {
+	// Every worker has its own queue, jobs are added to the queue of the
+	// adding worker or spread over all queues when added from other threads.
+	// Idle workers steal jobs from the other queues.
+	struct CQueue
+	{
+		CLock m_Lock;
+		std::deque<std::shared_ptr<IJob>> m_apJobs[IJob::NUM_PRIORITIES] GUARDED_BY(m_Lock);
+	};
+
 	std::vector<void *> m_vpThreads;
+	std::vector<std::unique_ptr<CQueue>> m_vpQueues;
+	std::atomic<unsigned> m_NextQueue;
 	std::atomic<bool> m_Shutdown;
 
-	CLock m_Lock;
 	SEMAPHORE m_Semaphore;
-	std::shared_ptr<IJob> m_pFirstJob GUARDED_BY(m_Lock);
-	std::shared_ptr<IJob> m_pLastJob GUARDED_BY(m_Lock);
+
+	CLock m_ContinuationLock;
+	std::vector<std::function<void()>> m_vContinuations GUARDED_BY(m_ContinuationLock);
+
+	struct CWorkerInfo
+	{
+		CJobPool *m_pPool;
+		int m_Index;
+	};
 
 	static void WorkerThread(void *pUser) NO_THREAD_SAFETY_ANALYSIS;
+	std::shared_ptr<IJob> Pop(int Index);
+	void Finish(IJob *pJob) REQUIRES(!m_ContinuationLock);
 
 public:
 	CJobPool();
@@ -55,7 +121,9 @@ public:
 
 	void Init(int NumThreads);
 	void Destroy();
-	void Add(std::shared_ptr<IJob> pJob) REQUIRES(!m_Lock);
+	void Add(std::shared_ptr<IJob> pJob, CJobGroup *pGroup = nullptr);
+	// Calls the continuations of the jobs that are done, see IJob::Then.
+	void RunContinuations() REQUIRES(!m_ContinuationLock);
 	static void RunBlocking(IJob *pJob);
 };
 #endif
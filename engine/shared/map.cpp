@@ -4,6 +4,7 @@
 
 #include <base/log.h>
 
+#include <engine/engine.h>
 #include <engine/storage.h>
 
 #include <game/mapitems.h>
@@ -91,10 +92,43 @@ bool CMap::Load(const char *pMapName)
 		return false;
 	}
 
-	// Replace compressed tile layers with uncompressed ones
 	int GroupsStart, GroupsNum, LayersStart, LayersNum;
 	NewDataFile.GetType(MAPITEMTYPE_GROUP, &GroupsStart, &GroupsNum);
 	NewDataFile.GetType(MAPITEMTYPE_LAYER, &LayersStart, &LayersNum);
+
+	// Decompress the tile layers that are loaded in any case in parallel:
+	// the physics layers and the tile layers with skipped tiles
+	std::vector<int> vTileData;
+	for(int g = 0; g < GroupsNum; g++)
+	{
+		const CMapItemGroup *pGroup = static_cast<CMapItemGroup *>(NewDataFile.GetItem(GroupsStart + g));
+		for(int l = 0; l < pGroup->m_NumLayers; l++)
+		{
+			const int LayerIndex = LayersStart + pGroup->m_StartLayer + l;
+			const CMapItemLayer *pLayer = static_cast<CMapItemLayer *>(NewDataFile.GetItem(LayerIndex));
+			if(pLayer->m_Type != LAYERTYPE_TILES)
+				continue;
+			const CMapItemLayerTilemap *pTilemap = reinterpret_cast<const CMapItemLayerTilemap *>(pLayer);
+			if(pTilemap->m_Version >= CMapItemLayerTilemap::TILE_SKIP_MIN_VERSION || pTilemap->m_Flags & TILESLAYERFLAG_GAME)
+				vTileData.push_back(pTilemap->m_Data);
+			// older layers store the DDRace data elsewhere, they are left to load on demand
+			if(pTilemap->m_Version < 3 || NewDataFile.GetItemSize(LayerIndex) < (int)sizeof(CMapItemLayerTilemap))
+				continue;
+			if(pTilemap->m_Flags & TILESLAYERFLAG_TELE)
+				vTileData.push_back(pTilemap->m_Tele);
+			if(pTilemap->m_Flags & TILESLAYERFLAG_SPEEDUP)
+				vTileData.push_back(pTilemap->m_Speedup);
+			if(pTilemap->m_Flags & TILESLAYERFLAG_FRONT)
+				vTileData.push_back(pTilemap->m_Front);
+			if(pTilemap->m_Flags & TILESLAYERFLAG_SWITCH)
+				vTileData.push_back(pTilemap->m_Switch);
+			if(pTilemap->m_Flags & TILESLAYERFLAG_TUNE)
+				vTileData.push_back(pTilemap->m_Tune);
+		}
+	}
+	NewDataFile.LoadData(std::move(vTileData), Kernel()->RequestInterface<IEngine>());
+
+	// Replace compressed tile layers with uncompressed ones
 	for(int g = 0; g < GroupsNum; g++)
 	{
 		const CMapItemGroup *pGroup = static_cast<CMapItemGroup *>(NewDataFile.GetItem(GroupsStart + g));
@@ -136,6 +170,16 @@ IOHANDLE CMap::File() const
 	return m_DataFile.File();
 }
 
+const unsigned char *CMap::FileData() const
+{
+	return m_DataFile.FileData();
+}
+
+unsigned CMap::FileSize() const
+{
+	return m_DataFile.FileSize();
+}
+
 SHA256_DIGEST CMap::Sha256() const
 {
 	return m_DataFile.Sha256();
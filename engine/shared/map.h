@@ -35,6 +35,8 @@ public:
 	void Unload() override;
 	bool IsLoaded() const override;
 	IOHANDLE File() const override;
+	const unsigned char *FileData() const override;
+	unsigned FileSize() const override;
 
 	SHA256_DIGEST Sha256() const override;
 	unsigned Crc() const override;
@@ -0,0 +1,286 @@
+#include "mapindex.h"
+
+#include <base/log.h>
+
+#include <engine/shared/linereader.h>
+#include <engine/storage.h>
+
+#include <cinttypes>
+
+struct CMapIndexScanData
+{
+	CMapIndex *m_pIndex;
+	const char *m_pPath;
+	std::unordered_set<std::string> *m_pSeen;
+};
+
+// the client names downloaded maps after their hash once it checked it,
+// so these do not have to be hashed again when they are indexed
+static bool Sha256FromDownloadedMapName(const char *pPath, SHA256_DIGEST *pSha256)
+{
+	const char *pSuffix = str_endswith(pPath, ".map");
+	if(!pSuffix || !str_startswith(pPath, "downloadedmaps/") || pSuffix - pPath < SHA256_MAXSTRSIZE)
+		return false;
+	const char *pHash = pSuffix - (SHA256_MAXSTRSIZE - 1);
+	if(pHash[-1] != '_')
+		return false;
+	char aSha256[SHA256_MAXSTRSIZE];
+	str_copy(aSha256, pHash, sizeof(aSha256));
+	return sha256_from_str(pSha256, aSha256) == 0;
+}
+
+CMapIndex::CMapIndex(IStorage *pStorage, const char *pIndexFilename) :
+	m_pStorage(pStorage), m_pIndexFilename(pIndexFilename)
+{
+	m_Loaded = false;
+	m_Scanned = false;
+	m_NumScans = 0;
+}
+
+bool CMapIndex::Stat(int StorageType, const char *pPath, int64_t *pSize, time_t *pModified) const
+{
+	char aBuf[IO_MAX_PATH_LENGTH];
+	m_pStorage->GetCompletePath(StorageType, pPath, aBuf, sizeof(aBuf));
+	return fs_file_stat(aBuf, pSize, pModified) == 0;
+}
+
+void CMapIndex::SetEntry(const std::string &Path, const CEntry &Entry)
+{
+	auto It = m_Entries.find(Path);
+	if(It != m_Entries.end())
+	{
+		RemovePath(Path, It->second.m_Sha256);
+		It->second = Entry;
+	}
+	else
+	{
+		m_Entries.emplace(Path, Entry);
+	}
+	m_Paths.emplace(Entry.m_Sha256, Path);
+}
+
+void CMapIndex::RemovePath(const std::string &Path, const SHA256_DIGEST &Sha256)
+{
+	auto Range = m_Paths.equal_range(Sha256);
+	for(auto It = Range.first; It != Range.second; ++It)
+	{
+		if(It->second == Path)
+		{
+			m_Paths.erase(It);
+			return;
+		}
+	}
+}
+
+static void WriteEntry(IOHANDLE File, const std::string &Path, const CMapIndex::CEntry &Entry)
+{
+	// sha256 size modified storage_type path
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(Entry.m_Sha256, aSha256, sizeof(aSha256));
+	char aBuf[SHA256_MAXSTRSIZE + 64 + IO_MAX_PATH_LENGTH];
+	str_format(aBuf, sizeof(aBuf), "%s %" PRId64 " %" PRId64 " %d %s", aSha256, Entry.m_Size, (int64_t)Entry.m_Modified, Entry.m_StorageType, Path.c_str());
+	io_write(File, aBuf, str_length(aBuf));
+	io_write_newline(File);
+}
+
+void CMapIndex::Load()
+{
+	m_Loaded = true;
+
+	IOHANDLE File = m_pStorage->OpenFile(m_pIndexFilename, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(!File)
+		return;
+
+	CLineReader LineReader;
+	LineReader.Init(File);
+	const char *pLine;
+	while((pLine = LineReader.Get()))
+	{
+		char aSha256[SHA256_MAXSTRSIZE];
+		char aSize[32];
+		char aModified[32];
+		char aStorageType[16];
+		CEntry Entry;
+		if(!(pLine = str_next_token(pLine, " ", aSha256, sizeof(aSha256))) ||
+			!(pLine = str_next_token(pLine, " ", aSize, sizeof(aSize))) ||
+			!(pLine = str_next_token(pLine, " ", aModified, sizeof(aModified))) ||
+			!(pLine = str_next_token(pLine, " ", aStorageType, sizeof(aStorageType))) ||
+			pLine[0] != ' ' || !pLine[1] ||
+			sha256_from_str(&Entry.m_Sha256, aSha256))
+		{
+			continue;
+		}
+		Entry.m_Size = str_toint64_base(aSize);
+		Entry.m_Modified = (time_t)str_toint64_base(aModified);
+		Entry.m_StorageType = str_toint(aStorageType);
+		if(Entry.m_StorageType < IStorage::TYPE_SAVE || Entry.m_StorageType >= m_pStorage->NumPaths())
+			continue;
+		// later lines were appended for newer files and replace the earlier ones
+		SetEntry(pLine + 1, Entry);
+	}
+
+	io_close(File);
+}
+
+void CMapIndex::Save()
+{
+	char aTmpFilename[IO_MAX_PATH_LENGTH];
+	IStorage::FormatTmpPath(aTmpFilename, sizeof(aTmpFilename), m_pIndexFilename);
+	IOHANDLE File = m_pStorage->OpenFile(aTmpFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		log_error("mapindex", "failed to open '%s' for writing", aTmpFilename);
+		return;
+	}
+	for(const auto &[Path, Entry] : m_Entries)
+		WriteEntry(File, Path, Entry);
+	io_close(File);
+
+	if(m_pStorage->FileExists(m_pIndexFilename, IStorage::TYPE_SAVE))
+		m_pStorage->RemoveFile(m_pIndexFilename, IStorage::TYPE_SAVE);
+	if(!m_pStorage->RenameFile(aTmpFilename, m_pIndexFilename, IStorage::TYPE_SAVE))
+		log_error("mapindex", "failed to save '%s'", m_pIndexFilename);
+}
+
+void CMapIndex::AppendEntry(const std::string &Path, const CEntry &Entry)
+{
+	IOHANDLE File = m_pStorage->OpenFile(m_pIndexFilename, IOFLAG_APPEND, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		log_error("mapindex", "failed to open '%s' for appending", m_pIndexFilename);
+		return;
+	}
+	WriteEntry(File, Path, Entry);
+	io_close(File);
+}
+
+bool CMapIndex::FindValid(const SHA256_DIGEST &Sha256, char *pBuffer, int BufferSize)
+{
+	auto Range = m_Paths.equal_range(Sha256);
+	for(auto It = Range.first; It != Range.second;)
+	{
+		const CEntry &Entry = m_Entries.at(It->second);
+		int64_t Size;
+		time_t Modified;
+		if(Stat(Entry.m_StorageType, It->second.c_str(), &Size, &Modified) && Size == Entry.m_Size && Modified == Entry.m_Modified)
+		{
+			str_copy(pBuffer, It->second.c_str(), BufferSize);
+			return true;
+		}
+		// the file changed or is gone, a scan looks at it again
+		m_Entries.erase(It->second);
+		It = m_Paths.erase(It);
+	}
+	return false;
+}
+
+int CMapIndex::ScanCallback(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	CMapIndexScanData *pData = static_cast<CMapIndexScanData *>(pUser);
+	if(pName[0] == '.')
+		return 0;
+
+	char aPath[IO_MAX_PATH_LENGTH];
+	str_format(aPath, sizeof(aPath), "%s/%s", pData->m_pPath, pName);
+	if(IsDir)
+	{
+		pData->m_pIndex->ScanFolder(StorageType, aPath, *pData->m_pSeen);
+		return 0;
+	}
+	// files are opened with TYPE_ALL, a map in an earlier storage path hides this one
+	if(!str_endswith(pName, ".map") || !pData->m_pSeen->insert(aPath).second)
+		return 0;
+
+	CMapIndex *pIndex = pData->m_pIndex;
+	CEntry Entry;
+	Entry.m_StorageType = StorageType;
+	if(!pIndex->Stat(StorageType, aPath, &Entry.m_Size, &Entry.m_Modified))
+		return 0;
+	auto It = pIndex->m_Entries.find(aPath);
+	if(It != pIndex->m_Entries.end() && It->second.m_StorageType == StorageType && It->second.m_Size == Entry.m_Size && It->second.m_Modified == Entry.m_Modified)
+		return 0;
+	if(!Sha256FromDownloadedMapName(aPath, &Entry.m_Sha256) && !pIndex->m_pStorage->CalculateHashes(aPath, StorageType, &Entry.m_Sha256))
+		return 0;
+	pIndex->SetEntry(aPath, Entry);
+	return 0;
+}
+
+void CMapIndex::ScanFolder(int StorageType, const char *pPath, std::unordered_set<std::string> &Seen)
+{
+	CMapIndexScanData Data;
+	Data.m_pIndex = this;
+	Data.m_pPath = pPath;
+	Data.m_pSeen = &Seen;
+	char aBuf[IO_MAX_PATH_LENGTH];
+	m_pStorage->GetCompletePath(StorageType, pPath, aBuf, sizeof(aBuf));
+	fs_listdir(aBuf, ScanCallback, StorageType, &Data);
+}
+
+void CMapIndex::Scan()
+{
+	m_Scanned = true;
+	m_NumScans++;
+
+	std::unordered_set<std::string> Seen;
+	for(int StorageType = IStorage::TYPE_SAVE; StorageType < m_pStorage->NumPaths(); StorageType++)
+	{
+		ScanFolder(StorageType, "maps", Seen);
+		ScanFolder(StorageType, "downloadedmaps", Seen);
+	}
+
+	for(auto It = m_Entries.begin(); It != m_Entries.end();)
+	{
+		if(Seen.count(It->first))
+		{
+			++It;
+			continue;
+		}
+		RemovePath(It->first, It->second.m_Sha256);
+		It = m_Entries.erase(It);
+	}
+
+	Save();
+}
+
+bool CMapIndex::Find(const SHA256_DIGEST &Sha256, char *pBuffer, int BufferSize)
+{
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	if(!m_Loaded)
+		Load();
+	if(FindValid(Sha256, pBuffer, BufferSize))
+		return true;
+
+	// maps that were added while the client is running are added with Add,
+	// the folders are only walked once per session
+	if(m_Scanned)
+		return false;
+	Scan();
+	return FindValid(Sha256, pBuffer, BufferSize);
+}
+
+void CMapIndex::Add(const char *pFilename, const SHA256_DIGEST &Sha256)
+{
+	if(!str_endswith(pFilename, ".map") || (!str_startswith(pFilename, "maps/") && !str_startswith(pFilename, "downloadedmaps/")))
+		return;
+
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	for(int StorageType = IStorage::TYPE_SAVE; StorageType < m_pStorage->NumPaths(); StorageType++)
+	{
+		CEntry Entry;
+		Entry.m_StorageType = StorageType;
+		Entry.m_Sha256 = Sha256;
+		if(!Stat(StorageType, pFilename, &Entry.m_Size, &Entry.m_Modified))
+			continue;
+
+		// if the index is not loaded yet, the appended line is picked up when it is
+		if(m_Loaded)
+		{
+			auto It = m_Entries.find(pFilename);
+			if(It != m_Entries.end() && It->second.m_StorageType == StorageType && It->second.m_Sha256 == Sha256 && It->second.m_Size == Entry.m_Size && It->second.m_Modified == Entry.m_Modified)
+				return;
+			SetEntry(pFilename, Entry);
+		}
+		AppendEntry(pFilename, Entry);
+		return;
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef ENGINE_SHARED_MAPINDEX_H
+#define ENGINE_SHARED_MAPINDEX_H
+
+#include <base/hash.h>
+#include <base/system.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+class IStorage;
+
+// Persistent index of the maps in the maps and downloadedmaps folders of all
+// storage paths, so a map can be found by its SHA256 without walking the
+// folders and hashing every candidate. The index is only loaded and the folders
+// are only scanned once a lookup needs it. Entries are validated by the size and
+// the modification time of the file before they are returned.
+class CMapIndex
+{
+public:
+	struct CEntry
+	{
+		int m_StorageType;
+		SHA256_DIGEST m_Sha256;
+		int64_t m_Size;
+		time_t m_Modified;
+	};
+
+private:
+	struct CSha256Hash
+	{
+		size_t operator()(const SHA256_DIGEST &Sha256) const
+		{
+			size_t Hash;
+			mem_copy(&Hash, Sha256.data, sizeof(Hash));
+			return Hash;
+		}
+	};
+
+	IStorage *m_pStorage;
+	const char *m_pIndexFilename;
+
+	std::mutex m_Mutex;
+	bool m_Loaded;
+	bool m_Scanned;
+	int m_NumScans;
+	// relative path usable with TYPE_ALL -> entry
+	std::unordered_map<std::string, CEntry> m_Entries;
+	std::unordered_multimap<SHA256_DIGEST, std::string, CSha256Hash> m_Paths;
+
+	void Load();
+	void Save();
+	void AppendEntry(const std::string &Path, const CEntry &Entry);
+	void SetEntry(const std::string &Path, const CEntry &Entry);
+	void RemovePath(const std::string &Path, const SHA256_DIGEST &Sha256);
+	bool FindValid(const SHA256_DIGEST &Sha256, char *pBuffer, int BufferSize);
+	bool Stat(int StorageType, const char *pPath, int64_t *pSize, time_t *pModified) const;
+	void Scan();
+	void ScanFolder(int StorageType, const char *pPath, std::unordered_set<std::string> &Seen);
+	static int ScanCallback(const char *pName, int IsDir, int StorageType, void *pUser);
+
+public:
+	CMapIndex(IStorage *pStorage, const char *pIndexFilename = "mapindex.txt");
+
+	bool Find(const SHA256_DIGEST &Sha256, char *pBuffer, int BufferSize);
+	void Add(const char *pFilename, const SHA256_DIGEST &Sha256);
+
+	int NumScans() const { return m_NumScans; }
+};
+
+#endif
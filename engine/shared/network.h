@@ -383,8 +383,21 @@ class CNetServer
 
 	CSpamConn m_aSpamConns[NET_CONNLIMIT_IPS];
 
+	// slots chained by a hash of their peer address without the port, so
+	// packets find their slot without a scan over all of them
+	enum
+	{
+		SLOT_HASH_SIZE = 128, // power of two, twice NET_MAX_CLIENTS
+	};
+	int m_aSlotHashHead[SLOT_HASH_SIZE];
+	int m_aSlotHashNext[NET_MAX_CLIENTS];
+	int m_aSlotHashBucket[NET_MAX_CLIENTS]; // -1 if the slot isn't indexed
+
 	CNetRecvUnpacker m_RecvUnpacker;
 
+	static unsigned SlotHash(const NETADDR &Addr);
+	void UpdateSlotIndex(int Slot);
+
 	void OnTokenCtrlMsg(NETADDR &Addr, int ControlMsg, const CNetPacketConstruct &Packet);
 	int OnSixupCtrlMsg(NETADDR &Addr, CNetChunk *pChunk, int ControlMsg, const CNetPacketConstruct &Packet, SECURITY_TOKEN &ResponseToken, SECURITY_TOKEN Token);
 	void OnPreConnMsg(NETADDR &Addr, CNetPacketConstruct &Packet);
@@ -411,6 +424,10 @@ public:
 	int Send(CNetChunk *pChunk);
 	int Update();
 
+	// queue outgoing packets until FlushSendQueue to save syscalls
+	void SetSendBatching(bool Batch) { net_udp_set_send_batching(m_Socket, Batch); }
+	int FlushSendQueue() { return net_udp_flush(m_Socket); }
+
 	//
 	int Drop(int ClientID, const char *pReason);
 
@@ -69,9 +69,46 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 	for(auto &Slot : m_aSlots)
 		Slot.m_Connection.Init(m_Socket, true);
 
+	for(int &Head : m_aSlotHashHead)
+		Head = -1;
+	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+	{
+		m_aSlotHashNext[i] = -1;
+		m_aSlotHashBucket[i] = -1;
+	}
+
 	return true;
 }
 
+unsigned CNetServer::SlotHash(const NETADDR &Addr)
+{
+	// fnv-1a over the type and the ip, the port is left out so all
+	// connections from one ip share a bucket
+	unsigned Hash = 2166136261u;
+	Hash = (Hash ^ (unsigned)Addr.type) * 16777619u;
+	for(unsigned char Byte : Addr.ip)
+		Hash = (Hash ^ Byte) * 16777619u;
+	return Hash & (SLOT_HASH_SIZE - 1);
+}
+
+// must be called whenever the peer address of a slot changes
+void CNetServer::UpdateSlotIndex(int Slot)
+{
+	// unlink from the old bucket
+	if(m_aSlotHashBucket[Slot] != -1)
+	{
+		int *pLink = &m_aSlotHashHead[m_aSlotHashBucket[Slot]];
+		while(*pLink != Slot)
+			pLink = &m_aSlotHashNext[*pLink];
+		*pLink = m_aSlotHashNext[Slot];
+	}
+
+	const int Bucket = SlotHash(*m_aSlots[Slot].m_Connection.PeerAddress());
+	m_aSlotHashBucket[Slot] = Bucket;
+	m_aSlotHashNext[Slot] = m_aSlotHashHead[Bucket];
+	m_aSlotHashHead[Bucket] = Slot;
+}
+
 int CNetServer::SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_DELCLIENT pfnDelClient, void *pUser)
 {
 	m_pfnNewClient = pfnNewClient;
@@ -154,7 +191,7 @@ void CNetServer::SendControl(NETADDR &Addr, int ControlMsg, const void *pExtra,
 int CNetServer::NumClientsWithAddr(NETADDR Addr)
 {
 	int FoundAddr = 0;
-	for(int i = 0; i < MaxClients(); ++i)
+	for(int i = m_aSlotHashHead[SlotHash(Addr)]; i != -1; i = m_aSlotHashNext[i])
 	{
 		if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE ||
 			(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_ERROR &&
@@ -247,6 +284,7 @@ int CNetServer::TryAcceptClient(NETADDR &Addr, SECURITY_TOKEN SecurityToken, boo
 
 	// init connection slot
 	m_aSlots[Slot].m_Connection.DirectInit(Addr, SecurityToken, Token, Sixup);
+	UpdateSlotIndex(Slot);
 
 	if(VanillaAuth)
 	{
@@ -580,12 +618,13 @@ int CNetServer::GetClientSlot(const NETADDR &Addr)
 {
 	int Slot = -1;
 
-	for(int i = 0; i < MaxClients(); i++)
+	// prefer the highest slot like the linear scan did
+	for(int i = m_aSlotHashHead[SlotHash(Addr)]; i != -1; i = m_aSlotHashNext[i])
 	{
-		if(m_aSlots[i].m_Connection.State() != NET_CONNSTATE_OFFLINE &&
+		if(i > Slot &&
+			m_aSlots[i].m_Connection.State() != NET_CONNSTATE_OFFLINE &&
 			m_aSlots[i].m_Connection.State() != NET_CONNSTATE_ERROR &&
 			net_addr_comp(m_aSlots[i].m_Connection.PeerAddress(), &Addr) == 0)
-
 		{
 			Slot = i;
 		}
@@ -802,6 +841,8 @@ bool CNetServer::SetTimedOut(int ClientID, int OrigID)
 
 	m_aSlots[ClientID].m_Connection.SetTimedOut(ClientAddr(OrigID), m_aSlots[OrigID].m_Connection.SeqSequence(), m_aSlots[OrigID].m_Connection.AckSequence(), m_aSlots[OrigID].m_Connection.SecurityToken(), m_aSlots[OrigID].m_Connection.ResendBuffer(), m_aSlots[OrigID].m_Connection.m_Sixup);
 	m_aSlots[OrigID].m_Connection.Reset();
+	UpdateSlotIndex(ClientID);
+	UpdateSlotIndex(OrigID);
 	return true;
 }
 
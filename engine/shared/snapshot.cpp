@@ -150,109 +150,115 @@ bool CSnapshot::IsValid(size_t ActualSize) const
 
 enum
 {
-	HASHLIST_SIZE = 256,
-	HASHLIST_BUCKET_SIZE = 64,
+	// twice CSnapshot::MAX_ITEMS, so the table is at most half full and
+	// probe sequences stay short
+	HASHLIST_BITS = 11,
+	HASHLIST_SIZE = 1 << HASHLIST_BITS,
 };
+static_assert(HASHLIST_SIZE >= 2 * CSnapshot::MAX_ITEMS, "the item hash table must stay at most half full");
 
-struct CItemList
+// open addressing hash from item keys to the index of their first item
+struct CItemHashlist
 {
-	int m_Num;
-	int m_aKeys[HASHLIST_BUCKET_SIZE];
-	int m_aIndex[HASHLIST_BUCKET_SIZE];
+	int m_aKeys[HASHLIST_SIZE];
+	int m_aIndex[HASHLIST_SIZE]; // -1 for free slots
 };
 
-inline size_t CalcHashID(int Key)
+static inline unsigned CalcHashID(int Key)
 {
-	// djb2 (http://www.cse.yorku.ca/~oz/hash.html)
-	unsigned Hash = 5381;
-	for(unsigned Shift = 0; Shift < sizeof(int); Shift++)
-		Hash = ((Hash << 5) + Hash) + ((Key >> (Shift * 8)) & 0xFF);
-	return Hash % HASHLIST_SIZE;
+	// fibonacci hashing, the high bits of the product are well mixed
+	return ((unsigned)Key * 2654435761u) >> (32 - HASHLIST_BITS);
 }
 
-static void GenerateHash(CItemList *pHashlist, const CSnapshot *pSnapshot)
+// slot of the key, or the free slot where it would be inserted
+static inline unsigned FindHashSlot(const CItemHashlist *pHashlist, int Key)
 {
-	for(int i = 0; i < HASHLIST_SIZE; i++)
-		pHashlist[i].m_Num = 0;
+	unsigned Slot = CalcHashID(Key);
+	while(pHashlist->m_aIndex[Slot] != -1 && pHashlist->m_aKeys[Slot] != Key)
+		Slot = (Slot + 1) & (HASHLIST_SIZE - 1);
+	return Slot;
+}
 
-	for(int i = 0; i < pSnapshot->NumItems(); i++)
-	{
-		int Key = pSnapshot->GetItem(i)->Key();
-		size_t HashID = CalcHashID(Key);
-		if(pHashlist[HashID].m_Num < HASHLIST_BUCKET_SIZE)
-		{
-			pHashlist[HashID].m_aIndex[pHashlist[HashID].m_Num] = i;
-			pHashlist[HashID].m_aKeys[pHashlist[HashID].m_Num] = Key;
-			pHashlist[HashID].m_Num++;
-		}
-	}
+static void ClearHash(CItemHashlist *pHashlist)
+{
+	for(int &Index : pHashlist->m_aIndex)
+		Index = -1;
 }
 
-static int GetItemIndexHashed(int Key, const CItemList *pHashlist)
+// returns the slot of the key, keeps the first index for duplicate keys
+static inline unsigned AddHashKey(CItemHashlist *pHashlist, int Key, int Index)
 {
-	size_t HashID = CalcHashID(Key);
-	for(int i = 0; i < pHashlist[HashID].m_Num; i++)
+	const unsigned Slot = FindHashSlot(pHashlist, Key);
+	if(pHashlist->m_aIndex[Slot] == -1)
 	{
-		if(pHashlist[HashID].m_aKeys[i] == Key)
-			return pHashlist[HashID].m_aIndex[i];
+		pHashlist->m_aKeys[Slot] = Key;
+		pHashlist->m_aIndex[Slot] = Index;
 	}
+	return Slot;
+}
 
-	return -1;
+static inline int GetItemIndexHashed(int Key, const CItemHashlist *pHashlist)
+{
+	return pHashlist->m_aIndex[FindHashSlot(pHashlist, Key)];
 }
 
+// the loops below are kept branch-free so the compiler can vectorize them
 int CSnapshotDelta::DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size)
 {
-	int Needed = 0;
-	while(Size)
+	unsigned Needed = 0;
+	for(int i = 0; i < Size; i++)
 	{
 		// subtraction with wrapping by casting to unsigned
-		*pOut = (unsigned)*pCurrent - (unsigned)*pPast;
-		Needed |= *pOut;
-		pOut++;
-		pPast++;
-		pCurrent++;
-		Size--;
+		const unsigned Diff = (unsigned)pCurrent[i] - (unsigned)pPast[i];
+		pOut[i] = (int)Diff;
+		Needed |= Diff;
 	}
 
-	return Needed;
+	return (int)Needed;
 }
 
-void CSnapshotDelta::UndiffItem(const int *pPast, const int *pDiff, int *pOut, int Size, int *pDataRate)
+int CSnapshotDelta::UndiffItem(const int *pPast, const int *pDiff, int *pOut, int Size)
 {
-	while(Size)
+	int DataRate = 0;
+	for(int i = 0; i < Size; i++)
 	{
 		// addition with wrapping by casting to unsigned
-		*pOut = (unsigned)*pPast + (unsigned)*pDiff;
-
-		if(*pDiff == 0)
-			*pDataRate += 1;
-		else
-		{
-			unsigned char aBuf[CVariableInt::MAX_BYTES_PACKED];
-			unsigned char *pEnd = CVariableInt::Pack(aBuf, *pDiff, sizeof(aBuf));
-			*pDataRate += (int)(pEnd - (unsigned char *)aBuf) * 8;
-		}
+		pOut[i] = (int)((unsigned)pPast[i] + (unsigned)pDiff[i]);
 
-		pOut++;
-		pPast++;
-		pDiff++;
-		Size--;
+		// a zero costs one bit, everything else the bits of its packed size, see CVariableInt::Pack
+		const unsigned Value = (unsigned)(pDiff[i] ^ (pDiff[i] >> 31));
+		const int PackedBytes = 1 + (Value >= (1u << 6)) + (Value >= (1u << 13)) + (Value >= (1u << 20)) + (Value >= (1u << 27));
+		DataRate += pDiff[i] == 0 ? 1 : PackedBytes * 8;
 	}
+	return DataRate;
+}
+
+void CSnapshotDelta::AddDataRate(int Type, int DataRate)
+{
+	// there is only one writer, so no atomic read-modify-write is needed
+	m_aSnapshotDataRate[Type].store(m_aSnapshotDataRate[Type].load(std::memory_order_relaxed) + DataRate, std::memory_order_relaxed);
+	m_aSnapshotDataUpdates[Type].store(m_aSnapshotDataUpdates[Type].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
 }
 
 CSnapshotDelta::CSnapshotDelta()
 {
 	mem_zero(m_aItemSizes, sizeof(m_aItemSizes));
-	mem_zero(m_aSnapshotDataRate, sizeof(m_aSnapshotDataRate));
-	mem_zero(m_aSnapshotDataUpdates, sizeof(m_aSnapshotDataUpdates));
+	for(int i = 0; i <= CSnapshot::MAX_TYPE; i++)
+	{
+		m_aSnapshotDataRate[i].store(0, std::memory_order_relaxed);
+		m_aSnapshotDataUpdates[i].store(0, std::memory_order_relaxed);
+	}
 	mem_zero(&m_Empty, sizeof(m_Empty));
 }
 
 CSnapshotDelta::CSnapshotDelta(const CSnapshotDelta &Old)
 {
 	mem_copy(m_aItemSizes, Old.m_aItemSizes, sizeof(m_aItemSizes));
-	mem_copy(m_aSnapshotDataRate, Old.m_aSnapshotDataRate, sizeof(m_aSnapshotDataRate));
-	mem_copy(m_aSnapshotDataUpdates, Old.m_aSnapshotDataUpdates, sizeof(m_aSnapshotDataUpdates));
+	for(int i = 0; i <= CSnapshot::MAX_TYPE; i++)
+	{
+		m_aSnapshotDataRate[i].store(Old.GetDataRate(i), std::memory_order_relaxed);
+		m_aSnapshotDataUpdates[i].store(Old.GetDataUpdates(i), std::memory_order_relaxed);
+	}
 	mem_zero(&m_Empty, sizeof(m_Empty));
 }
 
@@ -268,8 +274,7 @@ const CSnapshotDelta::CData *CSnapshotDelta::EmptyDelta() const
 	return &m_Empty;
 }
 
-// TODO: OPT: this should be made much faster
-int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, CSnapshot *pTo, void *pDstData)
+int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, CSnapshot *pTo, void *pDstData) const
 {
 	CData *pDelta = (CData *)pDstData;
 	int *pData = (int *)pDelta->m_aData;
@@ -278,34 +283,37 @@ int CSnapshotDelta::CreateDelta(const CSnapshot *pFrom, CSnapshot *pTo, void *pD
 	pDelta->m_NumUpdateItems = 0;
 	pDelta->m_NumTempItems = 0;
 
-	CItemList aHashlist[HASHLIST_SIZE];
-	GenerateHash(aHashlist, pTo);
+	// index the old snapshot once, the lookups of the new items then tell
+	// both the past index of every item and which old keys are still used
+	dbg_assert(pFrom->NumItems() <= CSnapshot::MAX_ITEMS && pTo->NumItems() <= CSnapshot::MAX_ITEMS, "too many items");
+	CItemHashlist Hashlist;
+	ClearHash(&Hashlist);
+	const int NumFromItems = pFrom->NumItems();
+	unsigned aFromSlots[CSnapshot::MAX_ITEMS];
+	for(int i = 0; i < NumFromItems; i++)
+		aFromSlots[i] = AddHashKey(&Hashlist, pFrom->GetItem(i)->Key(), i);
+
+	bool aSlotUsed[HASHLIST_SIZE] = {false};
+	int aPastIndices[CSnapshot::MAX_ITEMS];
+	const int NumItems = pTo->NumItems();
+	for(int i = 0; i < NumItems; i++)
+	{
+		const unsigned Slot = FindHashSlot(&Hashlist, pTo->GetItem(i)->Key());
+		aPastIndices[i] = Hashlist.m_aIndex[Slot];
+		aSlotUsed[Slot] = true;
+	}
 
 	// pack deleted stuff
-	for(int i = 0; i < pFrom->NumItems(); i++)
+	for(int i = 0; i < NumFromItems; i++)
 	{
-		const CSnapshotItem *pFromItem = pFrom->GetItem(i);
-		if(GetItemIndexHashed(pFromItem->Key(), aHashlist) == -1)
+		if(!aSlotUsed[aFromSlots[i]])
 		{
-			// deleted
 			pDelta->m_NumDeletedItems++;
-			*pData = pFromItem->Key();
+			*pData = pFrom->GetItem(i)->Key();
 			pData++;
 		}
 	}
 
-	GenerateHash(aHashlist, pFrom);
-
-	// fetch previous indices
-	// we do this as a separate pass because it helps the cache
-	int aPastIndices[CSnapshot::MAX_ITEMS];
-	const int NumItems = pTo->NumItems();
-	for(int i = 0; i < NumItems; i++)
-	{
-		const CSnapshotItem *pCurItem = pTo->GetItem(i); // O(1) .. O(n)
-		aPastIndices[i] = GetItemIndexHashed(pCurItem->Key(), aHashlist); // O(n) .. O(n^n)
-	}
-
 	for(int i = 0; i < NumItems; i++)
 	{
 		// do delta
@@ -376,23 +384,34 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 	if(pData > pEnd)
 		return -101;
 
+	// index the deleted keys and the keys of the old snapshot
+	if(pDelta->m_NumDeletedItems > CSnapshot::MAX_ITEMS || pFrom->NumItems() > CSnapshot::MAX_ITEMS)
+		return -206;
+	CItemHashlist DeletedHashlist;
+	ClearHash(&DeletedHashlist);
+	for(int d = 0; d < pDelta->m_NumDeletedItems; d++)
+		AddHashKey(&DeletedHashlist, pDeleted[d], d);
+
+	CItemHashlist FromHashlist;
+	ClearHash(&FromHashlist);
+	const int NumFromItems = pFrom->NumItems();
+	for(int i = 0; i < NumFromItems; i++)
+		AddHashKey(&FromHashlist, pFrom->GetItem(i)->Key(), i);
+
+	// builder index of every kept item of the old snapshot
+	int aKeptIndices[CSnapshot::MAX_ITEMS];
+
 	// copy all non deleted stuff
-	for(int i = 0; i < pFrom->NumItems(); i++)
+	for(int i = 0; i < NumFromItems; i++)
 	{
 		const CSnapshotItem *pFromItem = pFrom->GetItem(i);
 		const int ItemSize = pFrom->GetItemSize(i);
-		bool Keep = true;
-		for(int d = 0; d < pDelta->m_NumDeletedItems; d++)
-		{
-			if(pDeleted[d] == pFromItem->Key())
-			{
-				Keep = false;
-				break;
-			}
-		}
+		const bool Keep = GetItemIndexHashed(pFromItem->Key(), &DeletedHashlist) == -1;
 
+		aKeptIndices[i] = -1;
 		if(Keep)
 		{
+			aKeptIndices[i] = Builder.NumItems();
 			void *pObj = Builder.NewItem(pFromItem->Type(), pFromItem->ID(), ItemSize);
 			if(!pObj)
 				return -301;
@@ -434,25 +453,28 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 		const int Key = (Type << 16) | ID;
 
 		// create the item if needed
-		int *pNewData = Builder.GetItemData(Key);
+		const int FromIndex = GetItemIndexHashed(Key, &FromHashlist);
+		int *pNewData;
+		if(FromIndex != -1 && aKeptIndices[FromIndex] != -1)
+			pNewData = Builder.GetItem(aKeptIndices[FromIndex])->Data();
+		else
+			pNewData = Builder.GetItemData(Key);
 		if(!pNewData)
 			pNewData = (int *)Builder.NewItem(Type, ID, ItemSize);
 
 		if(!pNewData)
 			return -302;
 
-		const int FromIndex = pFrom->GetItemIndex(Key);
 		if(FromIndex != -1)
 		{
 			// we got an update so we need to apply the diff
-			UndiffItem(pFrom->GetItem(FromIndex)->Data(), pData, pNewData, ItemSize / sizeof(int32_t), &m_aSnapshotDataRate[Type]);
+			AddDataRate(Type, UndiffItem(pFrom->GetItem(FromIndex)->Data(), pData, pNewData, ItemSize / sizeof(int32_t)));
 		}
 		else // no previous, just copy the pData
 		{
 			mem_copy(pNewData, pData, ItemSize);
-			m_aSnapshotDataRate[Type] += ItemSize * 8;
+			AddDataRate(Type, ItemSize * 8);
 		}
-		m_aSnapshotDataUpdates[Type]++;
 
 		pData += ItemSize / sizeof(int32_t);
 	}
@@ -463,10 +485,32 @@ int CSnapshotDelta::UnpackDelta(const CSnapshot *pFrom, CSnapshot *pTo, const vo
 
 // CSnapshotStorage
 
+CSnapshotStorage::~CSnapshotStorage()
+{
+	PurgeAll();
+}
+
 void CSnapshotStorage::Init()
 {
-	m_pFirst = 0;
-	m_pLast = 0;
+	PurgeAll();
+}
+
+void CSnapshotStorage::Free(CHolder *pHolder)
+{
+	if(pHolder->m_Indexed)
+		m_apIndex[pHolder->m_Tick & (INDEX_SIZE - 1)] = nullptr;
+	else
+		m_NumUnindexed--;
+
+	if(m_NumSpare < MAX_SPARE)
+	{
+		// keep the memory for one of the next snapshots
+		pHolder->m_pNext = m_pSpare;
+		m_pSpare = pHolder;
+		m_NumSpare++;
+	}
+	else
+		free(pHolder);
 }
 
 void CSnapshotStorage::PurgeAll()
@@ -476,13 +520,21 @@ void CSnapshotStorage::PurgeAll()
 	while(pHolder)
 	{
 		CHolder *pNext = pHolder->m_pNext;
-		free(pHolder);
+		Free(pHolder);
 		pHolder = pNext;
 	}
 
 	// no more snapshots in storage
 	m_pFirst = 0;
 	m_pLast = 0;
+
+	while(m_pSpare)
+	{
+		CHolder *pNext = m_pSpare->m_pNext;
+		free(m_pSpare);
+		m_pSpare = pNext;
+	}
+	m_NumSpare = 0;
 }
 
 void CSnapshotStorage::PurgeUntil(int Tick)
@@ -494,7 +546,7 @@ void CSnapshotStorage::PurgeUntil(int Tick)
 		CHolder *pNext = pHolder->m_pNext;
 		if(pHolder->m_Tick >= Tick)
 			return; // no more to remove
-		free(pHolder);
+		Free(pHolder);
 
 		// did we come to the end of the list?
 		if(!pNext)
@@ -513,15 +565,38 @@ void CSnapshotStorage::PurgeUntil(int Tick)
 
 void CSnapshotStorage::Add(int Tick, int64_t Tagtime, int DataSize, const void *pData, int AltDataSize, const void *pAltData)
 {
-	// allocate memory for holder + snapshot_data
-	int TotalSize = sizeof(CHolder) + DataSize;
+	// memory for snapshot_data
+	int TotalSize = DataSize;
 
 	if(AltDataSize > 0)
 	{
 		TotalSize += AltDataSize;
 	}
 
-	CHolder *pHolder = (CHolder *)malloc(TotalSize);
+	CHolder *pHolder = m_pSpare;
+	if(pHolder)
+	{
+		m_pSpare = pHolder->m_pNext;
+		m_NumSpare--;
+	}
+	if(!pHolder || pHolder->m_DataCapacity < TotalSize)
+	{
+		// round up so slowly growing snapshots don't reallocate every time
+		const int Capacity = (TotalSize + 4095) & ~4095;
+		free(pHolder);
+		pHolder = (CHolder *)malloc(sizeof(CHolder) + Capacity);
+		pHolder->m_DataCapacity = Capacity;
+	}
+
+	CHolder *&pSlot = m_apIndex[Tick & (INDEX_SIZE - 1)];
+	if(pSlot)
+	{
+		// the slot still holds a snapshot from INDEX_SIZE ticks ago
+		pSlot->m_Indexed = false;
+		m_NumUnindexed++;
+	}
+	pSlot = pHolder;
+	pHolder->m_Indexed = true;
 
 	// set data
 	pHolder->m_Tick = Tick;
@@ -554,25 +629,35 @@ void CSnapshotStorage::Add(int Tick, int64_t Tagtime, int DataSize, const void *
 
 int CSnapshotStorage::Get(int Tick, int64_t *pTagtime, const CSnapshot **ppData, const CSnapshot **ppAltData)
 {
-	CHolder *pHolder = m_pFirst;
-
-	while(pHolder)
+	CHolder *pHolder = m_apIndex[Tick & (INDEX_SIZE - 1)];
+	if(!pHolder || pHolder->m_Tick != Tick)
 	{
-		if(pHolder->m_Tick == Tick)
+		pHolder = nullptr;
+
+		// only snapshots that are not in the index need a search
+		if(m_NumUnindexed > 0)
 		{
-			if(pTagtime)
-				*pTagtime = pHolder->m_Tagtime;
-			if(ppData)
-				*ppData = pHolder->m_pSnap;
-			if(ppAltData)
-				*ppAltData = pHolder->m_pAltSnap;
-			return pHolder->m_SnapSize;
+			for(CHolder *pOther = m_pFirst; pOther; pOther = pOther->m_pNext)
+			{
+				if(pOther->m_Tick == Tick)
+				{
+					pHolder = pOther;
+					break;
+				}
+			}
 		}
-
-		pHolder = pHolder->m_pNext;
 	}
 
-	return -1;
+	if(!pHolder)
+		return -1;
+
+	if(pTagtime)
+		*pTagtime = pHolder->m_Tagtime;
+	if(ppData)
+		*ppData = pHolder->m_pSnap;
+	if(ppAltData)
+		*ppAltData = pHolder->m_pAltSnap;
+	return pHolder->m_SnapSize;
 }
 
 // CSnapshotBuilder
@@ -698,3 +783,43 @@ void *CSnapshotBuilder::NewItem(int Type, int ID, int Size)
 
 	return pObj->Data();
 }
+
+// CSnapItemBuffer
+
+void CSnapItemBuffer::Clear()
+{
+	m_NumItems = 0;
+	m_DataSize = 0;
+}
+
+void CSnapItemBuffer::Truncate(int NumItems)
+{
+	dbg_assert(0 <= NumItems && NumItems <= m_NumItems, "invalid item count");
+	if(NumItems < m_NumItems)
+		m_DataSize = m_aItems[NumItems].m_Offset;
+	m_NumItems = NumItems;
+}
+
+void *CSnapItemBuffer::NewItem(int Type, int ID, int Size)
+{
+	if(ID == -1 || Size < 0)
+	{
+		return nullptr;
+	}
+
+	if(m_DataSize + Size > (int)sizeof(m_aData) || m_NumItems >= CSnapshot::MAX_ITEMS)
+	{
+		return nullptr;
+	}
+
+	CItem *pItem = &m_aItems[m_NumItems++];
+	pItem->m_Type = Type;
+	pItem->m_ID = ID;
+	pItem->m_Size = Size;
+	pItem->m_Offset = m_DataSize;
+	m_DataSize += (Size + sizeof(int) - 1) / sizeof(int) * sizeof(int);
+
+	void *pData = (char *)m_aData + pItem->m_Offset;
+	mem_zero(pData, Size);
+	return pData;
+}
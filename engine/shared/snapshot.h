@@ -3,6 +3,7 @@
 #ifndef ENGINE_SHARED_SNAPSHOT_H
 #define ENGINE_SHARED_SNAPSHOT_H
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 
@@ -11,6 +12,7 @@
 class CSnapshotItem
 {
 	friend class CSnapshotBuilder;
+	friend class CSnapshotDelta;
 
 	int *Data() { return (int *)(this + 1); }
 
@@ -83,21 +85,23 @@ private:
 		MAX_NETOBJSIZES = 64
 	};
 	short m_aItemSizes[MAX_NETOBJSIZES];
-	int m_aSnapshotDataRate[CSnapshot::MAX_TYPE + 1];
-	int m_aSnapshotDataUpdates[CSnapshot::MAX_TYPE + 1];
+	// only written by UnpackDelta, but can be read from other threads
+	std::atomic<int> m_aSnapshotDataRate[CSnapshot::MAX_TYPE + 1];
+	std::atomic<int> m_aSnapshotDataUpdates[CSnapshot::MAX_TYPE + 1];
 	CData m_Empty;
 
-	static void UndiffItem(const int *pPast, const int *pDiff, int *pOut, int Size, int *pDataRate);
+	static int UndiffItem(const int *pPast, const int *pDiff, int *pOut, int Size);
+	void AddDataRate(int Type, int DataRate);
 
 public:
 	static int DiffItem(const int *pPast, const int *pCurrent, int *pOut, int Size);
 	CSnapshotDelta();
 	CSnapshotDelta(const CSnapshotDelta &Old);
-	int GetDataRate(int Index) const { return m_aSnapshotDataRate[Index]; }
-	int GetDataUpdates(int Index) const { return m_aSnapshotDataUpdates[Index]; }
+	int GetDataRate(int Index) const { return m_aSnapshotDataRate[Index].load(std::memory_order_relaxed); }
+	int GetDataUpdates(int Index) const { return m_aSnapshotDataUpdates[Index].load(std::memory_order_relaxed); }
 	void SetStaticsize(int ItemType, int Size);
 	const CData *EmptyDelta() const;
-	int CreateDelta(const class CSnapshot *pFrom, class CSnapshot *pTo, void *pDstData);
+	int CreateDelta(const class CSnapshot *pFrom, class CSnapshot *pTo, void *pDstData) const;
 	int UnpackDelta(const class CSnapshot *pFrom, class CSnapshot *pTo, const void *pSrcData, int DataSize);
 };
 
@@ -120,18 +124,48 @@ public:
 
 		CSnapshot *m_pSnap;
 		CSnapshot *m_pAltSnap;
+
+		// bytes available for snapshot data behind the holder
+		int m_DataCapacity;
+		// whether the tick index points to this holder
+		bool m_Indexed;
 	};
 
-	CHolder *m_pFirst;
-	CHolder *m_pLast;
+	CHolder *m_pFirst = nullptr;
+	CHolder *m_pLast = nullptr;
 
-	CSnapshotStorage() { Init(); }
-	~CSnapshotStorage() { PurgeAll(); }
+	CSnapshotStorage() = default;
+	~CSnapshotStorage();
 	void Init();
+	// also frees the memory kept for the next snapshots
 	void PurgeAll();
 	void PurgeUntil(int Tick);
 	void Add(int Tick, int64_t Tagtime, int DataSize, const void *pData, int AltDataSize, const void *pAltData);
 	int Get(int Tick, int64_t *pTagtime, const CSnapshot **ppData, const CSnapshot **ppAltData);
+
+	int NumSpareHolders() const { return m_NumSpare; }
+
+private:
+	enum
+	{
+		// power of two, more ticks than the 3 seconds of snapshots the
+		// server keeps at 50 snapshots per second
+		INDEX_SIZE = 256,
+		// purged holders kept for reuse, usually one snapshot is purged
+		// for every one that is added
+		MAX_SPARE = 8,
+	};
+
+	// the stored snapshots by tick. a snapshot whose slot is taken by a
+	// newer one is only found through the list
+	CHolder *m_apIndex[INDEX_SIZE] = {};
+	int m_NumUnindexed = 0;
+
+	// purged holders with their memory, linked through m_pNext
+	CHolder *m_pSpare = nullptr;
+	int m_NumSpare = 0;
+
+	void Free(CHolder *pHolder);
 };
 
 class CSnapshotBuilder
@@ -165,8 +199,44 @@ public:
 
 	CSnapshotItem *GetItem(int Index);
 	int *GetItemData(int Key);
+	int NumItems() const { return m_NumItems; }
 
 	int Finish(void *pSnapdata);
 };
 
+// CSnapItemBuffer
+
+// items that are created once and then copied into several snapshots
+class CSnapItemBuffer
+{
+public:
+	class CItem
+	{
+	public:
+		int m_Type;
+		int m_ID;
+		int m_Size;
+		int m_Offset;
+	};
+
+private:
+	CItem m_aItems[CSnapshot::MAX_ITEMS];
+	int m_NumItems;
+
+	int m_aData[CSnapshot::MAX_SIZE / sizeof(int)];
+	int m_DataSize;
+
+public:
+	CSnapItemBuffer() { Clear(); }
+
+	void Clear();
+	void Truncate(int NumItems);
+
+	void *NewItem(int Type, int ID, int Size);
+
+	int NumItems() const { return m_NumItems; }
+	const CItem *GetItem(int Index) const { return &m_aItems[Index]; }
+	const void *GetItemData(int Index) const { return (const char *)m_aData + m_aItems[Index].m_Offset; }
+};
+
 #endif // ENGINE_SNAPSHOT_H
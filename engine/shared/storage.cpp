@@ -7,6 +7,7 @@
 
 #include <engine/client/updater.h>
 #include <engine/shared/linereader.h>
+#include <engine/shared/mapindex.h>
 #include <engine/storage.h>
 
 #include <unordered_set>
@@ -26,8 +27,10 @@ public:
 	char m_aUserdir[IO_MAX_PATH_LENGTH];
 	char m_aCurrentdir[IO_MAX_PATH_LENGTH];
 	char m_aBinarydir[IO_MAX_PATH_LENGTH];
+	CMapIndex m_MapIndex;
 
-	CStorage()
+	CStorage() :
+		m_MapIndex(this)
 	{
 		mem_zero(m_aaStoragePaths, sizeof(m_aaStoragePaths));
 		m_NumPaths = 0;
@@ -671,6 +674,19 @@ public:
 		return pBuffer[0] != 0;
 	}
 
+	bool FindMap(const SHA256_DIGEST &Sha256, char *pBuffer, int BufferSize) override
+	{
+		dbg_assert(BufferSize >= 1, "BufferSize invalid");
+
+		pBuffer[0] = 0;
+		return m_MapIndex.Find(Sha256, pBuffer, BufferSize);
+	}
+
+	void AddMapToIndex(const char *pFilename, const SHA256_DIGEST &Sha256) override
+	{
+		m_MapIndex.Add(pFilename, Sha256);
+	}
+
 	struct SFindFilesCallbackData
 	{
 		CStorage *m_pStorage;
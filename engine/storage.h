@@ -56,6 +56,9 @@ public:
 	virtual bool CalculateHashes(const char *pFilename, int Type, SHA256_DIGEST *pSha256, unsigned *pCrc = nullptr) = 0;
 	virtual bool FindFile(const char *pFilename, const char *pPath, int Type, char *pBuffer, int BufferSize) = 0;
 	virtual size_t FindFiles(const char *pFilename, const char *pPath, int Type, std::set<std::string> *pEntries) = 0;
+	// finds a map in the maps and downloadedmaps folders by its SHA256, whatever its filename
+	virtual bool FindMap(const SHA256_DIGEST &Sha256, char *pBuffer, int BufferSize) = 0;
+	virtual void AddMapToIndex(const char *pFilename, const SHA256_DIGEST &Sha256) = 0;
 	virtual bool RemoveFile(const char *pFilename, int Type) = 0;
 	virtual bool RemoveFolder(const char *pFilename, int Type) = 0;
 	virtual bool RenameFile(const char *pOldFilename, const char *pNewFilename, int Type) = 0;
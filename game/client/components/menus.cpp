@@ -836,6 +836,7 @@ void CMenus::OnInit()
 
 	m_RefreshButton.Init(UI(), -1);
 	m_ConnectButton.Init(UI(), -1);
+	m_pDemoInfoCache = std::make_shared<CDemoInfoCache>(Storage());
 
 	Console()->Chain("add_favorite", ConchainFavoritesUpdate, this);
 	Console()->Chain("remove_favorite", ConchainFavoritesUpdate, this);
@@ -1926,6 +1927,9 @@ void CMenus::OnReset()
 void CMenus::OnShutdown()
 {
 	KillServer();
+	AbortFetchingHeaders();
+	if(m_pDemoInfoCache)
+		m_pDemoInfoCache->Save();
 }
 
 bool CMenus::OnCursorMove(float x, float y, IInput::ECursorType CursorType)
@@ -2214,6 +2218,10 @@ void CMenus::SetMenuPage(int NewPage)
 	if(NewPage == PAGE_DDNET_LEGACY || NewPage == PAGE_KOG_LEGACY)
 		NewPage = PAGE_INTERNET;
 
+	// headers read for the details view are not written by a background pass
+	if(m_MenuPage == PAGE_DEMOS && NewPage != PAGE_DEMOS && m_pDemoInfoCache)
+		m_pDemoInfoCache->Save();
+
 	m_MenuPage = NewPage;
 	if(NewPage >= PAGE_INTERNET && NewPage <= PAGE_FAVORITES)
 		g_Config.m_UiPage = NewPage;
@@ -6,8 +6,10 @@
 #include <base/types.h>
 #include <base/vmath.h>
 
+#include <atomic>
 #include <chrono>
 #include <deque>
+#include <memory>
 #include <unordered_set>
 #include <vector>
 
@@ -16,6 +18,7 @@
 #include <engine/friends.h>
 #include <engine/serverbrowser.h>
 #include <engine/shared/config.h>
+#include <engine/shared/demoinfocache.h>
 #include <engine/shared/http.h>
 #include <engine/shared/linereader.h>
 #include <engine/textrender.h>
@@ -267,6 +270,17 @@ protected:
 		CDemoHeader m_Info;
 		CTimelineMarkers m_TimelineMarkers;
 		CMapInfo m_MapInfo;
+		int m_InfoRequest; // index in the running demo info pass, -1 if none
+
+		void SetInfo(const CDemoInfoCache::CInfo &Info)
+		{
+			m_InfosLoaded = true;
+			m_Valid = Info.m_Valid;
+			m_Info = Info.m_Info;
+			m_TimelineMarkers = Info.m_TimelineMarkers;
+			m_MapInfo = Info.m_MapInfo;
+			m_InfoRequest = -1;
+		}
 
 		int NumMarkers() const
 		{
@@ -332,6 +346,46 @@ protected:
 
 	std::chrono::nanoseconds m_DemoPopulateStartTime{0};
 
+	// the headers of the listed demos are read on the job pool, the list
+	// picks up the results while it is rendered
+	enum
+	{
+		DEMO_INFO_JOB_SIZE = 32,
+	};
+	struct CDemoInfoRequest
+	{
+		char m_aFilename[IO_MAX_PATH_LENGTH];
+		int m_StorageType;
+		CDemoInfoCache::CInfo m_Info;
+		std::atomic<bool> m_Done{false};
+	};
+	struct CDemoInfoPass
+	{
+		std::vector<CDemoInfoRequest> m_vRequests;
+		std::atomic<bool> m_Aborted{false};
+		std::atomic<int> m_NumPendingJobs{0};
+
+		CDemoInfoPass(size_t NumRequests) :
+			m_vRequests(NumRequests) {}
+	};
+	class CDemoInfoJob : public IJob
+	{
+		std::shared_ptr<CDemoInfoPass> m_pPass;
+		std::shared_ptr<CDemoInfoCache> m_pCache;
+		const IDemoPlayer *m_pDemoPlayer;
+		size_t m_Begin;
+		size_t m_End;
+
+		void Run() override;
+
+	public:
+		CDemoInfoJob(std::shared_ptr<CDemoInfoPass> pPass, std::shared_ptr<CDemoInfoCache> pCache, const IDemoPlayer *pDemoPlayer, size_t Begin, size_t End);
+	};
+	std::shared_ptr<CDemoInfoCache> m_pDemoInfoCache;
+	std::shared_ptr<CDemoInfoPass> m_pDemoInfoPass;
+	void AbortFetchingHeaders();
+	void UpdateFetchedHeaders();
+
 	void DemolistOnUpdate(bool Reset);
 	static int DemolistFetchCallback(const CFsFileInfo *pInfo, int IsDir, int StorageType, void *pUser);
 
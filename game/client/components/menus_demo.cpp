@@ -6,6 +6,7 @@
 #include <base/system.h>
 
 #include <engine/demo.h>
+#include <engine/engine.h>
 #include <engine/graphics.h>
 #include <engine/keys.h>
 #include <engine/shared/localization.h>
@@ -915,6 +916,7 @@ int CMenus::DemolistFetchCallback(const CFsFileInfo *pInfo, int IsDir, int Stora
 	}
 	Item.m_InfosLoaded = false;
 	Item.m_Valid = false;
+	Item.m_InfoRequest = -1;
 	Item.m_IsDir = IsDir != 0;
 	Item.m_IsLink = false;
 	Item.m_StorageType = StorageType;
@@ -930,6 +932,7 @@ int CMenus::DemolistFetchCallback(const CFsFileInfo *pInfo, int IsDir, int Stora
 
 void CMenus::DemolistPopulate()
 {
+	AbortFetchingHeaders();
 	m_vDemos.clear();
 
 	int NumStoragesWithDemos = 0;
@@ -950,6 +953,7 @@ void CMenus::DemolistPopulate()
 			str_copy(Item.m_aName, Localize("All combined"));
 			Item.m_InfosLoaded = false;
 			Item.m_Valid = false;
+			Item.m_InfoRequest = -1;
 			Item.m_Date = 0;
 			Item.m_IsDir = true;
 			Item.m_IsLink = true;
@@ -967,6 +971,7 @@ void CMenus::DemolistPopulate()
 				str_append(Item.m_aName, "/", sizeof(Item.m_aName));
 				Item.m_InfosLoaded = false;
 				Item.m_Valid = false;
+				Item.m_InfoRequest = -1;
 				Item.m_Date = 0;
 				Item.m_IsDir = true;
 				Item.m_IsLink = true;
@@ -979,11 +984,11 @@ void CMenus::DemolistPopulate()
 	{
 		m_DemoPopulateStartTime = time_get_nanoseconds();
 		Storage()->ListDirectoryInfo(m_DemolistStorageType, m_aCurrentDemoFolder, DemolistFetchCallback, this);
+		std::stable_sort(m_vDemos.begin(), m_vDemos.end());
 
+		// the demos are requested in list order, so the visible ones come first
 		if(g_Config.m_BrDemoFetchInfo)
 			FetchAllHeaders();
-
-		std::stable_sort(m_vDemos.begin(), m_vDemos.end());
 	}
 	RefreshFilteredDemos();
 }
@@ -1043,19 +1048,105 @@ bool CMenus::FetchHeader(CDemoItem &Item)
 	{
 		char aBuffer[IO_MAX_PATH_LENGTH];
 		str_format(aBuffer, sizeof(aBuffer), "%s/%s", m_aCurrentDemoFolder, Item.m_aFilename);
-		Item.m_Valid = DemoPlayer()->GetDemoInfo(Storage(), nullptr, aBuffer, Item.m_StorageType, &Item.m_Info, &Item.m_TimelineMarkers, &Item.m_MapInfo);
-		Item.m_InfosLoaded = true;
+		CDemoInfoCache::CInfo Info;
+		m_pDemoInfoCache->Get(DemoPlayer(), aBuffer, Item.m_StorageType, &Info);
+		Item.SetInfo(Info);
 	}
 	return Item.m_Valid;
 }
 
+CMenus::CDemoInfoJob::CDemoInfoJob(std::shared_ptr<CDemoInfoPass> pPass, std::shared_ptr<CDemoInfoCache> pCache, const IDemoPlayer *pDemoPlayer, size_t Begin, size_t End) :
+	m_pPass(std::move(pPass)), m_pCache(std::move(pCache)), m_pDemoPlayer(pDemoPlayer), m_Begin(Begin), m_End(End)
+{
+}
+
+void CMenus::CDemoInfoJob::Run()
+{
+	for(size_t i = m_Begin; i < m_End && !m_pPass->m_Aborted.load(std::memory_order_relaxed); i++)
+	{
+		CDemoInfoRequest &Request = m_pPass->m_vRequests[i];
+		m_pCache->Get(m_pDemoPlayer, Request.m_aFilename, Request.m_StorageType, &Request.m_Info);
+		Request.m_Done.store(true, std::memory_order_release);
+	}
+
+	// the last job of the pass writes the new entries to disk
+	if(m_pPass->m_NumPendingJobs.fetch_sub(1) == 1)
+		m_pCache->Save();
+}
+
 void CMenus::FetchAllHeaders()
 {
+	AbortFetchingHeaders();
+
+	size_t NumRequests = 0;
+	for(const auto &Item : m_vDemos)
+	{
+		if(!Item.m_IsDir && !Item.m_InfosLoaded)
+			NumRequests++;
+	}
+	if(NumRequests == 0)
+		return;
+
+	std::shared_ptr<CDemoInfoPass> pPass = std::make_shared<CDemoInfoPass>(NumRequests);
+	size_t Request = 0;
+	for(auto &Item : m_vDemos)
+	{
+		if(Item.m_IsDir || Item.m_InfosLoaded)
+			continue;
+		str_format(pPass->m_vRequests[Request].m_aFilename, sizeof(pPass->m_vRequests[Request].m_aFilename), "%s/%s", m_aCurrentDemoFolder, Item.m_aFilename);
+		pPass->m_vRequests[Request].m_StorageType = Item.m_StorageType;
+		Item.m_InfoRequest = (int)Request;
+		Request++;
+	}
+
+	pPass->m_NumPendingJobs.store((NumRequests + DEMO_INFO_JOB_SIZE - 1) / DEMO_INFO_JOB_SIZE);
+	for(size_t Begin = 0; Begin < NumRequests; Begin += DEMO_INFO_JOB_SIZE)
+	{
+		std::shared_ptr<CDemoInfoJob> pJob = std::make_shared<CDemoInfoJob>(pPass, m_pDemoInfoCache, DemoPlayer(), Begin, minimum<size_t>(Begin + DEMO_INFO_JOB_SIZE, NumRequests));
+		pJob->SetPriority(IJob::PRIORITY_HIGH);
+		Engine()->AddJob(pJob);
+	}
+	m_pDemoInfoPass = pPass;
+}
+
+void CMenus::AbortFetchingHeaders()
+{
+	if(!m_pDemoInfoPass)
+		return;
+	m_pDemoInfoPass->m_Aborted.store(true, std::memory_order_relaxed);
+	m_pDemoInfoPass = nullptr;
 	for(auto &Item : m_vDemos)
+		Item.m_InfoRequest = -1;
+}
+
+void CMenus::UpdateFetchedHeaders()
+{
+	if(!m_pDemoInfoPass)
+		return;
+
+	bool Pending = false;
+	for(auto &Item : m_vDemos)
+	{
+		if(Item.m_InfoRequest < 0)
+			continue;
+		const CDemoInfoRequest &Request = m_pDemoInfoPass->m_vRequests[Item.m_InfoRequest];
+		if(Item.m_InfosLoaded)
+			Item.m_InfoRequest = -1;
+		else if(Request.m_Done.load(std::memory_order_acquire))
+			Item.SetInfo(Request.m_Info);
+		else
+			Pending = true;
+	}
+	if(Pending)
+		return;
+
+	// only the length order depends on the headers, sort once when all are in
+	m_pDemoInfoPass = nullptr;
+	if(g_Config.m_BrDemoSort == SORT_LENGTH)
 	{
-		FetchHeader(Item);
+		std::stable_sort(m_vDemos.begin(), m_vDemos.end());
+		DemolistOnUpdate(false);
 	}
-	std::stable_sort(m_vDemos.begin(), m_vDemos.end());
 }
 
 void CMenus::RenderDemoBrowser(CUIRect MainView)
@@ -1081,6 +1172,7 @@ void CMenus::RenderDemoBrowserList(CUIRect ListView, bool &WasListboxItemActivat
 		DemolistOnUpdate(true);
 		m_DemoBrowserListInitialized = true;
 	}
+	UpdateFetchedHeaders();
 
 #if defined(CONF_VIDEORECORDER)
 	if(!m_DemoRenderInput.IsEmpty())
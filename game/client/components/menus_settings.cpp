@@ -796,6 +796,7 @@ void CMenus::RenderSettingsTee(CUIRect MainView)
 		CTeeRenderInfo Info = OwnSkinInfo;
 		Info.m_CustomColoredSkin = *pUseCustomColor;
 
+		m_pClient->m_Skins.Use(pSkinToBeDraw);
 		Info.m_OriginalRenderSkin = pSkinToBeDraw->m_OriginalSkin;
 		Info.m_ColorableRenderSkin = pSkinToBeDraw->m_ColorableSkin;
 		Info.m_SkinMetrics = pSkinToBeDraw->m_Metrics;
@@ -198,7 +198,8 @@ void CPlusFeatures::DrawPredictedPos()
 
 	std::vector<vec2> positions;
 	auto *curWorld = &m_pClient->m_PredictedWorld;
-	CGameWorld tempWorld(*curWorld);
+	CGameWorld tempWorld;
+	tempWorld.CopyWorld(curWorld);
 
 	auto *pTempChar = tempWorld.GetCharacterByID(m_pClient->m_aLocalIDs[g_Config.m_ClDummy]);
 	if(!pTempChar)
@@ -1065,7 +1066,8 @@ int CPlusFeatures::CheckPredictions(CNetObj_PlayerInput *inputData, int predictT
 		return -1;
 	}
 
-	CGameWorld predictWorld(*curWorld);
+	CGameWorld predictWorld;
+	predictWorld.CopyWorld(curWorld);
 
 	CCharacter *localChar = predictWorld.GetCharacterByID(m_pClient->m_Snap.m_LocalClientID);
 	if(!localChar)
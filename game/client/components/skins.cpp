@@ -5,6 +5,7 @@
 #include <base/system.h>
 
 #include <engine/engine.h>
+#include <engine/gfx/image_loader.h>
 #include <engine/graphics.h>
 #include <engine/shared/config.h>
 #include <engine/storage.h>
@@ -44,7 +45,7 @@ CSkins::CGetPngFile::CGetPngFile(CSkins *pSkins, const char *pUrl, IStorage *pSt
 struct SSkinScanUser
 {
 	CSkins *m_pThis;
-	CSkins::TSkinLoadedCBFunc m_SkinLoadedFunc;
+	std::vector<std::shared_ptr<CSkins::CSkinLoadJob>> m_vpJobs;
 };
 
 int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
@@ -62,18 +63,90 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 	if(g_Config.m_ClVanillaSkinsOnly && !IsVanillaSkin(aNameWithoutPng))
 		return 0;
 
-	// Don't add duplicate skins (one from user's config directory, other from
-	// client itself)
-	if(pSelf->m_Skins.find(aNameWithoutPng) != pSelf->m_Skins.end())
-		return 0;
-
+	// Duplicate skins (one from user's config directory, other from
+	// client itself) are skipped when the skins are added
 	char aBuf[IO_MAX_PATH_LENGTH];
 	str_format(aBuf, sizeof(aBuf), "skins/%s", pName);
-	pSelf->LoadSkin(aNameWithoutPng, aBuf, DirType);
-	pUserReal->m_SkinLoadedFunc((int)pSelf->m_Skins.size());
+	pUserReal->m_vpJobs.push_back(std::make_shared<CSkinLoadJob>(pSelf, aNameWithoutPng, aBuf, DirType));
 	return 0;
 }
 
+CSkins::CSkinLoadJob::CSkinLoadJob(CSkins *pSkins, const char *pName, const char *pPath, int DirType) :
+	m_pSkins(pSkins),
+	m_DirType(DirType),
+	m_Skin(pName)
+{
+	str_copy(m_aPath, pPath);
+	str_copy(m_Skin.m_aPath, pPath);
+	m_Skin.m_StorageType = DirType;
+}
+
+CSkins::CSkinLoadJob::~CSkinLoadJob()
+{
+	free(m_Info.m_pData);
+	free(m_ColorableInfo.m_pData);
+}
+
+void CSkins::CSkinLoadJob::Load()
+{
+	// the graphics are not thread safe, the warnings of the decoder are
+	// reported on the main thread
+	IOHANDLE File = m_pSkins->Storage()->OpenFile(m_aPath, IOFLAG_READ, m_DirType);
+	if(!File)
+		return;
+	const long int Length = io_length(File);
+	TImageByteBuffer ByteBuffer(maximum(Length, 0l));
+	const bool Read = Length > 0 && io_read(File, ByteBuffer.data(), ByteBuffer.size()) == ByteBuffer.size();
+	io_close(File);
+	if(!Read)
+		return;
+
+	SImageByteBuffer ImageByteBuffer(&ByteBuffer);
+	uint8_t *pImgBuffer = nullptr;
+	EImageFormat ImageFormat;
+	if(!::LoadPNG(ImageByteBuffer, m_aPath, m_PngliteIncompatible, m_Info.m_Width, m_Info.m_Height, pImgBuffer, ImageFormat))
+		return;
+	if(ImageFormat == IMAGE_FORMAT_RGB)
+		m_Info.m_Format = CImageInfo::FORMAT_RGB;
+	else if(ImageFormat == IMAGE_FORMAT_RGBA)
+		m_Info.m_Format = CImageInfo::FORMAT_RGBA;
+	else
+	{
+		free(pImgBuffer);
+		return;
+	}
+	m_Info.m_pData = pImgBuffer;
+	m_Loaded = true;
+
+	// invalid images are left to LoadSkin on the main thread,
+	// because the checks report warnings to the graphics
+	const CDataSprite &Body = g_pData->m_aSprites[SPRITE_TEE_BODY];
+	if(m_Info.m_Format != CImageInfo::FORMAT_RGBA || m_Info.m_Width == 0 || m_Info.m_Height == 0 || m_Info.m_Width % Body.m_pSet->m_Gridx != 0 || m_Info.m_Height % Body.m_pSet->m_Gridy != 0)
+		return;
+	m_Prepared = PrepareSkin(m_Skin, m_Info, m_ColorableInfo);
+}
+
+void CSkins::CSkinLoadJob::Run()
+{
+	if(m_Started.exchange(true))
+		return;
+	Load();
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	m_Finished = true;
+	m_FinishedCond.notify_all();
+}
+
+void CSkins::CSkinLoadJob::Wait()
+{
+	if(!m_Started.exchange(true))
+	{
+		Load();
+		return;
+	}
+	std::unique_lock<std::mutex> Lock(m_Mutex);
+	m_FinishedCond.wait(Lock, [this] { return m_Finished; });
+}
+
 static void CheckMetrics(CSkin::SSkinMetricVariable &Metrics, const uint8_t *pImg, int ImgWidth, int ImgX, int ImgY, int CheckWidth, int CheckHeight)
 {
 	int MaxY = -1;
@@ -109,14 +182,6 @@ static void CheckMetrics(CSkin::SSkinMetricVariable &Metrics, const uint8_t *pIm
 	Metrics.m_MaxHeight = CheckHeight;
 }
 
-const CSkin *CSkins::LoadSkin(const char *pName, const char *pPath, int DirType)
-{
-	CImageInfo Info;
-	if(!LoadSkinPNG(Info, pName, pPath, DirType))
-		return 0;
-	return LoadSkin(pName, Info);
-}
-
 bool CSkins::LoadSkinPNG(CImageInfo &Info, const char *pName, const char *pPath, int DirType)
 {
 	char aBuf[512];
@@ -129,7 +194,7 @@ bool CSkins::LoadSkinPNG(CImageInfo &Info, const char *pName, const char *pPath,
 	return true;
 }
 
-const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
+bool CSkins::CheckSkinImage(const char *pName, CImageInfo &Info)
 {
 	char aBuf[512];
 
@@ -137,26 +202,42 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 	{
 		str_format(aBuf, sizeof(aBuf), "skin failed image divisibility: %s", pName);
 		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
-		return nullptr;
+		return false;
 	}
 	if(!Graphics()->IsImageFormatRGBA(pName, Info))
 	{
 		str_format(aBuf, sizeof(aBuf), "skin format is not RGBA: %s", pName);
 		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
-		return nullptr;
+		return false;
 	}
+	return true;
+}
+
+const CSkin *CSkins::LoadSkin(const char *pName, const char *pPath, int DirType, CImageInfo &Info)
+{
+	if(!CheckSkinImage(pName, Info))
+		return nullptr;
 
 	CSkin Skin{pName};
-	Skin.m_OriginalSkin.m_Body = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
-	Skin.m_OriginalSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
-	Skin.m_OriginalSkin.m_Feet = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
-	Skin.m_OriginalSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
-	Skin.m_OriginalSkin.m_Hands = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
-	Skin.m_OriginalSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
+	str_copy(Skin.m_aPath, pPath);
+	Skin.m_StorageType = DirType;
+	CImageInfo ColorableInfo;
+	if(!PrepareSkin(Skin, Info, ColorableInfo))
+	{
+		Graphics()->FreePNG(&Info);
+		return nullptr;
+	}
 
-	for(int i = 0; i < 6; ++i)
-		Skin.m_OriginalSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
+	// the image is decoded already, so upload it right away
+	UploadTextures(Skin, Info, ColorableInfo);
+	Skin.m_LastUsed = m_UseGeneration;
+	Graphics()->FreePNG(&Info);
+	Graphics()->FreePNG(&ColorableInfo);
+	return AddSkin(std::move(Skin));
+}
 
+bool CSkins::PrepareSkin(CSkin &Skin, const CImageInfo &Info, CImageInfo &ColorableInfo)
+{
 	int FeetGridPixelsWidth = (Info.m_Width / g_pData->m_aSprites[SPRITE_TEE_FOOT].m_pSet->m_Gridx);
 	int FeetGridPixelsHeight = (Info.m_Height / g_pData->m_aSprites[SPRITE_TEE_FOOT].m_pSet->m_Gridy);
 	int FeetWidth = g_pData->m_aSprites[SPRITE_TEE_FOOT].m_W * FeetGridPixelsWidth;
@@ -184,8 +265,8 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 	int BodyWidth = g_pData->m_aSprites[SPRITE_TEE_BODY].m_W * (Info.m_Width / g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridx); // body width
 	int BodyHeight = g_pData->m_aSprites[SPRITE_TEE_BODY].m_H * (Info.m_Height / g_pData->m_aSprites[SPRITE_TEE_BODY].m_pSet->m_Gridy); // body height
 	if(BodyWidth > Info.m_Width || BodyHeight > Info.m_Height)
-		return nullptr;
-	unsigned char *pData = (unsigned char *)Info.m_pData;
+		return false;
+	const unsigned char *pOrgData = (const unsigned char *)Info.m_pData;
 	const int PixelStep = 4;
 	int Pitch = Info.m_Width * PixelStep;
 
@@ -195,12 +276,12 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 		for(int y = 0; y < BodyHeight; y++)
 			for(int x = 0; x < BodyWidth; x++)
 			{
-				uint8_t AlphaValue = pData[y * Pitch + x * PixelStep + 3];
+				uint8_t AlphaValue = pOrgData[y * Pitch + x * PixelStep + 3];
 				if(AlphaValue > 128)
 				{
-					aColors[0] += pData[y * Pitch + x * PixelStep + 0];
-					aColors[1] += pData[y * Pitch + x * PixelStep + 1];
-					aColors[2] += pData[y * Pitch + x * PixelStep + 2];
+					aColors[0] += pOrgData[y * Pitch + x * PixelStep + 0];
+					aColors[1] += pOrgData[y * Pitch + x * PixelStep + 1];
+					aColors[2] += pOrgData[y * Pitch + x * PixelStep + 2];
 				}
 			}
 		if(aColors[0] != 0 && aColors[1] != 0 && aColors[2] != 0)
@@ -209,18 +290,22 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 			Skin.m_BloodColor = ColorRGBA(0, 0, 0, 1);
 	}
 
-	CheckMetrics(Skin.m_Metrics.m_Body, pData, Pitch, 0, 0, BodyWidth, BodyHeight);
+	CheckMetrics(Skin.m_Metrics.m_Body, pOrgData, Pitch, 0, 0, BodyWidth, BodyHeight);
 
 	// body outline metrics
-	CheckMetrics(Skin.m_Metrics.m_Body, pData, Pitch, BodyOutlineOffsetX, BodyOutlineOffsetY, BodyOutlineWidth, BodyOutlineHeight);
+	CheckMetrics(Skin.m_Metrics.m_Body, pOrgData, Pitch, BodyOutlineOffsetX, BodyOutlineOffsetY, BodyOutlineWidth, BodyOutlineHeight);
 
 	// get feet size
-	CheckMetrics(Skin.m_Metrics.m_Feet, pData, Pitch, FeetOffsetX, FeetOffsetY, FeetWidth, FeetHeight);
+	CheckMetrics(Skin.m_Metrics.m_Feet, pOrgData, Pitch, FeetOffsetX, FeetOffsetY, FeetWidth, FeetHeight);
 
 	// get feet outline size
-	CheckMetrics(Skin.m_Metrics.m_Feet, pData, Pitch, FeetOutlineOffsetX, FeetOutlineOffsetY, FeetOutlineWidth, FeetOutlineHeight);
+	CheckMetrics(Skin.m_Metrics.m_Feet, pOrgData, Pitch, FeetOutlineOffsetX, FeetOutlineOffsetY, FeetOutlineWidth, FeetOutlineHeight);
 
 	// make the texture gray scale
+	ColorableInfo = Info;
+	ColorableInfo.m_pData = malloc((size_t)Info.m_Width * Info.m_Height * PixelStep);
+	unsigned char *pData = (unsigned char *)ColorableInfo.m_pData;
+	mem_copy(pData, pOrgData, (size_t)Info.m_Width * Info.m_Height * PixelStep);
 	for(int i = 0; i < Info.m_Width * Info.m_Height; i++)
 	{
 		int v = (pData[i * PixelStep] + pData[i * PixelStep + 1] + pData[i * PixelStep + 2]) / 3;
@@ -267,21 +352,102 @@ const CSkin *CSkins::LoadSkin(const char *pName, CImageInfo &Info)
 			pData[y * Pitch + x * PixelStep + 2] = v;
 		}
 
-	Skin.m_ColorableSkin.m_Body = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
-	Skin.m_ColorableSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
-	Skin.m_ColorableSkin.m_Feet = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
-	Skin.m_ColorableSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
-	Skin.m_ColorableSkin.m_Hands = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
-	Skin.m_ColorableSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
+	return true;
+}
+
+void CSkins::UploadTextures(CSkin &Skin, CImageInfo &Info, CImageInfo &ColorableInfo)
+{
+	Skin.m_OriginalSkin.m_Body = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
+	Skin.m_OriginalSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
+	Skin.m_OriginalSkin.m_Feet = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
+	Skin.m_OriginalSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
+	Skin.m_OriginalSkin.m_Hands = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
+	Skin.m_OriginalSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
+
+	for(int i = 0; i < 6; ++i)
+		Skin.m_OriginalSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
+
+	Skin.m_ColorableSkin.m_Body = Graphics()->LoadSpriteTexture(ColorableInfo, &g_pData->m_aSprites[SPRITE_TEE_BODY]);
+	Skin.m_ColorableSkin.m_BodyOutline = Graphics()->LoadSpriteTexture(ColorableInfo, &g_pData->m_aSprites[SPRITE_TEE_BODY_OUTLINE]);
+	Skin.m_ColorableSkin.m_Feet = Graphics()->LoadSpriteTexture(ColorableInfo, &g_pData->m_aSprites[SPRITE_TEE_FOOT]);
+	Skin.m_ColorableSkin.m_FeetOutline = Graphics()->LoadSpriteTexture(ColorableInfo, &g_pData->m_aSprites[SPRITE_TEE_FOOT_OUTLINE]);
+	Skin.m_ColorableSkin.m_Hands = Graphics()->LoadSpriteTexture(ColorableInfo, &g_pData->m_aSprites[SPRITE_TEE_HAND]);
+	Skin.m_ColorableSkin.m_HandsOutline = Graphics()->LoadSpriteTexture(ColorableInfo, &g_pData->m_aSprites[SPRITE_TEE_HAND_OUTLINE]);
 
 	for(int i = 0; i < 6; ++i)
-		Skin.m_ColorableSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(Info, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
+		Skin.m_ColorableSkin.m_aEyes[i] = Graphics()->LoadSpriteTexture(ColorableInfo, &g_pData->m_aSprites[SPRITE_TEE_EYE_NORMAL + i]);
+
+	Skin.m_Resident = true;
+}
+
+void CSkins::UnloadTextures(CSkin &Skin)
+{
+	Graphics()->UnloadTexture(&Skin.m_OriginalSkin.m_Body);
+	Graphics()->UnloadTexture(&Skin.m_OriginalSkin.m_BodyOutline);
+	Graphics()->UnloadTexture(&Skin.m_OriginalSkin.m_Feet);
+	Graphics()->UnloadTexture(&Skin.m_OriginalSkin.m_FeetOutline);
+	Graphics()->UnloadTexture(&Skin.m_OriginalSkin.m_Hands);
+	Graphics()->UnloadTexture(&Skin.m_OriginalSkin.m_HandsOutline);
+	for(auto &Eye : Skin.m_OriginalSkin.m_aEyes)
+		Graphics()->UnloadTexture(&Eye);
+
+	Graphics()->UnloadTexture(&Skin.m_ColorableSkin.m_Body);
+	Graphics()->UnloadTexture(&Skin.m_ColorableSkin.m_BodyOutline);
+	Graphics()->UnloadTexture(&Skin.m_ColorableSkin.m_Feet);
+	Graphics()->UnloadTexture(&Skin.m_ColorableSkin.m_FeetOutline);
+	Graphics()->UnloadTexture(&Skin.m_ColorableSkin.m_Hands);
+	Graphics()->UnloadTexture(&Skin.m_ColorableSkin.m_HandsOutline);
+	for(auto &Eye : Skin.m_ColorableSkin.m_aEyes)
+		Graphics()->UnloadTexture(&Eye);
+
+	Skin.m_Resident = false;
+}
+
+void CSkins::MakeResident(CSkin &Skin)
+{
+	Skin.m_LastUsed = m_UseGeneration;
+	if(Skin.m_Resident || Skin.m_aPath[0] == '\0')
+		return;
 
+	// a skin that fails to load again is not retried until it gets evicted
+	Skin.m_Resident = true;
+	CImageInfo Info;
+	if(!LoadSkinPNG(Info, Skin.GetName(), Skin.m_aPath, Skin.m_StorageType))
+		return;
+	if(CheckSkinImage(Skin.GetName(), Info))
+	{
+		// the metrics and blood color are kept from the refresh
+		CSkin Prepared{Skin.GetName()};
+		CImageInfo ColorableInfo;
+		if(PrepareSkin(Prepared, Info, ColorableInfo))
+		{
+			UploadTextures(Skin, Info, ColorableInfo);
+			Graphics()->FreePNG(&ColorableInfo);
+		}
+	}
 	Graphics()->FreePNG(&Info);
 
+	if(g_Config.m_Debug)
+	{
+		char aBuf[512];
+		str_format(aBuf, sizeof(aBuf), "upload skin %s", Skin.GetName());
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+	}
+}
+
+void CSkins::Use(const CSkin *pSkin)
+{
+	const auto SkinIt = m_Skins.find(pSkin->GetName());
+	if(SkinIt != m_Skins.end())
+		MakeResident(*SkinIt->second);
+}
+
+const CSkin *CSkins::AddSkin(CSkin &&Skin)
+{
 	// set skin data
 	if(g_Config.m_Debug)
 	{
+		char aBuf[512];
 		str_format(aBuf, sizeof(aBuf), "load skin %s", Skin.GetName());
 		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
 	}
@@ -310,37 +476,74 @@ void CSkins::OnInit()
 	});
 }
 
-void CSkins::Refresh(TSkinLoadedCBFunc &&SkinLoadedFunc)
+void CSkins::OnRender()
 {
+	const int64_t Now = time_get();
+	if(Now < m_NextEviction)
+		return;
+	m_NextEviction = Now + time_freq() * EVICT_INTERVAL;
+
+	// everything that keeps skin textures across frames finds its skins
+	// again, the rest is found every frame it's drawn. Skins that weren't
+	// found during the last interval aren't used anymore.
+	m_UseGeneration++;
+	GameClient()->RefindSkins();
 	for(const auto &SkinIt : m_Skins)
 	{
-		const auto &pSkin = SkinIt.second;
-		Graphics()->UnloadTexture(&pSkin->m_OriginalSkin.m_Body);
-		Graphics()->UnloadTexture(&pSkin->m_OriginalSkin.m_BodyOutline);
-		Graphics()->UnloadTexture(&pSkin->m_OriginalSkin.m_Feet);
-		Graphics()->UnloadTexture(&pSkin->m_OriginalSkin.m_FeetOutline);
-		Graphics()->UnloadTexture(&pSkin->m_OriginalSkin.m_Hands);
-		Graphics()->UnloadTexture(&pSkin->m_OriginalSkin.m_HandsOutline);
-		for(auto &Eye : pSkin->m_OriginalSkin.m_aEyes)
-			Graphics()->UnloadTexture(&Eye);
-
-		Graphics()->UnloadTexture(&pSkin->m_ColorableSkin.m_Body);
-		Graphics()->UnloadTexture(&pSkin->m_ColorableSkin.m_BodyOutline);
-		Graphics()->UnloadTexture(&pSkin->m_ColorableSkin.m_Feet);
-		Graphics()->UnloadTexture(&pSkin->m_ColorableSkin.m_FeetOutline);
-		Graphics()->UnloadTexture(&pSkin->m_ColorableSkin.m_Hands);
-		Graphics()->UnloadTexture(&pSkin->m_ColorableSkin.m_HandsOutline);
-		for(auto &Eye : pSkin->m_ColorableSkin.m_aEyes)
-			Graphics()->UnloadTexture(&Eye);
+		CSkin &Skin = *SkinIt.second;
+		if(Skin.m_Resident && Skin.m_LastUsed + 1 < m_UseGeneration)
+			UnloadTextures(Skin);
 	}
+}
+
+void CSkins::Refresh(TSkinLoadedCBFunc &&SkinLoadedFunc)
+{
+	for(const auto &SkinIt : m_Skins)
+		UnloadTextures(*SkinIt.second);
 
 	m_Skins.clear();
 	m_DownloadSkins.clear();
 	m_DownloadingSkins = 0;
 	SSkinScanUser SkinScanUser;
 	SkinScanUser.m_pThis = this;
-	SkinScanUser.m_SkinLoadedFunc = SkinLoadedFunc;
 	Storage()->ListDirectory(IStorage::TYPE_ALL, "skins", SkinScan, &SkinScanUser);
+
+	// decode the skins on the job pool, but only a few ahead of the ones
+	// being added, so the decoded images don't pile up in memory
+	std::vector<std::shared_ptr<CSkinLoadJob>> &vpJobs = SkinScanUser.m_vpJobs;
+	const size_t NumJobs = vpJobs.size();
+	size_t NextJob = 0;
+	for(size_t i = 0; i < NumJobs; i++)
+	{
+		for(; NextJob < NumJobs && NextJob < i + MAX_LOADING_SKINS; NextJob++)
+		{
+			vpJobs[NextJob]->SetPriority(IJob::PRIORITY_HIGH);
+			m_pClient->Engine()->AddJob(vpJobs[NextJob]);
+		}
+
+		std::shared_ptr<CSkinLoadJob> pJob = std::move(vpJobs[i]);
+		pJob->Wait();
+		if(pJob->m_Loaded)
+			Graphics()->WarnPngliteIncompatible(pJob->Path(), pJob->m_PngliteIncompatible);
+
+		// the first directory that has a skin wins
+		const char *pName = pJob->m_Skin.GetName();
+		if(m_Skins.find(pName) == m_Skins.end())
+		{
+			if(!pJob->m_Loaded)
+			{
+				char aBuf[512];
+				str_format(aBuf, sizeof(aBuf), "failed to load skin from %s", pName);
+				Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
+			}
+			else if(pJob->m_Prepared)
+				AddSkin(std::move(pJob->m_Skin));
+			else
+				LoadSkin(pName, pJob->Path(), pJob->m_Skin.m_StorageType, pJob->m_Info);
+		}
+		SkinLoadedFunc((int)m_Skins.size());
+	}
+
 	if(m_Skins.empty())
 	{
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "gameclient", "failed to load skins. folder='skins/'");
@@ -363,7 +566,10 @@ const CSkin *CSkins::Find(const char *pName)
 	{
 		pSkin = FindOrNullptr("default");
 		if(pSkin == nullptr)
+		{
+			MakeResident(*m_Skins.begin()->second);
 			return m_Skins.begin()->second.get();
+		}
 		else
 			return pSkin;
 	}
@@ -398,7 +604,10 @@ const CSkin *CSkins::FindImpl(const char *pName)
 {
 	auto SkinIt = m_Skins.find(pName);
 	if(SkinIt != m_Skins.end())
+	{
+		MakeResident(*SkinIt->second);
 		return SkinIt->second.get();
+	}
 
 	if(str_comp(pName, "default") == 0)
 		return nullptr;
@@ -417,7 +626,7 @@ const CSkin *CSkins::FindImpl(const char *pName)
 			char aPath[IO_MAX_PATH_LENGTH];
 			str_format(aPath, sizeof(aPath), "downloadedskins/%s.png", SkinDownloadIt->second->GetName());
 			Storage()->RenameFile(SkinDownloadIt->second->m_aPath, aPath, IStorage::TYPE_SAVE);
-			const auto *pSkin = LoadSkin(SkinDownloadIt->second->GetName(), SkinDownloadIt->second->m_pTask->m_Info);
+			const auto *pSkin = LoadSkin(SkinDownloadIt->second->GetName(), aPath, IStorage::TYPE_SAVE, SkinDownloadIt->second->m_pTask->m_Info);
 			SkinDownloadIt->second->m_pTask = nullptr;
 			--m_DownloadingSkins;
 			return pSkin;
@@ -5,8 +5,13 @@
 
 #include <base/system.h>
 #include <engine/shared/http.h>
+#include <engine/shared/jobs.h>
 #include <game/client/component.h>
 #include <game/client/skin.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string_view>
 #include <unordered_map>
 
@@ -27,6 +32,40 @@ public:
 		CImageInfo m_Info;
 	};
 
+	// Decodes a skin and prepares its metrics and colorable image on the job pool,
+	// the textures are created on the main thread once the skin is used.
+	class CSkinLoadJob : public IJob
+	{
+		CSkins *m_pSkins;
+		char m_aPath[IO_MAX_PATH_LENGTH];
+		int m_DirType;
+
+		// whoever starts the job first loads the skin, the worker or Wait
+		std::atomic<bool> m_Started{false};
+		std::mutex m_Mutex;
+		std::condition_variable m_FinishedCond;
+		bool m_Finished = false;
+
+		void Load();
+		void Run() override;
+
+	public:
+		CSkinLoadJob(CSkins *pSkins, const char *pName, const char *pPath, int DirType);
+		~CSkinLoadJob();
+
+		// loads the skin on the calling thread if no worker started it yet,
+		// otherwise waits for the worker to finish it
+		void Wait();
+		const char *Path() const { return m_aPath; }
+
+		bool m_Loaded = false;
+		bool m_Prepared = false;
+		int m_PngliteIncompatible = 0;
+		CSkin m_Skin;
+		CImageInfo m_Info;
+		CImageInfo m_ColorableInfo;
+	};
+
 	struct CDownloadSkin
 	{
 	private:
@@ -60,12 +99,15 @@ public:
 
 	virtual int Sizeof() const override { return sizeof(*this); }
 	void OnInit() override;
+	void OnRender() override;
 
 	void Refresh(TSkinLoadedCBFunc &&SkinLoadedFunc);
 	int Num();
 	std::unordered_map<std::string_view, std::unique_ptr<CSkin>> &GetSkinsUnsafe() { return m_Skins; }
 	const CSkin *FindOrNullptr(const char *pName);
 	const CSkin *Find(const char *pName);
+	// marks a skin from GetSkinsUnsafe as used and uploads its textures
+	void Use(const CSkin *pSkin);
 
 	bool IsDownloadingSkins() { return m_DownloadingSkins; }
 
@@ -77,14 +119,26 @@ public:
 		"twinbop", "twintri", "warpaint", "x_ninja", "x_spec"};
 
 private:
+	// number of skins that are decoded ahead of the ones being added
+	constexpr static size_t MAX_LOADING_SKINS = 64;
+	// seconds after which the textures of unused skins are unloaded
+	constexpr static int EVICT_INTERVAL = 30;
+
 	std::unordered_map<std::string_view, std::unique_ptr<CSkin>> m_Skins;
 	std::unordered_map<std::string_view, std::unique_ptr<CDownloadSkin>> m_DownloadSkins;
 	size_t m_DownloadingSkins = 0;
 	char m_aEventSkinPrefix[24];
+	int m_UseGeneration = 0;
+	int64_t m_NextEviction = 0;
 
 	bool LoadSkinPNG(CImageInfo &Info, const char *pName, const char *pPath, int DirType);
-	const CSkin *LoadSkin(const char *pName, const char *pPath, int DirType);
-	const CSkin *LoadSkin(const char *pName, CImageInfo &Info);
+	bool CheckSkinImage(const char *pName, CImageInfo &Info);
+	const CSkin *LoadSkin(const char *pName, const char *pPath, int DirType, CImageInfo &Info);
+	static bool PrepareSkin(CSkin &Skin, const CImageInfo &Info, CImageInfo &ColorableInfo);
+	void UploadTextures(CSkin &Skin, CImageInfo &Info, CImageInfo &ColorableInfo);
+	void UnloadTextures(CSkin &Skin);
+	void MakeResident(CSkin &Skin);
+	const CSkin *AddSkin(CSkin &&Skin);
 	const CSkin *FindImpl(const char *pName);
 	static int SkinScan(const char *pName, int IsDir, int DirType, void *pUser);
 };
@@ -545,6 +545,7 @@ void CGameClient::OnConnected()
 
 	m_GameWorld.Clear();
 	m_GameWorld.m_WorldConfig.m_InfiniteAmmo = true;
+	m_PredictionCache.m_Valid = false;
 	mem_zero(&m_GameInfo, sizeof(m_GameInfo));
 	m_PredictedDummyID = -1;
 	Console()->ResetGameSettings();
@@ -1912,6 +1913,37 @@ void CGameClient::UpdateEditorIngameMoved()
 	}
 }
 
+bool CGameClient::CanContinuePrediction(int BaseTick, int PredTick, bool Dummy, int DummyID, const CClientMask &Inactive, const CClientMask &OtherTeam)
+{
+	const CPredictionCache &Cache = m_PredictionCache;
+	// the gameworld invalidates its copy whenever a snapshot or anything else modifies it
+	if(!Cache.m_Valid || !m_PredictedWorld.m_IsValidCopy || m_PredictedWorld.m_pParent != &m_GameWorld || m_GameWorld.m_pChild != &m_PredictedWorld)
+		return false;
+	if(Cache.m_BaseTick != BaseTick || Cache.m_PredictedTick > PredTick || Cache.m_Dummy != Dummy || Cache.m_DummySwapping != m_IsDummySwapping)
+		return false;
+	if(Cache.m_LocalClientID != m_Snap.m_LocalClientID || Cache.m_DummyID != DummyID || Cache.m_Inactive != Inactive || Cache.m_OtherTeam != OtherTeam)
+		return false;
+
+	// the input of the newest tick may only be known after it was predicted
+	for(int Tick = BaseTick + 1; Tick <= Cache.m_PredictedTick; Tick++)
+	{
+		const CPredictionCache::CInput *pCachedInputs = Cache.m_aaInputs[Tick % CPredictionCache::MAX_TICKS];
+		for(int i = 0; i < NUM_DUMMIES; i++)
+		{
+			const CNetObj_PlayerInput *pInput = nullptr;
+			if(i == 0)
+				pInput = (CNetObj_PlayerInput *)Client()->GetInput(Tick, m_IsDummySwapping);
+			else if(DummyID >= 0 && m_PredictedWorld.GetCharacterByID(DummyID))
+				pInput = (CNetObj_PlayerInput *)Client()->GetInput(Tick, m_IsDummySwapping ^ 1);
+			if(pCachedInputs[i].m_Valid != (pInput != nullptr))
+				return false;
+			if(pInput && mem_comp(&pCachedInputs[i].m_Input, pInput, sizeof(*pInput)) != 0)
+				return false;
+		}
+	}
+	return true;
+}
+
 void CGameClient::OnPredict()
 {
 	// store the previous values so we can detect prediction errors
@@ -1944,34 +1976,70 @@ void CGameClient::OnPredict()
 
 	// init
 	bool Dummy = g_Config.m_ClDummy ^ m_IsDummySwapping;
-	m_PredictedWorld.CopyWorld(&m_GameWorld);
+	const int BaseTick = Client()->GameTick(g_Config.m_ClDummy);
+	const int PredTick = Client()->PredGameTick(g_Config.m_ClDummy);
+	const int DummyID = PredictDummy() ? m_PredictedDummyID : -1;
 
 	// don't predict inactive players, or entities from other teams
+	CClientMask Inactive;
+	CClientMask OtherTeam;
 	for(int i = 0; i < MAX_CLIENTS; i++)
-		if(CCharacter *pChar = m_PredictedWorld.GetCharacterByID(i))
-			if((!m_Snap.m_aCharacters[i].m_Active && pChar->m_SnapTicks > 10) || IsOtherTeam(i))
-				pChar->Destroy();
+	{
+		if(CCharacter *pChar = m_GameWorld.GetCharacterByID(i))
+			Inactive[i] = !m_Snap.m_aCharacters[i].m_Active && pChar->m_SnapTicks > 10;
+		OtherTeam[i] = IsOtherTeam(i);
+	}
 
-	CProjectile *pProjNext = 0;
-	for(CProjectile *pProj = (CProjectile *)m_PredictedWorld.FindFirst(CGameWorld::ENTTYPE_PROJECTILE); pProj; pProj = pProjNext)
+	// continue from the last predicted tick if neither the snapshot nor the inputs changed
+	int FirstTick = BaseTick + 1;
+	if(CanContinuePrediction(BaseTick, PredTick, Dummy, DummyID, Inactive, OtherTeam))
+	{
+		FirstTick = m_PredictionCache.m_PredictedTick + 1;
+	}
+	else
 	{
-		pProjNext = (CProjectile *)pProj->TypeNext();
-		if(IsOtherTeam(pProj->GetOwner()))
+		m_PredictedWorld.CopyWorld(&m_GameWorld);
+
+		for(int i = 0; i < MAX_CLIENTS; i++)
+			if(CCharacter *pChar = m_PredictedWorld.GetCharacterByID(i))
+				if(Inactive[i] || OtherTeam[i])
+					pChar->Destroy();
+
+		CProjectile *pProjNext = 0;
+		for(CProjectile *pProj = (CProjectile *)m_PredictedWorld.FindFirst(CGameWorld::ENTTYPE_PROJECTILE); pProj; pProj = pProjNext)
 		{
-			pProj->Destroy();
+			pProjNext = (CProjectile *)pProj->TypeNext();
+			if(IsOtherTeam(pProj->GetOwner()))
+			{
+				pProj->Destroy();
+			}
 		}
+
+		m_PredictionCache.m_BaseTick = BaseTick;
+		m_PredictionCache.m_PredictedTick = BaseTick;
+		m_PredictionCache.m_Dummy = Dummy;
+		m_PredictionCache.m_DummySwapping = m_IsDummySwapping;
+		m_PredictionCache.m_LocalClientID = m_Snap.m_LocalClientID;
+		m_PredictionCache.m_DummyID = DummyID;
+		m_PredictionCache.m_Inactive = Inactive;
+		m_PredictionCache.m_OtherTeam = OtherTeam;
 	}
+	// cl_predict_freeze 2 makes every tick depend on the newest predicted tick
+	m_PredictionCache.m_Valid = g_Config.m_ClPredictFreeze != 2 && PredTick - BaseTick < CPredictionCache::MAX_TICKS;
 
 	CCharacter *pLocalChar = m_PredictedWorld.GetCharacterByID(m_Snap.m_LocalClientID);
 	if(!pLocalChar)
+	{
+		m_PredictionCache.m_Valid = false;
 		return;
+	}
 	CCharacter *pDummyChar = 0;
 	if(PredictDummy())
 		pDummyChar = m_PredictedWorld.GetCharacterByID(m_PredictedDummyID);
 
 	// predict
 	// prediction actually happens here
-	for(int Tick = Client()->GameTick(g_Config.m_ClDummy) + 1; Tick <= Client()->PredGameTick(g_Config.m_ClDummy); Tick++)
+	for(int Tick = FirstTick; Tick <= PredTick; Tick++)
 	{
 		// fetch the previous characters
 		if(Tick == Client()->PredGameTick(g_Config.m_ClDummy))
@@ -1992,6 +2060,15 @@ void CGameClient::OnPredict()
 		CNetObj_PlayerInput *pDummyInputData = !pDummyChar ? 0 : (CNetObj_PlayerInput *)Client()->GetInput(Tick, m_IsDummySwapping ^ 1);
 		bool DummyFirst = pInputData && pDummyInputData && pDummyChar->GetCID() < pLocalChar->GetCID();
 
+		CPredictionCache::CInput *pCachedInputs = m_PredictionCache.m_aaInputs[Tick % CPredictionCache::MAX_TICKS];
+		pCachedInputs[0].m_Valid = pInputData != nullptr;
+		if(pInputData)
+			pCachedInputs[0].m_Input = *pInputData;
+		pCachedInputs[1].m_Valid = pDummyInputData != nullptr;
+		if(pDummyInputData)
+			pCachedInputs[1].m_Input = *pDummyInputData;
+		m_PredictionCache.m_PredictedTick = Tick;
+
 		if(DummyFirst)
 			pDummyChar->OnDirectInput(pDummyInputData);
 		if(pInputData)
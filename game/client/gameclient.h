@@ -756,6 +756,36 @@ private:
 	void UpdatePrediction();
 	void UpdateRenderedCharacters();
 
+	// what m_PredictedWorld was last predicted from, so OnPredict() can continue
+	// from the last predicted tick instead of resimulating from the snapshot
+	struct CPredictionCache
+	{
+		enum
+		{
+			MAX_TICKS = 64,
+		};
+
+		struct CInput
+		{
+			bool m_Valid;
+			CNetObj_PlayerInput m_Input;
+		};
+
+		bool m_Valid = false;
+		int m_BaseTick;
+		int m_PredictedTick;
+		bool m_Dummy;
+		int m_DummySwapping;
+		int m_LocalClientID;
+		int m_DummyID;
+		CClientMask m_Inactive;
+		CClientMask m_OtherTeam;
+		// inputs the ticks were simulated with, indexed by tick % MAX_TICKS
+		CInput m_aaInputs[MAX_TICKS][NUM_DUMMIES];
+	};
+	CPredictionCache m_PredictionCache;
+	bool CanContinuePrediction(int BaseTick, int PredTick, bool Dummy, int DummyID, const CClientMask &Inactive, const CClientMask &OtherTeam);
+
 	int m_aLastUpdateTick[MAX_CLIENTS] = {0};
 	void DetectStrongHook();
 
@@ -369,7 +369,7 @@ void CCharacter::FireWeapon()
 		{
 			int Lifetime = (int)(GameWorld()->GameTickSpeed() * GetTuning(m_TuneZone)->m_GunLifetime);
 
-			new CProjectile(
+			new(GameWorld()->EntityPool()) CProjectile(
 				GameWorld(),
 				WEAPON_GUN, //Type
 				GetCID(), //Owner
@@ -397,7 +397,7 @@ void CCharacter::FireWeapon()
 				a += aSpreading[i + 2];
 				float v = 1 - (absolute(i) / (float)ShotSpread);
 				float Speed = mix((float)Tuning()->m_ShotgunSpeeddiff, 1.0f, v);
-				new CProjectile(
+				new(GameWorld()->EntityPool()) CProjectile(
 					GameWorld(),
 					WEAPON_SHOTGUN, //Type
 					GetCID(), //Owner
@@ -414,7 +414,7 @@ void CCharacter::FireWeapon()
 		{
 			float LaserReach = GetTuning(m_TuneZone)->m_LaserReach;
 
-			new CLaser(GameWorld(), m_Pos, Direction, LaserReach, GetCID(), WEAPON_SHOTGUN);
+			new(GameWorld()->EntityPool()) CLaser(GameWorld(), m_Pos, Direction, LaserReach, GetCID(), WEAPON_SHOTGUN);
 		}
 	}
 	break;
@@ -423,7 +423,7 @@ void CCharacter::FireWeapon()
 	{
 		int Lifetime = (int)(GameWorld()->GameTickSpeed() * GetTuning(m_TuneZone)->m_GrenadeLifetime);
 
-		new CProjectile(
+		new(GameWorld()->EntityPool()) CProjectile(
 			GameWorld(),
 			WEAPON_GRENADE, //Type
 			GetCID(), //Owner
@@ -441,7 +441,7 @@ void CCharacter::FireWeapon()
 	{
 		float LaserReach = GetTuning(m_TuneZone)->m_LaserReach;
 
-		new CLaser(GameWorld(), m_Pos, Direction, LaserReach, GetCID(), WEAPON_LASER);
+		new(GameWorld()->EntityPool()) CLaser(GameWorld(), m_Pos, Direction, LaserReach, GetCID(), WEAPON_LASER);
 	}
 	break;
 
@@ -5,13 +5,16 @@
 
 #include <base/vmath.h>
 
-#include <game/alloc.h>
-
 #include "gameworld.h"
 
 class CEntity
 {
-	MACRO_ALLOC_HEAP()
+public:
+	// allocate with new(GameWorld()->EntityPool()) to reuse the memory of destroyed entities
+	void *operator new(size_t Size) { return CEntityPool::Allocate(nullptr, Size); }
+	void *operator new(size_t Size, CEntityPool *pPool) { return CEntityPool::Allocate(pPool, Size); }
+	void operator delete(void *pPtr) { CEntityPool::Free(pPtr); }
+	void operator delete(void *pPtr, CEntityPool *pPool) { CEntityPool::Free(pPtr); }
 
 private:
 	friend CGameWorld; // entity list handling
@@ -9,13 +9,104 @@
 #include "entities/projectile.h"
 #include "entity.h"
 #include <algorithm>
+#include <cstddef>
 #include <engine/shared/config.h>
+#include <game/alloc.h>
 #include <game/client/laser_data.h>
 #include <game/client/pickup_data.h>
 #include <game/client/projectile_data.h>
 #include <game/mapitems.h>
 #include <utility>
 
+//////////////////////////////////////////////////
+// entity pool
+//////////////////////////////////////////////////
+CEntityPool::~CEntityPool()
+{
+	dbg_assert(m_NumUsed == 0, "entities outlived their pool");
+	for(void *pSlab : m_vpSlabs)
+		free(pSlab);
+}
+
+size_t CEntityPool::SlotHeaderSize()
+{
+	// keep the entity behind the header suitably aligned
+	return (sizeof(CSlot) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+}
+
+CEntityPool::CSlot *CEntityPool::NewSlot(size_t Size)
+{
+	int SizeClass = 0;
+	while(SizeClass < (int)m_vSizeClasses.size() && m_vSizeClasses[SizeClass].m_Size != Size)
+		SizeClass++;
+	if(SizeClass == (int)m_vSizeClasses.size())
+		m_vSizeClasses.push_back({Size, nullptr});
+	CSizeClass *pClass = &m_vSizeClasses[SizeClass];
+
+	if(!pClass->m_pFirstFree)
+	{
+		// carve a new slab into free slots
+		const size_t SlotSize = SlotHeaderSize() + ((Size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1));
+		char *pSlab = (char *)malloc(SlotSize * SLOTS_PER_SLAB);
+		m_vpSlabs.push_back(pSlab);
+		for(int i = SLOTS_PER_SLAB - 1; i >= 0; i--)
+		{
+			CSlot *pSlot = (CSlot *)(pSlab + i * SlotSize);
+			pSlot->m_pPool = this;
+			pSlot->m_SizeClass = SizeClass;
+			pSlot->m_pNextFree = pClass->m_pFirstFree;
+			pClass->m_pFirstFree = pSlot;
+			ASAN_POISON_MEMORY_REGION((char *)pSlot + SlotHeaderSize(), Size);
+		}
+		m_NumSlots += SLOTS_PER_SLAB;
+	}
+
+	CSlot *pSlot = pClass->m_pFirstFree;
+	pClass->m_pFirstFree = pSlot->m_pNextFree;
+	pSlot->m_pNextFree = nullptr;
+	m_NumUsed++;
+	return pSlot;
+}
+
+void *CEntityPool::Allocate(CEntityPool *pPool, size_t Size)
+{
+	CSlot *pSlot;
+	if(pPool)
+	{
+		pSlot = pPool->NewSlot(Size);
+	}
+	else
+	{
+		pSlot = (CSlot *)malloc(SlotHeaderSize() + Size);
+		pSlot->m_pPool = nullptr;
+		pSlot->m_pNextFree = nullptr;
+		pSlot->m_SizeClass = -1;
+	}
+	void *pPtr = (char *)pSlot + SlotHeaderSize();
+	ASAN_UNPOISON_MEMORY_REGION(pPtr, Size);
+	mem_zero(pPtr, Size);
+	return pPtr;
+}
+
+void CEntityPool::Free(void *pPtr)
+{
+	if(!pPtr)
+		return;
+	CSlot *pSlot = (CSlot *)((char *)pPtr - SlotHeaderSize());
+	CEntityPool *pPool = pSlot->m_pPool;
+	if(!pPool)
+	{
+		free(pSlot);
+		return;
+	}
+
+	CSizeClass *pClass = &pPool->m_vSizeClasses[pSlot->m_SizeClass];
+	ASAN_POISON_MEMORY_REGION(pPtr, pClass->m_Size);
+	pSlot->m_pNextFree = pClass->m_pFirstFree;
+	pClass->m_pFirstFree = pSlot;
+	pPool->m_NumUsed--;
+}
+
 //////////////////////////////////////////////////
 // game world
 //////////////////////////////////////////////////
@@ -404,7 +495,7 @@ void CGameWorld::NetCharAdd(int ObjID, CNetObj_Character *pCharObj, CNetObj_DDNe
 		}
 		else
 		{
-			pChar = new CCharacter(this, ObjID, pCharObj, pExtended);
+			pChar = new(EntityPool()) CCharacter(this, ObjID, pCharObj, pExtended);
 			InsertEntity(pChar);
 		}
 
@@ -470,7 +561,7 @@ void CGameWorld::NetObjAdd(int ObjID, int ObjType, const void *pObjData, const C
 					NetProj.m_Owner = pClosest->m_ID;
 			}
 		}
-		CProjectile *pProj = new CProjectile(NetProj);
+		CProjectile *pProj = new(EntityPool()) CProjectile(NetProj);
 		InsertEntity(pProj);
 	}
 	else if((ObjType == NETOBJTYPE_PICKUP || ObjType == NETOBJTYPE_DDNETPICKUP) && m_WorldConfig.m_PredictWeapons)
@@ -486,7 +577,7 @@ void CGameWorld::NetObjAdd(int ObjID, int ObjType, const void *pObjData, const C
 				return;
 			}
 		}
-		CEntity *pEnt = new CPickup(NetPickup);
+		CEntity *pEnt = new(EntityPool()) CPickup(NetPickup);
 		InsertEntity(pEnt, true);
 	}
 	else if((ObjType == NETOBJTYPE_LASER || ObjType == NETOBJTYPE_DDNETLASER) && m_WorldConfig.m_PredictWeapons)
@@ -540,7 +631,7 @@ void CGameWorld::NetObjAdd(int ObjID, int ObjType, const void *pObjData, const C
 					pDragger->Read(&Data);
 					return;
 				}
-				CEntity *pEnt = new CDragger(NetDragger);
+				CEntity *pEnt = new(EntityPool()) CDragger(NetDragger);
 				InsertEntity(pEnt);
 			}
 		}
@@ -603,7 +694,7 @@ void CGameWorld::CopyWorld(CGameWorld *pFrom)
 	m_pTuningList = pFrom->m_pTuningList;
 	m_Teams = pFrom->m_Teams;
 	m_Core.m_vSwitchers = pFrom->m_Core.m_vSwitchers;
-	// delete the previous entities
+	// delete the previous entities, their slots are reused for the copies
 	Clear();
 	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
@@ -617,15 +708,15 @@ void CGameWorld::CopyWorld(CGameWorld *pFrom)
 		{
 			CEntity *pCopy = 0;
 			if(Type == ENTTYPE_PROJECTILE)
-				pCopy = new CProjectile(*((CProjectile *)pEnt));
+				pCopy = new(EntityPool()) CProjectile(*((CProjectile *)pEnt));
 			else if(Type == ENTTYPE_LASER)
-				pCopy = new CLaser(*((CLaser *)pEnt));
+				pCopy = new(EntityPool()) CLaser(*((CLaser *)pEnt));
 			else if(Type == ENTTYPE_DRAGGER)
-				pCopy = new CDragger(*((CDragger *)pEnt));
+				pCopy = new(EntityPool()) CDragger(*((CDragger *)pEnt));
 			else if(Type == ENTTYPE_CHARACTER)
-				pCopy = new CCharacter(*((CCharacter *)pEnt));
+				pCopy = new(EntityPool()) CCharacter(*((CCharacter *)pEnt));
 			else if(Type == ENTTYPE_PICKUP)
-				pCopy = new CPickup(*((CPickup *)pEnt));
+				pCopy = new(EntityPool()) CPickup(*((CPickup *)pEnt));
 			if(pCopy)
 			{
 				pCopy->m_pParent = pEnt;
@@ -13,6 +13,53 @@ class CCollision;
 class CCharacter;
 class CEntity;
 
+// Keeps the memory of the entities of one world around after they are
+// destroyed, so the next copy of the world reuses the freed slots instead
+// of going to the heap. Slots are grouped by object size, which gives every
+// entity type its own free list.
+class CEntityPool
+{
+public:
+	CEntityPool() = default;
+	CEntityPool(const CEntityPool &) = delete;
+	CEntityPool &operator=(const CEntityPool &) = delete;
+	~CEntityPool();
+
+	// a null pool allocates the entity on the heap
+	static void *Allocate(CEntityPool *pPool, size_t Size);
+	static void Free(void *pPtr);
+
+	int NumUsed() const { return m_NumUsed; }
+	int NumSlots() const { return m_NumSlots; }
+
+private:
+	enum
+	{
+		SLOTS_PER_SLAB = 32,
+	};
+
+	struct CSlot
+	{
+		CEntityPool *m_pPool;
+		CSlot *m_pNextFree;
+		int m_SizeClass;
+	};
+
+	struct CSizeClass
+	{
+		size_t m_Size;
+		CSlot *m_pFirstFree;
+	};
+
+	static size_t SlotHeaderSize();
+	CSlot *NewSlot(size_t Size);
+
+	std::vector<CSizeClass> m_vSizeClasses;
+	std::vector<void *> m_vpSlabs;
+	int m_NumUsed = 0;
+	int m_NumSlots = 0;
+};
+
 class CGameWorld
 {
 public:
@@ -104,9 +151,14 @@ public:
 	CTuningParams *TuningList() { return m_pTuningList; }
 	CTuningParams *GetTuning(int i) { return &TuningList()[i]; }
 
+	CEntityPool *EntityPool() { return &m_EntityPool; }
+
 private:
 	void RemoveEntities();
 
+	// outlives the entities, ~CGameWorld() clears them before the members are destroyed
+	CEntityPool m_EntityPool;
+
 	CEntity *m_pNextTraverseEntity = nullptr;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
 
@@ -131,6 +131,13 @@ public:
 	};
 	SSkinMetrics m_Metrics;
 
+	// the textures are only uploaded while the skin is in use, they are
+	// reloaded from this file when it's found again after being evicted
+	char m_aPath[IO_MAX_PATH_LENGTH] = "";
+	int m_StorageType = 0;
+	bool m_Resident = false;
+	int m_LastUsed = 0;
+
 	bool operator<(const CSkin &Other) const { return str_comp(m_aName, Other.m_aName) < 0; }
 	bool operator==(const CSkin &Other) const { return !str_comp(m_aName, Other.m_aName); }
 
@@ -7862,6 +7862,11 @@ void CEditor::HandleWriterFinishJobs()
 	str_format(aBuf, sizeof(aBuf), "saving '%s' done", pJob->GetRealFileName());
 	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "editor/save", aBuf);
 
+	// the client finds the map by its hash when a server runs it
+	SHA256_DIGEST Sha256;
+	if(Storage()->CalculateHashes(pJob->GetRealFileName(), IStorage::TYPE_SAVE, &Sha256))
+		Storage()->AddMapToIndex(pJob->GetRealFileName(), Sha256);
+
 	// send rcon.. if we can
 	if(Client()->RconAuthed())
 	{
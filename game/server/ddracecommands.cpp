@@ -350,6 +350,7 @@ void CGameContext::Teleport(CCharacter *pChr, vec2 Pos)
 {
 	pChr->Core()->m_Pos = Pos;
 	pChr->m_Pos = Pos;
+	pChr->GameWorld()->UpdateGridPosition(pChr);
 	pChr->m_PrevPos = Pos;
 	pChr->m_DDRaceState = DDRACE_CHEAT;
 }
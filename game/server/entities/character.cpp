@@ -806,6 +806,7 @@ void CCharacter::TickDeferred()
 	m_Core.Quantize();
 	bool StuckAfterQuant = Collision()->TestBox(m_Core.m_Pos, CCharacterCore::PhysicalSizeVec2());
 	m_Pos = m_Core.m_Pos;
+	GameWorld()->UpdateGridPosition(this);
 
 	if(!StuckBefore && (StuckAfterMove || StuckAfterQuant))
 	{
@@ -861,6 +862,7 @@ void CCharacter::TickDeferred()
 	{
 		m_Pos.x = m_Input.m_TargetX;
 		m_Pos.y = m_Input.m_TargetY;
+		GameWorld()->UpdateGridPosition(this);
 	}
 
 	// update the m_SendCore if needed
@@ -81,3 +81,15 @@ void CDoor::Snap(int SnappingClient)
 	GameServer()->SnapLaserObject(CSnapContext(SnappingClientVersion), GetID(),
 		m_Pos, From, StartTick, -1, LASERTYPE_DOOR, 0, m_Number);
 }
+
+bool CDoor::SnapShared(const CSnapContext &Context, CGameWorld::CSnapVisibility *pVisibility)
+{
+	// old clients see the door depending on the switch state of their team
+	if(Context.GetClientVersion() < VERSION_DDNET_ENTITY_NETOBJS)
+		return false;
+
+	pVisibility->m_To = m_To;
+	GameServer()->SnapLaserObject(CSnapContext(Context.GetClientVersion()), GetID(),
+		m_Pos, m_To, -1, -1, LASERTYPE_DOOR, 0, m_Number);
+	return true;
+}
@@ -19,6 +19,7 @@ public:
 
 	void Reset() override;
 	void Snap(int SnappingClient) override;
+	bool SnapShared(const CSnapContext &Context, CGameWorld::CSnapVisibility *pVisibility) override;
 };
 
 #endif // GAME_SERVER_ENTITIES_DOOR_H
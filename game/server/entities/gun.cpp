@@ -178,3 +178,15 @@ void CGun::Snap(int SnappingClient)
 	GameServer()->SnapLaserObject(CSnapContext(SnappingClientVersion), GetID(),
 		m_Pos, m_Pos, StartTick, -1, LASERTYPE_GUN, Subtype, m_Number);
 }
+
+bool CGun::SnapShared(const CSnapContext &Context, CGameWorld::CSnapVisibility *pVisibility)
+{
+	// old clients get the blinking of turned off turrets emulated per team
+	if(Context.GetClientVersion() < VERSION_DDNET_ENTITY_NETOBJS)
+		return false;
+
+	int Subtype = (m_Explosive ? 1 : 0) | (m_Freeze ? 2 : 0);
+	GameServer()->SnapLaserObject(CSnapContext(Context.GetClientVersion()), GetID(),
+		m_Pos, m_Pos, -1, -1, LASERTYPE_GUN, Subtype, m_Number);
+	return true;
+}
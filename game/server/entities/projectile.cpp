@@ -359,6 +359,29 @@ void CProjectile::Snap(int SnappingClient)
 	}
 }
 
+bool CProjectile::SnapShared(const CSnapContext &Context, CGameWorld::CSnapVisibility *pVisibility)
+{
+	// old clients get the blinking of switched projectiles emulated per team
+	if(Context.GetClientVersion() < VERSION_DDNET_ENTITY_NETOBJS)
+		return false;
+
+	float Ct = (Server()->Tick() - m_StartTick) / (float)Server()->TickSpeed();
+	pVisibility->m_Pos = GetPos(Ct);
+	pVisibility->m_To = pVisibility->m_Pos;
+
+	if(m_Owner != -1)
+	{
+		CCharacter *pOwnerChar = GameServer()->GetPlayerChar(m_Owner);
+		if(pOwnerChar && pOwnerChar->IsAlive())
+			pVisibility->m_Mask = pOwnerChar->TeamMask();
+	}
+
+	CNetObj_DDNetProjectile *pDDNetProjectile = static_cast<CNetObj_DDNetProjectile *>(Server()->SnapNewItem(NETOBJTYPE_DDNETPROJECTILE, GetID(), sizeof(CNetObj_DDNetProjectile)));
+	if(pDDNetProjectile)
+		FillExtraInfo(pDDNetProjectile);
+	return true;
+}
+
 void CProjectile::SwapClients(int Client1, int Client2)
 {
 	m_Owner = m_Owner == Client1 ? Client2 : m_Owner == Client2 ? Client1 : m_Owner;
@@ -11,6 +11,7 @@
 
 class CCollision;
 class CGameContext;
+struct CSnapContext;
 
 /*
 	Class: Entity
@@ -25,6 +26,10 @@ private:
 	CEntity *m_pPrevTypeEntity;
 	CEntity *m_pNextTypeEntity;
 
+	// broadphase grid, only used for the types the world indexes
+	friend CEntityGrid<CEntity>;
+	CEntityGrid<CEntity>::CNode m_GridNode;
+
 	/* Identity */
 	CGameWorld *m_pGameWorld;
 	CCollision *m_pCCollision;
@@ -122,6 +127,25 @@ public: // TODO: Maybe make protected
 	*/
 	virtual void Snap(int SnappingClient) {}
 
+	/*
+		Function: SnapShared
+			Called once per snapshot context before the client snapshots
+			are built, to create snapshot items that are shared by all
+			clients of this context.
+
+		Arguments:
+			Context - Version of the clients the items are created for.
+			pVisibility - Positions and client mask that decide which
+				clients receive the items, defaults to the entity
+				position and all clients.
+
+		Returns:
+			False if the items depend on the snapping client beyond
+			network clipping and the client mask. <Snap> is then
+			called for each client as usual.
+	*/
+	virtual bool SnapShared(const CSnapContext &Context, CGameWorld::CSnapVisibility *pVisibility) { return false; }
+
 	/*
 		Function: SwapClients
 			Called when two players have swapped their client ids.
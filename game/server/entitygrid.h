@@ -0,0 +1,165 @@
+#ifndef GAME_SERVER_ENTITYGRID_H
+#define GAME_SERVER_ENTITYGRID_H
+
+#include <base/vmath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+	Class: Entity Grid
+		Broadphase for the queries of the game world. Cells are hashed into
+		a fixed number of buckets, so the grid does not depend on the map
+		size. Entities are returned in the reverse order of their insertion,
+		which is the order of the entity lists of the world.
+
+		The entity type needs a vec2 m_Pos, GetProximityRadius() and a
+		CEntityGrid<T>::CNode m_GridNode the grid can access.
+*/
+template<typename T>
+class CEntityGrid
+{
+public:
+	enum
+	{
+		CELL_SIZE = 256,
+		NUM_BUCKETS = 256,
+	};
+
+	class CNode
+	{
+		friend CEntityGrid;
+
+		T *m_pPrev = nullptr;
+		T *m_pNext = nullptr;
+		int m_Bucket = -1;
+		int m_X = 0;
+		int m_Y = 0;
+		int64_t m_InsertOrder = 0;
+	};
+
+private:
+	T *m_apBuckets[NUM_BUCKETS] = {nullptr};
+	float m_MaxRadius = 0.0f;
+	int64_t m_NextInsertOrder = 0;
+
+	static int Coord(float Value)
+	{
+		// also catches NaN, such positions never pass the exact tests anyway
+		if(!(Value > -1e7f))
+			Value = -1e7f;
+		else if(Value > 1e7f)
+			Value = 1e7f;
+		return (int)std::floor(Value / CELL_SIZE);
+	}
+
+	static int Bucket(int X, int Y)
+	{
+		return (((unsigned)X * 73856093u) ^ ((unsigned)Y * 19349663u)) % NUM_BUCKETS;
+	}
+
+	void Link(T *pEnt)
+	{
+		CNode &Node = pEnt->m_GridNode;
+		Node.m_X = Coord(pEnt->m_Pos.x);
+		Node.m_Y = Coord(pEnt->m_Pos.y);
+		Node.m_Bucket = Bucket(Node.m_X, Node.m_Y);
+
+		T *&pHead = m_apBuckets[Node.m_Bucket];
+		if(pHead)
+			pHead->m_GridNode.m_pPrev = pEnt;
+		Node.m_pNext = pHead;
+		Node.m_pPrev = nullptr;
+		pHead = pEnt;
+
+		m_MaxRadius = maximum(m_MaxRadius, pEnt->GetProximityRadius());
+	}
+
+	void Unlink(T *pEnt)
+	{
+		CNode &Node = pEnt->m_GridNode;
+		if(Node.m_pPrev)
+			Node.m_pPrev->m_GridNode.m_pNext = Node.m_pNext;
+		else
+			m_apBuckets[Node.m_Bucket] = Node.m_pNext;
+		if(Node.m_pNext)
+			Node.m_pNext->m_GridNode.m_pPrev = Node.m_pPrev;
+
+		Node.m_pNext = nullptr;
+		Node.m_pPrev = nullptr;
+		Node.m_Bucket = -1;
+	}
+
+public:
+	// the largest proximity radius of all entities that were ever inserted
+	float MaxRadius() const { return m_MaxRadius; }
+
+	void Insert(T *pEnt)
+	{
+		pEnt->m_GridNode.m_InsertOrder = m_NextInsertOrder++;
+		Link(pEnt);
+	}
+
+	void Remove(T *pEnt)
+	{
+		if(pEnt->m_GridNode.m_Bucket >= 0)
+			Unlink(pEnt);
+	}
+
+	// moves the entity to the cell of its current position
+	void Update(T *pEnt)
+	{
+		if(pEnt->m_GridNode.m_Bucket < 0 || IsCurrent(pEnt))
+			return;
+		Unlink(pEnt);
+		Link(pEnt);
+	}
+
+	// whether the entity is in the cell of its current position
+	bool IsCurrent(const T *pEnt) const
+	{
+		return pEnt->m_GridNode.m_X == Coord(pEnt->m_Pos.x) && pEnt->m_GridNode.m_Y == Coord(pEnt->m_Pos.y);
+	}
+
+	// fills vpResult with the entities that may be within the box, newest first
+	void Query(vec2 Min, vec2 Max, std::vector<T *> &vpResult) const
+	{
+		vpResult.clear();
+
+		const int MinX = Coord(Min.x);
+		const int MinY = Coord(Min.y);
+		const int MaxX = Coord(Max.x);
+		const int MaxY = Coord(Max.y);
+		if((int64_t)(MaxX - MinX + 1) * (MaxY - MinY + 1) > NUM_BUCKETS)
+		{
+			// the box covers most of the buckets anyway
+			for(T *pHead : m_apBuckets)
+				for(T *pEnt = pHead; pEnt; pEnt = pEnt->m_GridNode.m_pNext)
+					vpResult.push_back(pEnt);
+		}
+		else
+		{
+			for(int y = MinY; y <= MaxY; y++)
+			{
+				for(int x = MinX; x <= MaxX; x++)
+				{
+					// other cells can share the bucket, only take the
+					// entities of this cell so none is added twice
+					for(T *pEnt = m_apBuckets[Bucket(x, y)]; pEnt; pEnt = pEnt->m_GridNode.m_pNext)
+					{
+						if(pEnt->m_GridNode.m_X == x && pEnt->m_GridNode.m_Y == y)
+							vpResult.push_back(pEnt);
+					}
+				}
+			}
+		}
+
+		std::sort(vpResult.begin(), vpResult.end(), [](const T *pA, const T *pB) {
+			return pA->m_GridNode.m_InsertOrder > pB->m_GridNode.m_InsertOrder;
+		});
+	}
+};
+
+#endif
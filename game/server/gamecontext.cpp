@@ -110,6 +110,7 @@ void CGameContext::Construct(int Resetting)
 
 	m_aDeleteTempfile[0] = 0;
 	m_TeeHistorianActive = false;
+	m_TeeHistorianCompressed = false;
 }
 
 void CGameContext::Destruct(int Resetting)
@@ -164,7 +165,10 @@ void CGameContext::Clear()
 void CGameContext::TeeHistorianWrite(const void *pData, int DataSize, void *pUser)
 {
 	CGameContext *pSelf = (CGameContext *)pUser;
-	aio_write(pSelf->m_pTeeHistorianFile, pData, DataSize);
+	if(pSelf->m_TeeHistorianCompressed)
+		CTeeHistorianCompressor::QueueWrite(pSelf->m_pTeeHistorianFile, pSelf->Server()->Tick(), pData, DataSize);
+	else
+		aio_write(pSelf->m_pTeeHistorianFile, pData, DataSize);
 }
 
 void CGameContext::CommandCallback(int ClientID, int FlagMask, const char *pCmd, IConsole::IResult *pResult, void *pUser)
@@ -3623,8 +3627,10 @@ void CGameContext::OnInit(const void *pPersistentData)
 		char aGameUuid[UUID_MAXSTRSIZE];
 		FormatUuid(m_GameUuid, aGameUuid, sizeof(aGameUuid));
 
+		m_TeeHistorianCompressed = g_Config.m_SvTeeHistorianCompress;
+
 		char aFilename[IO_MAX_PATH_LENGTH];
-		str_format(aFilename, sizeof(aFilename), "teehistorian/%s.teehistorian", aGameUuid);
+		str_format(aFilename, sizeof(aFilename), "teehistorian/%s.teehistorian%s", aGameUuid, m_TeeHistorianCompressed ? ".z" : "");
 
 		IOHANDLE THFile = Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
 		if(!THFile)
@@ -3637,7 +3643,15 @@ void CGameContext::OnInit(const void *pPersistentData)
 		{
 			dbg_msg("teehistorian", "recording to '%s'", aFilename);
 		}
-		m_pTeeHistorianFile = aio_new(THFile);
+		if(m_TeeHistorianCompressed)
+		{
+			m_TeeHistorianCompressor = CTeeHistorianCompressor();
+			m_pTeeHistorianFile = aio_new_filtered(THFile, CTeeHistorianCompressor::AioWrite, CTeeHistorianCompressor::AioFinish, &m_TeeHistorianCompressor);
+		}
+		else
+		{
+			m_pTeeHistorianFile = aio_new(THFile);
+		}
 
 		char aVersion[128];
 		if(GIT_SHORTREV_HASH)
@@ -4045,9 +4059,14 @@ void CGameContext::OnSnap(int ClientID)
 	m_World.Snap(ClientID);
 	m_Events.Snap(ClientID);
 }
-void CGameContext::OnPreSnap() {}
+void CGameContext::OnPreSnap()
+{
+	m_World.SnapShared();
+}
+
 void CGameContext::OnPostSnap()
 {
+	m_World.ClearSharedSnap();
 	m_Events.Clear();
 }
 
@@ -93,6 +93,8 @@ class CGameContext : public IGameServer
 	bool m_TeeHistorianActive;
 	CTeeHistorian m_TeeHistorian;
 	ASYNCIO *m_pTeeHistorianFile;
+	bool m_TeeHistorianCompressed;
+	CTeeHistorianCompressor m_TeeHistorianCompressor;
 	CUuid m_GameUuid;
 	CMapBugs m_MapBugs;
 	CPrng m_Prng;
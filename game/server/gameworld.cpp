@@ -8,6 +8,7 @@
 #include "gamecontroller.h"
 
 #include <engine/shared/config.h>
+#include <engine/shared/snapshot.h>
 
 #include <algorithm>
 #include <utility>
@@ -25,6 +26,8 @@ CGameWorld::CGameWorld()
 	m_ResetRequested = false;
 	for(auto &pFirstEntityType : m_apFirstEntityTypes)
 		pFirstEntityType = 0;
+	for(auto &SharedSnapIndex : m_aSharedSnapIndex)
+		SharedSnapIndex = -1;
 }
 
 CGameWorld::~CGameWorld()
@@ -47,12 +50,44 @@ CEntity *CGameWorld::FindFirst(int Type)
 	return Type < 0 || Type >= NUM_ENTTYPES ? 0 : m_apFirstEntityTypes[Type];
 }
 
+void CGameWorld::UpdateGridPosition(CEntity *pEnt)
+{
+	m_CharacterGrid.Update(pEnt);
+}
+
+void CGameWorld::GridQuery(vec2 Min, vec2 Max)
+{
+#ifdef CONF_DEBUG
+	for(CEntity *pEnt = m_apFirstEntityTypes[ENTTYPE_CHARACTER]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		dbg_assert(m_CharacterGrid.IsCurrent(pEnt), "entity moved without UpdateGridPosition");
+#endif
+	m_CharacterGrid.Query(Min, Max, m_vpGridCandidates);
+}
+
 int CGameWorld::FindEntities(vec2 Pos, float Radius, CEntity **ppEnts, int Max, int Type)
 {
 	if(Type < 0 || Type >= NUM_ENTTYPES)
 		return 0;
 
 	int Num = 0;
+	if(IsGridType(Type))
+	{
+		const float Margin = Radius + m_CharacterGrid.MaxRadius() + 1.0f;
+		GridQuery(Pos - vec2(Margin, Margin), Pos + vec2(Margin, Margin));
+		for(CEntity *pEnt : m_vpGridCandidates)
+		{
+			if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
+			{
+				if(ppEnts)
+					ppEnts[Num] = pEnt;
+				Num++;
+				if(Num == Max)
+					break;
+			}
+		}
+		return Num;
+	}
+
 	for(CEntity *pEnt = m_apFirstEntityTypes[Type]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
 	{
 		if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
@@ -81,6 +116,9 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 	pEnt->m_pNextTypeEntity = m_apFirstEntityTypes[pEnt->m_ObjType];
 	pEnt->m_pPrevTypeEntity = 0x0;
 	m_apFirstEntityTypes[pEnt->m_ObjType] = pEnt;
+
+	if(IsGridType(pEnt->m_ObjType))
+		m_CharacterGrid.Insert(pEnt);
 }
 
 void CGameWorld::RemoveEntity(CEntity *pEnt)
@@ -103,15 +141,45 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 
 	pEnt->m_pNextTypeEntity = 0;
 	pEnt->m_pPrevTypeEntity = 0;
+
+	m_CharacterGrid.Remove(pEnt);
+}
+
+void CGameWorld::SnapEntity(CEntity *pEnt, int SnappingClient, const CSharedSnap *pShared, size_t *pEntry)
+{
+	if(!pShared || *pEntry >= pShared->m_vEntries.size() || pShared->m_vEntries[*pEntry].m_pEntity != pEnt)
+	{
+		pEnt->Snap(SnappingClient);
+		return;
+	}
+
+	const CSharedSnapEntry &Entry = pShared->m_vEntries[(*pEntry)++];
+	if(!Entry.m_Visibility.m_Mask.test(SnappingClient))
+		return;
+	if(NetworkClipped(GameServer(), SnappingClient, Entry.m_Visibility.m_Pos) && NetworkClipped(GameServer(), SnappingClient, Entry.m_Visibility.m_To))
+		return;
+
+	for(int i = Entry.m_FirstItem; i < Entry.m_FirstItem + Entry.m_NumItems; i++)
+	{
+		const CSnapItemBuffer::CItem *pItem = pShared->m_pItems->GetItem(i);
+		void *pData = Server()->SnapNewItem(pItem->m_Type, pItem->m_ID, pItem->m_Size);
+		if(pData)
+			mem_copy(pData, pShared->m_pItems->GetItemData(i), pItem->m_Size);
+	}
 }
 
 //
 void CGameWorld::Snap(int SnappingClient)
 {
+	const CSharedSnap *pShared = nullptr;
+	if(SnappingClient >= 0 && m_aSharedSnapIndex[SnappingClient] >= 0)
+		pShared = &m_vSharedSnaps[m_aSharedSnapIndex[SnappingClient]];
+	size_t Entry = 0;
+
 	for(CEntity *pEnt = m_apFirstEntityTypes[ENTTYPE_CHARACTER]; pEnt;)
 	{
 		m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-		pEnt->Snap(SnappingClient);
+		SnapEntity(pEnt, SnappingClient, pShared, &Entry);
 		pEnt = m_pNextTraverseEntity;
 	}
 
@@ -123,12 +191,93 @@ void CGameWorld::Snap(int SnappingClient)
 		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt;)
 		{
 			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
-			pEnt->Snap(SnappingClient);
+			SnapEntity(pEnt, SnappingClient, pShared, &Entry);
 			pEnt = m_pNextTraverseEntity;
 		}
 	}
 }
 
+void CGameWorld::SnapShared()
+{
+	// one shared snapshot per distinct client version
+	m_NumSharedSnaps = 0;
+	for(int ClientID = 0; ClientID < MAX_CLIENTS; ClientID++)
+	{
+		m_aSharedSnapIndex[ClientID] = -1;
+		if(!Server()->ClientIngame(ClientID) || !GameServer()->m_apPlayers[ClientID])
+			continue;
+
+		const int ClientVersion = GameServer()->GetClientVersion(ClientID);
+		const bool Sixup = Server()->IsSixup(ClientID);
+		int Index = 0;
+		while(Index < m_NumSharedSnaps && (m_vSharedSnaps[Index].m_ClientVersion != ClientVersion || m_vSharedSnaps[Index].m_Sixup != Sixup))
+			Index++;
+		if(Index == m_NumSharedSnaps)
+		{
+			if(Index == (int)m_vSharedSnaps.size())
+			{
+				m_vSharedSnaps.emplace_back();
+				m_vSharedSnaps.back().m_pItems = std::make_unique<CSnapItemBuffer>();
+			}
+			m_vSharedSnaps[Index].m_ClientVersion = ClientVersion;
+			m_vSharedSnaps[Index].m_Sixup = Sixup;
+			m_NumSharedSnaps++;
+		}
+		m_aSharedSnapIndex[ClientID] = Index;
+	}
+
+	for(int s = 0; s < m_NumSharedSnaps; s++)
+	{
+		CSharedSnap &Shared = m_vSharedSnaps[s];
+		const CSnapContext Context(Shared.m_ClientVersion, Shared.m_Sixup);
+		Shared.m_pItems->Clear();
+		Shared.m_vEntries.clear();
+
+		const auto SnapSharedEntity = [&](CEntity *pEnt) {
+			CSharedSnapEntry Entry;
+			Entry.m_pEntity = pEnt;
+			Entry.m_Visibility.m_Pos = pEnt->m_Pos;
+			Entry.m_Visibility.m_To = pEnt->m_Pos;
+			Entry.m_Visibility.m_Mask.set();
+			Entry.m_FirstItem = Shared.m_pItems->NumItems();
+			if(pEnt->SnapShared(Context, &Entry.m_Visibility))
+			{
+				Entry.m_NumItems = Shared.m_pItems->NumItems() - Entry.m_FirstItem;
+				Shared.m_vEntries.push_back(Entry);
+			}
+			else
+			{
+				// snapped per client, drop whatever it created
+				Shared.m_pItems->Truncate(Entry.m_FirstItem);
+			}
+		};
+
+		// same order as in Snap
+		Server()->SnapSetItemBuffer(Shared.m_pItems.get());
+		for(CEntity *pEnt = m_apFirstEntityTypes[ENTTYPE_CHARACTER]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+			SnapSharedEntity(pEnt);
+
+		for(int i = 0; i < NUM_ENTTYPES; i++)
+		{
+			if(i == ENTTYPE_CHARACTER)
+				continue;
+
+			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+				SnapSharedEntity(pEnt);
+		}
+		Server()->SnapSetItemBuffer(nullptr);
+	}
+}
+
+void CGameWorld::ClearSharedSnap()
+{
+	for(int s = 0; s < m_NumSharedSnaps; s++)
+		m_vSharedSnaps[s].m_vEntries.clear();
+	m_NumSharedSnaps = 0;
+	for(auto &SharedSnapIndex : m_aSharedSnapIndex)
+		SharedSnapIndex = -1;
+}
+
 void CGameWorld::Reset()
 {
 	// reset all entities
@@ -276,9 +425,12 @@ CCharacter *CGameWorld::IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, v
 	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
 	CCharacter *pClosest = 0;
 
-	CCharacter *p = (CCharacter *)FindFirst(ENTTYPE_CHARACTER);
-	for(; p; p = (CCharacter *)p->TypeNext())
+	const float Margin = Radius + m_CharacterGrid.MaxRadius() + 1.0f;
+	GridQuery(vec2(minimum(Pos0.x, Pos1.x), minimum(Pos0.y, Pos1.y)) - vec2(Margin, Margin),
+		vec2(maximum(Pos0.x, Pos1.x), maximum(Pos0.y, Pos1.y)) + vec2(Margin, Margin));
+	for(CEntity *pEnt : m_vpGridCandidates)
 	{
+		CCharacter *p = (CCharacter *)pEnt;
 		if(p == pNotThis)
 			continue;
 
@@ -314,9 +466,12 @@ CCharacter *CGameWorld::ClosestCharacter(vec2 Pos, float Radius, const CEntity *
 	float ClosestRange = Radius * 2;
 	CCharacter *pClosest = 0;
 
-	CCharacter *p = (CCharacter *)GameServer()->m_World.FindFirst(ENTTYPE_CHARACTER);
-	for(; p; p = (CCharacter *)p->TypeNext())
+	CGameWorld *pWorld = &GameServer()->m_World;
+	const float Margin = Radius + pWorld->m_CharacterGrid.MaxRadius() + 1.0f;
+	pWorld->GridQuery(Pos - vec2(Margin, Margin), Pos + vec2(Margin, Margin));
+	for(CEntity *pEnt : pWorld->m_vpGridCandidates)
 	{
+		CCharacter *p = (CCharacter *)pEnt;
 		if(p == pNotThis)
 			continue;
 
@@ -337,9 +492,12 @@ CCharacter *CGameWorld::ClosestCharacter(vec2 Pos, float Radius, const CEntity *
 std::vector<CCharacter *> CGameWorld::IntersectedCharacters(vec2 Pos0, vec2 Pos1, float Radius, const CEntity *pNotThis)
 {
 	std::vector<CCharacter *> vpCharacters;
-	CCharacter *pChr = (CCharacter *)FindFirst(CGameWorld::ENTTYPE_CHARACTER);
-	for(; pChr; pChr = (CCharacter *)pChr->TypeNext())
+	const float Margin = Radius + m_CharacterGrid.MaxRadius() + 1.0f;
+	GridQuery(vec2(minimum(Pos0.x, Pos1.x), minimum(Pos0.y, Pos1.y)) - vec2(Margin, Margin),
+		vec2(maximum(Pos0.x, Pos1.x), maximum(Pos0.y, Pos1.y)) + vec2(Margin, Margin));
+	for(CEntity *pEnt : m_vpGridCandidates)
 	{
+		CCharacter *pChr = (CCharacter *)pEnt;
 		if(pChr == pNotThis)
 			continue;
 
@@ -5,10 +5,15 @@
 
 #include <game/gamecore.h>
 
+#include "entitygrid.h"
+
+#include <memory>
 #include <vector>
 
 class CEntity;
 class CCharacter;
+class CSnapItemBuffer;
+struct CSnapContext;
 
 /*
 	Class: Game World
@@ -28,13 +33,60 @@ public:
 		NUM_ENTTYPES
 	};
 
+	/*
+		Class: CSnapVisibility
+			Decides which clients receive the shared snapshot items of
+			an entity, see <SnapShared>.
+	*/
+	class CSnapVisibility
+	{
+	public:
+		// the entity is network clipped if both positions are
+		vec2 m_Pos;
+		vec2 m_To;
+		CClientMask m_Mask;
+	};
+
 private:
 	void Reset();
 	void RemoveEntities();
 
+	class CSharedSnapEntry
+	{
+	public:
+		CEntity *m_pEntity;
+		CSnapVisibility m_Visibility;
+		int m_FirstItem;
+		int m_NumItems;
+	};
+
+	class CSharedSnap
+	{
+	public:
+		int m_ClientVersion;
+		bool m_Sixup;
+		std::unique_ptr<CSnapItemBuffer> m_pItems;
+		std::vector<CSharedSnapEntry> m_vEntries;
+	};
+
+	std::vector<CSharedSnap> m_vSharedSnaps;
+	int m_NumSharedSnaps = 0;
+	int m_aSharedSnapIndex[MAX_CLIENTS];
+
+	void SnapEntity(CEntity *pEnt, int SnappingClient, const CSharedSnap *pShared, size_t *pEntry);
+
 	CEntity *m_pNextTraverseEntity = nullptr;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
 
+	// broadphase for the character queries
+	CEntityGrid<CEntity> m_CharacterGrid;
+	std::vector<CEntity *> m_vpGridCandidates;
+
+	static bool IsGridType(int Type) { return Type == ENTTYPE_CHARACTER; }
+	// Fills m_vpGridCandidates with the characters that may be within the
+	// box, in the order of the entity list.
+	void GridQuery(vec2 Min, vec2 Max);
+
 	class CGameContext *m_pGameServer;
 	class CConfig *m_pConfig;
 	class IServer *m_pServer;
@@ -119,6 +171,17 @@ public:
 	*/
 	void RemoveEntity(CEntity *pEntity);
 
+	/*
+		Function: UpdateGridPosition
+			Moves an entity to the grid cell of its current position.
+			Has to be called after every change of the position of
+			a character, the queries rely on it.
+
+		Arguments:
+			pEntity - Entity that moved
+	*/
+	void UpdateGridPosition(CEntity *pEntity);
+
 	void RemoveEntitiesFromPlayer(int PlayerId);
 	void RemoveEntitiesFromPlayers(int PlayerIds[], int NumPlayers);
 
@@ -133,6 +196,20 @@ public:
 	*/
 	void Snap(int SnappingClient);
 
+	/*
+		Function: SnapShared
+			Serializes the entities that support it once per distinct
+			client version instead of once per client. <Snap> then only
+			has to do the network clipping for these entities.
+	*/
+	void SnapShared();
+
+	/*
+		Function: ClearSharedSnap
+			Drops the items created by <SnapShared>.
+	*/
+	void ClearSharedSnap();
+
 	/*
 		Function: Tick
 			Calls Tick on all the entities in the world to progress
@@ -178,6 +178,7 @@ void CSaveTee::Load(CCharacter *pChr, int Team, bool IsSwap)
 		pChr->m_StartTime = pChr->Server()->Tick() - m_Time;
 
 	pChr->m_Pos = m_Pos;
+	pChr->GameWorld()->UpdateGridPosition(pChr);
 	pChr->m_PrevPos = m_PrevPos;
 	pChr->m_TeleCheckpoint = m_TeleCheckpoint;
 	pChr->m_LastPenalty = m_LastPenalty;
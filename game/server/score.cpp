@@ -36,15 +36,60 @@ void CScore::ExecPlayerThread(
 	if(pResult == nullptr)
 		return;
 	auto Tmp = std::make_unique<CSqlPlayerRequest>(pResult);
-	str_copy(Tmp->m_aName, pName, sizeof(Tmp->m_aName));
-	str_copy(Tmp->m_aMap, g_Config.m_SvMap, sizeof(Tmp->m_aMap));
-	str_copy(Tmp->m_aServer, g_Config.m_SvSqlServerName, sizeof(Tmp->m_aServer));
-	str_copy(Tmp->m_aRequestingPlayer, Server()->ClientName(ClientID), sizeof(Tmp->m_aRequestingPlayer));
-	Tmp->m_Offset = Offset;
+	FillPlayerRequest(Tmp.get(), ClientID, pName, Offset);
 
 	m_pPool->Execute(pFuncPtr, std::move(Tmp), pThreadName);
 }
 
+void CScore::FillPlayerRequest(CSqlPlayerRequest *pRequest, int ClientID, const char *pName, int Offset)
+{
+	str_copy(pRequest->m_aName, pName, sizeof(pRequest->m_aName));
+	str_copy(pRequest->m_aMap, g_Config.m_SvMap, sizeof(pRequest->m_aMap));
+	str_copy(pRequest->m_aServer, g_Config.m_SvSqlServerName, sizeof(pRequest->m_aServer));
+	str_copy(pRequest->m_aRequestingPlayer, Server()->ClientName(ClientID), sizeof(pRequest->m_aRequestingPlayer));
+	pRequest->m_Offset = Offset;
+}
+
+bool CScore::ExecFromRanking(
+	void (*pFuncPtr)(const CRankingIndex &, const CRankingIndex &, const CSqlPlayerRequest *, CScorePlayerResult *),
+	int ClientID,
+	const char *pName,
+	int Offset)
+{
+	if(!UpdateRanking())
+		return false;
+	auto pResult = NewSqlPlayerResult(ClientID);
+	if(pResult == nullptr)
+		return true;
+	CSqlPlayerRequest Request(pResult);
+	FillPlayerRequest(&Request, ClientID, pName, Offset);
+	pFuncPtr(m_GlobalRanking, m_RegionalRanking, &Request, pResult.get());
+	pResult->m_Success = true;
+	pResult->m_Completed = true;
+	return true;
+}
+
+bool CScore::UpdateRanking()
+{
+	if(m_pRankingResult != nullptr && m_pRankingResult->m_Completed)
+	{
+		if(m_pRankingResult->m_Success && m_pRankingResult->m_RankingLoaded)
+		{
+			m_GlobalRanking = std::move(m_pRankingResult->m_GlobalRanking);
+			m_RegionalRanking = std::move(m_pRankingResult->m_RegionalRanking);
+			for(const auto &[Name, Time] : m_vPendingFinishes)
+			{
+				m_GlobalRanking.Add(Name.c_str(), Time);
+				m_RegionalRanking.Add(Name.c_str(), Time);
+			}
+			m_RankingLoaded = true;
+		}
+		m_pRankingResult = nullptr;
+		m_vPendingFinishes.clear();
+	}
+	return m_RankingLoaded;
+}
+
 bool CScore::RateLimitPlayer(int ClientID)
 {
 	CPlayer *pPlayer = GameServer()->m_apPlayers[ClientID];
@@ -71,7 +116,8 @@ void CScore::GeneratePassphrase(char *pBuf, int BufSize)
 CScore::CScore(CGameContext *pGameServer, CDbConnectionPool *pPool) :
 	m_pPool(pPool),
 	m_pGameServer(pGameServer),
-	m_pServer(pGameServer->Server())
+	m_pServer(pGameServer->Server()),
+	m_RankingLoaded(false)
 {
 	LoadBestTime();
 
@@ -116,8 +162,12 @@ void CScore::LoadBestTime()
 	auto LoadBestTimeResult = std::make_shared<CScoreLoadBestTimeResult>();
 	m_pGameServer->m_pController->m_pLoadBestTimeResult = LoadBestTimeResult;
 
+	m_pRankingResult = LoadBestTimeResult;
+	m_vPendingFinishes.clear();
+
 	auto Tmp = std::make_unique<CSqlLoadBestTimeData>(LoadBestTimeResult);
 	str_copy(Tmp->m_aMap, g_Config.m_SvMap, sizeof(Tmp->m_aMap));
+	str_copy(Tmp->m_aServer, g_Config.m_SvSqlServerName, sizeof(Tmp->m_aServer));
 	m_pPool->Execute(CScoreWorker::LoadBestTime, std::move(Tmp), "load best time");
 }
 
@@ -160,6 +210,18 @@ void CScore::SaveScore(int ClientID, float Time, const char *pTimestamp, const f
 	for(int i = 0; i < NUM_CHECKPOINTS; i++)
 		Tmp->m_aCurrentTimeCp[i] = aTimeCp[i];
 
+	// the database stores the time with two decimals
+	char aTime[32];
+	str_format(aTime, sizeof(aTime), "%.2f", Time);
+	const float StoredTime = str_tofloat(aTime);
+	if(m_pRankingResult != nullptr)
+		m_vPendingFinishes.emplace_back(Tmp->m_aName, StoredTime);
+	if(UpdateRanking())
+	{
+		m_GlobalRanking.Add(Tmp->m_aName, StoredTime);
+		m_RegionalRanking.Add(Tmp->m_aName, StoredTime);
+	}
+
 	m_pPool->ExecuteWrite(CScoreWorker::SaveScore, std::move(Tmp), "save score");
 }
 
@@ -190,6 +252,8 @@ void CScore::ShowRank(int ClientID, const char *pName)
 {
 	if(RateLimitPlayer(ClientID))
 		return;
+	if(ExecFromRanking(CScoreWorker::ShowRankFromIndex, ClientID, pName, 0))
+		return;
 	ExecPlayerThread(CScoreWorker::ShowRank, "show rank", ClientID, pName, 0);
 }
 
@@ -204,6 +268,8 @@ void CScore::ShowTop(int ClientID, int Offset)
 {
 	if(RateLimitPlayer(ClientID))
 		return;
+	if(ExecFromRanking(CScoreWorker::ShowTopFromIndex, ClientID, "", Offset))
+		return;
 	ExecPlayerThread(CScoreWorker::ShowTop, "show top5", ClientID, "", Offset);
 }
 
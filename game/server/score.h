@@ -21,12 +21,30 @@ class CScore
 	CGameContext *m_pGameServer;
 	IServer *m_pServer;
 
+	// best times of the current map, /rank and /top5 are answered from
+	// these instead of the database once they are loaded
+	std::shared_ptr<CScoreLoadBestTimeResult> m_pRankingResult;
+	CRankingIndex m_GlobalRanking;
+	CRankingIndex m_RegionalRanking;
+	bool m_RankingLoaded;
+	// finishes while the rankings are loading, they might be missing in the result
+	std::vector<std::pair<std::string, float>> m_vPendingFinishes;
+	// returns true if the rankings can be used
+	bool UpdateRanking();
+	// answers the request from the rankings, returns false if they aren't loaded yet
+	bool ExecFromRanking(
+		void (*pFuncPtr)(const CRankingIndex &, const CRankingIndex &, const CSqlPlayerRequest *, CScorePlayerResult *),
+		int ClientID,
+		const char *pName,
+		int Offset);
+
 	std::vector<std::string> m_vWordlist;
 	CPrng m_Prng;
 	void GeneratePassphrase(char *pBuf, int BufSize);
 
 	// returns new SqlResult bound to the player, if no current Thread is active for this player
 	std::shared_ptr<CScorePlayerResult> NewSqlPlayerResult(int ClientID);
+	void FillPlayerRequest(CSqlPlayerRequest *pRequest, int ClientID, const char *pName, int Offset);
 	// Creates for player database requests
 	void ExecPlayerThread(
 		bool (*pFuncPtr)(IDbConnection *, const ISqlData *, char *pError, int ErrorSize),
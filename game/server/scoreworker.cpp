@@ -7,6 +7,7 @@
 #include <engine/server/sql_string_helpers.h>
 #include <engine/shared/config.h>
 
+#include <algorithm>
 #include <cmath>
 
 // "6b407e81-8b77-3e04-a207-8da17f37d000"
@@ -92,6 +93,96 @@ bool CTeamrank::SamePlayers(const std::vector<std::string> *pvSortedNames)
 	return true;
 }
 
+static bool CompareRankingEntries(const CRankingIndex::CEntry &Left, const CRankingIndex::CEntry &Right)
+{
+	if(Left.m_Time != Right.m_Time)
+		return Left.m_Time < Right.m_Time;
+	return str_comp(Left.m_aName, Right.m_aName) < 0;
+}
+
+void CRankingIndex::Clear()
+{
+	m_vEntries.clear();
+	m_BestTimes.clear();
+}
+
+bool CRankingIndex::Add(const char *pName, float Time)
+{
+	CEntry Entry;
+	Entry.m_Time = Time;
+	str_copy(Entry.m_aName, pName, sizeof(Entry.m_aName));
+
+	auto BestTime = m_BestTimes.find(Entry.m_aName);
+	if(BestTime != m_BestTimes.end())
+	{
+		if(BestTime->second <= Time)
+			return false;
+		CEntry Old = Entry;
+		Old.m_Time = BestTime->second;
+		m_vEntries.erase(std::lower_bound(m_vEntries.begin(), m_vEntries.end(), Old, CompareRankingEntries));
+		BestTime->second = Time;
+	}
+	else
+	{
+		m_BestTimes.emplace(Entry.m_aName, Time);
+	}
+	// loaded in order, so this usually appends
+	m_vEntries.insert(std::lower_bound(m_vEntries.begin(), m_vEntries.end(), Entry, CompareRankingEntries), Entry);
+	return true;
+}
+
+std::optional<float> CRankingIndex::BestTime(const char *pName) const
+{
+	auto BestTime = m_BestTimes.find(pName);
+	if(BestTime == m_BestTimes.end())
+		return std::nullopt;
+	return BestTime->second;
+}
+
+int CRankingIndex::Rank(float Time) const
+{
+	auto First = std::lower_bound(m_vEntries.begin(), m_vEntries.end(), Time, [](const CEntry &Entry, float Value) {
+		return Entry.m_Time < Value;
+	});
+	return First - m_vEntries.begin() + 1;
+}
+
+float CRankingIndex::PercentRank(int Rank) const
+{
+	if(m_vEntries.size() <= 1)
+		return 0.0f;
+	return (double)(Rank - 1) / (m_vEntries.size() - 1);
+}
+
+static bool LoadRanking(IDbConnection *pSqlServer, const char *pMap, const char *pServerLike, CRankingIndex *pRanking, char *pError, int ErrorSize)
+{
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf),
+		"SELECT Name, MIN(Time) AS Time "
+		"FROM %s_race "
+		"WHERE Map = ? "
+		"AND Server LIKE ? "
+		"GROUP BY Name "
+		"ORDER BY MIN(Time) ASC, Name ASC",
+		pSqlServer->GetPrefix());
+	if(pSqlServer->PrepareStatement(aBuf, pError, ErrorSize))
+	{
+		return true;
+	}
+	pSqlServer->BindString(1, pMap);
+	pSqlServer->BindString(2, pServerLike);
+
+	pRanking->Clear();
+	bool End = false;
+	while(!pSqlServer->Step(&End, pError, ErrorSize) && !End)
+	{
+		char aName[MAX_NAME_LENGTH];
+		pSqlServer->GetString(1, aName, sizeof(aName));
+		pRanking->Add(aName, pSqlServer->GetFloat(2));
+	}
+	return !End;
+}
+
 bool CScoreWorker::LoadBestTime(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
 {
 	const auto *pData = dynamic_cast<const CSqlLoadBestTimeData *>(pGameData);
@@ -118,6 +209,20 @@ bool CScoreWorker::LoadBestTime(IDbConnection *pSqlServer, const ISqlData *pGame
 		pResult->m_CurrentRecord = pSqlServer->GetFloat(1);
 	}
 
+	// load the rankings once per map so /rank and /top5 don't have to
+	// rank the whole map on every request
+	char aServerLike[16];
+	str_format(aServerLike, sizeof(aServerLike), "%%%s%%", pData->m_aServer);
+	if(LoadRanking(pSqlServer, pData->m_aMap, "%", &pResult->m_GlobalRanking, pError, ErrorSize) ||
+		LoadRanking(pSqlServer, pData->m_aMap, aServerLike, &pResult->m_RegionalRanking, pError, ErrorSize))
+	{
+		// keep the best time, the ranks are queried from the database
+		dbg_msg("sql", "failed to load the ranking: %s", pError);
+		pResult->m_GlobalRanking.Clear();
+		pResult->m_RegionalRanking.Clear();
+		return false;
+	}
+	pResult->m_RankingLoaded = true;
 	return false;
 }
 
@@ -718,6 +823,47 @@ bool CScoreWorker::SaveTeamScore(IDbConnection *pSqlServer, const ISqlData *pGam
 	return false;
 }
 
+static void FormatRank(const CSqlPlayerRequest *pData, CScorePlayerResult *pResult, int Rank, float Time, float PercentRank, const char *pRegionalRank)
+{
+	char aTime[32];
+	str_time_float(Time, TIME_HOURS_CENTISECS, aTime, sizeof(aTime));
+	// CEIL and FLOOR are not supported in SQLite
+	int BetterThanPercent = std::floor(100.0f - 100.0f * PercentRank);
+	if(g_Config.m_SvHideScore)
+	{
+		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+			"Your time: %s, better than %d%%", aTime, BetterThanPercent);
+		return;
+	}
+
+	pResult->m_MessageKind = CScorePlayerResult::ALL;
+
+	if(str_comp_nocase(pData->m_aRequestingPlayer, pData->m_aName) == 0)
+	{
+		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+			"%s - %s - better than %d%%",
+			pData->m_aName, aTime, BetterThanPercent);
+	}
+	else
+	{
+		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+			"%s - %s - better than %d%% - requested by %s",
+			pData->m_aName, aTime, BetterThanPercent, pData->m_aRequestingPlayer);
+	}
+
+	if(g_Config.m_SvRegionalRankings)
+	{
+		str_format(pResult->m_Data.m_aaMessages[1], sizeof(pResult->m_Data.m_aaMessages[1]),
+			"Global rank %d - %s %s",
+			Rank, pData->m_aServer, pRegionalRank);
+	}
+	else
+	{
+		str_format(pResult->m_Data.m_aaMessages[1], sizeof(pResult->m_Data.m_aaMessages[1]),
+			"Global rank %d", Rank);
+	}
+}
+
 bool CScoreWorker::ShowRank(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
 {
 	const auto *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
@@ -782,45 +928,7 @@ bool CScoreWorker::ShowRank(IDbConnection *pSqlServer, const ISqlData *pGameData
 
 	if(!End)
 	{
-		int Rank = pSqlServer->GetInt(1);
-		float Time = pSqlServer->GetFloat(2);
-		// CEIL and FLOOR are not supported in SQLite
-		int BetterThanPercent = std::floor(100.0f - 100.0f * pSqlServer->GetFloat(3));
-		str_time_float(Time, TIME_HOURS_CENTISECS, aBuf, sizeof(aBuf));
-		if(g_Config.m_SvHideScore)
-		{
-			str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-				"Your time: %s, better than %d%%", aBuf, BetterThanPercent);
-		}
-		else
-		{
-			pResult->m_MessageKind = CScorePlayerResult::ALL;
-
-			if(str_comp_nocase(pData->m_aRequestingPlayer, pData->m_aName) == 0)
-			{
-				str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-					"%s - %s - better than %d%%",
-					pData->m_aName, aBuf, BetterThanPercent);
-			}
-			else
-			{
-				str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
-					"%s - %s - better than %d%% - requested by %s",
-					pData->m_aName, aBuf, BetterThanPercent, pData->m_aRequestingPlayer);
-			}
-
-			if(g_Config.m_SvRegionalRankings)
-			{
-				str_format(pResult->m_Data.m_aaMessages[1], sizeof(pResult->m_Data.m_aaMessages[1]),
-					"Global rank %d - %s %s",
-					Rank, pData->m_aServer, aRegionalRank);
-			}
-			else
-			{
-				str_format(pResult->m_Data.m_aaMessages[1], sizeof(pResult->m_Data.m_aaMessages[1]),
-					"Global rank %d", Rank);
-			}
-		}
+		FormatRank(pData, pResult, pSqlServer->GetInt(1), pSqlServer->GetFloat(2), pSqlServer->GetFloat(3), aRegionalRank);
 	}
 	else
 	{
@@ -830,6 +938,31 @@ bool CScoreWorker::ShowRank(IDbConnection *pSqlServer, const ISqlData *pGameData
 	return false;
 }
 
+void CScoreWorker::ShowRankFromIndex(const CRankingIndex &GlobalRanking, const CRankingIndex &RegionalRanking, const CSqlPlayerRequest *pData, CScorePlayerResult *pResult)
+{
+	std::optional<float> Time = GlobalRanking.BestTime(pData->m_aName);
+	if(!Time.has_value())
+	{
+		str_format(pResult->m_Data.m_aaMessages[0], sizeof(pResult->m_Data.m_aaMessages[0]),
+			"%s is not ranked", pData->m_aName);
+		return;
+	}
+
+	char aRegionalRank[16];
+	std::optional<float> RegionalTime = RegionalRanking.BestTime(pData->m_aName);
+	if(RegionalTime.has_value())
+	{
+		str_format(aRegionalRank, sizeof(aRegionalRank), "rank %d", RegionalRanking.Rank(*RegionalTime));
+	}
+	else
+	{
+		str_copy(aRegionalRank, "unranked", sizeof(aRegionalRank));
+	}
+
+	int Rank = GlobalRanking.Rank(*Time);
+	FormatRank(pData, pResult, Rank, *Time, GlobalRanking.PercentRank(Rank), aRegionalRank);
+}
+
 bool CScoreWorker::ShowTeamRank(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
 {
 	const auto *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
@@ -1006,6 +1139,39 @@ bool CScoreWorker::ShowTop(IDbConnection *pSqlServer, const ISqlData *pGameData,
 	return !End;
 }
 
+static void AddTopLines(const CRankingIndex &Ranking, int Offset, int Num, CScorePlayerResult *pResult, int *pLine)
+{
+	int Start = maximum(absolute(Offset) - 1, 0);
+	char aTime[32];
+	for(int i = Start; i < Start + Num && i < Ranking.Num(); i++)
+	{
+		const CRankingIndex::CEntry &Entry = Ranking.Entry(Offset >= 0 ? i : Ranking.Num() - 1 - i);
+		str_time_float(Entry.m_Time, TIME_HOURS_CENTISECS, aTime, sizeof(aTime));
+		str_format(pResult->m_Data.m_aaMessages[*pLine], sizeof(pResult->m_Data.m_aaMessages[*pLine]),
+			"%d. %s Time: %s", Ranking.Rank(Entry.m_Time), Entry.m_aName, aTime);
+		(*pLine)++;
+	}
+}
+
+void CScoreWorker::ShowTopFromIndex(const CRankingIndex &GlobalRanking, const CRankingIndex &RegionalRanking, const CSqlPlayerRequest *pData, CScorePlayerResult *pResult)
+{
+	int Line = 0;
+	str_copy(pResult->m_Data.m_aaMessages[Line], "------------ Global Top ------------", sizeof(pResult->m_Data.m_aaMessages[Line]));
+	Line++;
+	AddTopLines(GlobalRanking, pData->m_Offset, 5, pResult, &Line);
+
+	if(!g_Config.m_SvRegionalRankings)
+	{
+		str_copy(pResult->m_Data.m_aaMessages[Line], "----------------------------------------", sizeof(pResult->m_Data.m_aaMessages[Line]));
+		return;
+	}
+
+	str_format(pResult->m_Data.m_aaMessages[Line], sizeof(pResult->m_Data.m_aaMessages[Line]),
+		"------------ %s Top ------------", pData->m_aServer);
+	Line++;
+	AddTopLines(RegionalRanking, pData->m_Offset, 3, pResult, &Line);
+}
+
 bool CScoreWorker::ShowTeamTop5(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize)
 {
 	const auto *pData = dynamic_cast<const CSqlPlayerRequest *>(pGameData);
@@ -4,6 +4,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -61,13 +62,48 @@ struct CScorePlayerResult : ISqlResult
 	void SetVariant(Variant v);
 };
 
+// Best time of every player on a map, sorted by time. Answers the ranks
+// the window function queries of ShowRank and ShowTop compute without
+// going through the database.
+class CRankingIndex
+{
+public:
+	struct CEntry
+	{
+		float m_Time;
+		char m_aName[MAX_NAME_LENGTH];
+	};
+
+	void Clear();
+	// returns true if this is the first or a better time of the player
+	bool Add(const char *pName, float Time);
+
+	int Num() const { return m_vEntries.size(); }
+	const CEntry &Entry(int Index) const { return m_vEntries[Index]; }
+	std::optional<float> BestTime(const char *pName) const;
+	// same as RANK() OVER (ORDER BY MIN(Time)), starting at 1
+	int Rank(float Time) const;
+	// same as PERCENT_RANK() OVER (ORDER BY MIN(Time))
+	float PercentRank(int Rank) const;
+
+private:
+	std::vector<CEntry> m_vEntries;
+	std::unordered_map<std::string, float> m_BestTimes;
+};
+
 struct CScoreLoadBestTimeResult : ISqlResult
 {
 	CScoreLoadBestTimeResult() :
-		m_CurrentRecord(0)
+		m_CurrentRecord(0),
+		m_RankingLoaded(false)
 	{
 	}
 	float m_CurrentRecord;
+	// if the rankings failed to load they stay empty and ranks are
+	// queried from the database instead
+	bool m_RankingLoaded;
+	CRankingIndex m_GlobalRanking;
+	CRankingIndex m_RegionalRanking;
 };
 
 struct CSqlLoadBestTimeData : ISqlData
@@ -79,6 +115,8 @@ struct CSqlLoadBestTimeData : ISqlData
 
 	// current map
 	char m_aMap[MAX_MAP_LENGTH];
+	// server for the regional ranking
+	char m_aServer[5] = "";
 };
 
 struct CSqlPlayerRequest : ISqlData
@@ -295,6 +333,10 @@ struct CScoreWorker
 	static bool ShowTopPoints(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
 	static bool GetSaves(IDbConnection *pSqlServer, const ISqlData *pGameData, char *pError, int ErrorSize);
 
+	// answer from the rankings loaded by LoadBestTime instead of the database
+	static void ShowRankFromIndex(const CRankingIndex &GlobalRanking, const CRankingIndex &RegionalRanking, const CSqlPlayerRequest *pData, CScorePlayerResult *pResult);
+	static void ShowTopFromIndex(const CRankingIndex &GlobalRanking, const CRankingIndex &RegionalRanking, const CSqlPlayerRequest *pData, CScorePlayerResult *pResult);
+
 	static bool SaveTeam(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize);
 	static bool LoadTeam(IDbConnection *pSqlServer, const ISqlData *pGameData, Write w, char *pError, int ErrorSize);
 
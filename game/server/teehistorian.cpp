@@ -6,6 +6,8 @@
 #include <engine/shared/snapshot.h>
 #include <game/gamecore.h>
 
+#include <zlib.h>
+
 static const char TEEHISTORIAN_NAME[] = "teehistorian@ddnet.tw";
 static const CUuid TEEHISTORIAN_UUID = CalculateUuid(TEEHISTORIAN_NAME);
 static const char TEEHISTORIAN_VERSION[] = "2";
@@ -818,3 +820,280 @@ void CTeeHistorian::Finish()
 
 	Write(Buffer.Data(), Buffer.Size());
 }
+
+static const unsigned char gs_aTeeHistorianBlocksMagic[8] = {'T', 'H', 'B', 'L', 'O', 'C', 'K', 'S'};
+static const unsigned char gs_aTeeHistorianIndexMagic[4] = {'T', 'H', 'I', 'X'};
+static const unsigned char gs_TeeHistorianBlocksVersion = 1;
+
+static void Int64ToBytesBe(unsigned char *pBytes, int64_t Value)
+{
+	uint_to_bytes_be(pBytes, (uint64_t)Value >> 32);
+	uint_to_bytes_be(pBytes + 4, (uint64_t)Value & 0xffffffff);
+}
+
+static int64_t BytesBeToInt64(const unsigned char *pBytes)
+{
+	return (int64_t)(((uint64_t)bytes_be_to_uint(pBytes) << 32) | bytes_be_to_uint(pBytes + 4));
+}
+
+// io_seek only takes int offsets, but the files can grow past 2 GiB
+static bool SeekTo(IOHANDLE File, int64_t Offset)
+{
+	if(io_seek(File, 0, IOSEEK_START) != 0)
+		return false;
+	while(Offset > 0)
+	{
+		const int Step = (int)minimum(Offset, (int64_t)0x40000000);
+		if(io_seek(File, Step, IOSEEK_CUR) != 0)
+			return false;
+		Offset -= Step;
+	}
+	return true;
+}
+
+CTeeHistorianCompressor::CTeeHistorianCompressor()
+{
+	m_FrameHeaderSize = 0;
+	m_FrameTick = 0;
+	m_FrameRemaining = 0;
+	m_BlockFirstTick = -1;
+	m_BlockLastTick = -1;
+	m_Offset = 0;
+}
+
+void CTeeHistorianCompressor::QueueWrite(ASYNCIO *pAio, int Tick, const void *pData, int DataSize)
+{
+	// the data is framed with its tick so the ASYNCIO thread can cut the
+	// blocks at tick boundaries
+	int32_t aFrameHeader[2] = {Tick, DataSize};
+	aio_lock(pAio);
+	aio_write_unlocked(pAio, aFrameHeader, sizeof(aFrameHeader));
+	aio_write_unlocked(pAio, pData, DataSize);
+	aio_unlock(pAio);
+}
+
+void CTeeHistorianCompressor::AioWrite(IOHANDLE File, const void *pData, unsigned Size, void *pUser)
+{
+	CTeeHistorianCompressor *pThis = (CTeeHistorianCompressor *)pUser;
+	const unsigned char *pBytes = (const unsigned char *)pData;
+	while(Size > 0)
+	{
+		if(pThis->m_FrameHeaderSize < (int)sizeof(pThis->m_aFrameHeader))
+		{
+			const unsigned Copy = minimum(Size, (unsigned)sizeof(pThis->m_aFrameHeader) - pThis->m_FrameHeaderSize);
+			mem_copy(pThis->m_aFrameHeader + pThis->m_FrameHeaderSize, pBytes, Copy);
+			pThis->m_FrameHeaderSize += Copy;
+			pBytes += Copy;
+			Size -= Copy;
+			if(pThis->m_FrameHeaderSize < (int)sizeof(pThis->m_aFrameHeader))
+				break;
+
+			int32_t aFrameHeader[2];
+			mem_copy(aFrameHeader, pThis->m_aFrameHeader, sizeof(aFrameHeader));
+			pThis->m_FrameTick = aFrameHeader[0];
+			pThis->m_FrameRemaining = aFrameHeader[1];
+		}
+
+		const unsigned Copy = minimum(Size, (unsigned)pThis->m_FrameRemaining);
+		pThis->Write(File, pThis->m_FrameTick, pBytes, Copy);
+		pThis->m_FrameRemaining -= Copy;
+		pBytes += Copy;
+		Size -= Copy;
+		if(pThis->m_FrameRemaining == 0)
+			pThis->m_FrameHeaderSize = 0;
+	}
+}
+
+void CTeeHistorianCompressor::AioFinish(IOHANDLE File, void *pUser)
+{
+	((CTeeHistorianCompressor *)pUser)->Finish(File);
+}
+
+void CTeeHistorianCompressor::Write(IOHANDLE File, int Tick, const void *pData, int DataSize)
+{
+	if(m_Offset == 0)
+	{
+		unsigned char aHeader[HEADER_SIZE] = {0};
+		mem_copy(aHeader, gs_aTeeHistorianBlocksMagic, sizeof(gs_aTeeHistorianBlocksMagic));
+		aHeader[8] = gs_TeeHistorianBlocksVersion;
+		aHeader[9] = CODEC_ZLIB;
+		io_write(File, aHeader, sizeof(aHeader));
+		m_Offset = sizeof(aHeader);
+	}
+
+	if(Tick != m_BlockLastTick && m_vBlock.size() >= (size_t)BLOCK_SIZE)
+		FlushBlock(File);
+
+	if(m_vBlock.empty())
+		m_BlockFirstTick = Tick;
+	m_BlockLastTick = Tick;
+	m_vBlock.insert(m_vBlock.end(), (const unsigned char *)pData, (const unsigned char *)pData + DataSize);
+}
+
+void CTeeHistorianCompressor::FlushBlock(IOHANDLE File)
+{
+	if(m_vBlock.empty())
+		return;
+
+	uLongf CompressedSize = compressBound(m_vBlock.size());
+	m_vCompressed.resize(BLOCK_HEADER_SIZE + CompressedSize);
+	if(compress(m_vCompressed.data() + BLOCK_HEADER_SIZE, &CompressedSize, m_vBlock.data(), m_vBlock.size()) != Z_OK)
+	{
+		dbg_msg("teehistorian", "failed to compress block of %d bytes", (int)m_vBlock.size());
+		m_vBlock.clear();
+		return;
+	}
+
+	unsigned char *pHeader = m_vCompressed.data();
+	uint_to_bytes_be(pHeader, CompressedSize);
+	uint_to_bytes_be(pHeader + 4, m_vBlock.size());
+	uint_to_bytes_be(pHeader + 8, m_BlockFirstTick);
+	uint_to_bytes_be(pHeader + 12, m_BlockLastTick);
+	io_write(File, pHeader, BLOCK_HEADER_SIZE + CompressedSize);
+
+	m_vIndex.push_back({m_Offset, m_BlockFirstTick, m_BlockLastTick});
+	m_Offset += BLOCK_HEADER_SIZE + CompressedSize;
+	m_vBlock.clear();
+}
+
+void CTeeHistorianCompressor::Finish(IOHANDLE File)
+{
+	if(m_Offset == 0)
+		return;
+
+	FlushBlock(File);
+
+	std::vector<unsigned char> vIndex(m_vIndex.size() * INDEX_ENTRY_SIZE + FOOTER_SIZE);
+	unsigned char *pEntry = vIndex.data();
+	for(const CBlockInfo &Block : m_vIndex)
+	{
+		Int64ToBytesBe(pEntry, Block.m_Offset);
+		uint_to_bytes_be(pEntry + 8, Block.m_FirstTick);
+		uint_to_bytes_be(pEntry + 12, Block.m_LastTick);
+		pEntry += INDEX_ENTRY_SIZE;
+	}
+	uint_to_bytes_be(pEntry, m_vIndex.size());
+	Int64ToBytesBe(pEntry + 4, m_Offset);
+	mem_copy(pEntry + 12, gs_aTeeHistorianIndexMagic, sizeof(gs_aTeeHistorianIndexMagic));
+	io_write(File, vIndex.data(), vIndex.size());
+}
+
+bool CTeeHistorianReader::IsCompressed(IOHANDLE File)
+{
+	unsigned char aHeader[CTeeHistorianCompressor::HEADER_SIZE];
+	const bool Compressed = io_read(File, aHeader, sizeof(aHeader)) == sizeof(aHeader) &&
+				mem_comp(aHeader, gs_aTeeHistorianBlocksMagic, sizeof(gs_aTeeHistorianBlocksMagic)) == 0;
+	io_seek(File, 0, IOSEEK_START);
+	return Compressed;
+}
+
+bool CTeeHistorianReader::Open(IOHANDLE File)
+{
+	m_File = File;
+	m_FileSize = io_length(File);
+	m_vIndex.clear();
+
+	unsigned char aHeader[CTeeHistorianCompressor::HEADER_SIZE];
+	if(!SeekTo(File, 0) || io_read(File, aHeader, sizeof(aHeader)) != sizeof(aHeader) ||
+		mem_comp(aHeader, gs_aTeeHistorianBlocksMagic, sizeof(gs_aTeeHistorianBlocksMagic)) != 0 ||
+		aHeader[8] != gs_TeeHistorianBlocksVersion || aHeader[9] != CTeeHistorianCompressor::CODEC_ZLIB)
+		return false;
+
+	// try the index at the end of the file first
+	unsigned char aFooter[CTeeHistorianCompressor::FOOTER_SIZE];
+	if(io_seek(File, -(int)sizeof(aFooter), IOSEEK_END) == 0 &&
+		io_read(File, aFooter, sizeof(aFooter)) == sizeof(aFooter) &&
+		mem_comp(aFooter + 12, gs_aTeeHistorianIndexMagic, sizeof(gs_aTeeHistorianIndexMagic)) == 0)
+	{
+		// the index fills the file between the last block and the footer
+		const int64_t NumBlocks = bytes_be_to_uint(aFooter);
+		const int64_t IndexOffset = BytesBeToInt64(aFooter + 4);
+		const int64_t IndexEnd = m_FileSize - CTeeHistorianCompressor::FOOTER_SIZE;
+		if(IndexOffset < CTeeHistorianCompressor::HEADER_SIZE || IndexOffset > IndexEnd ||
+			IndexEnd - IndexOffset != NumBlocks * CTeeHistorianCompressor::INDEX_ENTRY_SIZE)
+			return false;
+
+		std::vector<unsigned char> vIndex(NumBlocks * CTeeHistorianCompressor::INDEX_ENTRY_SIZE);
+		if(SeekTo(File, IndexOffset) && io_read(File, vIndex.data(), vIndex.size()) == vIndex.size())
+		{
+			for(int i = 0; i < NumBlocks; i++)
+			{
+				const unsigned char *pEntry = vIndex.data() + i * CTeeHistorianCompressor::INDEX_ENTRY_SIZE;
+				m_vIndex.push_back({BytesBeToInt64(pEntry), (int)bytes_be_to_uint(pEntry + 8), (int)bytes_be_to_uint(pEntry + 12)});
+			}
+			return true;
+		}
+	}
+
+	// unfinished file, walk the block headers
+	int64_t Offset = CTeeHistorianCompressor::HEADER_SIZE;
+	SeekTo(File, Offset);
+	while(true)
+	{
+		unsigned char aBlockHeader[CTeeHistorianCompressor::BLOCK_HEADER_SIZE];
+		if(io_read(File, aBlockHeader, sizeof(aBlockHeader)) != sizeof(aBlockHeader))
+			break;
+		const unsigned CompressedSize = bytes_be_to_uint(aBlockHeader);
+		if(CompressedSize == 0 || CompressedSize > m_FileSize - Offset - (int64_t)sizeof(aBlockHeader) || io_skip(File, CompressedSize) != 0)
+			break;
+		m_vIndex.push_back({Offset, (int)bytes_be_to_uint(aBlockHeader + 8), (int)bytes_be_to_uint(aBlockHeader + 12)});
+		Offset += sizeof(aBlockHeader) + CompressedSize;
+	}
+	// the last block may be cut off
+	std::vector<unsigned char> vData;
+	while(!m_vIndex.empty() && !ReadBlock(m_vIndex.size() - 1, vData))
+		m_vIndex.pop_back();
+	return true;
+}
+
+int CTeeHistorianReader::FindBlock(int Tick) const
+{
+	int Low = 0;
+	int High = m_vIndex.size();
+	while(Low < High)
+	{
+		const int Middle = (Low + High) / 2;
+		if(m_vIndex[Middle].m_LastTick < Tick)
+			Low = Middle + 1;
+		else
+			High = Middle;
+	}
+	return Low < (int)m_vIndex.size() ? Low : -1;
+}
+
+bool CTeeHistorianReader::ReadBlock(int Index, std::vector<unsigned char> &vData) const
+{
+	unsigned char aBlockHeader[CTeeHistorianCompressor::BLOCK_HEADER_SIZE];
+	if(Index < 0 || Index >= (int)m_vIndex.size())
+		return false;
+	const int64_t Offset = m_vIndex[Index].m_Offset;
+	if(Offset < CTeeHistorianCompressor::HEADER_SIZE || Offset > m_FileSize - (int64_t)sizeof(aBlockHeader) ||
+		!SeekTo(m_File, Offset) || io_read(m_File, aBlockHeader, sizeof(aBlockHeader)) != sizeof(aBlockHeader))
+		return false;
+
+	// the sizes come from the file, don't allocate more than it can hold
+	const unsigned CompressedSize = bytes_be_to_uint(aBlockHeader);
+	const unsigned RawSize = bytes_be_to_uint(aBlockHeader + 4);
+	if(CompressedSize > m_FileSize - Offset - (int64_t)sizeof(aBlockHeader) || RawSize > (unsigned)CTeeHistorianCompressor::MAX_RAW_BLOCK_SIZE)
+		return false;
+	std::vector<unsigned char> vCompressed(CompressedSize);
+	if(io_read(m_File, vCompressed.data(), CompressedSize) != CompressedSize)
+		return false;
+
+	vData.resize(RawSize);
+	uLongf Size = RawSize;
+	return uncompress(vData.data(), &Size, vCompressed.data(), CompressedSize) == Z_OK && Size == RawSize;
+}
+
+bool CTeeHistorianReader::ReadAll(std::vector<unsigned char> &vData) const
+{
+	vData.clear();
+	std::vector<unsigned char> vBlock;
+	for(int i = 0; i < (int)m_vIndex.size(); i++)
+	{
+		if(!ReadBlock(i, vBlock))
+			return false;
+		vData.insert(vData.end(), vBlock.begin(), vBlock.end());
+	}
+	return true;
+}
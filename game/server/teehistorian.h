@@ -7,6 +7,7 @@
 #include <game/generated/protocol.h>
 
 #include <ctime>
+#include <vector>
 
 class CConfig;
 class CTuningParams;
@@ -144,4 +145,93 @@ private:
 	CTeam m_aPrevTeams[MAX_CLIENTS];
 };
 
+// Block framed container for compressed teehistorian files.
+//
+// File layout, all integers big endian:
+//   header  "THBLOCKS", version (1 byte), codec (1 byte), 6 reserved bytes
+//   blocks  compressed size, raw size, first tick, last tick, data
+//   index   per block: offset (8 bytes), first tick, last tick
+//   footer  number of blocks, index offset (8 bytes), "THIX"
+//
+// Every block can be decompressed on its own and no tick spans two blocks,
+// so tools can seek by tick through the index, or through the block headers
+// if the file was not finished.
+class CTeeHistorianCompressor
+{
+public:
+	enum
+	{
+		CODEC_ZLIB = 1,
+
+		BLOCK_SIZE = 256 * 1024,
+		// a block is flushed once it reaches BLOCK_SIZE, so it only grows
+		// past it by the data of one tick
+		MAX_RAW_BLOCK_SIZE = 64 * BLOCK_SIZE,
+		HEADER_SIZE = 16,
+		BLOCK_HEADER_SIZE = 16,
+		INDEX_ENTRY_SIZE = 16,
+		FOOTER_SIZE = 16,
+	};
+
+	struct CBlockInfo
+	{
+		int64_t m_Offset;
+		int m_FirstTick;
+		int m_LastTick;
+	};
+
+	CTeeHistorianCompressor();
+
+	// Called on the game thread, queues teehistorian data written during the
+	// given tick.
+	static void QueueWrite(ASYNCIO *pAio, int Tick, const void *pData, int DataSize);
+
+	// Callbacks for aio_new_filtered, called on the ASYNCIO thread.
+	static void AioWrite(IOHANDLE File, const void *pData, unsigned Size, void *pUser);
+	static void AioFinish(IOHANDLE File, void *pUser);
+
+	void Write(IOHANDLE File, int Tick, const void *pData, int DataSize);
+	void Finish(IOHANDLE File);
+
+	const std::vector<CBlockInfo> &Index() const { return m_vIndex; }
+
+private:
+	void FlushBlock(IOHANDLE File);
+
+	// partially received frame of the queued stream
+	unsigned char m_aFrameHeader[2 * sizeof(int32_t)];
+	int m_FrameHeaderSize;
+	int m_FrameTick;
+	int m_FrameRemaining;
+
+	std::vector<unsigned char> m_vBlock;
+	std::vector<unsigned char> m_vCompressed;
+	int m_BlockFirstTick;
+	int m_BlockLastTick;
+
+	int64_t m_Offset;
+	std::vector<CBlockInfo> m_vIndex;
+};
+
+class CTeeHistorianReader
+{
+public:
+	// Reads the block index of a compressed teehistorian file, recovering it
+	// from the block headers if the file was not finished.
+	bool Open(IOHANDLE File);
+
+	const std::vector<CTeeHistorianCompressor::CBlockInfo> &Index() const { return m_vIndex; }
+	// First block containing the tick or later ticks, -1 if there is none.
+	int FindBlock(int Tick) const;
+	bool ReadBlock(int Index, std::vector<unsigned char> &vData) const;
+	bool ReadAll(std::vector<unsigned char> &vData) const;
+
+	static bool IsCompressed(IOHANDLE File);
+
+private:
+	IOHANDLE m_File = nullptr;
+	int64_t m_FileSize = 0;
+	std::vector<CTeeHistorianCompressor::CBlockInfo> m_vIndex;
+};
+
 #endif // GAME_SERVER_TEEHISTORIAN_H
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <base/system.h>
 #include <engine/shared/compression.h>
 
 static const int DATA[] = {0, 1, -1, 32, 64, 256, -512, 12345, -123456, 1234567, 12345678, 123456789, 2147483647, (-2147483647 - 1)};
@@ -82,3 +83,114 @@ TEST(CVariableInt, DecompressBufferTooSmall)
 	long CompressedSize = CVariableInt::Decompress(aCompressed, sizeof(aCompressed), aUncompressed, sizeof(aUncompressed));
 	ASSERT_EQ(CompressedSize, -1);
 }
+
+// the int at a time implementation the bulk codec has to match
+static long ScalarCompress(const int *pSrc, int Num, unsigned char *pDst, int DstSize)
+{
+	unsigned char *pCur = pDst;
+	for(int i = 0; i < Num; i++)
+	{
+		pCur = CVariableInt::Pack(pCur, pSrc[i], pDst + DstSize - pCur);
+		if(!pCur)
+			return -1;
+	}
+	return pCur - pDst;
+}
+
+static long ScalarDecompress(const unsigned char *pSrc, int SrcSize, int *pDst, int DstNum)
+{
+	const unsigned char *pEnd = pSrc + SrcSize;
+	int Num = 0;
+	while(pSrc < pEnd)
+	{
+		if(Num >= DstNum)
+			return -1;
+		pSrc = CVariableInt::Unpack(pSrc, &pDst[Num], pEnd - pSrc);
+		if(!pSrc)
+			return -1;
+		Num++;
+	}
+	return Num * sizeof(int);
+}
+
+class CFuzzRandom
+{
+	unsigned m_Seed;
+
+public:
+	CFuzzRandom(unsigned Seed) :
+		m_Seed(Seed) {}
+	unsigned Next()
+	{
+		m_Seed = m_Seed * 1103515245 + 12345;
+		return m_Seed ^ (m_Seed >> 15);
+	}
+	// mostly zero and small deltas with runs and the occasional large value, like snapshot deltas
+	int NextInt()
+	{
+		switch(Next() % 8)
+		{
+		case 0: return (int)Next();
+		case 1: return (int)(Next() % 20000) - 10000;
+		case 2: return (int)(Next() % 256) - 128;
+		case 3:
+		case 4: return 0;
+		default: return (int)(Next() % 128) - 64;
+		}
+	}
+};
+
+TEST(CVariableInt, FuzzCompressMatchesScalar)
+{
+	CFuzzRandom Random(1);
+	for(int Round = 0; Round < 2000; Round++)
+	{
+		int aData[256];
+		const int Num = Random.Next() % std::size(aData);
+		// every other round is made of long runs of single byte ints
+		for(int i = 0; i < Num; i++)
+			aData[i] = Round % 2 && Random.Next() % 16 ? (int)(Random.Next() % 128) - 64 : Random.NextInt();
+
+		unsigned char aExpected[std::size(aData) * CVariableInt::MAX_BYTES_PACKED];
+		unsigned char aCompressed[std::size(aData) * CVariableInt::MAX_BYTES_PACKED];
+		const int DstSize = Round % 4 ? sizeof(aCompressed) : Random.Next() % sizeof(aCompressed);
+		const long ExpectedSize = ScalarCompress(aData, Num, aExpected, DstSize);
+		const long Size = CVariableInt::Compress(aData, Num * sizeof(int), aCompressed, DstSize);
+		ASSERT_EQ(Size, ExpectedSize);
+		if(Size < 0)
+			continue;
+		ASSERT_EQ(mem_comp(aCompressed, aExpected, Size), 0);
+
+		int aDecompressed[std::size(aData)];
+		ASSERT_EQ(CVariableInt::Decompress(aCompressed, Size, aDecompressed, sizeof(aDecompressed)), (long)(Num * sizeof(int)));
+		for(int i = 0; i < Num; i++)
+			ASSERT_EQ(aDecompressed[i], aData[i]);
+	}
+}
+
+TEST(CVariableInt, FuzzDecompressMatchesScalar)
+{
+	CFuzzRandom Random(2);
+	for(int Round = 0; Round < 5000; Round++)
+	{
+		// arbitrary bytes, extend bits become rarer in later rounds to get long single byte runs
+		unsigned char aData[512];
+		const int Size = Random.Next() % sizeof(aData);
+		const unsigned ExtendRate = 1 + Round % 16;
+		for(int i = 0; i < Size; i++)
+		{
+			aData[i] = Random.Next() & 0x7F;
+			if(Random.Next() % ExtendRate == 0)
+				aData[i] |= 0x80;
+		}
+
+		int aExpected[std::size(aData)];
+		int aDecompressed[std::size(aData)];
+		const int DstNum = Round % 3 ? std::size(aDecompressed) : Random.Next() % std::size(aDecompressed);
+		const long ExpectedSize = ScalarDecompress(aData, Size, aExpected, DstNum);
+		const long DecompressedSize = CVariableInt::Decompress(aData, Size, aDecompressed, DstNum * sizeof(int));
+		ASSERT_EQ(DecompressedSize, ExpectedSize);
+		for(long i = 0; i < DecompressedSize / (long)sizeof(int); i++)
+			ASSERT_EQ(aDecompressed[i], aExpected[i]);
+	}
+}
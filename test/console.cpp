@@ -0,0 +1,170 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/kernel.h>
+#include <engine/shared/config.h>
+#include <engine/storage.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+static void RecordCommand(IConsole::IResult *pResult, void *pUserData)
+{
+	std::vector<std::string> *pvCalls = static_cast<std::vector<std::string> *>(pUserData);
+	std::string Call = pResult->NumArguments() ? pResult->GetString(0) : "";
+	for(int i = 1; i < pResult->NumArguments(); i++)
+		Call += std::string(" ") + pResult->GetString(i);
+	pvCalls->push_back(Call);
+}
+
+TEST(Console, FindCommandCaseInsensitive)
+{
+	std::unique_ptr<IConsole> pConsole = CreateConsole(CFGFLAG_SERVER);
+	std::vector<std::string> vCalls;
+	char aaNames[64][16];
+	for(int i = 0; i < 64; i++)
+	{
+		str_format(aaNames[i], sizeof(aaNames[i]), "test_cmd%d", i);
+		pConsole->Register(aaNames[i], "?s", CFGFLAG_SERVER, RecordCommand, &vCalls, "");
+	}
+
+	for(int i = 0; i < 64; i++)
+	{
+		const IConsole::CCommandInfo *pInfo = pConsole->GetCommandInfo(aaNames[i], CFGFLAG_SERVER, false);
+		ASSERT_TRUE(pInfo);
+		EXPECT_STREQ(pInfo->m_pName, aaNames[i]);
+	}
+	EXPECT_FALSE(pConsole->GetCommandInfo("test_cmd64", CFGFLAG_SERVER, false));
+	EXPECT_FALSE(pConsole->GetCommandInfo("test_cmd1", CFGFLAG_CLIENT, false));
+
+	pConsole->ExecuteLine("TEST_CMD7 upper; Test_Cmd8 mixed");
+	ASSERT_EQ(vCalls.size(), 2u);
+	EXPECT_EQ(vCalls[0], "upper");
+	EXPECT_EQ(vCalls[1], "mixed");
+
+	// the list stays sorted for iteration
+	const IConsole::CCommandInfo *pPrev = nullptr;
+	for(const IConsole::CCommandInfo *pInfo = pConsole->FirstCommandInfo(IConsole::ACCESS_LEVEL_ADMIN, CFGFLAG_SERVER); pInfo; pInfo = pInfo->NextCommandInfo(IConsole::ACCESS_LEVEL_ADMIN, CFGFLAG_SERVER))
+	{
+		if(pPrev)
+			EXPECT_LE(str_comp(pPrev->m_pName, pInfo->m_pName), 0);
+		pPrev = pInfo;
+	}
+}
+
+TEST(Console, TempCommands)
+{
+	std::unique_ptr<IConsole> pConsole = CreateConsole(CFGFLAG_CLIENT);
+	pConsole->RegisterTemp("kill", "", CFGFLAG_SERVER, "");
+	pConsole->RegisterTemp("spec", "?r", CFGFLAG_SERVER, "");
+	ASSERT_TRUE(pConsole->GetCommandInfo("KILL", CFGFLAG_SERVER, true));
+	EXPECT_FALSE(pConsole->GetCommandInfo("kill", CFGFLAG_SERVER, false));
+
+	pConsole->DeregisterTemp("kill");
+	EXPECT_FALSE(pConsole->GetCommandInfo("kill", CFGFLAG_SERVER, true));
+	EXPECT_TRUE(pConsole->GetCommandInfo("spec", CFGFLAG_SERVER, true));
+
+	// reuses the recycled entry
+	pConsole->RegisterTemp("pause", "", CFGFLAG_SERVER, "");
+	EXPECT_TRUE(pConsole->GetCommandInfo("pause", CFGFLAG_SERVER, true));
+	EXPECT_FALSE(pConsole->GetCommandInfo("kill", CFGFLAG_SERVER, true));
+
+	pConsole->DeregisterTempAll();
+	EXPECT_FALSE(pConsole->GetCommandInfo("pause", CFGFLAG_SERVER, true));
+	EXPECT_FALSE(pConsole->GetCommandInfo("spec", CFGFLAG_SERVER, true));
+	EXPECT_TRUE(pConsole->GetCommandInfo("echo", CFGFLAG_SERVER, false));
+}
+
+class ConsoleFile : public ::testing::Test
+{
+protected:
+	CTestInfo m_Info;
+	std::unique_ptr<IKernel> m_pKernel;
+	IStorage *m_pStorage;
+	std::unique_ptr<IConsole> m_pConsole;
+	std::vector<std::string> m_vCalls;
+	std::vector<std::string> m_vOtherCalls;
+	char m_aFilename[IO_MAX_PATH_LENGTH];
+
+	ConsoleFile()
+	{
+		m_Info.m_DeleteTestStorageFilesOnSuccess = true;
+		m_pKernel = std::unique_ptr<IKernel>(IKernel::Create());
+		m_pStorage = m_Info.CreateTestStorage();
+		m_pKernel->RegisterInterface(m_pStorage);
+		IConfigManager *pConfigManager = CreateConfigManager();
+		m_pKernel->RegisterInterface(pConfigManager);
+		m_pConsole = CreateConsole(CFGFLAG_SERVER);
+		m_pKernel->RegisterInterface(m_pConsole.get(), false);
+		m_pConsole->Init();
+		m_pConsole->Register("record", "s[first] ?i[second] ?r[rest]", CFGFLAG_SERVER, RecordCommand, &m_vCalls, "");
+		str_copy(m_aFilename, "console_test.cfg");
+	}
+
+	~ConsoleFile()
+	{
+		m_pStorage->RemoveFile(m_aFilename, IStorage::TYPE_SAVE);
+		m_pKernel->Shutdown();
+	}
+
+	void WriteFile(const char *pContent)
+	{
+		IOHANDLE File = m_pStorage->OpenFile(m_aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		ASSERT_TRUE(File);
+		io_write(File, pContent, str_length(pContent));
+		io_close(File);
+	}
+};
+
+TEST_F(ConsoleFile, ExecuteTwice)
+{
+	WriteFile("record a 1\nrecord \"quoted ; arg\" 2 rest of it # comment\nrecord b; record c 3\nunknown_cmd\nrecord\n");
+	for(int i = 0; i < 2; i++)
+	{
+		m_vCalls.clear();
+		ASSERT_TRUE(m_pConsole->ExecuteFile(m_aFilename, -1, false, IStorage::TYPE_SAVE));
+		ASSERT_EQ(m_vCalls.size(), 4u);
+		EXPECT_EQ(m_vCalls[0], "a 1");
+		EXPECT_EQ(m_vCalls[1], "quoted ; arg 2 rest of it ");
+		EXPECT_EQ(m_vCalls[2], "b");
+		EXPECT_EQ(m_vCalls[3], "c 3");
+	}
+
+	// changed lines are parsed again
+	WriteFile("record a 1\nrecord changed\n");
+	m_vCalls.clear();
+	ASSERT_TRUE(m_pConsole->ExecuteFile(m_aFilename, -1, false, IStorage::TYPE_SAVE));
+	ASSERT_EQ(m_vCalls.size(), 2u);
+	EXPECT_EQ(m_vCalls[1], "changed");
+}
+
+TEST_F(ConsoleFile, RegisterBetweenExecutions)
+{
+	WriteFile("record x\n");
+	ASSERT_TRUE(m_pConsole->ExecuteFile(m_aFilename, -1, false, IStorage::TYPE_SAVE));
+	ASSERT_EQ(m_vCalls.size(), 1u);
+
+	// replacing the command must not run the old callback from the cached line
+	m_pConsole->Register("record", "s[first]", CFGFLAG_SERVER, RecordCommand, &m_vOtherCalls, "");
+	ASSERT_TRUE(m_pConsole->ExecuteFile(m_aFilename, -1, false, IStorage::TYPE_SAVE));
+	EXPECT_EQ(m_vCalls.size(), 1u);
+	ASSERT_EQ(m_vOtherCalls.size(), 1u);
+	EXPECT_EQ(m_vOtherCalls[0], "x");
+}
+
+TEST_F(ConsoleFile, AccessLevel)
+{
+	WriteFile("record allowed\n");
+	m_pConsole->SetAccessLevel(IConsole::ACCESS_LEVEL_ADMIN);
+	ASSERT_TRUE(m_pConsole->ExecuteFile(m_aFilename, -1, false, IStorage::TYPE_SAVE));
+	EXPECT_EQ(m_vCalls.size(), 1u);
+
+	// the access level is checked on every execution, not when the line was cached
+	m_pConsole->SetAccessLevel(IConsole::ACCESS_LEVEL_USER);
+	ASSERT_TRUE(m_pConsole->ExecuteFile(m_aFilename, -1, false, IStorage::TYPE_SAVE));
+	EXPECT_EQ(m_vCalls.size(), 1u);
+}
@@ -2,6 +2,7 @@
 #include <gtest/gtest.h>
 #include <memory>
 
+#include <engine/engine.h>
 #include <engine/shared/datafile.h>
 #include <engine/storage.h>
 #include <game/mapitems_ex.h>
@@ -105,3 +106,62 @@ TEST(Datafile, StringData)
 		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
 	}
 }
+
+TEST(Datafile, LoadDataParallel)
+{
+	auto pStorage = std::unique_ptr<IStorage>(CreateLocalStorage());
+	auto pEngine = std::unique_ptr<IEngine>(CreateTestEngine("Datafile", 4));
+	CTestInfo Info;
+
+	const int NUM_DATA = 64;
+	const int DATA_SIZE = 16 * 1024;
+	std::vector<int> vData(DATA_SIZE / sizeof(int));
+	{
+		CDataFileWriter Writer;
+		Writer.Open(pStorage.get(), Info.m_aFilename);
+		for(int i = 0; i < NUM_DATA; i++)
+		{
+			for(size_t j = 0; j < vData.size(); j++)
+				vData[j] = i * (j % 7);
+			EXPECT_EQ(Writer.AddData(DATA_SIZE, vData.data()), i);
+		}
+		Writer.Finish();
+	}
+
+	{
+		CDataFileReader Reader;
+		ASSERT_TRUE(Reader.Open(pStorage.get(), Info.m_aFilename, IStorage::TYPE_ALL));
+
+		// the whole file is available without reading it again
+		void *pFileData;
+		unsigned FileSize;
+		ASSERT_TRUE(pStorage->ReadFile(Info.m_aFilename, IStorage::TYPE_ALL, &pFileData, &FileSize));
+		ASSERT_EQ(Reader.FileSize(), FileSize);
+		EXPECT_EQ(mem_comp(Reader.FileData(), pFileData, FileSize), 0);
+		EXPECT_EQ(Reader.Crc(), crc32(0, (const Bytef *)pFileData, FileSize));
+		EXPECT_EQ(Reader.Sha256(), sha256(pFileData, FileSize));
+		free(pFileData);
+
+		// duplicate and invalid indices are skipped
+		std::vector<int> vIndices = {-1, NUM_DATA, NUM_DATA - 1};
+		for(int i = 0; i < NUM_DATA; i++)
+			vIndices.push_back(i);
+		Reader.LoadData(vIndices, pEngine.get());
+
+		for(int i = 0; i < NUM_DATA; i++)
+		{
+			ASSERT_EQ(Reader.GetDataSize(i), DATA_SIZE);
+			const int *pData = (const int *)Reader.GetData(i);
+			ASSERT_TRUE(pData);
+			for(size_t j = 0; j < vData.size(); j++)
+				ASSERT_EQ(pData[j], (int)(i * (j % 7)));
+		}
+
+		Reader.Close();
+	}
+
+	if(!HasFailure())
+	{
+		pStorage->RemoveFile(Info.m_aFilename, IStorage::TYPE_SAVE);
+	}
+}
@@ -0,0 +1,140 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <memory>
+#include <vector>
+
+static int BuildSnapshot(int Tick, char *pData)
+{
+	CSnapshotBuilder Builder;
+	Builder.Init();
+	for(int i = 0; i < 16; i++)
+	{
+		int *pItem = (int *)Builder.NewItem(1 + i % 3, i, 8 * sizeof(int));
+		for(int j = 0; j < 8; j++)
+			pItem[j] = (i * 8 + j) * (j % 2 ? Tick : 1);
+	}
+	return Builder.Finish(pData);
+}
+
+static void RecordTick(CDemoRecorder *pRecorder, int Tick)
+{
+	char aSnapshot[CSnapshot::MAX_SIZE];
+	pRecorder->RecordSnapshot(Tick, aSnapshot, BuildSnapshot(Tick, aSnapshot));
+	char aMessage[32];
+	str_format(aMessage, sizeof(aMessage), "message %d", Tick);
+	pRecorder->RecordMessage(aMessage, str_length(aMessage) + 1);
+	if(Tick % 100 == 0)
+		pRecorder->AddDemoMarker();
+}
+
+static void Start(CDemoRecorder *pRecorder, IStorage *pStorage, const char *pFilename)
+{
+	// the map data is not written, but without it the recorder looks for the map file
+	unsigned char aMapData[1] = {0};
+	SHA256_DIGEST Sha256 = {};
+	ASSERT_EQ(pRecorder->Start(pStorage, nullptr, pFilename, "0.6", "map", Sha256, 0, "server", 0, aMapData), 0);
+	ASSERT_TRUE(pRecorder->IsRecording());
+}
+
+static void Stop(CDemoRecorder *pRecorder)
+{
+	EXPECT_EQ(pRecorder->Length(), 599 / SERVER_TICK_SPEED);
+	ASSERT_EQ(pRecorder->Stop(), 0);
+	EXPECT_FALSE(pRecorder->IsRecording());
+	EXPECT_EQ(pRecorder->AsyncStats().m_NumDropped, 0);
+}
+
+static void Record(IStorage *pStorage, const char *pFilename, CDemoWriter *pWriter)
+{
+	CSnapshotDelta SnapshotDelta;
+	CDemoRecorder Recorder(&SnapshotDelta, true);
+	Recorder.SetAsyncWriter(pWriter);
+	Start(&Recorder, pStorage, pFilename);
+	for(int Tick = 1; Tick <= 600; Tick++)
+		RecordTick(&Recorder, Tick);
+	Stop(&Recorder);
+}
+
+static std::vector<unsigned char> ReadDemo(IStorage *pStorage, const char *pFilename)
+{
+	void *pData;
+	unsigned Size;
+	if(!pStorage->ReadFile(pFilename, IStorage::TYPE_SAVE, &pData, &Size) || Size < sizeof(CDemoHeader))
+		return {};
+	std::vector<unsigned char> vData((unsigned char *)pData, (unsigned char *)pData + Size);
+	free(pData);
+	// the timestamp in the header may differ
+	CDemoHeader *pHeader = (CDemoHeader *)vData.data();
+	mem_zero(pHeader->m_aTimestamp, sizeof(pHeader->m_aTimestamp));
+	return vData;
+}
+
+TEST(Demo, AsyncRecordingMatchesSync)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+	CNetBase::Init();
+
+	Record(pStorage.get(), "sync.demo", nullptr);
+	// large enough for the whole demo, nothing may be dropped however slow the writer is
+	CDemoWriter Writer;
+	Writer.SetQueueSize(4 * 1024 * 1024);
+	Record(pStorage.get(), "async.demo", &Writer);
+
+	const std::vector<unsigned char> vSync = ReadDemo(pStorage.get(), "sync.demo");
+	const std::vector<unsigned char> vAsync = ReadDemo(pStorage.get(), "async.demo");
+	EXPECT_GT(vSync.size(), sizeof(CDemoHeader));
+	EXPECT_TRUE(vSync == vAsync);
+}
+
+TEST(Demo, SharedWriter)
+{
+	CTestInfo Info;
+	Info.m_DeleteTestStorageFilesOnSuccess = true;
+	auto pStorage = std::unique_ptr<IStorage>(Info.CreateTestStorage());
+	ASSERT_TRUE(pStorage);
+	CNetBase::Init();
+
+	Record(pStorage.get(), "sync.demo", nullptr);
+	const std::vector<unsigned char> vSync = ReadDemo(pStorage.get(), "sync.demo");
+
+	// the recordings go through one queue, one of them stops while the
+	// others still record
+	CDemoWriter Writer;
+	Writer.SetQueueSize(4 * 1024 * 1024);
+	CSnapshotDelta SnapshotDelta;
+	CDemoRecorder aRecorders[3];
+	char aaFilenames[3][32];
+	for(int i = 0; i < 3; i++)
+	{
+		aRecorders[i] = CDemoRecorder(&SnapshotDelta, true);
+		aRecorders[i].SetAsyncWriter(&Writer);
+		str_format(aaFilenames[i], sizeof(aaFilenames[i]), "shared%d.demo", i);
+		Start(&aRecorders[i], pStorage.get(), aaFilenames[i]);
+	}
+	for(int Tick = 1; Tick <= 600; Tick++)
+		for(auto &Recorder : aRecorders)
+			RecordTick(&Recorder, Tick);
+	Stop(&aRecorders[1]);
+	for(int i = 0; i < 3; i++)
+	{
+		if(i != 1)
+			Stop(&aRecorders[i]);
+		EXPECT_TRUE(ReadDemo(pStorage.get(), aaFilenames[i]) == vSync);
+		pStorage->RemoveFile(aaFilenames[i], IStorage::TYPE_SAVE);
+	}
+
+	// a new size is used by the next recording
+	Writer.SetQueueSize(512 * 1024);
+	Record(pStorage.get(), "async.demo", &Writer);
+	EXPECT_TRUE(ReadDemo(pStorage.get(), "async.demo") == vSync);
+}
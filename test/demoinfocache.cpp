@@ -0,0 +1,144 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/demoinfocache.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <memory>
+
+static void Record(IStorage *pStorage, const char *pFilename, int NumTicks)
+{
+	CSnapshotDelta SnapshotDelta;
+	CDemoRecorder Recorder(&SnapshotDelta, true);
+	unsigned char aMapData[1] = {0};
+	SHA256_DIGEST Sha256 = {};
+	Sha256.data[0] = 42;
+	ASSERT_EQ(Recorder.Start(pStorage, nullptr, pFilename, "0.6", "map", Sha256, 0, "server", 0, aMapData), 0);
+
+	CSnapshotBuilder Builder;
+	char aSnapshot[CSnapshot::MAX_SIZE];
+	for(int Tick = 1; Tick <= NumTicks; Tick++)
+	{
+		Builder.Init();
+		int *pItem = (int *)Builder.NewItem(1, 0, sizeof(int));
+		*pItem = Tick;
+		Recorder.RecordSnapshot(Tick, aSnapshot, Builder.Finish(aSnapshot));
+		if(Tick == NumTicks / 2)
+			Recorder.AddDemoMarker();
+	}
+	ASSERT_EQ(Recorder.Stop(), 0);
+}
+
+static void WriteFile(IStorage *pStorage, const char *pFilename, const char *pContent)
+{
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, pContent, str_length(pContent));
+	io_close(File);
+}
+
+class DemoInfoCache : public ::testing::Test
+{
+protected:
+	CTestInfo m_Info;
+	std::unique_ptr<IStorage> m_pStorage;
+	CSnapshotDelta m_SnapshotDelta;
+	CDemoPlayer m_DemoPlayer{&m_SnapshotDelta, false};
+
+	DemoInfoCache()
+	{
+		m_Info.m_DeleteTestStorageFilesOnSuccess = true;
+		m_pStorage = std::unique_ptr<IStorage>(m_Info.CreateTestStorage());
+		CNetBase::Init();
+		Record(m_pStorage.get(), "first.demo", 10 * SERVER_TICK_SPEED);
+		WriteFile(m_pStorage.get(), "invalid.demo", "not a demo");
+	}
+
+	~DemoInfoCache()
+	{
+		m_pStorage->RemoveFile("first.demo", IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFile("invalid.demo", IStorage::TYPE_SAVE);
+	}
+};
+
+TEST_F(DemoInfoCache, Get)
+{
+	CDemoInfoCache Cache(m_pStorage.get());
+	CDemoInfoCache::CInfo Info;
+	ASSERT_TRUE(Cache.Get(&m_DemoPlayer, "first.demo", IStorage::TYPE_SAVE, &Info));
+	EXPECT_TRUE(Info.m_Valid);
+	EXPECT_STREQ(Info.m_MapInfo.m_aName, "map");
+	EXPECT_EQ(Info.m_MapInfo.m_Sha256.data[0], 42);
+	EXPECT_EQ(bytes_be_to_uint(Info.m_TimelineMarkers.m_aNumTimelineMarkers), 1u);
+	EXPECT_FALSE(Cache.Get(&m_DemoPlayer, "invalid.demo", IStorage::TYPE_SAVE, &Info));
+	EXPECT_FALSE(Info.m_Valid);
+	EXPECT_EQ(Cache.NumReads(), 2);
+
+	CDemoInfoCache::CInfo Cached;
+	ASSERT_TRUE(Cache.Get(&m_DemoPlayer, "first.demo", IStorage::TYPE_SAVE, &Cached));
+	EXPECT_FALSE(Cache.Get(&m_DemoPlayer, "invalid.demo", IStorage::TYPE_SAVE, &Info));
+	EXPECT_EQ(Cache.NumReads(), 2);
+	EXPECT_STREQ(Cached.m_MapInfo.m_aName, "map");
+}
+
+TEST_F(DemoInfoCache, Persistent)
+{
+	CDemoInfoCache::CInfo Info;
+	{
+		CDemoInfoCache Cache(m_pStorage.get());
+		ASSERT_TRUE(Cache.Get(&m_DemoPlayer, "first.demo", IStorage::TYPE_SAVE, &Info));
+		EXPECT_FALSE(Cache.Get(&m_DemoPlayer, "invalid.demo", IStorage::TYPE_SAVE, &Info));
+		Cache.Save();
+	}
+
+	CDemoInfoCache Cache(m_pStorage.get());
+	CDemoInfoCache::CInfo Cached;
+	ASSERT_TRUE(Cache.Get(&m_DemoPlayer, "first.demo", IStorage::TYPE_SAVE, &Cached));
+	EXPECT_FALSE(Cache.Get(&m_DemoPlayer, "invalid.demo", IStorage::TYPE_SAVE, &Info));
+	EXPECT_EQ(Cache.NumReads(), 0);
+	ASSERT_TRUE(m_DemoPlayer.GetDemoInfo(m_pStorage.get(), nullptr, "first.demo", IStorage::TYPE_SAVE, &Info.m_Info, &Info.m_TimelineMarkers, &Info.m_MapInfo));
+	EXPECT_EQ(mem_comp(&Cached.m_Info, &Info.m_Info, sizeof(Info.m_Info)), 0);
+	EXPECT_EQ(mem_comp(&Cached.m_TimelineMarkers, &Info.m_TimelineMarkers, sizeof(Info.m_TimelineMarkers)), 0);
+	EXPECT_STREQ(Cached.m_MapInfo.m_aName, Info.m_MapInfo.m_aName);
+	EXPECT_EQ(Cached.m_MapInfo.m_Sha256, Info.m_MapInfo.m_Sha256);
+	EXPECT_EQ(Cached.m_MapInfo.m_Crc, Info.m_MapInfo.m_Crc);
+	EXPECT_EQ(Cached.m_MapInfo.m_Size, Info.m_MapInfo.m_Size);
+
+	// a changed file is read again
+	Record(m_pStorage.get(), "first.demo", 20 * SERVER_TICK_SPEED);
+	ASSERT_TRUE(Cache.Get(&m_DemoPlayer, "first.demo", IStorage::TYPE_SAVE, &Cached));
+	EXPECT_EQ(Cache.NumReads(), 1);
+	EXPECT_NE(bytes_be_to_uint(Cached.m_Info.m_aLength), bytes_be_to_uint(Info.m_Info.m_aLength));
+}
+
+TEST_F(DemoInfoCache, RemovedFiles)
+{
+	CDemoInfoCache::CInfo Info;
+	{
+		CDemoInfoCache Cache(m_pStorage.get());
+		ASSERT_TRUE(Cache.Get(&m_DemoPlayer, "first.demo", IStorage::TYPE_SAVE, &Info));
+		EXPECT_FALSE(Cache.Get(&m_DemoPlayer, "invalid.demo", IStorage::TYPE_SAVE, &Info));
+		Cache.Save();
+	}
+
+	// entries that were not looked up are only dropped with their file
+	m_pStorage->RemoveFile("invalid.demo", IStorage::TYPE_SAVE);
+	WriteFile(m_pStorage.get(), "other.demo", "not a demo either");
+	{
+		CDemoInfoCache Cache(m_pStorage.get());
+		EXPECT_FALSE(Cache.Get(&m_DemoPlayer, "other.demo", IStorage::TYPE_SAVE, &Info));
+		Cache.Save();
+	}
+	m_pStorage->RemoveFile("other.demo", IStorage::TYPE_SAVE);
+
+	CDemoInfoCache Cache(m_pStorage.get());
+	ASSERT_TRUE(Cache.Get(&m_DemoPlayer, "first.demo", IStorage::TYPE_SAVE, &Info));
+	EXPECT_EQ(Cache.NumReads(), 0);
+	WriteFile(m_pStorage.get(), "invalid.demo", "not a demo");
+	EXPECT_FALSE(Cache.Get(&m_DemoPlayer, "invalid.demo", IStorage::TYPE_SAVE, &Info));
+	EXPECT_EQ(Cache.NumReads(), 1);
+}
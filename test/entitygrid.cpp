@@ -0,0 +1,232 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <game/prng.h>
+#include <game/server/entitygrid.h>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class CTestEntity
+{
+public:
+	vec2 m_Pos;
+	float m_ProximityRadius;
+	vec2 m_Intersection;
+	CEntityGrid<CTestEntity>::CNode m_GridNode;
+
+	float GetProximityRadius() const { return m_ProximityRadius; }
+};
+
+// The queries below are the ones of CGameWorld, once walking the entity list
+// and once walking the grid candidates. Both have to give the same results in
+// the same order.
+class EntityGrid : public ::testing::Test
+{
+protected:
+	CPrng m_Prng;
+	CEntityGrid<CTestEntity> m_Grid;
+	std::vector<std::unique_ptr<CTestEntity>> m_vpEntities;
+	// like the entity lists of the world, newest first
+	std::vector<CTestEntity *> m_vpList;
+	std::vector<CTestEntity *> m_vpCandidates;
+
+	EntityGrid()
+	{
+		uint64_t aSeed[2] = {0x5eed, 0x9e3779b97f4a7c15};
+		m_Prng.Seed(aSeed);
+	}
+
+	int Random(int Max) { return m_Prng.RandomBits() % Max; }
+	float RandomFloat(float Min, float Max) { return Min + (Max - Min) * (m_Prng.RandomBits() / (float)0xffffffffu); }
+
+	vec2 RandomPos()
+	{
+		switch(Random(8))
+		{
+		case 0: // on the cell borders
+			return vec2((Random(13) - 6) * 256.0f, (Random(13) - 6) * 256.0f);
+		case 1: // a few shared spots, for ties
+			return vec2(Random(3) * 100.0f, 500.0f);
+		case 2: // far away, cells from everywhere share the buckets
+			return vec2(RandomFloat(-1e6f, 1e6f), RandomFloat(-1e6f, 1e6f));
+		default:
+			return vec2(RandomFloat(-2000.0f, 2000.0f), RandomFloat(-2000.0f, 2000.0f));
+		}
+	}
+
+	CTestEntity *Insert(vec2 Pos, float Radius = 28.0f)
+	{
+		m_vpEntities.push_back(std::make_unique<CTestEntity>());
+		CTestEntity *pEnt = m_vpEntities.back().get();
+		pEnt->m_Pos = Pos;
+		pEnt->m_ProximityRadius = Radius;
+		m_vpList.insert(m_vpList.begin(), pEnt);
+		m_Grid.Insert(pEnt);
+		return pEnt;
+	}
+
+	void Remove(CTestEntity *pEnt)
+	{
+		m_Grid.Remove(pEnt);
+		m_vpList.erase(std::find(m_vpList.begin(), m_vpList.end(), pEnt));
+	}
+
+	void Move(CTestEntity *pEnt, vec2 Pos)
+	{
+		pEnt->m_Pos = Pos;
+		m_Grid.Update(pEnt);
+	}
+
+	const std::vector<CTestEntity *> &Candidates(vec2 Min, vec2 Max, bool UseGrid)
+	{
+		if(!UseGrid)
+			return m_vpList;
+		m_Grid.Query(Min, Max, m_vpCandidates);
+		return m_vpCandidates;
+	}
+
+	std::vector<CTestEntity *> FindEntities(vec2 Pos, float Radius, int Max, bool UseGrid)
+	{
+		std::vector<CTestEntity *> vpResult;
+		const float Margin = Radius + m_Grid.MaxRadius() + 1.0f;
+		for(CTestEntity *pEnt : Candidates(Pos - vec2(Margin, Margin), Pos + vec2(Margin, Margin), UseGrid))
+		{
+			if(distance(pEnt->m_Pos, Pos) < Radius + pEnt->m_ProximityRadius)
+			{
+				vpResult.push_back(pEnt);
+				if((int)vpResult.size() == Max)
+					break;
+			}
+		}
+		return vpResult;
+	}
+
+	const std::vector<CTestEntity *> &LineCandidates(vec2 Pos0, vec2 Pos1, float Radius, bool UseGrid)
+	{
+		const float Margin = Radius + m_Grid.MaxRadius() + 1.0f;
+		return Candidates(vec2(minimum(Pos0.x, Pos1.x), minimum(Pos0.y, Pos1.y)) - vec2(Margin, Margin),
+			vec2(maximum(Pos0.x, Pos1.x), maximum(Pos0.y, Pos1.y)) + vec2(Margin, Margin), UseGrid);
+	}
+
+	CTestEntity *IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, vec2 &NewPos, const CTestEntity *pNotThis, bool UseGrid)
+	{
+		float ClosestLen = distance(Pos0, Pos1) * 100.0f;
+		CTestEntity *pClosest = nullptr;
+		for(CTestEntity *pEnt : LineCandidates(Pos0, Pos1, Radius, UseGrid))
+		{
+			if(pEnt == pNotThis)
+				continue;
+			vec2 IntersectPos;
+			if(closest_point_on_line(Pos0, Pos1, pEnt->m_Pos, IntersectPos))
+			{
+				float Len = distance(pEnt->m_Pos, IntersectPos);
+				if(Len < pEnt->m_ProximityRadius + Radius)
+				{
+					Len = distance(Pos0, IntersectPos);
+					if(Len < ClosestLen)
+					{
+						NewPos = IntersectPos;
+						ClosestLen = Len;
+						pClosest = pEnt;
+					}
+				}
+			}
+		}
+		return pClosest;
+	}
+
+	std::vector<CTestEntity *> IntersectedCharacters(vec2 Pos0, vec2 Pos1, float Radius, const CTestEntity *pNotThis, bool UseGrid)
+	{
+		std::vector<CTestEntity *> vpResult;
+		for(CTestEntity *pEnt : LineCandidates(Pos0, Pos1, Radius, UseGrid))
+		{
+			if(pEnt == pNotThis)
+				continue;
+			vec2 IntersectPos;
+			if(closest_point_on_line(Pos0, Pos1, pEnt->m_Pos, IntersectPos))
+			{
+				if(distance(pEnt->m_Pos, IntersectPos) < pEnt->m_ProximityRadius + Radius)
+				{
+					pEnt->m_Intersection = IntersectPos;
+					vpResult.push_back(pEnt);
+				}
+			}
+		}
+		return vpResult;
+	}
+
+	void ExpectSameResults(vec2 Pos, float Radius, int Max, vec2 Pos0, vec2 Pos1, const CTestEntity *pNotThis)
+	{
+		EXPECT_EQ(FindEntities(Pos, Radius, Max, true), FindEntities(Pos, Radius, Max, false));
+
+		vec2 GridPos(0, 0), ListPos(0, 0);
+		EXPECT_EQ(IntersectCharacter(Pos0, Pos1, Radius, GridPos, pNotThis, true), IntersectCharacter(Pos0, Pos1, Radius, ListPos, pNotThis, false));
+		EXPECT_EQ(GridPos, ListPos);
+
+		EXPECT_EQ(IntersectedCharacters(Pos0, Pos1, Radius, pNotThis, true), IntersectedCharacters(Pos0, Pos1, Radius, pNotThis, false));
+	}
+};
+
+TEST_F(EntityGrid, Ties)
+{
+	// the Max cut-off has to keep the newest entities, like the list walk
+	for(int i = 0; i < 20; i++)
+		Insert(vec2(300.0f, 300.0f));
+	const std::vector<CTestEntity *> vpFound = FindEntities(vec2(300.0f, 300.0f), 10.0f, 5, true);
+	ASSERT_EQ(vpFound.size(), 5u);
+	for(int i = 0; i < 5; i++)
+		EXPECT_EQ(vpFound[i], m_vpList[i]);
+
+	// moving between cells does not change the order
+	Move(m_vpList[0], vec2(-300.0f, 300.0f));
+	Move(m_vpList[0], vec2(300.0f, 300.0f));
+	ExpectSameResults(vec2(300.0f, 300.0f), 10.0f, 5, vec2(0.0f, 300.0f), vec2(600.0f, 300.0f), nullptr);
+}
+
+TEST_F(EntityGrid, IntersectedCharactersOrder)
+{
+	// a line through many cells, the entities are inserted in random order
+	std::vector<vec2> vPositions;
+	for(int i = 0; i < 32; i++)
+		vPositions.emplace_back(-2000.0f + i * 125.0f, 40.0f * (i % 3));
+	for(int i = 0; i < (int)vPositions.size(); i++)
+		std::swap(vPositions[i], vPositions[i + Random(vPositions.size() - i)]);
+	for(vec2 Pos : vPositions)
+		Insert(Pos);
+
+	const std::vector<CTestEntity *> vpGrid = IntersectedCharacters(vec2(-2100.0f, 0.0f), vec2(2100.0f, 0.0f), 30.0f, m_vpList[3], true);
+	EXPECT_EQ(vpGrid, IntersectedCharacters(vec2(-2100.0f, 0.0f), vec2(2100.0f, 0.0f), 30.0f, m_vpList[3], false));
+	EXPECT_FALSE(vpGrid.empty());
+}
+
+TEST_F(EntityGrid, Random)
+{
+	for(int Round = 0; Round < 3000; Round++)
+	{
+		const int Op = Random(10);
+		if(m_vpList.empty() || (Op < 3 && m_vpList.size() < 100))
+			Insert(RandomPos(), Random(20) ? 28.0f : RandomFloat(1.0f, 150.0f));
+		else if(Op < 4)
+			Remove(m_vpList[Random(m_vpList.size())]);
+		else
+		{
+			// small steps like in the game, or teleports
+			CTestEntity *pEnt = m_vpList[Random(m_vpList.size())];
+			Move(pEnt, Random(4) ? pEnt->m_Pos + vec2(RandomFloat(-40.0f, 40.0f), RandomFloat(-40.0f, 40.0f)) : RandomPos());
+		}
+
+		for(int Query = 0; Query < 4; Query++)
+		{
+			const vec2 Pos = RandomPos();
+			const vec2 Pos0 = Random(2) ? RandomPos() : Pos;
+			const vec2 Pos1 = Random(2) ? RandomPos() : Pos0 + vec2(RandomFloat(-800.0f, 800.0f), RandomFloat(-800.0f, 800.0f));
+			const CTestEntity *pNotThis = !m_vpList.empty() && Random(2) ? m_vpList[Random(m_vpList.size())] : nullptr;
+			ExpectSameResults(Pos, RandomFloat(0.0f, 600.0f), 1 + Random(8), Pos0, Pos1, pNotThis);
+		}
+		if(::testing::Test::HasFailure())
+			break;
+	}
+}
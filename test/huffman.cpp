@@ -1,7 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <base/math.h>
 #include <base/system.h>
+#include <engine/shared/compression.h>
 #include <engine/shared/huffman.h>
+#include <engine/shared/network.h>
+
+#include <vector>
 
 TEST(Huffman, CompressionShouldNotChangeData)
 {
@@ -46,3 +51,134 @@ TEST(Huffman, CompressionCompatible)
 	EXPECT_EQ(match, 0) << "The compression is not compatible with older/other implementations anymore";
 	EXPECT_EQ(Size, 15);
 }
+
+// deterministic packet corpus shaped like snapshot deltas and net messages:
+// packed ints of small deltas, runs of zeros and the occasional string
+static std::vector<std::vector<unsigned char>> GenerateCorpus(int NumPackets)
+{
+	unsigned Seed = 1234;
+	auto Random = [&Seed](unsigned Max) {
+		Seed = Seed * 1103515245 + 12345;
+		return (Seed >> 16) % Max;
+	};
+
+	std::vector<std::vector<unsigned char>> vPackets;
+	for(int i = 0; i < NumPackets; i++)
+	{
+		unsigned char aPacket[NET_MAX_PAYLOAD];
+		unsigned char *pCur = aPacket;
+		unsigned char *pEnd = aPacket + 64 + Random(NET_MAX_PAYLOAD - 64);
+		while(pEnd - pCur >= CVariableInt::MAX_BYTES_PACKED + 16)
+		{
+			switch(Random(8))
+			{
+			case 0:
+			case 1:
+			case 2:
+				pCur = CVariableInt::Pack(pCur, (int)Random(16) - 8, pEnd - pCur);
+				break;
+			case 3:
+				pCur = CVariableInt::Pack(pCur, (int)Random(4096) - 2048, pEnd - pCur);
+				break;
+			case 4:
+			case 5:
+			{
+				const int Zeros = 1 + Random(16);
+				mem_zero(pCur, Zeros);
+				pCur += Zeros;
+				break;
+			}
+			case 6:
+				pCur = CVariableInt::Pack(pCur, (int)(Random(1 << 16) << 12), pEnd - pCur);
+				break;
+			default:
+			{
+				const char *pText = "nameless tee";
+				str_copy((char *)pCur, pText, 16);
+				pCur += str_length(pText) + 1;
+			}
+			}
+		}
+		vPackets.emplace_back(aPacket, pCur);
+	}
+	return vPackets;
+}
+
+TEST(Huffman, CorpusCompatible)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+
+	// hash of the corpus compressed by the byte-at-a-time implementation
+	unsigned Hash = 2166136261u;
+	int TotalSize = 0;
+	for(const auto &vPacket : GenerateCorpus(500))
+	{
+		unsigned char aCompressed[NET_MAX_PAYLOAD * 2];
+		const int Size = Huffman.Compress(vPacket.data(), vPacket.size(), aCompressed, sizeof(aCompressed));
+		ASSERT_GT(Size, 0);
+		for(int i = 0; i < Size; i++)
+			Hash = (Hash ^ aCompressed[i]) * 16777619u;
+		TotalSize += Size;
+
+		unsigned char aDecompressed[NET_MAX_PAYLOAD];
+		ASSERT_EQ(Huffman.Decompress(aCompressed, Size, aDecompressed, sizeof(aDecompressed)), (int)vPacket.size());
+		ASSERT_EQ(mem_comp(aDecompressed, vPacket.data(), vPacket.size()), 0);
+	}
+	EXPECT_EQ(Hash, 0xe7393073u);
+	EXPECT_EQ(TotalSize, 278100);
+}
+
+TEST(Huffman, BufferLimits)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+
+	const std::vector<unsigned char> vPacket = GenerateCorpus(1)[0];
+	unsigned char aCompressed[NET_MAX_PAYLOAD * 2];
+	const int Size = Huffman.Compress(vPacket.data(), vPacket.size(), aCompressed, sizeof(aCompressed));
+	ASSERT_GT(Size, 0);
+	for(int OutputSize = 1; OutputSize < Size; OutputSize++)
+		EXPECT_EQ(Huffman.Compress(vPacket.data(), vPacket.size(), aCompressed, OutputSize), -1);
+	EXPECT_EQ(Huffman.Compress(vPacket.data(), vPacket.size(), aCompressed, Size), Size);
+
+	unsigned char aDecompressed[NET_MAX_PAYLOAD];
+	for(int OutputSize = 0; OutputSize < (int)vPacket.size(); OutputSize++)
+		EXPECT_EQ(Huffman.Decompress(aCompressed, Size, aDecompressed, OutputSize), -1);
+	EXPECT_EQ(Huffman.Decompress(aCompressed, Size, aDecompressed, vPacket.size()), (int)vPacket.size());
+}
+
+TEST(Huffman, Benchmark)
+{
+	CHuffman Huffman;
+	Huffman.Init();
+
+	const std::vector<std::vector<unsigned char>> vCorpus = GenerateCorpus(500);
+	std::vector<std::vector<unsigned char>> vCompressed;
+	int64_t RawBytes = 0;
+	for(const auto &vPacket : vCorpus)
+	{
+		unsigned char aCompressed[NET_MAX_PAYLOAD * 2];
+		const int Size = Huffman.Compress(vPacket.data(), vPacket.size(), aCompressed, sizeof(aCompressed));
+		ASSERT_GT(Size, 0);
+		vCompressed.emplace_back(aCompressed, aCompressed + Size);
+		RawBytes += vPacket.size();
+	}
+
+	const int Iterations = 20;
+	unsigned char aBuffer[NET_MAX_PAYLOAD * 2];
+	int64_t Start = time_get_impl();
+	for(int Iteration = 0; Iteration < Iterations; Iteration++)
+		for(const auto &vPacket : vCorpus)
+			ASSERT_GT(Huffman.Compress(vPacket.data(), vPacket.size(), aBuffer, sizeof(aBuffer)), 0);
+	const int64_t CompressTime = time_get_impl() - Start;
+
+	Start = time_get_impl();
+	for(int Iteration = 0; Iteration < Iterations; Iteration++)
+		for(const auto &vData : vCompressed)
+			ASSERT_GT(Huffman.Decompress(vData.data(), vData.size(), aBuffer, sizeof(aBuffer)), 0);
+	const int64_t DecompressTime = time_get_impl() - Start;
+
+	const double MegaBytes = (double)RawBytes * Iterations / (1024 * 1024);
+	dbg_msg("huffman", "compress=%.1fMB/s decompress=%.1fMB/s", MegaBytes * time_freq() / maximum<int64_t>(CompressTime, 1), MegaBytes * time_freq() / maximum<int64_t>(DecompressTime, 1));
+}
@@ -78,3 +78,43 @@ TEST(Io, SyncWorks)
 	EXPECT_FALSE(io_close(File));
 	EXPECT_FALSE(fs_remove(Info.m_aFilename));
 }
+
+TEST(Io, Map)
+{
+	CTestInfo Info;
+	const char aContents[] = "map me\0and the rest";
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	EXPECT_EQ(io_write(File, aContents, sizeof(aContents)), sizeof(aContents));
+	EXPECT_FALSE(io_close(File));
+
+	File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	unsigned Size;
+	const void *pData = io_map(File, &Size);
+	EXPECT_FALSE(io_close(File));
+	ASSERT_TRUE(pData);
+	// the mapping outlives the file handle
+	ASSERT_EQ(Size, sizeof(aContents));
+	EXPECT_EQ(mem_comp(pData, aContents, sizeof(aContents)), 0);
+	io_unmap(pData, Size);
+
+	fs_remove(Info.m_aFilename);
+}
+
+TEST(Io, MapEmpty)
+{
+	CTestInfo Info;
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	EXPECT_FALSE(io_close(File));
+
+	File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	unsigned Size = 1;
+	EXPECT_EQ(io_map(File, &Size), nullptr);
+	EXPECT_EQ(Size, 0u);
+	EXPECT_FALSE(io_close(File));
+
+	fs_remove(Info.m_aFilename);
+}
@@ -146,3 +146,116 @@ TEST_F(Jobs, Many)
 	}
 	new(&m_Pool) CJobPool();
 }
+
+TEST_F(Jobs, Group)
+{
+	std::atomic<int> NumDone(0);
+	CJobGroup Group;
+	for(int i = 0; i < 64; i++)
+	{
+		m_Pool.Add(std::make_shared<CJob>([&] { NumDone++; }), &Group);
+	}
+	Group.Wait();
+	EXPECT_EQ(NumDone.load(), 64);
+	EXPECT_EQ(Group.NumPending(), 0);
+
+	// the group can be reused
+	m_Pool.Add(std::make_shared<CJob>([&] { NumDone++; }), &Group);
+	Group.Wait();
+	EXPECT_EQ(NumDone.load(), 65);
+}
+
+TEST_F(Jobs, GroupDestroyedAfterWait)
+{
+	// the worker must be done with the group once Wait returns
+	std::atomic<int> NumDone(0);
+	for(int i = 0; i < 1000; i++)
+	{
+		auto pGroup = std::make_unique<CJobGroup>();
+		m_Pool.Add(std::make_shared<CJob>([&] { NumDone++; }), pGroup.get());
+		pGroup->Wait();
+	}
+	EXPECT_EQ(NumDone.load(), 1000);
+}
+
+TEST_F(Jobs, Nested)
+{
+	// jobs added by workers go to their own queue and are stolen by the others
+	std::atomic<int> NumDone(0);
+	CJobGroup Group;
+	for(int i = 0; i < TEST_NUM_THREADS; i++)
+	{
+		m_Pool.Add(std::make_shared<CJob>([&] {
+			for(int j = 0; j < 32; j++)
+				m_Pool.Add(std::make_shared<CJob>([&] { NumDone++; }), &Group);
+			NumDone++;
+		}),
+			&Group);
+	}
+	Group.Wait();
+	EXPECT_EQ(NumDone.load(), TEST_NUM_THREADS * 33);
+}
+
+TEST_F(Jobs, Priority)
+{
+	// a single blocked worker, so the queued jobs are taken in order afterwards
+	CJobPool Pool;
+	Pool.Init(1);
+	std::atomic<bool> Blocked(true);
+	CJobGroup Group;
+	Pool.Add(std::make_shared<CJob>([&] {
+		while(Blocked)
+			thread_yield();
+	}),
+		&Group);
+
+	std::vector<int> vOrder;
+	for(int i = 0; i < 8; i++)
+	{
+		Pool.Add(std::make_shared<CJob>([&vOrder, i] { vOrder.push_back(IJob::PRIORITY_NORMAL * 100 + i); }), &Group);
+		auto pHigh = std::make_shared<CJob>([&vOrder, i] { vOrder.push_back(IJob::PRIORITY_HIGH * 100 + i); });
+		pHigh->SetPriority(IJob::PRIORITY_HIGH);
+		Pool.Add(pHigh, &Group);
+	}
+
+	Blocked = false;
+	Group.Wait();
+	ASSERT_EQ(vOrder.size(), 16u);
+	for(int i = 0; i < 8; i++)
+	{
+		EXPECT_EQ(vOrder[i], IJob::PRIORITY_HIGH * 100 + i);
+		EXPECT_EQ(vOrder[8 + i], IJob::PRIORITY_NORMAL * 100 + i);
+	}
+}
+
+TEST_F(Jobs, Continuation)
+{
+	int Result = 0;
+	bool Continued = false;
+	auto pJob = std::make_shared<CJob>([&] { Result = 1; });
+	pJob->Then([&] {
+		EXPECT_EQ(Result, 1);
+		Continued = true;
+	});
+	CJobGroup Group;
+	m_Pool.Add(pJob, &Group);
+	Group.Wait();
+	EXPECT_EQ(pJob->Status(), IJob::STATE_DONE);
+	// continuations only run when the owner asks for them
+	EXPECT_FALSE(Continued);
+	m_Pool.RunContinuations();
+	EXPECT_TRUE(Continued);
+
+	Continued = false;
+	m_Pool.RunContinuations();
+	EXPECT_FALSE(Continued);
+}
+
+TEST_F(Jobs, ContinuationRunBlocking)
+{
+	bool Continued = false;
+	CJob Job([] {});
+	Job.Then([&] { Continued = true; });
+	RunBlocking(&Job);
+	EXPECT_TRUE(Continued);
+}
@@ -0,0 +1,121 @@
+#include "test.h"
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/shared/mapindex.h>
+#include <engine/storage.h>
+
+#include <memory>
+
+static void WriteMap(IStorage *pStorage, const char *pFilename, const char *pContent)
+{
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	ASSERT_TRUE(File);
+	io_write(File, pContent, str_length(pContent));
+	io_close(File);
+}
+
+static SHA256_DIGEST ContentSha256(const char *pContent)
+{
+	return sha256(pContent, str_length(pContent));
+}
+
+class MapIndex : public ::testing::Test
+{
+protected:
+	CTestInfo m_Info;
+	std::unique_ptr<IStorage> m_pStorage;
+	char m_aDownloadedFilename[IO_MAX_PATH_LENGTH];
+	SHA256_DIGEST m_DownloadedSha256;
+
+	MapIndex()
+	{
+		m_Info.m_DeleteTestStorageFilesOnSuccess = true;
+		m_pStorage = std::unique_ptr<IStorage>(m_Info.CreateTestStorage());
+		m_pStorage->CreateFolder("maps", IStorage::TYPE_SAVE);
+		m_pStorage->CreateFolder("maps/sub", IStorage::TYPE_SAVE);
+		m_pStorage->CreateFolder("downloadedmaps", IStorage::TYPE_SAVE);
+		WriteMap(m_pStorage.get(), "maps/sub/first.map", "first");
+		WriteMap(m_pStorage.get(), "maps/second.map", "second");
+
+		// downloaded maps are trusted to be named after their hash
+		char aSha256[SHA256_MAXSTRSIZE];
+		m_DownloadedSha256 = ContentSha256("not hashed");
+		sha256_str(m_DownloadedSha256, aSha256, sizeof(aSha256));
+		str_format(m_aDownloadedFilename, sizeof(m_aDownloadedFilename), "downloadedmaps/third_%s.map", aSha256);
+		WriteMap(m_pStorage.get(), m_aDownloadedFilename, "downloaded");
+	}
+
+	~MapIndex()
+	{
+		// the test storage cleanup does not descend into subfolders
+		m_pStorage->RemoveFile("maps/sub/first.map", IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFile("maps/second.map", IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFile("maps/added.map", IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFile(m_aDownloadedFilename, IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFolder("maps/sub", IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFolder("maps", IStorage::TYPE_SAVE);
+		m_pStorage->RemoveFolder("downloadedmaps", IStorage::TYPE_SAVE);
+	}
+};
+
+TEST_F(MapIndex, FindByHash)
+{
+	CMapIndex Index(m_pStorage.get());
+	char aBuf[IO_MAX_PATH_LENGTH];
+	ASSERT_TRUE(Index.Find(ContentSha256("first"), aBuf, sizeof(aBuf)));
+	EXPECT_STREQ(aBuf, "maps/sub/first.map");
+	ASSERT_TRUE(Index.Find(ContentSha256("second"), aBuf, sizeof(aBuf)));
+	EXPECT_STREQ(aBuf, "maps/second.map");
+	ASSERT_TRUE(Index.Find(m_DownloadedSha256, aBuf, sizeof(aBuf)));
+	EXPECT_STREQ(aBuf, m_aDownloadedFilename);
+	EXPECT_FALSE(Index.Find(ContentSha256("downloaded"), aBuf, sizeof(aBuf)));
+	EXPECT_FALSE(Index.Find(ContentSha256("missing"), aBuf, sizeof(aBuf)));
+	EXPECT_EQ(Index.NumScans(), 1);
+}
+
+TEST_F(MapIndex, Persistent)
+{
+	char aBuf[IO_MAX_PATH_LENGTH];
+	{
+		CMapIndex Index(m_pStorage.get());
+		ASSERT_TRUE(Index.Find(ContentSha256("first"), aBuf, sizeof(aBuf)));
+	}
+
+	CMapIndex Index(m_pStorage.get());
+	ASSERT_TRUE(Index.Find(ContentSha256("second"), aBuf, sizeof(aBuf)));
+	EXPECT_STREQ(aBuf, "maps/second.map");
+	ASSERT_TRUE(Index.Find(m_DownloadedSha256, aBuf, sizeof(aBuf)));
+	EXPECT_EQ(Index.NumScans(), 0);
+
+	// a changed file is not returned for its old hash
+	WriteMap(m_pStorage.get(), "maps/second.map", "changed second");
+	EXPECT_FALSE(Index.Find(ContentSha256("second"), aBuf, sizeof(aBuf)));
+	ASSERT_TRUE(Index.Find(ContentSha256("changed second"), aBuf, sizeof(aBuf)));
+	EXPECT_STREQ(aBuf, "maps/second.map");
+	EXPECT_EQ(Index.NumScans(), 1);
+}
+
+TEST_F(MapIndex, Add)
+{
+	char aBuf[IO_MAX_PATH_LENGTH];
+	CMapIndex Index(m_pStorage.get());
+	ASSERT_TRUE(Index.Find(ContentSha256("first"), aBuf, sizeof(aBuf)));
+
+	// the folders are only walked once, new maps have to be added
+	WriteMap(m_pStorage.get(), "maps/added.map", "added");
+	EXPECT_FALSE(Index.Find(ContentSha256("added"), aBuf, sizeof(aBuf)));
+	Index.Add("maps/added.map", ContentSha256("added"));
+	ASSERT_TRUE(Index.Find(ContentSha256("added"), aBuf, sizeof(aBuf)));
+	EXPECT_STREQ(aBuf, "maps/added.map");
+	EXPECT_EQ(Index.NumScans(), 1);
+
+	// files outside of the map folders are not indexed
+	Index.Add("mapindex.txt", ContentSha256("ignored"));
+	EXPECT_FALSE(Index.Find(ContentSha256("ignored"), aBuf, sizeof(aBuf)));
+
+	// the added map is in the index file
+	CMapIndex Reloaded(m_pStorage.get());
+	ASSERT_TRUE(Reloaded.Find(ContentSha256("added"), aBuf, sizeof(aBuf)));
+	EXPECT_EQ(Reloaded.NumScans(), 0);
+}
@@ -48,3 +48,49 @@ TEST(Net, Ipv4AndIpv6Work)
 	net_udp_close(Socket1);
 	net_udp_close(Socket2);
 }
+
+TEST(Net, SendBatching)
+{
+	NETADDR Bindaddr = {};
+	NETSOCKET Socket1;
+	NETSOCKET Socket2;
+
+	Bindaddr.type = NETTYPE_IPV4;
+	Socket2 = net_udp_create(Bindaddr);
+	do
+	{
+		Bindaddr.port = secure_rand() % 64511 + 1024;
+	} while(!(Socket1 = net_udp_create(Bindaddr)));
+
+	NETADDR Target;
+	ASSERT_FALSE(net_addr_from_str(&Target, "127.0.0.1"));
+	Target.port = Bindaddr.port;
+
+	net_udp_set_send_batching(Socket2, true);
+
+	// few enough packets to not overflow the receive buffer
+	const int NUM_PACKETS = 64;
+	for(int i = 0; i < NUM_PACKETS; i++)
+		EXPECT_EQ(net_udp_send(Socket2, &Target, &i, sizeof(i)), (int)sizeof(i));
+	net_udp_flush(Socket2);
+
+	// the receiving side reads all of them at once
+	NETADDR Addr;
+	unsigned char *pData;
+	EXPECT_EQ(net_socket_read_wait(Socket1, 10000000), 1);
+	for(int i = 0; i < NUM_PACKETS; i++)
+	{
+		ASSERT_EQ(net_udp_recv(Socket1, &Addr, &pData), (int)sizeof(i));
+		EXPECT_EQ(mem_comp(pData, &i, sizeof(i)), 0);
+	}
+
+	// disabling sends the rest right away
+	EXPECT_EQ(net_udp_send(Socket2, &Target, "abc", 3), 3);
+	net_udp_set_send_batching(Socket2, false);
+	EXPECT_EQ(net_socket_read_wait(Socket1, 10000000), 1);
+	ASSERT_EQ(net_udp_recv(Socket1, &Addr, &pData), 3);
+	EXPECT_EQ(mem_comp(pData, "abc", 3), 0);
+
+	net_udp_close(Socket1);
+	net_udp_close(Socket2);
+}
@@ -1,3 +1,4 @@
+#include "test.h"
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -9,6 +10,9 @@
 
 #include <sqlite3.h>
 
+#include <chrono>
+#include <thread>
+
 #if defined(CONF_TEST_MYSQL)
 int DummyMysqlInit = (MysqlInit(), 1);
 #endif
@@ -36,6 +40,114 @@ TEST(SQLite, Version)
 	ASSERT_GE(sqlite3_libversion_number(), 3025000) << "SQLite >= 3.25.0 required for Window functions";
 }
 
+TEST(RankingIndex, Ranks)
+{
+	CRankingIndex Ranking;
+	EXPECT_TRUE(Ranking.Add("a", 20.0f));
+	EXPECT_TRUE(Ranking.Add("b", 10.0f));
+	EXPECT_TRUE(Ranking.Add("c", 20.0f));
+	EXPECT_TRUE(Ranking.Add("d", 30.0f));
+	ASSERT_EQ(Ranking.Num(), 4);
+
+	// equal times share a rank like RANK()
+	EXPECT_EQ(Ranking.Rank(10.0f), 1);
+	EXPECT_EQ(Ranking.Rank(20.0f), 2);
+	EXPECT_EQ(Ranking.Rank(30.0f), 4);
+	EXPECT_FLOAT_EQ(Ranking.PercentRank(1), 0.0f);
+	EXPECT_FLOAT_EQ(Ranking.PercentRank(4), 1.0f);
+	EXPECT_STREQ(Ranking.Entry(0).m_aName, "b");
+	EXPECT_STREQ(Ranking.Entry(1).m_aName, "a");
+	EXPECT_STREQ(Ranking.Entry(2).m_aName, "c");
+	EXPECT_FALSE(Ranking.BestTime("e").has_value());
+}
+
+TEST(RankingIndex, Improve)
+{
+	CRankingIndex Ranking;
+	EXPECT_TRUE(Ranking.Add("a", 20.0f));
+	EXPECT_TRUE(Ranking.Add("b", 10.0f));
+	EXPECT_FALSE(Ranking.Add("a", 25.0f));
+	EXPECT_FALSE(Ranking.Add("a", 20.0f));
+	EXPECT_TRUE(Ranking.Add("a", 5.0f));
+	ASSERT_EQ(Ranking.Num(), 2);
+	ASSERT_TRUE(Ranking.BestTime("a").has_value());
+	EXPECT_EQ(*Ranking.BestTime("a"), 5.0f);
+	EXPECT_STREQ(Ranking.Entry(0).m_aName, "a");
+	EXPECT_EQ(Ranking.Rank(*Ranking.BestTime("b")), 2);
+
+	Ranking.Clear();
+	EXPECT_EQ(Ranking.Num(), 0);
+	EXPECT_FALSE(Ranking.BestTime("a").has_value());
+	EXPECT_FLOAT_EQ(Ranking.PercentRank(1), 0.0f);
+}
+
+static void WaitForResult(const std::shared_ptr<ISqlResult> &pResult)
+{
+	for(int i = 0; i < 1000 && !pResult->m_Completed; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	ASSERT_TRUE(pResult->m_Completed);
+}
+
+TEST(DbConnectionPool, ReadWorkersAndWriteBatches)
+{
+	CTestInfo Info;
+	char aFilename[256];
+	Info.Filename(aFilename, sizeof(aFilename), ".sqlite");
+	{
+		CDbConnectionPool Pool;
+		Pool.SetNumReadWorkers(4);
+		Pool.RegisterSqliteDatabase(CDbConnectionPool::READ, aFilename);
+		Pool.RegisterSqliteDatabase(CDbConnectionPool::WRITE, aFilename);
+
+		// queued at once, so the write worker executes most of them in batches
+		std::vector<std::shared_ptr<CScorePlayerResult>> vpWrites;
+		for(int i = 0; i < 20; i++)
+		{
+			vpWrites.push_back(std::make_shared<CScorePlayerResult>());
+			auto pData = std::make_unique<CSqlScoreData>(vpWrites.back());
+			str_copy(pData->m_aMap, "Kobra 3", sizeof(pData->m_aMap));
+			str_copy(pData->m_aGameUuid, "8d300ecf-5873-4297-bee5-95668fdff320", sizeof(pData->m_aGameUuid));
+			str_format(pData->m_aName, sizeof(pData->m_aName), "player %d", i);
+			pData->m_ClientID = 0;
+			pData->m_Time = 100.0f + i;
+			str_copy(pData->m_aTimestamp, "2021-11-24 19:24:08", sizeof(pData->m_aTimestamp));
+			for(float &TimeCp : pData->m_aCurrentTimeCp)
+				TimeCp = 0;
+			str_copy(pData->m_aRequestingPlayer, pData->m_aName, sizeof(pData->m_aRequestingPlayer));
+			Pool.ExecuteWrite(CScoreWorker::SaveScore, std::move(pData), "save score");
+		}
+		for(auto &pWrite : vpWrites)
+		{
+			WaitForResult(pWrite);
+			EXPECT_TRUE(pWrite->m_Success);
+		}
+
+		g_Config.m_SvRegionalRankings = false;
+		g_Config.m_SvHideScore = false;
+		std::vector<std::shared_ptr<CScorePlayerResult>> vpReads;
+		for(int i = 0; i < 20; i++)
+		{
+			vpReads.push_back(std::make_shared<CScorePlayerResult>());
+			auto pRequest = std::make_unique<CSqlPlayerRequest>(vpReads.back());
+			str_copy(pRequest->m_aMap, "Kobra 3", sizeof(pRequest->m_aMap));
+			str_format(pRequest->m_aName, sizeof(pRequest->m_aName), "player %d", i);
+			str_copy(pRequest->m_aRequestingPlayer, pRequest->m_aName, sizeof(pRequest->m_aRequestingPlayer));
+			str_copy(pRequest->m_aServer, "GER", sizeof(pRequest->m_aServer));
+			pRequest->m_Offset = 0;
+			Pool.Execute(CScoreWorker::ShowRank, std::move(pRequest), "show rank");
+		}
+		for(int i = 0; i < 20; i++)
+		{
+			WaitForResult(vpReads[i]);
+			EXPECT_TRUE(vpReads[i]->m_Success);
+			char aRank[32];
+			str_format(aRank, sizeof(aRank), "Global rank %d", i + 1);
+			EXPECT_STREQ(vpReads[i]->m_Data.m_aaMessages[1], aRank);
+		}
+	}
+	fs_remove(aFilename);
+}
+
 struct Score : public testing::TestWithParam<IDbConnection *>
 {
 	Score()
@@ -107,6 +219,32 @@ struct Score : public testing::TestWithParam<IDbConnection *>
 		ASSERT_FALSE(CScoreWorker::SaveScore(m_pConn, &ScoreData, Write::NORMAL, m_aError, sizeof(m_aError))) << m_aError;
 	}
 
+	void InsertRankAs(const char *pName, float Time)
+	{
+		CSqlScoreData ScoreData(std::make_shared<CScorePlayerResult>());
+		str_copy(ScoreData.m_aMap, "Kobra 3", sizeof(ScoreData.m_aMap));
+		str_copy(ScoreData.m_aGameUuid, "8d300ecf-5873-4297-bee5-95668fdff320", sizeof(ScoreData.m_aGameUuid));
+		str_copy(ScoreData.m_aName, pName, sizeof(ScoreData.m_aName));
+		ScoreData.m_ClientID = 0;
+		ScoreData.m_Time = Time;
+		str_copy(ScoreData.m_aTimestamp, "2021-11-24 19:24:08", sizeof(ScoreData.m_aTimestamp));
+		for(float &TimeCp : ScoreData.m_aCurrentTimeCp)
+			TimeCp = 0;
+		str_copy(ScoreData.m_aRequestingPlayer, pName, sizeof(ScoreData.m_aRequestingPlayer));
+		ASSERT_FALSE(CScoreWorker::SaveScore(m_pConn, &ScoreData, Write::NORMAL, m_aError, sizeof(m_aError))) << m_aError;
+	}
+
+	void LoadRankings(CScoreLoadBestTimeResult *pRankings, const char *pServer)
+	{
+		auto pResult = std::make_shared<CScoreLoadBestTimeResult>();
+		CSqlLoadBestTimeData LoadBestTimeData(pResult);
+		str_copy(LoadBestTimeData.m_aMap, "Kobra 3", sizeof(LoadBestTimeData.m_aMap));
+		str_copy(LoadBestTimeData.m_aServer, pServer, sizeof(LoadBestTimeData.m_aServer));
+		ASSERT_FALSE(CScoreWorker::LoadBestTime(m_pConn, &LoadBestTimeData, m_aError, sizeof(m_aError))) << m_aError;
+		pRankings->m_GlobalRanking = std::move(pResult->m_GlobalRanking);
+		pRankings->m_RegionalRanking = std::move(pResult->m_RegionalRanking);
+	}
+
 	void ExpectLines(const std::shared_ptr<CScorePlayerResult> &pPlayerResult, std::initializer_list<const char *> Lines, bool All = false)
 	{
 		EXPECT_EQ(pPlayerResult->m_MessageKind, All ? CScorePlayerResult::ALL : CScorePlayerResult::DIRECT);
@@ -278,6 +416,51 @@ TEST_P(SingleScore, TimesDoesntExist)
 	ExpectLines(m_pPlayerResult, {"There are no times in the specified range"});
 }
 
+TEST_P(SingleScore, RankFromIndex)
+{
+	g_Config.m_SvRegionalRankings = true;
+	InsertRank(80.0);
+	str_copy(m_PlayerRequest.m_aName, "brainless tee", sizeof(m_PlayerRequest.m_aName));
+	InsertRankAs("brainless tee", 90.0);
+	InsertRankAs("brainless tee", 120.0);
+	CScoreLoadBestTimeResult Rankings;
+	LoadRankings(&Rankings, "USA");
+	str_copy(m_PlayerRequest.m_aServer, "USA", sizeof(m_PlayerRequest.m_aServer));
+
+	ASSERT_FALSE(CScoreWorker::ShowRank(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+	auto pIndexResult = std::make_shared<CScorePlayerResult>();
+	CScoreWorker::ShowRankFromIndex(Rankings.m_GlobalRanking, Rankings.m_RegionalRanking, &m_PlayerRequest, pIndexResult.get());
+	EXPECT_EQ(pIndexResult->m_MessageKind, m_pPlayerResult->m_MessageKind);
+	for(int i = 0; i < CScorePlayerResult::MAX_MESSAGES; i++)
+		EXPECT_STREQ(pIndexResult->m_Data.m_aaMessages[i], m_pPlayerResult->m_Data.m_aaMessages[i]);
+	ExpectLines(pIndexResult, {"brainless tee - 01:30.00 - better than 0%", "Global rank 2 - USA rank 2"}, true);
+
+	str_copy(m_PlayerRequest.m_aName, "foo", sizeof(m_PlayerRequest.m_aName));
+	pIndexResult = std::make_shared<CScorePlayerResult>();
+	CScoreWorker::ShowRankFromIndex(Rankings.m_GlobalRanking, Rankings.m_RegionalRanking, &m_PlayerRequest, pIndexResult.get());
+	ExpectLines(pIndexResult, {"foo is not ranked"});
+}
+
+TEST_P(SingleScore, TopFromIndex)
+{
+	g_Config.m_SvRegionalRankings = true;
+	InsertRankAs("brainless tee", 90.0);
+	InsertRankAs("finishless", 110.0);
+	CScoreLoadBestTimeResult Rankings;
+	LoadRankings(&Rankings, "GER");
+
+	for(int Offset : {1, 2, -1})
+	{
+		m_PlayerRequest.m_Offset = Offset;
+		m_pPlayerResult->SetVariant(CScorePlayerResult::DIRECT);
+		ASSERT_FALSE(CScoreWorker::ShowTop(m_pConn, &m_PlayerRequest, m_aError, sizeof(m_aError))) << m_aError;
+		auto pIndexResult = std::make_shared<CScorePlayerResult>();
+		CScoreWorker::ShowTopFromIndex(Rankings.m_GlobalRanking, Rankings.m_RegionalRanking, &m_PlayerRequest, pIndexResult.get());
+		for(int i = 0; i < CScorePlayerResult::MAX_MESSAGES; i++)
+			EXPECT_STREQ(pIndexResult->m_Data.m_aaMessages[i], m_pPlayerResult->m_Data.m_aaMessages[i]) << "offset " << Offset;
+	}
+}
+
 struct TeamScore : public Score
 {
 	void SetUp() override
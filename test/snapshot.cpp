@@ -0,0 +1,259 @@
+#include <gtest/gtest.h>
+
+#include <base/hash.h>
+#include <base/system.h>
+#include <engine/shared/snapshot.h>
+
+#include <initializer_list>
+#include <vector>
+
+static void AddSnapshot(CSnapshotStorage *pStorage, int Tick, int Size)
+{
+	char aData[CSnapshot::MAX_SIZE];
+	for(int i = 0; i < Size; i++)
+		aData[i] = (char)(Tick + i);
+	pStorage->Add(Tick, Tick, Size, aData, 0, nullptr);
+}
+
+static void ExpectSnapshot(CSnapshotStorage *pStorage, int Tick, int Size)
+{
+	int64_t Tagtime;
+	const CSnapshot *pData;
+	ASSERT_EQ(pStorage->Get(Tick, &Tagtime, &pData, nullptr), Size);
+	EXPECT_EQ(Tagtime, Tick);
+	for(int i = 0; i < Size; i++)
+		ASSERT_EQ(((const char *)pData)[i], (char)(Tick + i));
+}
+
+TEST(SnapshotStorage, AddGetPurge)
+{
+	CSnapshotStorage Storage;
+	for(int Tick = 100; Tick < 110; Tick++)
+		AddSnapshot(&Storage, Tick, 64 + Tick);
+	for(int Tick = 100; Tick < 110; Tick++)
+		ExpectSnapshot(&Storage, Tick, 64 + Tick);
+	EXPECT_EQ(Storage.Get(99, nullptr, nullptr, nullptr), -1);
+	EXPECT_EQ(Storage.Get(110, nullptr, nullptr, nullptr), -1);
+
+	Storage.PurgeUntil(105);
+	EXPECT_EQ(Storage.m_pFirst->m_Tick, 105);
+	EXPECT_EQ(Storage.m_pLast->m_Tick, 109);
+	EXPECT_EQ(Storage.Get(104, nullptr, nullptr, nullptr), -1);
+	ExpectSnapshot(&Storage, 105, 64 + 105);
+
+	Storage.PurgeAll();
+	EXPECT_EQ(Storage.m_pFirst, nullptr);
+	EXPECT_EQ(Storage.Get(105, nullptr, nullptr, nullptr), -1);
+}
+
+TEST(SnapshotStorage, Wraparound)
+{
+	// keep a window of snapshots while the ticks go around the ring a few times
+	CSnapshotStorage Storage;
+	for(int Tick = 0; Tick < 2000; Tick++)
+	{
+		AddSnapshot(&Storage, Tick, 16 + Tick % 300);
+		Storage.PurgeUntil(Tick - 150);
+		ExpectSnapshot(&Storage, Tick, 16 + Tick % 300);
+		if(Tick >= 150)
+			ExpectSnapshot(&Storage, Tick - 150, 16 + (Tick - 150) % 300);
+	}
+}
+
+TEST(SnapshotStorage, LargeWindow)
+{
+	// more snapshots than the ring has slots
+	CSnapshotStorage Storage;
+	for(int Tick = 0; Tick < 1000; Tick++)
+		AddSnapshot(&Storage, Tick, 32);
+	for(int Tick = 0; Tick < 1000; Tick++)
+		ExpectSnapshot(&Storage, Tick, 32);
+
+	int Num = 0;
+	for(CSnapshotStorage::CHolder *pHolder = Storage.m_pFirst; pHolder; pHolder = pHolder->m_pNext)
+		EXPECT_EQ(pHolder->m_Tick, Num++);
+	EXPECT_EQ(Num, 1000);
+
+	Storage.PurgeUntil(900);
+	EXPECT_EQ(Storage.Get(899, nullptr, nullptr, nullptr), -1);
+	for(int Tick = 900; Tick < 1000; Tick++)
+		ExpectSnapshot(&Storage, Tick, 32);
+	for(int Tick = 1000; Tick < 1300; Tick++)
+		AddSnapshot(&Storage, Tick, 48);
+	for(int Tick = 1000; Tick < 1300; Tick++)
+		ExpectSnapshot(&Storage, Tick, 48);
+}
+
+TEST(SnapshotStorage, SpareHolders)
+{
+	// a few purged holders are kept for the next snapshots, not one per tick
+	CSnapshotStorage Storage;
+	for(int Tick = 0; Tick < 1000; Tick++)
+	{
+		AddSnapshot(&Storage, Tick, 2000 + Tick % 3000);
+		Storage.PurgeUntil(Tick - 10);
+		ExpectSnapshot(&Storage, Tick, 2000 + Tick % 3000);
+		EXPECT_LE(Storage.NumSpareHolders(), 1);
+	}
+	Storage.PurgeUntil(2000);
+	EXPECT_EQ(Storage.NumSpareHolders(), 8);
+	AddSnapshot(&Storage, 2000, 4000);
+	EXPECT_EQ(Storage.NumSpareHolders(), 7);
+	ExpectSnapshot(&Storage, 2000, 4000);
+
+	Storage.PurgeAll();
+	EXPECT_EQ(Storage.NumSpareHolders(), 0);
+}
+
+TEST(SnapshotStorage, AltSnapshot)
+{
+	CSnapshotStorage Storage;
+	const char aData[] = "snapshot";
+	const char aAltData[] = "alternative snapshot";
+	Storage.Add(5, 0, sizeof(aData), aData, sizeof(aAltData), aAltData);
+
+	const CSnapshot *pData;
+	const CSnapshot *pAltData;
+	ASSERT_EQ(Storage.Get(5, nullptr, &pData, &pAltData), (int)sizeof(aData));
+	EXPECT_EQ(mem_comp(pData, aData, sizeof(aData)), 0);
+	EXPECT_EQ(mem_comp(pAltData, aAltData, sizeof(aAltData)), 0);
+	EXPECT_EQ(Storage.m_pLast->m_AltSnapSize, (int)sizeof(aAltData));
+}
+
+// unpacked snapshots have the same items, not necessarily in the same order
+static void ExpectSameItems(const CSnapshot *pSnap, const CSnapshot *pExpected)
+{
+	ASSERT_EQ(pSnap->NumItems(), pExpected->NumItems());
+	for(int i = 0; i < pExpected->NumItems(); i++)
+	{
+		const int Index = pSnap->GetItemIndex(pExpected->GetItem(i)->Key());
+		ASSERT_NE(Index, -1);
+		ASSERT_EQ(pSnap->GetItemSize(Index), pExpected->GetItemSize(i));
+		EXPECT_EQ(mem_comp(pSnap->GetItem(Index)->Data(), pExpected->GetItem(i)->Data(), pExpected->GetItemSize(i)), 0);
+	}
+}
+
+static void AddItem(CSnapshotBuilder *pBuilder, int Type, int ID, std::initializer_list<int> Data)
+{
+	int *pItem = (int *)pBuilder->NewItem(Type, ID, Data.size() * sizeof(int));
+	for(int Value : Data)
+		*pItem++ = Value;
+}
+
+TEST(SnapshotDelta, CreateDeltaWireFormat)
+{
+	CSnapshotDelta Delta;
+	Delta.SetStaticsize(5, 4 * sizeof(int));
+
+	char aFrom[CSnapshot::MAX_SIZE];
+	char aTo[CSnapshot::MAX_SIZE];
+	CSnapshotBuilder Builder;
+	Builder.Init();
+	AddItem(&Builder, 1, 0, {1, 2, 3});
+	AddItem(&Builder, 1, 1, {4, 5, 6});
+	AddItem(&Builder, 2, 0, {8, 9});
+	AddItem(&Builder, 5, 3, {10, 11, 12, 13});
+	AddItem(&Builder, 5, 4, {20, 21, 22, 23});
+	Builder.Finish(aFrom);
+	Builder.Init();
+	AddItem(&Builder, 5, 9, {0, 0, 0, 0}); // added, static size
+	AddItem(&Builder, 1, 0, {1, 2, 3}); // unchanged
+	AddItem(&Builder, 3, 7, {-1, 100000}); // added
+	AddItem(&Builder, 1, 1, {4, 7, 6}); // changed
+	AddItem(&Builder, 5, 3, {10, 11, -12, 13}); // changed, static size
+	AddItem(&Builder, 5, 4, {20, 21, 22, 23}); // unchanged, static size
+	const int ToSize = Builder.Finish(aTo);
+
+	// as created by the implementation before the hash table rewrite
+	const int aExpected[] = {
+		1, 4, 0, // deleted, updated, temp
+		2 << 16 | 0, // deleted keys
+		5, 9, 0, 0, 0, 0, // type, id, data
+		3, 7, 2, -1, 100000, // type, id, size, data
+		1, 1, 3, 0, 2, 0,
+		5, 3, 0, 0, -24, 0};
+	char aDelta[CSnapshot::MAX_SIZE];
+	ASSERT_EQ(Delta.CreateDelta((CSnapshot *)aFrom, (CSnapshot *)aTo, aDelta), (int)sizeof(aExpected));
+	EXPECT_EQ(mem_comp(aDelta, aExpected, sizeof(aExpected)), 0);
+
+	char aUnpacked[CSnapshot::MAX_SIZE];
+	ASSERT_EQ(Delta.UnpackDelta((CSnapshot *)aFrom, (CSnapshot *)aUnpacked, aDelta, sizeof(aExpected)), ToSize);
+	ExpectSameItems((CSnapshot *)aUnpacked, (CSnapshot *)aTo);
+}
+
+TEST(SnapshotDelta, CreateDeltaWireFormatRandom)
+{
+	CSnapshotDelta Delta;
+	for(int Type = 0; Type < 64; Type++)
+		Delta.SetStaticsize(Type, Type % 3 ? (Type % 7 + 1) * sizeof(int) : 0);
+
+	class CItem
+	{
+	public:
+		int m_Type;
+		int m_ID;
+		int m_Size;
+		int m_aData[16];
+	};
+	unsigned Seed = 1;
+	int NextID = 0;
+	auto Random = [&Seed]() {
+		Seed = Seed * 1103515245 + 12345;
+		return Seed >> 8;
+	};
+	auto RandomItem = [&Random, &NextID]() {
+		CItem Item;
+		Item.m_Type = Random() % 40 + 1;
+		Item.m_ID = NextID++;
+		Item.m_Size = Item.m_Type % 3 ? Item.m_Type % 7 + 1 : Random() % 16;
+		for(int &Data : Item.m_aData)
+			Data = Random() % 100;
+		return Item;
+	};
+	std::vector<CItem> vItems;
+	for(int i = 0; i < 600; i++)
+		vItems.push_back(RandomItem());
+
+	// the deltas of many ticks with removed, added, changed and unchanged
+	// items, with and without static sizes
+	char aaSnapshots[2][CSnapshot::MAX_SIZE];
+	char aDelta[CSnapshot::MAX_SIZE];
+	char aUnpacked[CSnapshot::MAX_SIZE];
+	CSnapshotBuilder Builder;
+	Builder.Init();
+	Builder.Finish(aaSnapshots[0]);
+	std::vector<unsigned char> vDeltas;
+	for(int Tick = 0; Tick < 100; Tick++)
+	{
+		for(auto &Item : vItems)
+			if(Random() % 4 == 0)
+				Item.m_aData[Random() % 16] += Random() % 3 - 1;
+		if(Random() % 3 == 0)
+			vItems.erase(vItems.begin() + Random() % vItems.size());
+		if(Random() % 3 == 0)
+			vItems.push_back(RandomItem());
+
+		Builder.Init();
+		for(const auto &Item : vItems)
+		{
+			int *pData = (int *)Builder.NewItem(Item.m_Type, Item.m_ID, Item.m_Size * sizeof(int));
+			if(pData)
+				mem_copy(pData, Item.m_aData, Item.m_Size * sizeof(int));
+		}
+		CSnapshot *pFrom = (CSnapshot *)aaSnapshots[Tick % 2];
+		CSnapshot *pTo = (CSnapshot *)aaSnapshots[(Tick + 1) % 2];
+		const int ToSize = Builder.Finish(pTo);
+		const int DeltaSize = Delta.CreateDelta(pFrom, pTo, aDelta);
+		ASSERT_GT(DeltaSize, 0);
+		vDeltas.insert(vDeltas.end(), (unsigned char *)&DeltaSize, (unsigned char *)(&DeltaSize + 1));
+		vDeltas.insert(vDeltas.end(), (unsigned char *)aDelta, (unsigned char *)aDelta + DeltaSize);
+
+		ASSERT_EQ(Delta.UnpackDelta(pFrom, (CSnapshot *)aUnpacked, aDelta, DeltaSize), ToSize);
+		ExpectSameItems((CSnapshot *)aUnpacked, pTo);
+	}
+
+	// as created by the implementation before the hash table rewrite
+	char aSha256[SHA256_MAXSTRSIZE];
+	sha256_str(sha256(vDeltas.data(), vDeltas.size()), aSha256, sizeof(aSha256));
+	EXPECT_STREQ(aSha256, "8c62226a806e96a41f1a3c458cfb703c340536452119b9a2cdc6a12a3086f0b1");
+}
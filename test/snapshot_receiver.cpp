@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+
+#include <base/system.h>
+#include <engine/client/snapshot_receiver.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/snapshot.h>
+
+static int BuildSnapshot(int Tick, CSnapshot *pSnap)
+{
+	CSnapshotBuilder Builder;
+	Builder.Init();
+	for(int i = 0; i < 16; i++)
+	{
+		int *pItem = (int *)Builder.NewItem(1 + i % 3, i, 8 * sizeof(int));
+		for(int j = 0; j < 8; j++)
+			pItem[j] = (i * 8 + j) * (j % 2 ? Tick : 1);
+	}
+	return Builder.Finish(pSnap);
+}
+
+class SnapshotReceiver : public ::testing::TestWithParam<bool>
+{
+protected:
+	CSnapshotReceiver m_Receiver;
+	CSnapshotDelta m_SnapshotDelta;
+	char m_aaSnapshots[8][CSnapshot::MAX_SIZE];
+	int m_aSnapSizes[8];
+
+	SnapshotReceiver()
+	{
+		// the alternative snapshot is a plain copy
+		m_Receiver.Init([](const CSnapshot *pFrom, CSnapshot *pTo) {
+			CSnapshotBuilder Builder;
+			Builder.Init();
+			for(int i = 0; i < pFrom->NumItems(); i++)
+			{
+				const CSnapshotItem *pItem = pFrom->GetItem(i);
+				void *pObj = Builder.NewItem(pItem->Type(), pItem->ID(), pFrom->GetItemSize(i));
+				mem_copy(pObj, pItem->Data(), pFrom->GetItemSize(i));
+			}
+			return Builder.Finish(pTo);
+		},
+			GetParam());
+		for(int Tick = 0; Tick < 8; Tick++)
+			m_aSnapSizes[Tick] = BuildSnapshot(Tick + 1, (CSnapshot *)m_aaSnapshots[Tick]);
+	}
+
+	CSnapshot *Snap(int Tick) { return (CSnapshot *)m_aaSnapshots[Tick - 1]; }
+
+	bool PushSnapshot(int Conn, int Tick, int DeltaTick, int64_t RecvTime = 0)
+	{
+		const CSnapshot *pDeltaShot = DeltaTick >= 0 ? Snap(DeltaTick) : CSnapshot::EmptySnapshot();
+		char aDelta[CSnapshot::MAX_SIZE];
+		char aCompressed[CSnapshot::MAX_SIZE];
+		const int DeltaSize = m_SnapshotDelta.CreateDelta(pDeltaShot, Snap(Tick), aDelta);
+		const int CompressedSize = DeltaSize ? CVariableInt::Compress(aDelta, DeltaSize, aCompressed, sizeof(aCompressed)) : 0;
+		return m_Receiver.PushSnapshot(Conn, Tick, DeltaTick, Snap(Tick)->Crc(), false, RecvTime, aCompressed, CompressedSize);
+	}
+
+	const CSnapshotReceiver::CResult *WaitResult()
+	{
+		const int64_t Timeout = time_get() + time_freq() * 10;
+		const CSnapshotReceiver::CResult *pResult;
+		while(!(pResult = m_Receiver.Peek()) && time_get() < Timeout)
+			thread_yield();
+		return pResult;
+	}
+
+	void ExpectSnapshot(int Conn, int Tick, int64_t RecvTime = 0)
+	{
+		const CSnapshotReceiver::CResult *pResult = WaitResult();
+		ASSERT_TRUE(pResult);
+		ASSERT_EQ(pResult->m_Type, CSnapshotReceiver::RESULT_SNAPSHOT);
+		EXPECT_EQ(pResult->m_Conn, Conn);
+		EXPECT_EQ(pResult->m_GameTick, Tick);
+		EXPECT_EQ(pResult->m_RecvTime, RecvTime);
+		ASSERT_EQ(pResult->m_SnapSize, m_aSnapSizes[Tick - 1]);
+		EXPECT_EQ(mem_comp(pResult->Snap(), Snap(Tick), pResult->m_SnapSize), 0);
+		ASSERT_EQ(pResult->m_AltSnapSize, m_aSnapSizes[Tick - 1]);
+		EXPECT_EQ(mem_comp(pResult->AltSnap(), Snap(Tick), pResult->m_AltSnapSize), 0);
+		m_Receiver.Pop();
+	}
+};
+
+TEST_P(SnapshotReceiver, Deltas)
+{
+	ASSERT_TRUE(PushSnapshot(0, 1, -1, 100));
+	ASSERT_TRUE(PushSnapshot(1, 1, -1));
+	ASSERT_TRUE(PushSnapshot(0, 2, 1, 200));
+	ASSERT_TRUE(PushSnapshot(0, 3, 1, 300));
+	ASSERT_TRUE(PushSnapshot(0, 4, 3, 400));
+	ExpectSnapshot(0, 1, 100);
+	ExpectSnapshot(1, 1);
+	ExpectSnapshot(0, 2, 200);
+	ExpectSnapshot(0, 3, 300);
+	ExpectSnapshot(0, 4, 400);
+
+	// handed over again before it was acked
+	ASSERT_TRUE(PushSnapshot(0, 4, 3));
+	// the delta snapshot was purged
+	ASSERT_TRUE(PushSnapshot(0, 5, 1));
+	const CSnapshotReceiver::CResult *pResult = WaitResult();
+	ASSERT_TRUE(pResult);
+	EXPECT_EQ(pResult->m_Type, CSnapshotReceiver::RESULT_MISSING_DELTA);
+	EXPECT_EQ(pResult->m_GameTick, 5);
+	m_Receiver.Pop();
+	EXPECT_FALSE(m_Receiver.Peek());
+}
+
+TEST_P(SnapshotReceiver, CrcError)
+{
+	char aCompressed[CSnapshot::MAX_SIZE];
+	char aDelta[CSnapshot::MAX_SIZE];
+	const int DeltaSize = m_SnapshotDelta.CreateDelta(CSnapshot::EmptySnapshot(), Snap(1), aDelta);
+	const int CompressedSize = CVariableInt::Compress(aDelta, DeltaSize, aCompressed, sizeof(aCompressed));
+	ASSERT_TRUE(m_Receiver.PushSnapshot(0, 1, -1, Snap(1)->Crc() + 1, false, 0, aCompressed, CompressedSize));
+	const CSnapshotReceiver::CResult *pResult = WaitResult();
+	ASSERT_TRUE(pResult);
+	EXPECT_EQ(pResult->m_Type, CSnapshotReceiver::RESULT_CRC_ERROR);
+	EXPECT_EQ(pResult->m_GotCrc, Snap(1)->Crc());
+	EXPECT_EQ(pResult->m_DataSize, CompressedSize);
+	m_Receiver.Pop();
+
+	// nothing was kept as delta
+	ASSERT_TRUE(PushSnapshot(0, 2, 1));
+	pResult = WaitResult();
+	ASSERT_TRUE(pResult);
+	EXPECT_EQ(pResult->m_Type, CSnapshotReceiver::RESULT_MISSING_DELTA);
+	m_Receiver.Pop();
+}
+
+TEST_P(SnapshotReceiver, MessagesInOrder)
+{
+	const char aMessage[] = "message";
+	ASSERT_TRUE(PushSnapshot(0, 1, -1));
+	ASSERT_TRUE(m_Receiver.PushMessage(0, aMessage, sizeof(aMessage)));
+	ASSERT_TRUE(PushSnapshot(0, 2, 1));
+	ExpectSnapshot(0, 1);
+	const CSnapshotReceiver::CResult *pResult = WaitResult();
+	ASSERT_TRUE(pResult);
+	ASSERT_EQ(pResult->m_Type, CSnapshotReceiver::RESULT_MESSAGE);
+	ASSERT_EQ(pResult->m_DataSize, (int)sizeof(aMessage));
+	EXPECT_STREQ((const char *)pResult->Message(), aMessage);
+	m_Receiver.Pop();
+	ExpectSnapshot(0, 2);
+}
+
+TEST_P(SnapshotReceiver, Reset)
+{
+	ASSERT_TRUE(PushSnapshot(0, 1, -1));
+	ASSERT_TRUE(PushSnapshot(1, 1, -1));
+	m_Receiver.Reset(0);
+
+	// results of the old connection are skipped, the other one is untouched
+	ExpectSnapshot(1, 1);
+	EXPECT_FALSE(m_Receiver.Peek());
+
+	ASSERT_TRUE(PushSnapshot(0, 2, 1));
+	ASSERT_TRUE(PushSnapshot(0, 1, -1));
+	const CSnapshotReceiver::CResult *pResult = WaitResult();
+	ASSERT_TRUE(pResult);
+	EXPECT_EQ(pResult->m_Type, CSnapshotReceiver::RESULT_MISSING_DELTA);
+	m_Receiver.Pop();
+	ExpectSnapshot(0, 1);
+}
+
+TEST_P(SnapshotReceiver, Burst)
+{
+	// more results than fit into the queue, the thread waits for room
+	for(int i = 0; i < 200; i++)
+	{
+		ASSERT_TRUE(PushSnapshot(0, i % 8 + 1, -1));
+		m_Receiver.Reset(0);
+		if(!GetParam())
+			EXPECT_FALSE(m_Receiver.Peek());
+	}
+	ASSERT_TRUE(PushSnapshot(0, 1, -1));
+	ExpectSnapshot(0, 1);
+	EXPECT_EQ(m_Receiver.NumDropped(), 0);
+}
+
+TEST_P(SnapshotReceiver, ReadyResults)
+{
+	for(int Tick = 1; Tick <= 8; Tick++)
+		ASSERT_TRUE(PushSnapshot(0, Tick, Tick > 1 ? Tick - 1 : -1));
+
+	// take what is ready every frame like PumpNetwork, the data rates can be
+	// read while the thread unpacks
+	const int64_t Timeout = time_get() + time_freq() * 10;
+	int NumSnapshots = 0;
+	while(NumSnapshots < 8 && time_get() < Timeout)
+	{
+		EXPECT_GE(m_Receiver.SnapshotDelta()->GetDataRate(1), 0);
+		const CSnapshotReceiver::CResult *pResult;
+		while((pResult = m_Receiver.Peek()))
+		{
+			EXPECT_EQ(pResult->m_Type, CSnapshotReceiver::RESULT_SNAPSHOT);
+			EXPECT_EQ(pResult->m_GameTick, ++NumSnapshots);
+			m_Receiver.Pop();
+		}
+		thread_yield();
+	}
+	EXPECT_EQ(NumSnapshots, 8);
+	EXPECT_EQ(m_Receiver.SnapshotDelta()->GetDataUpdates(1), 8 * 6);
+}
+
+INSTANTIATE_TEST_SUITE_P(Threaded, SnapshotReceiver, ::testing::Values(false, true));
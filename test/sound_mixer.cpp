@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+
+#include <base/math.h>
+#include <engine/client/sound_mixer.h>
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+static std::vector<short> Noise(size_t Size)
+{
+	std::vector<short> vSamples(Size);
+	unsigned State = 1;
+	for(auto &Sample : vSamples)
+	{
+		State = State * 1103515245 + 12345;
+		Sample = (short)(State >> 16);
+	}
+	return vSamples;
+}
+
+static CSoundMixer::CVoiceParams DefaultParams()
+{
+	CSoundMixer::CVoiceParams Params;
+	Params.m_Vol = 255;
+	Params.m_Flags = 0;
+	Params.m_X = 0;
+	Params.m_Y = 0;
+	Params.m_Falloff = 0.0f;
+	Params.m_Shape = ISound::SHAPE_CIRCLE;
+	Params.m_Circle.m_Radius = 1500;
+	return Params;
+}
+
+TEST(SoundMixer, MixKernels)
+{
+	const std::vector<short> vIn = Noise(2 * 67);
+	for(unsigned Frames : {0, 1, 3, 4, 8, 15, 16, 67})
+	{
+		std::vector<int> vMono(2 * Frames, 7);
+		std::vector<int> vStereo(2 * Frames, -7);
+		CSoundMixer::MixMono(vMono.data(), vIn.data(), Frames, 255, 32767);
+		CSoundMixer::MixStereo(vStereo.data(), vIn.data(), Frames, 13, 0);
+		for(unsigned i = 0; i < Frames; i++)
+		{
+			EXPECT_EQ(vMono[2 * i], 7 + vIn[i] * 255);
+			EXPECT_EQ(vMono[2 * i + 1], 7 + vIn[i] * 32767);
+			EXPECT_EQ(vStereo[2 * i], -7 + vIn[2 * i] * 13);
+			EXPECT_EQ(vStereo[2 * i + 1], -7);
+		}
+	}
+}
+
+TEST(SoundMixer, Clip)
+{
+	std::vector<int> vIn = {0, 1, -1, 25856, -25856, 255, 1 << 20, -(1 << 20), std::numeric_limits<int>::max(), std::numeric_limits<int>::min(), 123456789, -987654321, 25855, 3};
+	std::vector<short> vOut(vIn.size());
+	for(int MasterVol : {0, 50, 100})
+	{
+		CSoundMixer::Clip(vOut.data(), vIn.data(), vIn.size(), MasterVol);
+		for(size_t i = 0; i < vIn.size(); i++)
+		{
+			const int64_t Expected = clamp<int64_t>(((int64_t)vIn[i] * MasterVol / 101) >> 8, std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+			EXPECT_NEAR(vOut[i], Expected, 1) << vIn[i] << " " << MasterVol;
+		}
+	}
+}
+
+class SoundMixerVoices : public ::testing::Test
+{
+protected:
+	std::unique_ptr<CSoundMixer> m_pMixer = std::make_unique<CSoundMixer>();
+	std::vector<short> m_vSample = Noise(1000);
+	std::vector<short> m_vOut;
+
+	SoundMixerVoices()
+	{
+		m_pMixer->Init(64);
+		m_pMixer->SetChannel(0, 255, 0);
+	}
+
+	void Mix(unsigned Frames)
+	{
+		m_vOut.assign(2 * Frames, 1);
+		m_pMixer->Mix(m_vOut.data(), Frames);
+	}
+
+	short Expected(int Tick) const
+	{
+		return (short)((m_vSample[Tick] * 255 * 100 / 101) >> 8);
+	}
+};
+
+TEST_F(SoundMixerVoices, PlayUntilFinished)
+{
+	m_pMixer->Play(3, 42, m_vSample.data(), m_vSample.size(), 1, 0, 0, DefaultParams());
+	int Tick;
+	EXPECT_FALSE(m_pMixer->Position(3, 42, &Tick));
+
+	// larger than the mix buffer
+	Mix(200);
+	for(int i = 0; i < 200; i++)
+	{
+		EXPECT_NEAR(m_vOut[2 * i], Expected(i), 1);
+		EXPECT_NEAR(m_vOut[2 * i + 1], Expected(i), 1);
+	}
+	ASSERT_TRUE(m_pMixer->Position(3, 42, &Tick));
+	EXPECT_EQ(Tick, 200);
+	EXPECT_FALSE(m_pMixer->Finished(3, 42));
+
+	Mix(900);
+	EXPECT_TRUE(m_pMixer->Finished(3, 42));
+	EXPECT_NEAR(m_vOut[2 * 799], Expected(999), 1);
+	EXPECT_EQ(m_vOut[2 * 800], 0);
+	EXPECT_EQ(m_vOut[2 * 899 + 1], 0);
+}
+
+TEST_F(SoundMixerVoices, Loop)
+{
+	CSoundMixer::CVoiceParams Params = DefaultParams();
+	Params.m_Flags = ISound::FLAG_LOOP;
+	m_pMixer->Play(0, 1, m_vSample.data(), m_vSample.size(), 1, 0, 990, Params);
+	Mix(20);
+	EXPECT_NEAR(m_vOut[2 * 9], Expected(999), 1);
+	EXPECT_NEAR(m_vOut[2 * 10], Expected(0), 1);
+	EXPECT_NEAR(m_vOut[2 * 19], Expected(9), 1);
+	EXPECT_FALSE(m_pMixer->Finished(0, 1));
+}
+
+TEST_F(SoundMixerVoices, Commands)
+{
+	const std::vector<short> vStereo = Noise(2 * 100);
+	m_pMixer->Play(0, 1, vStereo.data(), 100, 2, 0, 0, DefaultParams());
+	m_pMixer->Seek(0, 1, 50);
+	CSoundMixer::CVoiceParams Params = DefaultParams();
+	Params.m_Vol = 0;
+	m_pMixer->SetParams(0, 1, Params);
+	// commands for an earlier playback of the voice are ignored
+	m_pMixer->Stop(0, 0);
+	const uint64_t Sequence = m_pMixer->Sequence();
+	EXPECT_FALSE(m_pMixer->Reached(Sequence));
+
+	Mix(10);
+	EXPECT_TRUE(m_pMixer->Reached(Sequence));
+	for(short Sample : m_vOut)
+		EXPECT_EQ(Sample, 0);
+	int Tick;
+	ASSERT_TRUE(m_pMixer->Position(0, 1, &Tick));
+	EXPECT_EQ(Tick, 60);
+
+	m_pMixer->Stop(0, 1);
+	Mix(10);
+	ASSERT_TRUE(m_pMixer->Position(0, 1, &Tick));
+	EXPECT_EQ(Tick, 60);
+	EXPECT_FALSE(m_pMixer->Finished(0, 1));
+}
+
+TEST_F(SoundMixerVoices, Position)
+{
+	m_pMixer->SetChannel(0, 255, 255);
+	m_pMixer->SetListenerPos(100, 0);
+	CSoundMixer::CVoiceParams Params = DefaultParams();
+	Params.m_Flags = ISound::FLAG_POS;
+	Params.m_Falloff = 1.0f;
+	Params.m_X = 1100;
+	m_pMixer->Play(0, 1, m_vSample.data(), m_vSample.size(), 1, 0, 0, Params);
+	// too far away
+	Params.m_X = 5000;
+	m_pMixer->Play(1, 2, m_vSample.data(), m_vSample.size(), 1, 0, 0, Params);
+	Mix(4);
+	for(int i = 0; i < 4; i++)
+	{
+		// to the right, the left side is quieter
+		EXPECT_NEAR(m_vOut[2 * i + 1], Expected(i), 1);
+		EXPECT_NEAR(m_vOut[2 * i], (short)((m_vSample[i] * ((1500 - 1000) * 255 / 1500) * 100 / 101) >> 8), 1);
+	}
+	int Tick;
+	ASSERT_TRUE(m_pMixer->Position(1, 2, &Tick));
+	EXPECT_EQ(Tick, 4);
+}
+
+TEST_F(SoundMixerVoices, Overflow)
+{
+	// nothing is mixed for a while
+	for(int i = 0; i < 10000; i++)
+		m_pMixer->Seek(0, 1, i % 100);
+	m_pMixer->Play(0, 1, m_vSample.data(), m_vSample.size(), 1, 0, 0, DefaultParams());
+	m_pMixer->Seek(0, 1, 500);
+	const uint64_t Sequence = m_pMixer->Sequence();
+
+	for(int i = 0; i < 10 && !m_pMixer->Reached(Sequence); i++)
+	{
+		Mix(1);
+		m_pMixer->Flush();
+	}
+	EXPECT_TRUE(m_pMixer->Reached(Sequence));
+	int Tick;
+	ASSERT_TRUE(m_pMixer->Position(0, 1, &Tick));
+	EXPECT_EQ(Tick, 501);
+}
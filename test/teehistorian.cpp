@@ -1,3 +1,4 @@
+#include "test.h"
 #include <gtest/gtest.h>
 
 #include <base/detect.h>
@@ -21,6 +22,8 @@ protected:
 	CTeeHistorian::CGameInfo m_GameInfo;
 
 	std::vector<unsigned char> m_vBuffer;
+	ASYNCIO *m_pCompressedFile = nullptr;
+	int m_CurrentTick = 0;
 
 	enum
 	{
@@ -93,6 +96,8 @@ protected:
 	{
 		TeeHistorian *pThis = (TeeHistorian *)pUser;
 		WriteBuffer(pThis->m_vBuffer, pData, DataSize);
+		if(pThis->m_pCompressedFile)
+			CTeeHistorianCompressor::QueueWrite(pThis->m_pCompressedFile, pThis->m_CurrentTick, pData, DataSize);
 	}
 
 	void Reset(const CTeeHistorian::CGameInfo *pGameInfo)
@@ -179,6 +184,7 @@ protected:
 
 	void Tick(int Tick)
 	{
+		m_CurrentTick = Tick;
 		if(m_State == STATE_PLAYERS)
 		{
 			Inputs();
@@ -223,6 +229,27 @@ protected:
 		Char.m_Y = y;
 		m_TH.RecordPlayer(ClientID, &Char);
 	}
+
+	// records enough ticks for several blocks into a compressed file
+	void RecordCompressed(const char *pFilename, CTeeHistorianCompressor *pCompressor)
+	{
+		IOHANDLE File = io_open(pFilename, IOFLAG_WRITE);
+		ASSERT_TRUE(File);
+		m_pCompressedFile = aio_new_filtered(File, CTeeHistorianCompressor::AioWrite, CTeeHistorianCompressor::AioFinish, pCompressor);
+		Reset(&m_GameInfo);
+		for(int t = 1; t <= 30000; t++)
+		{
+			Tick(t);
+			for(int i = 0; i < 8; i++)
+				Player(i, (t * (i + 1)) % 1000, (t * 7 + i * 13) % 500);
+		}
+		Finish();
+		aio_close(m_pCompressedFile);
+		aio_wait(m_pCompressedFile);
+		EXPECT_EQ(aio_error(m_pCompressedFile), 0);
+		aio_free(m_pCompressedFile);
+		m_pCompressedFile = nullptr;
+	}
 };
 
 TEST_F(TeeHistorian, Empty)
@@ -857,3 +884,129 @@ TEST_F(TeeHistorian, PrevGameUuid)
 	EXPECT_STREQ(JsonPrevGameUuid, "fe19c218-f555-4002-a273-126c59ccc17a");
 	json_value_free(pJson);
 }
+
+TEST_F(TeeHistorian, Compressed)
+{
+	CTestInfo Info;
+	CTeeHistorianCompressor Compressor;
+	RecordCompressed(Info.m_aFilename, &Compressor);
+	const std::vector<CTeeHistorianCompressor::CBlockInfo> &vIndex = Compressor.Index();
+	ASSERT_GT(vIndex.size(), 1u);
+
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	EXPECT_TRUE(CTeeHistorianReader::IsCompressed(File));
+	CTeeHistorianReader Reader;
+	ASSERT_TRUE(Reader.Open(File));
+	ASSERT_EQ(Reader.Index().size(), vIndex.size());
+	for(size_t i = 0; i < vIndex.size(); i++)
+	{
+		EXPECT_EQ(Reader.Index()[i].m_Offset, vIndex[i].m_Offset);
+		EXPECT_EQ(Reader.Index()[i].m_FirstTick, vIndex[i].m_FirstTick);
+		EXPECT_EQ(Reader.Index()[i].m_LastTick, vIndex[i].m_LastTick);
+		// no tick is split between blocks
+		if(i > 0)
+			EXPECT_GT(vIndex[i].m_FirstTick, vIndex[i - 1].m_LastTick);
+	}
+
+	std::vector<unsigned char> vData;
+	ASSERT_TRUE(Reader.ReadAll(vData));
+	EXPECT_TRUE(vData == m_vBuffer);
+
+	const int Block = Reader.FindBlock(20000);
+	ASSERT_GE(Block, 0);
+	EXPECT_LE(vIndex[Block].m_FirstTick, 20000);
+	EXPECT_GE(vIndex[Block].m_LastTick, 20000);
+	EXPECT_EQ(Reader.FindBlock(30001), -1);
+	EXPECT_TRUE(Reader.ReadBlock(Block, vData));
+
+	io_close(File);
+	fs_remove(Info.m_aFilename);
+}
+
+TEST_F(TeeHistorian, CompressedUnfinished)
+{
+	CTestInfo Info;
+	CTeeHistorianCompressor Compressor;
+	RecordCompressed(Info.m_aFilename, &Compressor);
+	const std::vector<CTeeHistorianCompressor::CBlockInfo> &vIndex = Compressor.Index();
+	ASSERT_GT(vIndex.size(), 1u);
+
+	// cut the file in the middle of the last block, losing the index
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	std::vector<unsigned char> vFile(vIndex.back().m_Offset + 20);
+	ASSERT_EQ(io_read(File, vFile.data(), vFile.size()), vFile.size());
+	io_close(File);
+	File = io_open(Info.m_aFilename, IOFLAG_WRITE);
+	ASSERT_TRUE(File);
+	io_write(File, vFile.data(), vFile.size());
+	io_close(File);
+
+	File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	CTeeHistorianReader Reader;
+	ASSERT_TRUE(Reader.Open(File));
+	ASSERT_EQ(Reader.Index().size(), vIndex.size() - 1);
+	EXPECT_EQ(Reader.Index().back().m_LastTick, vIndex[vIndex.size() - 2].m_LastTick);
+
+	std::vector<unsigned char> vData;
+	ASSERT_TRUE(Reader.ReadAll(vData));
+	ASSERT_LT(vData.size(), m_vBuffer.size());
+	EXPECT_EQ(mem_comp(vData.data(), m_vBuffer.data(), vData.size()), 0);
+
+	io_close(File);
+	fs_remove(Info.m_aFilename);
+}
+
+TEST_F(TeeHistorian, CompressedCorrupt)
+{
+	CTestInfo Info;
+	CTeeHistorianCompressor Compressor;
+	RecordCompressed(Info.m_aFilename, &Compressor);
+	const std::vector<CTeeHistorianCompressor::CBlockInfo> &vIndex = Compressor.Index();
+	ASSERT_GT(vIndex.size(), 1u);
+
+	IOHANDLE File = io_open(Info.m_aFilename, IOFLAG_READ);
+	ASSERT_TRUE(File);
+	std::vector<unsigned char> vFile(io_length(File));
+	ASSERT_EQ(io_read(File, vFile.data(), vFile.size()), vFile.size());
+	io_close(File);
+
+	const auto &&WriteFile = [&](const std::vector<unsigned char> &vData) {
+		IOHANDLE Out = io_open(Info.m_aFilename, IOFLAG_WRITE);
+		ASSERT_TRUE(Out);
+		io_write(Out, vData.data(), vData.size());
+		io_close(Out);
+	};
+
+	// block count in the footer that doesn't fit the file
+	{
+		std::vector<unsigned char> vCorrupt = vFile;
+		uint_to_bytes_be(vCorrupt.data() + vCorrupt.size() - CTeeHistorianCompressor::FOOTER_SIZE, 0xffffffff);
+		WriteFile(vCorrupt);
+		File = io_open(Info.m_aFilename, IOFLAG_READ);
+		ASSERT_TRUE(File);
+		CTeeHistorianReader Reader;
+		EXPECT_FALSE(Reader.Open(File));
+		io_close(File);
+	}
+
+	// block sizes beyond the file and the maximum block size
+	for(unsigned SizeOffset : {0, 4})
+	{
+		std::vector<unsigned char> vCorrupt = vFile;
+		uint_to_bytes_be(vCorrupt.data() + vIndex[0].m_Offset + SizeOffset, 0xfffffff0);
+		WriteFile(vCorrupt);
+		File = io_open(Info.m_aFilename, IOFLAG_READ);
+		ASSERT_TRUE(File);
+		CTeeHistorianReader Reader;
+		ASSERT_TRUE(Reader.Open(File));
+		std::vector<unsigned char> vData;
+		EXPECT_FALSE(Reader.ReadBlock(0, vData));
+		EXPECT_TRUE(Reader.ReadBlock(1, vData));
+		io_close(File);
+	}
+
+	fs_remove(Info.m_aFilename);
+}
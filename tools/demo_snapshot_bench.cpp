@@ -0,0 +1,135 @@
+#include <base/logger.h>
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/network.h>
+#include <engine/shared/snapshot.h>
+#include <engine/storage.h>
+
+#include <vector>
+
+static const char *TOOL_NAME = "demo_snapshot_bench";
+
+class CSnapshotCollector : public CDemoPlayer::IListener
+{
+public:
+	std::vector<std::vector<char>> m_vSnapshots;
+
+	void OnDemoPlayerSnapshot(void *pData, int Size) override
+	{
+		const char *pBytes = (const char *)pData;
+		m_vSnapshots.emplace_back(pBytes, pBytes + Size);
+	}
+
+	void OnDemoPlayerMessage(void *pData, int Size) override {}
+};
+
+int Process(const char *pDemoFilePath, IStorage *pStorage, int Iterations)
+{
+	CSnapshotDelta DemoSnapshotDelta;
+	CDemoPlayer DemoPlayer(&DemoSnapshotDelta, false);
+
+	if(DemoPlayer.Load(pStorage, nullptr, pDemoFilePath, IStorage::TYPE_ALL_OR_ABSOLUTE) == -1)
+	{
+		dbg_msg(TOOL_NAME, "Demo file '%s' failed to load: %s", pDemoFilePath, DemoPlayer.ErrorMessage());
+		return -1;
+	}
+
+	CSnapshotCollector Collector;
+	DemoPlayer.SetListener(&Collector);
+
+	const CDemoPlayer::CPlaybackInfo *pInfo = DemoPlayer.Info();
+	CNetBase::Init();
+	DemoPlayer.Play();
+
+	while(DemoPlayer.IsPlaying())
+	{
+		DemoPlayer.Update(false);
+		if(pInfo->m_Info.m_Paused)
+			break;
+	}
+
+	DemoPlayer.Stop();
+
+	const int NumSnapshots = Collector.m_vSnapshots.size();
+	if(NumSnapshots < 2)
+	{
+		dbg_msg(TOOL_NAME, "Demo file '%s' contains too few snapshots", pDemoFilePath);
+		return -1;
+	}
+
+	// encode and decode every snapshot against its predecessor, like the
+	// server and the client do for consecutive ticks
+	CSnapshotDelta SnapshotDelta;
+	static char s_aDeltaData[CSnapshot::MAX_SIZE];
+	static char s_aSnapshotData[CSnapshot::MAX_SIZE];
+	int64_t CreateTime = 0;
+	int64_t UnpackTime = 0;
+	int64_t DeltaBytes = 0;
+	int NumDeltas = 0;
+	for(int Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		for(int i = 1; i < NumSnapshots; i++)
+		{
+			const CSnapshot *pFrom = (const CSnapshot *)Collector.m_vSnapshots[i - 1].data();
+			CSnapshot *pTo = (CSnapshot *)Collector.m_vSnapshots[i].data();
+
+			int64_t Start = time_get();
+			const int DeltaSize = SnapshotDelta.CreateDelta(pFrom, pTo, s_aDeltaData);
+			CreateTime += time_get() - Start;
+			if(DeltaSize <= 0)
+				continue;
+
+			Start = time_get();
+			const int SnapSize = SnapshotDelta.UnpackDelta(pFrom, (CSnapshot *)s_aSnapshotData, s_aDeltaData, DeltaSize);
+			UnpackTime += time_get() - Start;
+			if(SnapSize < 0)
+			{
+				dbg_msg(TOOL_NAME, "Failed to unpack delta of snapshot %d: %d", i, SnapSize);
+				return -1;
+			}
+			// the item order may differ from the recorded snapshot, compare the checksums
+			if(((CSnapshot *)s_aSnapshotData)->Crc() != pTo->Crc())
+			{
+				dbg_msg(TOOL_NAME, "Delta of snapshot %d does not round-trip", i);
+				return -1;
+			}
+
+			DeltaBytes += DeltaSize;
+			NumDeltas++;
+		}
+	}
+
+	if(NumDeltas == 0)
+	{
+		dbg_msg(TOOL_NAME, "All snapshots of '%s' are identical", pDemoFilePath);
+		return 0;
+	}
+
+	const double Freq = time_freq();
+	dbg_msg(TOOL_NAME, "snapshots=%d deltas=%d avg_delta_size=%.1f", NumSnapshots, NumDeltas, (double)DeltaBytes / NumDeltas);
+	dbg_msg(TOOL_NAME, "create_delta=%.2fus unpack_delta=%.2fus", CreateTime * 1000000.0 / Freq / NumDeltas, UnpackTime * 1000000.0 / Freq / NumDeltas);
+	return 0;
+}
+
+int main(int argc, const char *argv[])
+{
+	IStorage *pStorage = CreateLocalStorage();
+	if(!pStorage)
+	{
+		dbg_msg(TOOL_NAME, "Error loading storage");
+		return -1;
+	}
+
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	if(argc != 2 && argc != 3)
+	{
+		dbg_msg(TOOL_NAME, "Usage: %s <demo_filename> [iterations]", TOOL_NAME);
+		return -1;
+	}
+
+	const int Iterations = argc == 3 ? maximum(str_toint(argv[2]), 1) : 10;
+	return Process(argv[1], pStorage, Iterations);
+}
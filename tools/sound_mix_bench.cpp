@@ -0,0 +1,83 @@
+#include <base/logger.h>
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/client/sound_mixer.h>
+
+#include <vector>
+
+static const char *TOOL_NAME = "sound_mix_bench";
+
+// mixes synthetic voices like a busy game does, without an audio device
+int Process(int NumVoices, int NumBuffers, unsigned BufferFrames)
+{
+	static CSoundMixer s_Mixer;
+	s_Mixer.Init(BufferFrames);
+	s_Mixer.SetChannel(0, 255, 255);
+	s_Mixer.SetListenerPos(0, 0);
+
+	// one second of noise in mono and stereo
+	const int NumFrames = 48000;
+	std::vector<short> vMono(NumFrames);
+	std::vector<short> vStereo(NumFrames * 2);
+	for(auto &Sample : vMono)
+		Sample = (short)(rand() % 65536 - 32768);
+	for(auto &Sample : vStereo)
+		Sample = (short)(rand() % 65536 - 32768);
+
+	CSoundMixer::CVoiceParams Params;
+	Params.m_Vol = 255;
+	Params.m_Flags = ISound::FLAG_POS | ISound::FLAG_LOOP;
+	Params.m_Falloff = 0.5f;
+	Params.m_Shape = ISound::SHAPE_CIRCLE;
+	Params.m_Circle.m_Radius = 1500;
+	for(int i = 0; i < NumVoices; i++)
+	{
+		// some voices are too far away to be heard
+		Params.m_X = (i * 97) % 2000 - 1000;
+		Params.m_Y = (i * 31) % 2000 - 1000;
+		const bool Stereo = i % 2;
+		s_Mixer.Play(i, i, Stereo ? vStereo.data() : vMono.data(), NumFrames, Stereo ? 2 : 1, 0, (i * 1013) % NumFrames, Params);
+	}
+
+	std::vector<short> vOut(BufferFrames * 2);
+	int64_t MixTime = 0;
+	int64_t MaxMixTime = 0;
+	for(int Buffer = 0; Buffer < NumBuffers; Buffer++)
+	{
+		// the game thread keeps moving the voices
+		for(int i = 0; i < NumVoices; i += 4)
+		{
+			Params.m_X = ((i + Buffer) * 97) % 2000 - 1000;
+			s_Mixer.SetParams(i, i, Params);
+		}
+
+		const int64_t Start = time_get();
+		s_Mixer.Mix(vOut.data(), BufferFrames);
+		const int64_t Time = time_get() - Start;
+		MixTime += Time;
+		MaxMixTime = maximum(MaxMixTime, Time);
+	}
+
+	const double Freq = time_freq();
+	const double BufferDuration = BufferFrames / 48000.0;
+	dbg_msg(TOOL_NAME, "voices=%d buffers=%d frames=%u", NumVoices, NumBuffers, BufferFrames);
+	dbg_msg(TOOL_NAME, "mix=%.2fus max=%.2fus load=%.2f%%", MixTime * 1000000.0 / Freq / NumBuffers, MaxMixTime * 1000000.0 / Freq, MixTime / Freq / NumBuffers / BufferDuration * 100.0);
+	return 0;
+}
+
+int main(int argc, const char *argv[])
+{
+	CCmdlineFix CmdlineFix(&argc, &argv);
+	log_set_global_logger_default();
+
+	if(argc > 4)
+	{
+		dbg_msg(TOOL_NAME, "Usage: %s [voices] [buffers] [frames]", TOOL_NAME);
+		return -1;
+	}
+
+	const int NumVoices = argc >= 2 ? clamp(str_toint(argv[1]), 1, (int)CSoundMixer::NUM_VOICES) : CSoundMixer::NUM_VOICES;
+	const int NumBuffers = argc >= 3 ? maximum(str_toint(argv[2]), 1) : 10000;
+	const unsigned BufferFrames = argc >= 4 ? clamp(str_toint(argv[3]), 64, 8192) : 512;
+	return Process(NumVoices, NumBuffers, BufferFrames);
+}